@@ -23,6 +23,7 @@
 #include "FemmReader.h"
 #include "stringTools.h"
 #include "make_unique.h"
+#include "parallelTools.h"
 
 #include <cassert>
 #include <cmath>
@@ -56,22 +57,14 @@ femm::ParserResult ElectrostaticsPostProcessor::parseSolution(std::istream &inpu
     int k;
     // read in meshnodes;
     parseValue(input, k, err);
-    meshnodes.reserve(k);
-    for(int i=0;i<k;i++)
-    {
-        meshnodes.push_back(MAKE_UNIQUE<CSMeshNode>(CSMeshNode::fromStream(input,err)));
-    }
+    parseRecords<CSMeshNode>(input, k, meshnodes, err, [](CSMeshNode &){});
 
     // read in elements;
     parseValue(input, k, err);
-    meshelems.reserve(k);
-    auto &labellist = problem->labellist;
-    for(int i=0;i<k;i++)
-    {
-        CHSElement elm = CHSElement::fromStream(input,err);
+    const auto &labellist = problem->labellist;
+    parseRecords<CHSElement>(input, k, meshelems, err, [&labellist](CHSElement &elm) {
         elm.blk = labellist[elm.lbl]->BlockType;
-        meshelems.push_back(MAKE_UNIQUE<CHSElement>(elm));
-    }
+    });
 
     // read in circuit data;
     auto &circproplist = problem->circproplist;
@@ -118,10 +111,15 @@ bool ElectrostaticsPostProcessor::OpenDocument(std::string solutionFile)
                 e->rsqr=b;
         }
     }
+    buildElementGrid();
+    buildLabelElements();
+    buildNodeTree();
 
     // Find flux density in each element;
-    for(int i=0;i<(int)meshelems.size();i++)
-        getElementD(i);
+    parallelFor((int)meshelems.size(), [this](int begin, int end) {
+        for(int i=begin;i<end;i++)
+            getElementD(i);
+    });
 
     // Find extreme values of A;
     CSMeshNode *node = reinterpret_cast<CSMeshNode*>(meshnodes[0].get());
@@ -187,11 +185,13 @@ bool ElectrostaticsPostProcessor::OpenDocument(std::string solutionFile)
     PlotBounds[0][0]=d_PlotBounds[0][0];
     PlotBounds[0][1]=d_PlotBounds[0][1];
 
-    for(int i=0;i<(int)meshelems.size();i++)
-    {
-        auto elem = reinterpret_cast<CHSElement*>(meshelems[i].get());
-        getNodalD(elem->d,i);
-    }
+    parallelFor((int)meshelems.size(), [this](int begin, int end) {
+        for(int i=begin;i<end;i++)
+        {
+            auto elem = reinterpret_cast<CHSElement*>(meshelems[i].get());
+            getNodalD(elem->d,i);
+        }
+    });
 
     // Find extreme values of D and E;
     const auto &labellist = problem->labellist;
@@ -267,132 +267,150 @@ bool ElectrostaticsPostProcessor::OpenDocument(std::string solutionFile)
 
 CComplex ElectrostaticsPostProcessor::blockIntegral(int inttype) const
 {
+    // the contributions of the elements are summed using several threads;
+    // the partial sums are combined in a fixed order, independent of the number of threads.
     CComplex result=0;
-    for(int i=0;i<(int)meshelems.size();i++)
+    if(inttype<5)
     {
-        auto elem = getMeshElement(i);
-        if((problem->labellist[elem->lbl]->IsSelected) && (inttype<5))
-        {
-            double R=0; // for axisymmetric problems
-            // compute some useful quantities employed by most integrals...
-            double a=ElmArea(i)*sqr(LengthConv[problem->LengthUnits]);
-            if(problem->problemType==AXISYMMETRIC){
-                double r[3];
-                for(int k=0;k<3;k++)
-                    r[k]=meshnodes[elem->p[k]]->x*LengthConv[problem->LengthUnits];
-                R=(r[0]+r[1]+r[2])/3.;
-            }
+        std::vector<int> elements = selectedElements();
+        result = parallelSum<CComplex>((int)elements.size(), [this,inttype,&elements](int q) {
+            return selectedBlockIntegrand(inttype, elements[q]);
+        });
+    }
+    else
+    {
+        // integrals that need to be evaluated over all elements,
+        // regardless of which elements are actually selected.
+        result = parallelSum<CComplex>((int)meshelems.size(), [this,inttype](int i) {
+            return blockIntegrand(inttype, i);
+        });
+    }
 
-            // now, compute the desired integral;
-            switch(inttype)
-            {
-            case 0: // stored energy
-                if(problem->problemType==AXISYMMETRIC)
-                    a*=(2.*PI*R);
-                else
-                    a*=problem->Depth;
-                result+=a*Re(elem->D*conj(E(elem)))/2.;
-                break;
+    // Integrals 3 and 4 are averages over the selected volume;
+    // Need to divide by the block volme to get the average.
+    if((inttype==3) || (inttype==4)) result/=blockIntegral(2);
 
-            case 1: // cross-section area
-                result+=a;
-                break;
+    return result;
+}
 
-            case 2: // volume
-                if(problem->problemType==AXISYMMETRIC)
-                    a*=(2.*PI*R);
-                else
-                    a*=problem->Depth;
-                result+=a;
-                break;
+CComplex ElectrostaticsPostProcessor::selectedBlockIntegrand(int inttype, int i) const
+{
+    auto elem = getMeshElement(i);
+    CComplex result=0;
+    double R=0; // for axisymmetric problems
+    // compute some useful quantities employed by most integrals...
+    double a=ElmArea(i)*sqr(LengthConv[problem->LengthUnits]);
+    if(problem->problemType==AXISYMMETRIC){
+        double r[3];
+        for(int k=0;k<3;k++)
+            r[k]=meshnodes[elem->p[k]]->x*LengthConv[problem->LengthUnits];
+        R=(r[0]+r[1]+r[2])/3.;
+    }
 
-            case 3: // D
-                if(problem->problemType==AXISYMMETRIC)
-                    a*=(2.*PI*R);
-                else
-                    a*=problem->Depth;
-                result+=a*elem->D;
-                break;
-
-            case 4: // E
-                if(problem->problemType==AXISYMMETRIC)
-                    a*=(2.*PI*R);
-                else a*=problem->Depth;
-                result+=a*E(elem);
-                break;
-
-            default:
-                break;
-            }
-        }
+    // now, compute the desired integral;
+    switch(inttype)
+    {
+    case 0: // stored energy
+        if(problem->problemType==AXISYMMETRIC)
+            a*=(2.*PI*R);
+        else
+            a*=problem->Depth;
+        result=a*Re(elem->D*conj(E(elem)))/2.;
+        break;
 
-        // integrals that need to be evaluated over all elements,
-        // regardless of which elements are actually selected.
-        if(inttype>4)
-        {
-            double a=ElmArea(i)*sqr(LengthConv[problem->LengthUnits]);
-            if(problem->problemType==AXISYMMETRIC){
-                double r[3];
-                for(int k=0;k<3;k++)
-                    r[k]=meshnodes[elem->p[k]]->x*LengthConv[problem->LengthUnits];
-                double R=(r[0]+r[1]+r[2])/3.;
-                a*=(2.*PI*R);
-            }
-            else a*=problem->Depth;
+    case 1: // cross-section area
+        result=a;
+        break;
 
-            switch(inttype)
-            {
-            case 5:
-            {
-                double B1=Re(elem->D);
-                double B2=Im(elem->D);
-                CComplex c=HenrotteVector(i);
-
-                // x (or r) direction Henrotte force, SS part.
-                double y;
-                if(problem->problemType==PLANAR){
-                    y=(((B1*B1) - (B2*B2))*Re(c) + 2.*(B1*B2)*Im(c))/(2.*eo)*AECF(elem);
-                    result.re += (a*y);
-                } else {
-                    // y (or z) direction Henrotte force, SS part
-                    y=(((B2*B2) - (B1*B1))*Im(c) + 2.*(B1*B2)*Re(c))/(2.*eo)*AECF(elem);
-                }
-                result.im += (a*y);
-                break;
-            }
+    case 2: // volume
+        if(problem->problemType==AXISYMMETRIC)
+            a*=(2.*PI*R);
+        else
+            a*=problem->Depth;
+        result=a;
+        break;
 
-            case 6: // Henrotte torque, SS part.
-            {
-                if(problem->problemType!=PLANAR) break;
-                double B1=Re(elem->D);
-                double B2=Im(elem->D);
-                CComplex c=HenrotteVector(i);
+    case 3: // D
+        if(problem->problemType==AXISYMMETRIC)
+            a*=(2.*PI*R);
+        else
+            a*=problem->Depth;
+        result=a*elem->D;
+        break;
 
-                double F1 = (((B1*B1) - (B2*B2))*Re(c) +
-                      2.*(B1*B2)*Im(c))/(2.*eo);
-                double F2 = (((B2*B2) - (B1*B1))*Im(c) +
-                      2.*(B1*B2)*Re(c))/(2.*eo);
+    case 4: // E
+        if(problem->problemType==AXISYMMETRIC)
+            a*=(2.*PI*R);
+        else a*=problem->Depth;
+        result=a*E(elem);
+        break;
 
-                c=0;
-                for(int k=0;k<3;k++)
-                    c+=meshnodes[elem->p[k]]->CC()*LengthConv[problem->LengthUnits]/3.;
+    default:
+        break;
+    }
+    return result;
+}
 
-                double y=Re(c)*F2 -Im(c)*F1;
-                y*=AECF(elem);
-                result+=(a*y);
+CComplex ElectrostaticsPostProcessor::blockIntegrand(int inttype, int i) const
+{
+    auto elem = getMeshElement(i);
+    CComplex result=0;
+    double a=ElmArea(i)*sqr(LengthConv[problem->LengthUnits]);
+    if(problem->problemType==AXISYMMETRIC){
+        double r[3];
+        for(int k=0;k<3;k++)
+            r[k]=meshnodes[elem->p[k]]->x*LengthConv[problem->LengthUnits];
+        double R=(r[0]+r[1]+r[2])/3.;
+        a*=(2.*PI*R);
+    }
+    else a*=problem->Depth;
 
-                break;
-            }
-            default:
-                break;
-            }
+    switch(inttype)
+    {
+    case 5:
+    {
+        double B1=Re(elem->D);
+        double B2=Im(elem->D);
+        CComplex c=HenrotteVector(i);
+
+        // x (or r) direction Henrotte force, SS part.
+        double y;
+        if(problem->problemType==PLANAR){
+            y=(((B1*B1) - (B2*B2))*Re(c) + 2.*(B1*B2)*Im(c))/(2.*eo)*AECF(elem);
+            result.re += (a*y);
+        } else {
+            // y (or z) direction Henrotte force, SS part
+            y=(((B2*B2) - (B1*B1))*Im(c) + 2.*(B1*B2)*Re(c))/(2.*eo)*AECF(elem);
         }
+        result.im += (a*y);
+        break;
     }
 
-    // Integrals 3 and 4 are averages over the selected volume;
-    // Need to divide by the block volme to get the average.
-    if((inttype==3) || (inttype==4)) result/=blockIntegral(2);
+    case 6: // Henrotte torque, SS part.
+    {
+        if(problem->problemType!=PLANAR) break;
+        double B1=Re(elem->D);
+        double B2=Im(elem->D);
+        CComplex c=HenrotteVector(i);
+
+        double F1 = (((B1*B1) - (B2*B2))*Re(c) +
+              2.*(B1*B2)*Im(c))/(2.*eo);
+        double F2 = (((B2*B2) - (B1*B1))*Im(c) +
+              2.*(B1*B2)*Re(c))/(2.*eo);
+
+        c=0;
+        for(int k=0;k<3;k++)
+            c+=meshnodes[elem->p[k]]->CC()*LengthConv[problem->LengthUnits]/3.;
+
+        double y=Re(c)*F2 -Im(c)*F1;
+        y*=AECF(elem);
+        result+=(a*y);
 
+        break;
+    }
+    default:
+        break;
+    }
     return result;
 }
 
@@ -431,6 +449,26 @@ bool ElectrostaticsPostProcessor::getPointValues(double x, double y, CSPointVals
     return true;
 }
 
+int ElectrostaticsPostProcessor::getPointValues(int n, const double *x, const double *y, CSPointVals *u, bool *inMesh) const
+{
+    return evaluatePoints(n, x, y, inMesh, [this,x,y,u](int k, int elm) {
+        getPointValues(x[k],y[k],elm,u[k]);
+    });
+}
+
+int ElectrostaticsPostProcessor::rasterizeFields(const femm::RasterGrid &grid, std::vector<float> &values) const
+{
+    rasterize(grid, 4, [this](double x, double y, int elm, float *v) {
+        CSPointVals u;
+        getPointValues(x,y,elm,u);
+        v[0] = static_cast<float>(u.V);
+        v[1] = static_cast<float>(u.D.re);
+        v[2] = static_cast<float>(u.D.im);
+        v[3] = static_cast<float>(abs(u.D));
+    }, values);
+    return 4;
+}
+
 void ElectrostaticsPostProcessor::getPointValues(double x, double y, int k, CSPointVals &u) const
 {
     int n[3];
@@ -508,65 +546,31 @@ void ElectrostaticsPostProcessor::lineIntegral(int intType, double (&results)[2]
     // inttype==1 => D.n
     if(intType==1)
     {
-        int NumPlotPoints=d_LineIntegralPoints;
-
         results[0]=0;
         results[1]=0;
-        bool flag;
         for(int k=1; k<(int)contour.size();k++)
         {
-            double dz = abs(contour[k]-contour[k-1])/((double) NumPlotPoints);
-            int elm = -1;
-            for(int i=0;i<NumPlotPoints;i++)
-            {
-                double u=(((double) i)+0.5)/((double) NumPlotPoints);
-                CComplex pt=contour[k-1] + u*(contour[k] - contour[k-1]);
-                CComplex t=contour[k]-contour[k-1];
-                t/=abs(t);
-                CComplex n=I*t;
-                pt+=n*1.e-06;
-
-                if (elm<0) elm=InTriangle(pt.re,pt.im);
-                else if (! InTriangleTest(pt.re,pt.im,elm))
-                {
-                    flag=false;
-                    for(int j=0;j<3;j++)
-                    {
-                        for(int m=0; m<NumList[meshelems[elm]->p[j]]; m++)
-                        {
-                            elm=ConList[meshelems[elm]->p[j]][m];
-                            if (InTriangleTest(pt.re,pt.im,elm))
-                            {
-                                flag=true;
-                                m=100;
-                                j=3;
-                            }
-                        }
-                    }
-                    if (!flag)
-                        elm=InTriangle(pt.re,pt.im);
-                }
+            CComplex t=contour[k]-contour[k-1];
+            t/=abs(t);
+            CComplex n=I*t;
+
+            // integrate element by element along the segment,
+            // shifted a little in the normal direction
+            integrateContourSegment(contour[k-1]+n*1.e-06, contour[k]+n*1.e-06,
+                                    [&](int elm, CComplex pt, double dz) {
                 CSPointVals v;
-                if(elm>=0)
-                {
-                    getPointValues(pt.re,pt.im,elm,v);
-                    flag=true;
-                }
-                else flag=false;
+                getPointValues(pt.re,pt.im,elm,v);
+                double Dn = Re(v.D/n);
 
-                if(flag){
-                    double Dn = Re(v.D/n);
-
-                    double d;
-                    if (problem->problemType==AXISYMMETRIC)
-                        d=2.*PI*pt.re*sqr(LengthConv[problem->LengthUnits]);
-                    else
-                        d=problem->Depth*LengthConv[problem->LengthUnits];
+                double d;
+                if (problem->problemType==AXISYMMETRIC)
+                    d=2.*PI*pt.re*sqr(LengthConv[problem->LengthUnits]);
+                else
+                    d=problem->Depth*LengthConv[problem->LengthUnits];
 
-                    results[0]+=(Dn*dz*d);
-                    results[1]+=dz*d;
-                }
-            }
+                results[0]+=(Dn*dz*d);
+                results[1]+=dz*d;
+            });
         }
         results[1]=results[0]/results[1]; // Average D.n over the surface;
     }
@@ -599,126 +603,62 @@ void ElectrostaticsPostProcessor::lineIntegral(int intType, double (&results)[2]
     {
         results[0]=0;
         results[1]=0;
-        int NumPlotPoints=d_LineIntegralPoints;
-        bool flag;
 
         for(int k=1;k<(int)contour.size();k++)
         {
-            double dz=abs(contour[k]-contour[k-1])/((double) NumPlotPoints);
-            int elm=-1;
-            for(int i=0; i<NumPlotPoints;i++)
-            {
-                double u=(((double) i)+0.5)/((double) NumPlotPoints);
-                CComplex pt=contour[k-1] + u*(contour[k] - contour[k-1]);
-                CComplex t=contour[k]-contour[k-1];
-                t/=abs(t);
-                CComplex n=I*t;
-                pt+=n*1.e-06;
-
-                if (elm<0) elm=InTriangle(pt.re,pt.im);
-                else if (!InTriangleTest(pt.re,pt.im,elm))
-                {
-                    flag=false;
-                    for(int j=0;j<3;j++)
-                        for(int m=0;m<NumList[meshelems[elm]->p[j]];m++)
-                        {
-                            elm=ConList[meshelems[elm]->p[j]][m];
-                            if (InTriangleTest(pt.re,pt.im,elm))
-                            {
-                                flag=true;
-                                m=100;
-                                j=3;
-                            }
-                        }
-                    if (!flag) elm=InTriangle(pt.re,pt.im);
-                }
-                CSPointVals v;
-                if(elm>=0)
-                {
-                    getPointValues(pt.re,pt.im,elm,v);
-                    flag = true;
-                } else flag=false;
+            CComplex t=contour[k]-contour[k-1];
+            t/=abs(t);
+            CComplex n=I*t;
 
-                if(flag)
-                {
-                    double Hn= Re(v.E/n);
-                    double Bn= Re(v.D/n);
-                    double BH= Re(v.D*conj(v.E));
-                    double dF1=v.E.re*Bn + v.D.re*Hn - n.re*BH;
-                    double dF2=v.E.im*Bn + v.D.im*Hn - n.im*BH;
-
-                    double dza=dz*LengthConv[problem->LengthUnits];
-                    if(problem->problemType==AXISYMMETRIC){
-                        dza*=2.*PI*pt.re*LengthConv[problem->LengthUnits];
-                        dF1=0;
-                    }
-                    else dza*=problem->Depth;
-
-                    results[0]+=(dF1*dza/2.);
-                    results[1]+=(dF2*dza/2.);
+            integrateContourSegment(contour[k-1]+n*1.e-06, contour[k]+n*1.e-06,
+                                    [&](int elm, CComplex pt, double dz) {
+                CSPointVals v;
+                getPointValues(pt.re,pt.im,elm,v);
+
+                double Hn= Re(v.E/n);
+                double Bn= Re(v.D/n);
+                double BH= Re(v.D*conj(v.E));
+                double dF1=v.E.re*Bn + v.D.re*Hn - n.re*BH;
+                double dF2=v.E.im*Bn + v.D.im*Hn - n.im*BH;
+
+                double dza=dz*LengthConv[problem->LengthUnits];
+                if(problem->problemType==AXISYMMETRIC){
+                    dza*=2.*PI*pt.re*LengthConv[problem->LengthUnits];
+                    dF1=0;
                 }
-            }
+                else dza*=problem->Depth;
+
+                results[0]+=(dF1*dza/2.);
+                results[1]+=(dF2*dza/2.);
+            });
         }
     }
 
     // inttype==4 => Stress Tensor Torque
     if(intType==4)
     {
-        int NumPlotPoints=d_LineIntegralPoints;
-        bool flag;
-
         results[0]=results[1]=0;
         for(int k=1;k<(int)contour.size();k++)
         {
-            double dz=abs(contour[k]-contour[k-1])/((double) NumPlotPoints);
-            int elm=-1;
-            for(int i=0;i<NumPlotPoints;i++)
-            {
-                double u=(((double) i)+0.5)/((double) NumPlotPoints);
-                CComplex pt=contour[k-1]+ u*(contour[k] - contour[k-1]);
-                CComplex t=contour[k]-contour[k-1];
-                t/=abs(t);
-                CComplex n=I*t;
-                pt+=n*1.e-6;
-
-                if (elm<0) elm=InTriangle(pt.re,pt.im);
-                else if (!InTriangleTest(pt.re,pt.im,elm))
-                {
-                    flag=false;
-                    for(int j=0;j<3;j++)
-                        for(int m=0;m<NumList[meshelems[elm]->p[j]];m++)
-                        {
-                            elm=ConList[meshelems[elm]->p[j]][m];
-                            if (InTriangleTest(pt.re,pt.im,elm))
-                            {
-                                flag=true;
-                                m=100;
-                                j=3;
-                            }
-                        }
-                    if (!flag) elm=InTriangle(pt.re,pt.im);
-                }
-                CSPointVals v;
-                if(elm>=0)
-                {
-                    getPointValues(pt.re,pt.im,elm,v);
-                    flag = true;
-                }
-                else flag=false;
+            CComplex t=contour[k]-contour[k-1];
+            t/=abs(t);
+            CComplex n=I*t;
 
-                if(flag)
-                {
-                    double Hn= Re(v.E/n);
-                    double Bn= Re(v.D/n);
-                    double BH= Re(v.D*conj(v.E));
-                    double dF1=v.E.re*Bn + v.D.re*Hn - n.re*BH;
-                    double dF2=v.E.im*Bn + v.D.im*Hn - n.im*BH;
-                    double dT= pt.re*dF2 - dF1*pt.im;
-                    double dza=dz*sqr(LengthConv[problem->LengthUnits]);
-
-                    results[0]+=(dT*dza*problem->Depth/2.);
-                }
-            }
+            integrateContourSegment(contour[k-1]+n*1.e-6, contour[k]+n*1.e-6,
+                                    [&](int elm, CComplex pt, double dz) {
+                CSPointVals v;
+                getPointValues(pt.re,pt.im,elm,v);
+
+                double Hn= Re(v.E/n);
+                double Bn= Re(v.D/n);
+                double BH= Re(v.D*conj(v.E));
+                double dF1=v.E.re*Bn + v.D.re*Hn - n.re*BH;
+                double dF2=v.E.im*Bn + v.D.im*Hn - n.im*BH;
+                double dT= pt.re*dF2 - dF1*pt.im;
+                double dza=dz*sqr(LengthConv[problem->LengthUnits]);
+
+                results[0]+=(dT*dza*problem->Depth/2.);
+            });
         }
     }
 }
@@ -45,6 +45,9 @@ public:
      * 5       | Weighted Stress Tensor Force
      * 6       | Weighted Stress Tensor Torque
      *
+     * The elements are processed on several threads; the partial sums are combined
+     * in a fixed order, so the result does not depend on the number of threads.
+     *
      * @param inttype
      * @return the result of the computation
      * \internal
@@ -59,6 +62,24 @@ public:
 
     bool getPointValues(double x, double y, CSPointVals &u) const;
     void getPointValues(double x, double y, int k, CSPointVals &u) const;
+    /**
+     * @brief Get the point values for several points at once.
+     * @param n the number of points
+     * @param x array of \p n x coordinates
+     * @param y array of \p n y coordinates
+     * @param u array of \p n point values; u[i] is only set if the point is inside the mesh.
+     * @param inMesh array of \p n flags, set to \c true for points inside the mesh.
+     * @return the number of points inside the mesh
+     */
+    int getPointValues(int n, const double *x, const double *y, CSPointVals *u, bool *inMesh) const;
+    /**
+     * @brief Sample the voltage and electric flux density on a regular grid.
+     * The values are interpolated like in getPointValues(), i.e. using the smoothed nodal flux density if smoothing is enabled.
+     * @param grid the grid
+     * @param values receives 4 planes of grid.size() values: V, Dx, Dy and |D|; NaN for points outside the mesh.
+     * @return the number of planes
+     */
+    int rasterizeFields(const femm::RasterGrid &grid, std::vector<float> &values) const;
 
     bool isSelectionOnAxis() const override;
 
@@ -86,6 +107,15 @@ private:
      */
     CComplex E(const femmsolver::CHSElement *elem) const;
 
+    /**
+     * @brief Contribution of element \p i to the block integrals 0-4 (over the selected blocks).
+     */
+    CComplex selectedBlockIntegrand(int inttype, int i) const;
+    /**
+     * @brief Contribution of element \p i to the block integrals 5 and 6 (over all elements).
+     */
+    CComplex blockIntegrand(int inttype, int i) const;
+
     /**
      * @brief GetElementD
      * Compute and fill in the D value of a mesh element.
@@ -127,25 +127,37 @@ bool ESolver::LoadProblemFile ()
 LoadMeshErr ESolver::LoadMesh(bool deleteFiles)
 {
     int i,j,k,q,n0,n1,n;
-    char infile[256];
+    std::string infile;
     FILE *fp;
-    char s[1024];
+    std::string s;
+
+    // removes the triangle files once they are no longer needed
+    auto removeMeshFiles = [this](bool withEdges)
+    {
+        remove((PathName + ".ele").c_str());
+        remove((PathName + ".node").c_str());
+        remove((PathName + ".pbc").c_str());
+        remove((PathName + ".poly").c_str());
+        if (withEdges)
+            remove((PathName + ".edge").c_str());
+    };
 
     //read meshnodes;
-    std::sprintf(infile,"%s.node",PathName.c_str());
-    if((fp=fopen(infile,"rt"))==NULL){
+    infile = PathName + ".node";
+    if((fp=fopen(infile.c_str(),"rt"))==NULL){
         return BADELEMENTFILE;
     }
-    if (fgets(s,1024,fp)==NULL)
+    if (!readLine(fp,s))
     {
         return BADELEMENTFILE;
     }
-    std::sscanf(s,"%i",&k);
-    NumNodes=k;
+    long long count = 0;
+    std::sscanf(s.c_str(),"%lld",&count);
+    NumNodes=count;
 
-    meshnode = new CNode[k];
+    meshnode = new CNode[NumNodes];
     CNode node;
-    for (i=0; i<k; i++)
+    for (i=0; i<NumNodes; i++)
     {
         fscanf(fp,"%i",&j);
         fscanf(fp,"%lf",&node.x);
@@ -183,12 +195,12 @@ LoadMeshErr ESolver::LoadMesh(bool deleteFiles)
     fclose(fp);
 
     //read in periodic boundary conditions;
-    sprintf(infile,"%s.pbc",PathName.c_str());
-    if((fp=fopen(infile,"rt"))==NULL){
+    infile = PathName + ".pbc";
+    if((fp=fopen(infile.c_str(),"rt"))==NULL){
         return BADPBCFILE;
     }
-    fgets(s,1024,fp);
-    sscanf(s,"%i",&k);
+    readLine(fp,s);
+    sscanf(s.c_str(),"%i",&k);
     NumPBCs=k;
 
     if (k!=0)
@@ -204,21 +216,22 @@ LoadMeshErr ESolver::LoadMesh(bool deleteFiles)
     fclose(fp);
 
     // read in elements;
-    sprintf(infile,"%s.ele",PathName.c_str());
-    if((fp=fopen(infile,"rt"))==NULL){
+    infile = PathName + ".ele";
+    if((fp=fopen(infile.c_str(),"rt"))==NULL){
         return BADELEMENTFILE;
     }
-    fgets(s,1024,fp);
-    sscanf(s,"%i",&k); NumEls=k;
+    readLine(fp,s);
+    count = 0;
+    sscanf(s.c_str(),"%lld",&count); NumEls=count;
 
-    meshele.reserve(k);
+    meshele.reserve(NumEls);
     femmsolver::CElement elm;
 
     int defaultLabel;
     for(i=0,defaultLabel=-1;i<NumBlockLabels;i++)
         if (labellist[i].IsDefault) defaultLabel=i;
 
-    for(i=0;i<k;i++){
+    for(i=0;i<NumEls;i++){
         fscanf(fp,"%i",&j);
         fscanf(fp,"%i",&elm.p[0]);
         fscanf(fp,"%i",&elm.p[1]);
@@ -235,16 +248,7 @@ LoadMeshErr ESolver::LoadMesh(bool deleteFiles)
             fclose(fp);
             if (deleteFiles)
             {
-                sprintf(infile,"%s.ele",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.node",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.pbc",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.poly",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.edge",PathName.c_str());
-                remove(infile);
+                removeMeshFiles(true);
             }
             return MISSINGMATPROPS;
         }
@@ -292,8 +296,8 @@ LoadMeshErr ESolver::LoadMesh(bool deleteFiles)
             nmbr[k]++;
         }
 
-    sprintf(infile,"%s.edge",PathName.c_str());
-    if((fp=fopen(infile,"rt"))==NULL)
+    infile = PathName + ".edge";
+    if((fp=fopen(infile.c_str(),"rt"))==NULL)
     {
         return BADEDGEFILE;
     }
@@ -360,14 +364,7 @@ LoadMeshErr ESolver::LoadMesh(bool deleteFiles)
     if (deleteFiles)
     {
         // clear out temporary files
-        sprintf(infile,"%s.ele",PathName.c_str());
-        remove(infile);
-        sprintf(infile,"%s.node",PathName.c_str());
-        remove(infile);
-        sprintf(infile,"%s.pbc",PathName.c_str());
-        remove(infile);
-        sprintf(infile,"%s.poly",PathName.c_str());
-        remove(infile);
+        removeMeshFiles(false);
     }
 
     return NOERROR;
@@ -671,6 +668,7 @@ bool ESolver::runSolver(bool verbose)
         std::string stats = "Problem Statistics:\n";
         stats += to_string(NumNodes) + " nodes\n";
         stats += to_string(NumEls) + " elements\n";
+        stats += "bandwidth " + to_string(BandWidth) + ", profile " + to_string(Profile) + "\n";
         PrintMessage(stats.c_str());
         std::cout << "Precision: " << Precision << "\n";
     }
@@ -721,46 +719,38 @@ int ESolver::WriteResults(CBigLinProb &L)
 {
 	// write solution to disk;
 
-	char c[1024];
-	FILE *fp,*fz;
+	FILE *fp;
 	int i;
     double cf;
-	// first, echo input .fee file to the .res file;
-	sprintf(c,"%s.fee",PathName.c_str());
-
-	fz=fopen(c,"rt");
-	if(fz==NULL)
-    {
-		printf("Couldn't open %s.fee\n", PathName.c_str());
-        return false;
-	}
 
-    sprintf(c,"%s.res",PathName.c_str());
-    fp=fopen(c,"wt");
+    std::string c = PathName + ".res";
+    fp = fopen(c.c_str(),"wt");
 	if(fp==NULL)
     {
 		printf("Couldn't write to %s.res",PathName.c_str());
         return false;
 	}
 
-	while(fgets(c,1024,fz)!=NULL)
+	// first, echo input .fee file to the .res file;
+	if (!writeProblemDescription(fp, PathName+".fee"))
     {
-        fputs(c,fp);
-    }
-	fclose(fz);
+		fclose(fp);
+		printf("Couldn't open %s.fee\n", PathName.c_str());
+        return false;
+	}
 
 	// then print out node, line, and element information
 	fprintf(fp,"[Solution]\n");
     // get conversion factor for conversion from internal working units of
     // mm to the specified length units
 	cf = units[LengthUnits];
-	fprintf(fp,"%i\n",NumNodes);
+	fprintf(fp,"%lld\n",(long long)NumNodes);
 	for(i=0;i<NumNodes;i++)
     {
 		fprintf(fp,"%.17g	%.17g	%.17g	%i\n",meshnode[i].x/cf,meshnode[i].y/cf,L.V[i],L.Q[i]);
     }
 
-	fprintf(fp,"%i\n",NumEls);
+	fprintf(fp,"%lld\n",(long long)NumEls);
 
 	for(i=0;i<NumEls;i++)
     {
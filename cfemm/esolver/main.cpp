@@ -33,6 +33,8 @@
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <iostream>
+#include <string>
 #include "femmcomplex.h"
 #include "spars.h"
 #include "esolver.h"
@@ -41,17 +43,14 @@
 int main(int argc, char** argv)
 {
     ESolver solverInstance;
-    char PathName[512];
+    std::string PathName;
 
     if (argc < 2)
     {
         // request the file name from the user
         printf("Enter fee file name without extension:\n");
 
-        fgets(PathName, 512, stdin);
-        char *pos;
-        if ((pos=strchr(PathName, '\n')) != NULL)
-            *pos = '\0';
+        std::getline(std::cin, PathName);
 
     }
     else if(argc > 2)
@@ -60,7 +59,7 @@ int main(int argc, char** argv)
     }
     else
     {
-        strcpy(PathName, argv[1]);
+        PathName = argv[1];
     }
 
     solverInstance.PathName = PathName;
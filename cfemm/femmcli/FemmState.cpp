@@ -22,7 +22,20 @@
 #include "epproc.h"
 #include "hpproc.h"
 
+#include <fstream>
 #include <memory>
+#include <sstream>
+
+namespace {
+// mesh files read by the solvers
+const char *meshFileExtensions[] = { ".node", ".ele", ".edge", ".pbc" };
+
+// filename.fem -> filename
+std::string meshFileBaseName(const std::string &pathName)
+{
+    return pathName.substr(0,pathName.find_last_of("."));
+}
+}
 
 
 const std::shared_ptr<femm::FemmProblem> femmcli::FemmState::femmDocument()
@@ -67,11 +80,62 @@ void femmcli::FemmState::closeSolution()
     current.postProcessor.reset();
 }
 
+bool femmcli::FemmState::restoreMesh(const std::string &pathName, uint64_t fingerprint)
+{
+    if (!current.meshCache || current.meshCache->fingerprint != fingerprint)
+        return false;
+
+    const std::string baseName = meshFileBaseName(pathName);
+    for (const auto &file: current.meshCache->files)
+    {
+        std::ofstream output(baseName + file.first, std::ios::binary);
+        output << file.second;
+        if (!output)
+        {
+            discardMesh();
+            return false;
+        }
+    }
+    return true;
+}
+
+void femmcli::FemmState::storeMesh(const std::string &pathName, uint64_t fingerprint)
+{
+    auto cache = std::make_shared<MeshCache>();
+    cache->fingerprint = fingerprint;
+    cache->numbering = std::make_shared<NodeNumbering>();
+
+    const std::string baseName = meshFileBaseName(pathName);
+    for (const char *extension: meshFileExtensions)
+    {
+        std::ifstream input(baseName + extension, std::ios::binary);
+        if (!input)
+            continue;
+        std::ostringstream content;
+        content << input.rdbuf();
+        cache->files[extension] = content.str();
+    }
+    current.meshCache = cache;
+}
+
+void femmcli::FemmState::discardMesh()
+{
+    current.meshCache.reset();
+}
+
+std::shared_ptr<NodeNumbering> femmcli::FemmState::meshNumbering()
+{
+    if (!current.meshCache)
+        return nullptr;
+    return current.meshCache->numbering;
+}
+
 void femmcli::FemmState::close()
 {
     current.document.reset();
     current.mesher.reset();
     current.postProcessor.reset();
+    current.meshCache.reset();
 }
 
 void femmcli::FemmState::deactivateProblemSet()
@@ -25,7 +25,10 @@
 #include "fsolver.h"
 #include "PostProcessor.h"
 
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <string>
 
 namespace femmcli
 {
@@ -116,6 +119,34 @@ public:
      */
     void closeSolution();
 
+    /**
+     * @brief Write the mesh files of the last analysis for the current document, if they are still valid.
+     * The mesh files are valid, if FemmProblem::meshFingerprint() has not changed since they were stored using storeMesh().
+     * @param pathName path of the problem file; the mesh files are written next to it
+     * @param fingerprint the mesh fingerprint of the current document
+     * @return \c true, if the mesh files were written and the document does not need to be meshed.
+     */
+    bool restoreMesh(const std::string &pathName, uint64_t fingerprint);
+
+    /**
+     * @brief Keep a copy of the mesh files that were just created for the current document.
+     * @param pathName path of the problem file
+     * @param fingerprint the mesh fingerprint of the current document
+     */
+    void storeMesh(const std::string &pathName, uint64_t fingerprint);
+
+    /**
+     * @brief Discard the mesh files kept by storeMesh().
+     */
+    void discardMesh();
+
+    /**
+     * @brief The node renumbering for the mesh kept by storeMesh().
+     * The solvers fill it in on their first run on the mesh, and reuse it afterwards.
+     * @return the node renumbering, or a null pointer if no mesh is kept.
+     */
+    std::shared_ptr<NodeNumbering> meshNumbering();
+
     /**
      * @brief Close and discard the current problem set.
      * After this operation, the current problem set is empty and you
@@ -143,10 +174,21 @@ public:
      */
     bool isValid() const;
 private:
+    /**
+     * @brief The MeshCache struct holds the mesh of the last analysis.
+     */
+    struct MeshCache {
+        uint64_t fingerprint;
+        /// file extension -> file content
+        std::map<std::string, std::string> files;
+        std::shared_ptr<NodeNumbering> numbering;
+    };
+
     struct ProblemSet {
         std::shared_ptr<femm::FemmProblem> document;
         std::shared_ptr<fmesher::FMesher> mesher;
         std::shared_ptr<femm::PProcIface> postProcessor;
+        std::shared_ptr<MeshCache> meshCache;
     };
 
     ProblemSet current;
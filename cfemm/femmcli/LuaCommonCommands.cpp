@@ -24,6 +24,7 @@
 #include "locationTools.h"
 #include "LuaInstance.h"
 #include "MatlibReader.h"
+#include "rasterTools.h"
 #include "stringTools.h"
 
 #include <lua.h>
@@ -32,6 +33,7 @@
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
 
@@ -78,7 +80,82 @@ bool femmcli::luaExpectParameterCount(lua_State *L, int expected)
     return false;
 }
 
+bool femmcli::luaToPointArrays(lua_State *L, std::vector<double> &x, std::vector<double> &y)
+{
+    if (!lua_istable(L,1) || !lua_istable(L,2) || lua_getn(L,1) != lua_getn(L,2))
+    {
+        std::string msg = luaCurrentFunctionName(L) + "(): expected two tables of x and y coordinates with the same length!";
+        lua_error(L, msg.c_str());
+        return false;
+    }
 
+    const int n = lua_getn(L,1);
+    x.resize(n);
+    y.resize(n);
+    for (int k=0; k<n; k++)
+    {
+        lua_rawgeti(L,1,k+1);
+        x[k] = lua_todouble(L,-1);
+        lua_rawgeti(L,2,k+1);
+        y[k] = lua_todouble(L,-1);
+        lua_pop(L,2);
+    }
+    return true;
+}
+
+void femmcli::luaToNumberArray(lua_State *L, int index, std::vector<double> &values)
+{
+    const int n = lua_getn(L,index);
+    values.resize(n);
+    for (int k=0; k<n; k++)
+    {
+        lua_rawgeti(L,index,k+1);
+        values[k] = lua_todouble(L,-1);
+        lua_pop(L,1);
+    }
+}
+
+bool femmcli::luaToRasterGrid(lua_State *L, femm::RasterGrid &grid)
+{
+    const double nx = std::floor(lua_todouble(L,5));
+    const double ny = std::floor(lua_todouble(L,6));
+    if (nx<1 || ny<1 || nx*ny>std::numeric_limits<int>::max())
+    {
+        std::string msg = luaCurrentFunctionName(L) + "(): invalid number of grid points!";
+        lua_error(L, msg.c_str());
+        return false;
+    }
+    grid = femm::makeRasterGrid(lua_todouble(L,1), lua_todouble(L,2),
+                                lua_todouble(L,3), lua_todouble(L,4),
+                                static_cast<int>(nx), static_cast<int>(ny));
+    return true;
+}
+
+void femmcli::luaPushPointValueTables(lua_State *L, int numPoints, const bool *inMesh, int numValues,
+                                      std::function<void (int, CComplex *)> getValues)
+{
+    std::vector<CComplex> values(static_cast<size_t>(numPoints)*numValues);
+    for (int k=0; k<numPoints; k++)
+    {
+        if (inMesh[k])
+            getValues(k, &values[static_cast<size_t>(k)*numValues]);
+    }
+
+    for (int j=0; j<numValues; j++)
+    {
+        lua_newtable(L);
+        for (int k=0; k<numPoints; k++)
+        {
+            if (!inMesh[k])
+                continue;
+            lua_pushnumber(L, values[static_cast<size_t>(k)*numValues+j]);
+            lua_rawseti(L,-2,k+1);
+        }
+        lua_pushstring(L,"n");
+        lua_pushnumber(L,numPoints);
+        lua_rawset(L,-3);
+    }
+}
 
 void femmcli::luaDebugWriteFEMFile(lua_State *L)
 {
@@ -190,23 +267,7 @@ int femmcli::LuaCommonCommands::luaAddBlocklabel(lua_State *L)
     double x = lua_todouble(L,1);
     double y = lua_todouble(L,2);
 
-    double d;
-    if (doc->nodelist.size()<2)
-        d = 1.e-08;
-    else{
-        CComplex p0,p1,p2;
-        p0 = doc->nodelist[0]->CC();
-        p1 = p0;
-        for (int i=1; i<(int)doc->nodelist.size(); i++)
-        {
-            p2 = doc->nodelist[i]->CC();
-            if(p2.re<p0.re) p0.re = p2.re;
-            if(p2.re>p1.re) p1.re = p2.re;
-            if(p2.im<p0.im) p0.im = p2.im;
-            if(p2.im>p1.im) p1.im = p2.im;
-        }
-        d = abs(p1-p0)*CLOSE_ENOUGH;
-    }
+    double d = doc->defaultTolerance();
     doc->addBlockLabel(x,y,d);
 
     //BOOL flag=thisDoc->AddBlockLabel(x,y,d);
@@ -382,23 +443,7 @@ int femmcli::LuaCommonCommands::luaAddNode(lua_State *L)
     double x=lua_todouble(L,1);
     double y=lua_todouble(L,2);
 
-    double d;
-    if ((int)doc->nodelist.size()<2) {
-        d=1.e-08;
-    } else {
-        CComplex p0,p1,p2;
-        p0=doc->nodelist[0]->CC();
-        p1=p0;
-        for(int i=1; i< (int)doc->nodelist.size(); i++)
-        {
-            p2=doc->nodelist[i]->CC();
-            if(p2.re<p0.re) p0.re=p2.re;
-            if(p2.re>p1.re) p1.re=p2.re;
-            if(p2.im<p0.im) p0.im=p2.im;
-            if(p2.im>p1.im) p1.im=p2.im;
-        }
-        d=abs(p1-p0)*CLOSE_ENOUGH;
-    }
+    double d = doc->defaultTolerance();
     doc->addNode(x,y,d);
 
     //BOOL flag=doc->AddNode(x,y,d);
@@ -740,7 +785,7 @@ int femmcli::LuaCommonCommands::luaCopyTranslate(lua_State *L)
     }
 
 
-    doc->updateUndo();
+    doc->updateUndoIncremental();
     doc->translateCopy(x,y,copies,editAction);
     femmState->closeSolution();
     mesher->meshline.clear();
@@ -1743,7 +1788,7 @@ int femmcli::LuaCommonCommands::luaMirrorCopy(lua_State *L)
         return 0;
     }
 
-    doc->updateUndo();
+    doc->updateUndoIncremental();
     doc->mirrorCopy(m_pax,m_pay,m_pbx,m_pby,editAction);
 
     if (luaInstance->getDebugGeometry())
@@ -1797,7 +1842,7 @@ int femmcli::LuaCommonCommands::luaMoveRotate(lua_State *L)
             return 0;
     }
 
-    doc->updateUndo();
+    doc->updateUndoIncremental();
     doc->rotateMove(CComplex(x,y),shiftangle,editAction);
     femmState->closeSolution();
     mesher->meshline.clear();
@@ -1855,7 +1900,7 @@ int femmcli::LuaCommonCommands::luaMoveTranslate(lua_State *L)
         return 0;
     }
 
-    doc->updateUndo();
+    doc->updateUndoIncremental();
     doc->translateMove(x,y,editAction);
     femmState->closeSolution();
     mesher->meshline.clear();
@@ -2241,7 +2286,7 @@ int femmcli::LuaCommonCommands::luaScaleMove(lua_State *L)
     }
 
 
-    doc->updateUndo();
+    doc->updateUndoIncremental();
     doc->scaleMove(x,y,scalefactor,editAction);
 
     if (luaInstance->getDebugGeometry())
@@ -18,10 +18,16 @@
 #ifndef LUACOMMONCOMMANDS_H
 #define LUACOMMONCOMMANDS_H
 
+#include "femmcomplex.h"
+
+#include <functional>
+#include <vector>
+
 struct lua_State;
 
 namespace femm {
 class LuaInstance;
+struct RasterGrid;
 }
 
 namespace femmcli
@@ -58,6 +64,54 @@ bool luaExpectParameterCount(lua_State *L, int min, int max);
  */
 bool luaExpectParameterCount(lua_State *L, int expected);
 
+/**
+ * @brief luaToPointArrays reads the coordinate tables of a vectorised point query.
+ * Parameters 1 and 2 are expected to be tables of the same length,
+ * containing the x and y coordinates, respectively.
+ * If this is not the case, an error message is printed using lua_error().
+ *
+ * @param L
+ * @param x receives the x coordinates
+ * @param y receives the y coordinates
+ * @return \c true, if the parameters are valid.
+ */
+bool luaToPointArrays(lua_State *L, std::vector<double> &x, std::vector<double> &y);
+
+/**
+ * @brief luaToNumberArray reads a table of numbers.
+ *
+ * @param L
+ * @param index the stack index of the table
+ * @param values receives the entries 1..n of the table
+ */
+void luaToNumberArray(lua_State *L, int index, std::vector<double> &values);
+
+/**
+ * @brief luaPushPointValueTables pushes the results of a vectorised point query.
+ * For each of the \p numValues quantities, a table is pushed that contains the value for point k at index k+1.
+ * Entries for points outside the mesh are left empty (nil), and the \c n field of each table is set to \p numPoints.
+ *
+ * @param L
+ * @param numPoints the number of points
+ * @param inMesh array of \p numPoints flags, \c true for points inside the mesh
+ * @param numValues number of quantities per point
+ * @param getValues callback that fills in the \p numValues quantities of point \c k
+ */
+void luaPushPointValueTables(lua_State *L, int numPoints, const bool *inMesh, int numValues,
+                             std::function<void(int k, CComplex *values)> getValues);
+
+/**
+ * @brief luaToRasterGrid reads the grid of a raster export.
+ * Parameters 1 to 6 are expected to be the corners x0, y0, x1, y1 and the number of grid points nx, ny.
+ * If the number of grid points is not positive or too large, an error message is printed using lua_error().
+ *
+ * @param L
+ * @param grid receives the grid
+ * @return \c true, if the parameters are valid.
+ * @see femm::makeRasterGrid()
+ */
+bool luaToRasterGrid(lua_State *L, femm::RasterGrid &grid);
+
 /**
  * @brief luaDebugWriteFEMFile writes the active input document into a file.
  * The file will be named "debug-<seq>-<luaFunctionName>.<fileType>", e.g.
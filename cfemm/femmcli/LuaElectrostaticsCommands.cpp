@@ -27,6 +27,7 @@
 #include "FemmState.h"
 #include "LuaInstance.h"
 #include "make_unique.h"
+#include "rasterTools.h"
 
 #include <lua.h>
 
@@ -243,6 +244,7 @@ void femmcli::LuaElectrostaticsCommands::registerCommands(LuaInstance &li)
     li.addFunction("eo_numelements", LuaCommonCommands::luaNumElements);
     li.addFunction("eo_num_nodes", LuaCommonCommands::luaNumNodes);
     li.addFunction("eo_numnodes", LuaCommonCommands::luaNumNodes);
+    li.addFunction("eo_rasterize", luaRasterize);
     li.addFunction("eo_refresh_view", LuaInstance::luaNOP);
     li.addFunction("eo_refreshview", LuaInstance::luaNOP);
     li.addFunction("eo_reload", LuaCommonCommands::luaLoadSolution);
@@ -428,6 +430,9 @@ int femmcli::LuaElectrostaticsCommands::luaAddPointProperty(lua_State *L)
 /**
  * @brief Mesh the problem description, save it, and run the solver.
  * If the global variable "XFEMM_VERBOSE" is set to 1, the mesher and solver is more verbose and prints statistics.
+ * If the global variable "XFEMM_SHARE_PROBLEM_FILE" is set to 1, the solution file references the problem file instead of containing a copy of it.
+ * The global variable "XFEMM_NODE_ORDERING" selects how the mesh nodes are renumbered:
+ * "cm" (Cuthill-McKee, the default), "rcm" (reverse Cuthill-McKee), or "nd" (nested dissection).
  * @param L
  * @return 0
  * \ingroup LuaES
@@ -571,7 +576,17 @@ int femmcli::LuaElectrostaticsCommands::luaAnalyze(lua_State *L)
     // allow setting verbosity from lua:
     const bool verbose = (luaInstance->getGlobal("XFEMM_VERBOSE") != 0);
     mesherDoc->Verbose = verbose;
-    if (mesherDoc->HasPeriodicBC()){
+    // if nothing has changed that affects the mesh, the mesh of the previous analysis is reused
+    // (set XFEMM_ALWAYS_REMESH to disable this):
+    const uint64_t meshFingerprint = doc->meshFingerprint();
+    const bool reuseMesh = (luaInstance->getGlobal("XFEMM_ALWAYS_REMESH") == 0)
+            && femmState->restoreMesh(pathName, meshFingerprint);
+    if (reuseMesh)
+    {
+        if (verbose)
+            PrintWarningMsg("reusing the mesh of the previous analysis\n");
+    }
+    else if (mesherDoc->HasPeriodicBC()){
         if (mesherDoc->DoPeriodicBCTriangulation(pathName) != 0)
         {
             //EndWaitCursor();
@@ -588,6 +603,8 @@ int femmcli::LuaElectrostaticsCommands::luaAnalyze(lua_State *L)
             return 0;
         }
     }
+    if (!reuseMesh)
+        femmState->storeMesh(pathName, meshFingerprint);
     //EndWaitCursor();
     if (!doc->consistencyCheckOK())
     {
@@ -601,6 +618,17 @@ int femmcli::LuaElectrostaticsCommands::luaAnalyze(lua_State *L)
     theSolver.PathName = doc->pathName.substr(0,dotpos);
     theSolver.WarnMessage = &PrintWarningMsg;
     theSolver.PrintMessage = &PrintWarningMsg;
+    // share the node renumbering with other analyses on the same mesh:
+    theSolver.nodeNumbering = femmState->meshNumbering();
+    // select the node ordering:
+    theSolver.Ordering = nameToNodeOrdering(luaInstance->getGlobalString("XFEMM_NODE_ORDERING"));
+    if (theSolver.Ordering == NodeOrdering::Invalid)
+    {
+        lua_error(L, "ei_analyze(): XFEMM_NODE_ORDERING must be \"cm\", \"rcm\" or \"nd\"!");
+        return 0;
+    }
+    // allow writing solutions that only reference the problem file:
+    theSolver.ShareProblemFile = (luaInstance->getGlobal("XFEMM_SHARE_PROBLEM_FILE") != 0);
     if (!theSolver.LoadProblemFile())
     {
         lua_error(L, "ei_analyze(): problem initializing solver!");
@@ -697,6 +725,10 @@ int femmcli::LuaElectrostaticsCommands::luaBlockIntegral(lua_State *L)
  * ### Implements:
  * - \lua{eo_getpointvalues(X,Y)}
  *
+ * If X and Y are tables of coordinates, the values for all points are computed in one go,
+ * and one table per value is returned. Entries for points outside the mesh are nil.
+ * This is an xfemm extension.
+ *
  * ### FEMM sources:
  * - \femm42{femm/belaviewLua.cpp,lua_getpointvals()}
  * \endinternal
@@ -713,6 +745,28 @@ int femmcli::LuaElectrostaticsCommands::luaGetPointValues(lua_State *L)
         return 0;
     }
 
+    if (lua_istable(L,1))
+    {
+        std::vector<double> px,py;
+        if (!luaToPointArrays(L, px, py))
+            return 0;
+        const int n = (int)px.size();
+        std::vector<CSPointVals> u(n);
+        std::unique_ptr<bool[]> inMesh(new bool[n]);
+        pproc->getPointValues(n, px.data(), py.data(), u.data(), inMesh.get());
+        luaPushPointValueTables(L, n, inMesh.get(), 8, [&u](int k, CComplex *v) {
+            v[0]=u[k].V;
+            v[1]=u[k].D.re;
+            v[2]=u[k].D.im;
+            v[3]=u[k].E.re;
+            v[4]=u[k].E.im;
+            v[5]=u[k].e.re;
+            v[6]=u[k].e.im;
+            v[7]=u[k].nrg;
+        });
+        return 8;
+    }
+
     double px,py;
     px=lua_tonumber(L,1).re;
     py=lua_tonumber(L,2).re;
@@ -790,6 +844,54 @@ int femmcli::LuaElectrostaticsCommands::luaLineIntegral(lua_State *L)
     return 2;
 }
 
+/**
+ * @brief Sample the solution on a regular grid, and write the values to a binary file.
+ * The grid has nx times ny points, with corners (x0,y0) and (x1,y1).
+ * The file contains planes of nx*ny values, stored as 32 bit floats in native byte order, without header;
+ * points outside the mesh are NaN.
+ * The grid points are stored row by row, starting at (x0,y0). The planes are V, Dx, Dy and |D|.
+ * Returns the number of planes.
+ * @param L
+ * @return 1 on success, 0 otherwise
+ * \ingroup LuaES
+ *
+ * \internal
+ * ### Implements:
+ * - \lua{eo_rasterize(x0,y0,x1,y1,nx,ny,"filename")}
+ *
+ * This is an xfemm extension.
+ * \endinternal
+ */
+int femmcli::LuaElectrostaticsCommands::luaRasterize(lua_State *L)
+{
+    auto luaInstance = LuaInstance::instance(L);
+    std::shared_ptr<FemmState> femmState = std::dynamic_pointer_cast<FemmState>(luaInstance->femmState());
+    std::shared_ptr<ElectrostaticsPostProcessor> pproc = std::dynamic_pointer_cast<ElectrostaticsPostProcessor>(femmState->getPostProcessor());
+    if (!pproc)
+    {
+        lua_error(L,"No electrostatics output in focus");
+        return 0;
+    }
+
+    luaExpectParameterCount(L, 7);
+    femm::RasterGrid grid;
+    if (!luaToRasterGrid(L, grid))
+        return 0;
+    std::string fileName = lua_tostring(L,7);
+
+    std::vector<float> values;
+    int numPlanes = pproc->rasterizeFields(grid, values);
+    if (!femm::writeRaster(fileName, values))
+    {
+        std::string msg = "eo_rasterize(): could not write file " + fileName;
+        lua_error(L, msg.c_str());
+        return 0;
+    }
+
+    lua_pushnumber(L,numPlanes);
+    return 1;
+}
+
 /**
  * @brief Modify a field of a boundary property.
  * @param L
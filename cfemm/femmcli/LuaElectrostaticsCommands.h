@@ -55,6 +55,7 @@ int luaModifyMaterialProperty(lua_State *L);
 int luaModifyPointProperty(lua_State *L);
 int luaNewDocument(lua_State *L);
 int luaProblemDefinition(lua_State *L);
+int luaRasterize(lua_State *L);
 int luaSetArcsegmentProperty(lua_State *L);
 int luaSetFocus(lua_State *L);
 }
@@ -27,6 +27,7 @@
 #include "FemmState.h"
 #include "LuaInstance.h"
 #include "make_unique.h"
+#include "rasterTools.h"
 
 #include <lua.h>
 
@@ -246,6 +247,7 @@ void femmcli::LuaHeatflowCommands::registerCommands(LuaInstance &li)
     li.addFunction("ho_numelements", LuaCommonCommands::luaNumElements);
     li.addFunction("ho_num_nodes", LuaCommonCommands::luaNumNodes);
     li.addFunction("ho_numnodes", LuaCommonCommands::luaNumNodes);
+    li.addFunction("ho_rasterize", luaRasterize);
     li.addFunction("ho_refresh_view", LuaInstance::luaNOP);
     li.addFunction("ho_refreshview", LuaInstance::luaNOP);
     li.addFunction("ho_reload", LuaCommonCommands::luaLoadSolution);
@@ -433,6 +435,9 @@ int femmcli::LuaHeatflowCommands::luaAddPointProperty(lua_State *L)
 /**
  * @brief Mesh the problem description, save it, and run the solver.
  * If the global variable "XFEMM_VERBOSE" is set to 1, the mesher and solver is more verbose and prints statistics.
+ * If the global variable "XFEMM_SHARE_PROBLEM_FILE" is set to 1, the solution file references the problem file instead of containing a copy of it.
+ * The global variable "XFEMM_NODE_ORDERING" selects how the mesh nodes are renumbered:
+ * "cm" (Cuthill-McKee, the default), "rcm" (reverse Cuthill-McKee), or "nd" (nested dissection).
  * @param L
  * @return 0
  * \ingroup LuaHF
@@ -576,7 +581,17 @@ int femmcli::LuaHeatflowCommands::luaAnalyze(lua_State *L)
     // allow setting verbosity from lua:
     const bool verbose = (luaInstance->getGlobal("XFEMM_VERBOSE") != 0);
     mesherDoc->Verbose = verbose;
-    if (mesherDoc->HasPeriodicBC()){
+    // if nothing has changed that affects the mesh, the mesh of the previous analysis is reused
+    // (set XFEMM_ALWAYS_REMESH to disable this):
+    const uint64_t meshFingerprint = doc->meshFingerprint();
+    const bool reuseMesh = (luaInstance->getGlobal("XFEMM_ALWAYS_REMESH") == 0)
+            && femmState->restoreMesh(pathName, meshFingerprint);
+    if (reuseMesh)
+    {
+        if (verbose)
+            PrintWarningMsg("reusing the mesh of the previous analysis\n");
+    }
+    else if (mesherDoc->HasPeriodicBC()){
         if (mesherDoc->DoPeriodicBCTriangulation(pathName) != 0)
         {
             //EndWaitCursor();
@@ -593,6 +608,8 @@ int femmcli::LuaHeatflowCommands::luaAnalyze(lua_State *L)
             return 0;
         }
     }
+    if (!reuseMesh)
+        femmState->storeMesh(pathName, meshFingerprint);
     //EndWaitCursor();
     if (!doc->consistencyCheckOK())
     {
@@ -606,6 +623,17 @@ int femmcli::LuaHeatflowCommands::luaAnalyze(lua_State *L)
     theSolver.PathName = doc->pathName.substr(0,dotpos);
     theSolver.WarnMessage = &PrintWarningMsg;
     theSolver.PrintMessage = &PrintWarningMsg;
+    // share the node renumbering with other analyses on the same mesh:
+    theSolver.nodeNumbering = femmState->meshNumbering();
+    // select the node ordering:
+    theSolver.Ordering = nameToNodeOrdering(luaInstance->getGlobalString("XFEMM_NODE_ORDERING"));
+    if (theSolver.Ordering == NodeOrdering::Invalid)
+    {
+        lua_error(L, "hi_analyze(): XFEMM_NODE_ORDERING must be \"cm\", \"rcm\" or \"nd\"!");
+        return 0;
+    }
+    // allow writing solutions that only reference the problem file:
+    theSolver.ShareProblemFile = (luaInstance->getGlobal("XFEMM_SHARE_PROBLEM_FILE") != 0);
     theSolver.dT = doc->dT;
     theSolver.previousSolutionFile = doc->previousSolutionFile;
     if (!theSolver.LoadProblemFile())
@@ -783,6 +811,10 @@ int femmcli::LuaHeatflowCommands::luaBlockIntegral(lua_State *L)
  * ### Implements:
  * - \lua{ho_getpointvalues(X,Y)}
  *
+ * If X and Y are tables of coordinates, the values for all points are computed in one go,
+ * and one table per value is returned. Entries for points outside the mesh are nil.
+ * This is an xfemm extension.
+ *
  * ### FEMM sources:
  * - \femm42{femm/hviewLua.cpp,lua_getpointvals()}
  * \endinternal
@@ -799,6 +831,27 @@ int femmcli::LuaHeatflowCommands::luaGetPointValues(lua_State *L)
         return 0;
     }
 
+    if (lua_istable(L,1))
+    {
+        std::vector<double> px,py;
+        if (!luaToPointArrays(L, px, py))
+            return 0;
+        const int n = (int)px.size();
+        std::vector<CHPointVals> u(n);
+        std::unique_ptr<bool[]> inMesh(new bool[n]);
+        pproc->getPointValues(n, px.data(), py.data(), u.data(), inMesh.get());
+        luaPushPointValueTables(L, n, inMesh.get(), 7, [&u](int k, CComplex *v) {
+            v[0]=u[k].T;
+            v[1]=u[k].F.re;
+            v[2]=u[k].F.im;
+            v[3]=u[k].G.re;
+            v[4]=u[k].G.im;
+            v[5]=u[k].K.re;
+            v[6]=u[k].K.im;
+        });
+        return 7;
+    }
+
     double px,py;
     px=lua_tonumber(L,1).re;
     py=lua_tonumber(L,2).re;
@@ -878,6 +931,54 @@ int femmcli::LuaHeatflowCommands::luaLineIntegral(lua_State *L)
     return 2;
 }
 
+/**
+ * @brief Sample the solution on a regular grid, and write the values to a binary file.
+ * The grid has nx times ny points, with corners (x0,y0) and (x1,y1).
+ * The file contains planes of nx*ny values, stored as 32 bit floats in native byte order, without header;
+ * points outside the mesh are NaN.
+ * The grid points are stored row by row, starting at (x0,y0). The planes are T, Fx, Fy and |F|.
+ * Returns the number of planes.
+ * @param L
+ * @return 1 on success, 0 otherwise
+ * \ingroup LuaHF
+ *
+ * \internal
+ * ### Implements:
+ * - \lua{ho_rasterize(x0,y0,x1,y1,nx,ny,"filename")}
+ *
+ * This is an xfemm extension.
+ * \endinternal
+ */
+int femmcli::LuaHeatflowCommands::luaRasterize(lua_State *L)
+{
+    auto luaInstance = LuaInstance::instance(L);
+    std::shared_ptr<FemmState> femmState = std::dynamic_pointer_cast<FemmState>(luaInstance->femmState());
+    std::shared_ptr<HPProc> pproc = std::dynamic_pointer_cast<HPProc>(femmState->getPostProcessor());
+    if (!pproc)
+    {
+        lua_error(L,"No heat flow output in focus");
+        return 0;
+    }
+
+    luaExpectParameterCount(L, 7);
+    femm::RasterGrid grid;
+    if (!luaToRasterGrid(L, grid))
+        return 0;
+    std::string fileName = lua_tostring(L,7);
+
+    std::vector<float> values;
+    int numPlanes = pproc->rasterizeFields(grid, values);
+    if (!femm::writeRaster(fileName, values))
+    {
+        std::string msg = "ho_rasterize(): could not write file " + fileName;
+        lua_error(L, msg.c_str());
+        return 0;
+    }
+
+    lua_pushnumber(L,numPlanes);
+    return 1;
+}
+
 /**
  * @brief Modify a field of a boundary property.
  * @param L
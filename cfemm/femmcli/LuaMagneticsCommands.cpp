@@ -27,15 +27,18 @@
 #include "LuaInstance.h"
 #include "stringTools.h"
 #include "make_unique.h"
+#include "rasterTools.h"
 
 #include <lua.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #ifdef DEBUG_FEMMLUA
 #define debug std::cerr
@@ -161,6 +164,8 @@ void femmcli::LuaMagneticsCommands::registerCommands(LuaInstance &li)
     li.addFunction("mo_hidepoints", LuaInstance::luaNOP);
     li.addFunction("mo_line_integral", luaLineIntegral);
     li.addFunction("mo_lineintegral", luaLineIntegral);
+    li.addFunction("mo_load_series_step", luaLoadSeriesStep);
+    li.addFunction("mo_loadseriesstep", luaLoadSeriesStep);
     li.addFunction("mo_make_plot", LuaInstance::luaNOP);
     li.addFunction("mo_makeplot", LuaInstance::luaNOP);
     li.addFunction("mi_maximize", LuaInstance::luaNOP);
@@ -186,11 +191,14 @@ void femmcli::LuaMagneticsCommands::registerCommands(LuaInstance &li)
     li.addFunction("mo_numelements", LuaCommonCommands::luaNumElements);
     li.addFunction("mo_num_nodes", LuaCommonCommands::luaNumNodes);
     li.addFunction("mo_numnodes", LuaCommonCommands::luaNumNodes);
+    li.addFunction("mo_open_series", luaOpenSeries);
+    li.addFunction("mo_openseries", luaOpenSeries);
     li.addFunction("mi_setprevious", luaSetPrevious);
     li.addFunction("mi_prob_def", luaProblemDefinition);
     li.addFunction("mi_probdef", luaProblemDefinition);
     li.addFunction("mi_purge_mesh", LuaCommonCommands::luaPurgeMesh);
     li.addFunction("mi_purgemesh", LuaCommonCommands::luaPurgeMesh);
+    li.addFunction("mo_rasterize", luaRasterize);
     li.addFunction("mi_read_dxf", LuaInstance::luaNOP);
     li.addFunction("mi_readdxf", LuaInstance::luaNOP);
     li.addFunction("mo_refresh_view", LuaInstance::luaNOP);
@@ -270,6 +278,8 @@ void femmcli::LuaMagneticsCommands::registerCommands(LuaInstance &li)
     li.addFunction("mo_show_points", LuaInstance::luaNOP);
     li.addFunction("mo_showpoints", LuaInstance::luaNOP);
     li.addFunction("mo_smooth", luaSetSmoothing);
+    li.addFunction("mi_sweep_air_gap", luaSweepAirGap);
+    li.addFunction("mi_sweepairgap", luaSweepAirGap);
     li.addFunction("mi_set_focus", LuaCommonCommands::luaSetFocus);
     li.addFunction("mi_setfocus", LuaCommonCommands::luaSetFocus);
     li.addFunction("mo_set_focus", LuaCommonCommands::luaSetFocus);
@@ -639,33 +649,169 @@ int femmcli::LuaMagneticsCommands::luaAddPointProperty(lua_State *L)
     return 0;
 }
 
+namespace {
+/// \brief Parameters of an air gap sweep, see luaSweepAirGap()
+struct AirGapSweepArgs
+{
+    std::string bdryName;
+    std::vector<double> innerAngles;
+    std::vector<double> outerAngles;
+};
+
+/**
+ * @brief Set the size field of the mesher from an earlier solution, as selected by the global variable "XFEMM_SIZE_FIELD".
+ * If it is a number other than 0, the solution loaded in the post processor is used;
+ * if it is a string, the solution is read from that file.
+ * The size field is derived using FPProc::ElementSizeField(), with the settings
+ * "XFEMM_SIZE_FIELD_TOLERANCE" (default: 0.05) and "XFEMM_SIZE_FIELD_MAX_ELEMENTS".
+ * @param L
+ * @param femmState
+ * @param doc the problem to mesh
+ * @param mesher
+ * @param verbose
+ * @return \c false (after raising a lua error) if the solution is not available
+ */
+bool setSizeField(lua_State *L, femmcli::FemmState &femmState, const FemmProblem &doc, fmesher::FMesher &mesher, bool verbose)
+{
+    auto luaInstance = LuaInstance::instance(L);
+    mesher.sizeField.clear();
+
+    std::shared_ptr<FPProc> solution;
+    bool isNumber;
+    const double useLoadedSolution = Re(luaInstance->getGlobal("XFEMM_SIZE_FIELD", &isNumber));
+    if (isNumber)
+    {
+        if (useLoadedSolution == 0)
+            return true;
+        solution = std::dynamic_pointer_cast<FPProc>(femmState.getPostProcessor());
+        if (!solution || solution->meshelem.empty())
+        {
+            lua_error(L, "mi_analyze(): XFEMM_SIZE_FIELD is set, but no solution is loaded!\n");
+            return false;
+        }
+    } else {
+        const std::string solutionFile = luaInstance->getGlobalString("XFEMM_SIZE_FIELD");
+        if (solutionFile.empty())
+            return true;
+        solution = std::make_shared<FPProc>();
+        if (!solution->OpenDocument(solutionFile))
+        {
+            std::string msg = "mi_analyze(): error while loading the size field solution file:\n" + solutionFile;
+            lua_error(L, msg.c_str());
+            return false;
+        }
+    }
+
+    bool ok;
+    double tolerance = Re(luaInstance->getGlobal("XFEMM_SIZE_FIELD_TOLERANCE", &ok));
+    if (!ok || tolerance <= 0)
+        tolerance = 0.05;
+    const int maxElements = (int) Re(luaInstance->getGlobal("XFEMM_SIZE_FIELD_MAX_ELEMENTS"));
+    std::vector<double> maxArea;
+    tolerance = solution->ElementSizeField(tolerance, maxElements, maxArea);
+    if (verbose)
+    {
+        std::string msg = "size field for an estimated relative error of " + std::to_string(tolerance) + "\n";
+        PrintWarningMsg(msg.c_str());
+    }
+
+    // convert to the length unit of the problem:
+    const double scale = LengthConvMeters[solution->LengthUnits] / LengthConvMeters[doc.LengthUnits];
+    std::vector<double> points;
+    points.reserve(2*solution->meshnode.size());
+    for (const auto &node: solution->meshnode)
+    {
+        points.push_back(scale*node.x);
+        points.push_back(scale*node.y);
+    }
+    std::vector<int> triangles;
+    triangles.reserve(3*solution->meshelem.size());
+    for (const auto &elm: solution->meshelem)
+        triangles.insert(triangles.end(), elm.p, elm.p+3);
+    for (double &a: maxArea)
+    {
+        if (a > 0)
+            a *= scale*scale;
+    }
+    mesher.sizeField.setMesh(std::move(points), std::move(triangles), std::move(maxArea));
+    return true;
+}
+
+/**
+ * @brief Solve the problem, refining the mesh until the estimated error is small enough.
+ * The mesher has to keep the triangulation of the initial mesh files.
+ * Settings are read from the global variables "XFEMM_ADAPTIVE_MAX_ELEMENTS" and "XFEMM_ADAPTIVE_MAX_STEPS",
+ * and the estimated relative error of the solution is stored in "XFEMM_ADAPTIVE_ERROR".
+ * @param L
+ * @param solver a solver that has loaded the problem file
+ * @param mesher the mesher that created the mesh files
+ * @param tolerance the target for the estimated relative error
+ * @param verbose
+ * @return \c true on success, \c false if the solver failed
+ */
+bool refineAndSolve(lua_State *L, FSolver &solver, fmesher::FMesher &mesher, double tolerance, bool verbose)
+{
+    auto luaInstance = LuaInstance::instance(L);
+    const double maxElements = Re(luaInstance->getGlobal("XFEMM_ADAPTIVE_MAX_ELEMENTS"));
+    bool ok;
+    int maxSteps = (int) Re(luaInstance->getGlobal("XFEMM_ADAPTIVE_MAX_STEPS", &ok));
+    if (!ok)
+        maxSteps = 10;
+
+    // the solver removes the mesh files after loading them, but the refined meshes still need the .pbc file:
+    const std::string pbcFile = solver.PathName + ".pbc";
+    std::string pbcContent;
+    {
+        std::ifstream input(pbcFile, std::ios::binary);
+        std::ostringstream content;
+        content << input.rdbuf();
+        pbcContent = content.str();
+    }
+
+    solver.Adaptive = FSolver::AdaptiveRefinement();
+    solver.Adaptive.Tolerance = tolerance;
+    solver.Adaptive.MaxElements = (int) maxElements;
+    solver.Adaptive.LastStep = (maxSteps <= 0);
+    bool solved = solver.runSolver(verbose);
+    for (int step=1; solved && !solver.Adaptive.MaxArea.empty(); step++)
+    {
+        if (verbose)
+        {
+            std::string msg = "adaptive refinement step " + std::to_string(step)
+                    + ": estimated error " + std::to_string(solver.Adaptive.RelativeError)
+                    + " with " + std::to_string(solver.NumEls) + " elements\n";
+            PrintWarningMsg(msg.c_str());
+        }
+        std::ofstream output(pbcFile, std::ios::binary);
+        output << pbcContent;
+        output.close();
+        if (!output || mesher.RefineMesh(solver.PathName + ".fem", solver.Adaptive.MaxArea) != 0)
+        {
+            lua_error(L, "mi_analyze(): mesh refinement failed!\n");
+            return false;
+        }
+        solver.Adaptive.LastStep = (step >= maxSteps);
+        solved = solver.runSolver(verbose);
+    }
+    mesher.keepTriangulation = false;
+    mesher.triangulation = fmesher::Triangulation();
+    luaInstance->setGlobal("XFEMM_ADAPTIVE_ERROR", solver.Adaptive.RelativeError);
+    return solved;
+}
+
 /**
  * @brief Mesh the problem description, save it, and run the solver.
- * If the global variable "XFEMM_VERBOSE" is set to 1, the mesher and solver is more verbose and prints statistics.
+ * This implements luaAnalyze(), and luaSweepAirGap() if sweep is not null.
  * @param L
+ * @param sweep the air gap sweep to solve, or null to solve the problem once
  * @return 0
- * \ingroup LuaMM
- *
- * \internal
- * ### Implements:
- * - \lua{mi_analyze(flag)}
- *   Parameter flag (0,1) determines visibility of fkern window and is ignored on xfemm.
- *
- * ### FEMM source:
- * - \femm42{femm/femmeLua.cpp,lua_analyze()}
- *
- * #### Additional source:
- * - \femm42{femm/femmeLua.cpp,lua_analyze()}: extracts thisDoc (=mesherDoc) and the accompanying FemmeViewDoc, calls CFemmeView::lnu_analyze(flag)
- * - \femm42{femm/FemmeView.cpp,CFemmeView::OnMenuAnalyze()}: does the things we do here directly...
- * \endinternal
  */
-int femmcli::LuaMagneticsCommands::luaAnalyze(lua_State *L)
+int analyze(lua_State *L, const AirGapSweepArgs *sweep)
 {
     auto luaInstance = LuaInstance::instance(L);
-    std::shared_ptr<FemmState> femmState = std::dynamic_pointer_cast<FemmState>(luaInstance->femmState());
+    std::shared_ptr<femmcli::FemmState> femmState = std::dynamic_pointer_cast<femmcli::FemmState>(luaInstance->femmState());
     std::shared_ptr<femm::FemmProblem> doc = femmState->femmDocument();
 
-    luaExpectParameterCount(L, 0,1);
     // check to see if all blocklabels are kosher...
     if (doc->labellist.size()==0){
         std::string msg = "No block information has been defined\n"
@@ -790,7 +936,27 @@ int femmcli::LuaMagneticsCommands::luaAnalyze(lua_State *L)
     // allow setting verbosity from lua:
     const bool verbose = (luaInstance->getGlobal("XFEMM_VERBOSE") != 0);
     mesherDoc->Verbose = verbose;
-    if (mesherDoc->HasPeriodicBC()){
+    // adaptive mesh refinement (not for sweeps):
+    const double adaptiveTolerance = sweep ? 0 : Re(luaInstance->getGlobal("XFEMM_ADAPTIVE_TOLERANCE"));
+    const bool adaptive = (adaptiveTolerance > 0);
+    mesherDoc->keepTriangulation = adaptive;
+    // mesh size field from an earlier solution:
+    if (!setSizeField(L, *femmState, *doc, *mesherDoc, verbose))
+        return 0;
+    const bool hasSizeField = !mesherDoc->sizeField.empty();
+    // if nothing has changed that affects the mesh, the mesh of the previous analysis is reused
+    // (set XFEMM_ALWAYS_REMESH to disable this):
+    const uint64_t meshFingerprint = doc->meshFingerprint();
+    const bool reuseMesh = !adaptive && !hasSizeField
+            && (luaInstance->getGlobal("XFEMM_ALWAYS_REMESH") == 0)
+            && femmState->restoreMesh(pathName, meshFingerprint);
+    luaInstance->setGlobal("XFEMM_MESH_REUSED", reuseMesh ? 1 : 0);
+    if (reuseMesh)
+    {
+        if (verbose)
+            PrintWarningMsg("reusing the mesh of the previous analysis\n");
+    }
+    else if (mesherDoc->HasPeriodicBC()){
         if (mesherDoc->DoPeriodicBCTriangulation(pathName) != 0)
         {
             //EndWaitCursor();
@@ -807,6 +973,10 @@ int femmcli::LuaMagneticsCommands::luaAnalyze(lua_State *L)
             return 0;
         }
     }
+    mesherDoc->sizeField.clear();
+    // the refined meshes of an adaptive analysis, or of a size field, are not reused
+    if (!reuseMesh && !adaptive && !hasSizeField)
+        femmState->storeMesh(pathName, meshFingerprint);
     //EndWaitCursor();
     if (!doc->consistencyCheckOK())
     {
@@ -820,6 +990,21 @@ int femmcli::LuaMagneticsCommands::luaAnalyze(lua_State *L)
     theFSolver.PathName = doc->pathName.substr(0,dotpos);
     theFSolver.WarnMessage = &PrintWarningMsg;
     theFSolver.PrintMessage = &PrintWarningMsg;
+    // share the node renumbering with other analyses on the same mesh:
+    if (!adaptive && !hasSizeField)
+        theFSolver.nodeNumbering = femmState->meshNumbering();
+    // select the node ordering:
+    theFSolver.Ordering = nameToNodeOrdering(luaInstance->getGlobalString("XFEMM_NODE_ORDERING"));
+    if (theFSolver.Ordering == NodeOrdering::Invalid)
+    {
+        lua_error(L, "mi_analyze(): XFEMM_NODE_ORDERING must be \"cm\", \"rcm\" or \"nd\"!");
+        return 0;
+    }
+    // allow writing solutions that only reference the problem file:
+    theFSolver.ShareProblemFile = (luaInstance->getGlobal("XFEMM_SHARE_PROBLEM_FILE") != 0);
+    // append the solution to a solution series:
+    theFSolver.SeriesFile = luaInstance->getGlobalString("XFEMM_SOLUTION_SERIES");
+    theFSolver.SeriesStepLabel = luaInstance->getGlobalString("XFEMM_SERIES_STEP_LABEL");
     // not supported yet, but set the previous solution so that we can detect this case afterwards:
     theFSolver.previousSolutionFile = doc->previousSolutionFile;
     if (!theFSolver.LoadProblemFile())
@@ -836,12 +1021,135 @@ int femmcli::LuaMagneticsCommands::luaAnalyze(lua_State *L)
     assert( doc->circproplist.size() <= theFSolver.circproplist.size());
     // holes are not read by the solver, which means that the solver may have fewer blocklabels:
     assert( doc->labellist.size() >= theFSolver.labellist.size());
-    if (!theFSolver.runSolver(verbose))
+    bool solved;
+    if (sweep)
+        solved = theFSolver.runAirGapSweep(sweep->bdryName, sweep->innerAngles, sweep->outerAngles, verbose);
+    else if (adaptive)
+        solved = refineAndSolve(L, theFSolver, *mesherDoc, adaptiveTolerance, verbose);
+    else
+        solved = theFSolver.runSolver(verbose);
+    if (!solved)
     {
         lua_error(L, "solver failed.");
     }
     return 0;
 }
+} // namespace
+
+/**
+ * @brief Mesh the problem description, save it, and run the solver.
+ * If the global variable "XFEMM_VERBOSE" is set to 1, the mesher and solver is more verbose and prints statistics.
+ * If the global variable "XFEMM_SHARE_PROBLEM_FILE" is set to 1, the solution file references the problem file instead of containing a copy of it.
+ * If nothing that affects the mesh has changed since the previous analysis, the previous mesh is reused,
+ * unless the global variable "XFEMM_ALWAYS_REMESH" is set to 1.
+ * The global variable "XFEMM_MESH_REUSED" is set to 1 if the mesh was reused, and to 0 otherwise.
+ * The global variable "XFEMM_NODE_ORDERING" selects how the mesh nodes are renumbered:
+ * "cm" (Cuthill-McKee, the default), "rcm" (reverse Cuthill-McKee), or "nd" (nested dissection).
+ * If the global variable "XFEMM_SOLUTION_SERIES" is set to a file name, the solution is also appended to that solution series,
+ * using the value of "XFEMM_SERIES_STEP_LABEL" as label of the step.
+ * If the global variable "XFEMM_ADAPTIVE_TOLERANCE" is set to a positive value (static planar problems only),
+ * the mesh is refined where the estimated field error is largest, and the problem solved again,
+ * until the estimated relative error is below the tolerance,
+ * the mesh has about "XFEMM_ADAPTIVE_MAX_ELEMENTS" elements (if set),
+ * or "XFEMM_ADAPTIVE_MAX_STEPS" refinement steps (default: 10) have been done.
+ * The estimated relative error of the solution is stored in "XFEMM_ADAPTIVE_ERROR".
+ * If the global variable "XFEMM_SIZE_FIELD" is set to the name of a solution file, or to 1 for the loaded solution,
+ * the mesh is refined according to the field error of that solution (e.g. of a similar design),
+ * aiming at an estimated relative error of "XFEMM_SIZE_FIELD_TOLERANCE" (default: 0.05)
+ * with at most about "XFEMM_SIZE_FIELD_MAX_ELEMENTS" elements (if set).
+ * @param L
+ * @return 0
+ * \ingroup LuaMM
+ *
+ * \internal
+ * ### Implements:
+ * - \lua{mi_analyze(flag)}
+ *   Parameter flag (0,1) determines visibility of fkern window and is ignored on xfemm.
+ *
+ * ### FEMM source:
+ * - \femm42{femm/femmeLua.cpp,lua_analyze()}
+ *
+ * #### Additional source:
+ * - \femm42{femm/femmeLua.cpp,lua_analyze()}: extracts thisDoc (=mesherDoc) and the accompanying FemmeViewDoc, calls CFemmeView::lnu_analyze(flag)
+ * - \femm42{femm/FemmeView.cpp,CFemmeView::OnMenuAnalyze()}: does the things we do here directly...
+ * \endinternal
+ */
+int femmcli::LuaMagneticsCommands::luaAnalyze(lua_State *L)
+{
+    luaExpectParameterCount(L, 0,1);
+    return analyze(L, nullptr);
+}
+
+/**
+ * @brief Mesh the problem description, save it, and solve it for a sequence of air gap angles.
+ * The mesh and node numbering are computed only once, and each step starts from the solution of the previous step.
+ * Only the contributions of the air gap element change from step to step;
+ * for linear problems, the rest of the assembled system is reused, too.
+ *
+ * The solution of the first step is written to the solution file,
+ * and all steps are appended to the solution series given by "XFEMM_SOLUTION_SERIES",
+ * which has to be set. The steps are labeled with their angles.
+ * The other global variables of mi_analyze() apply as well.
+ * @param L
+ * @return 0
+ * \ingroup LuaMM
+ *
+ * \internal
+ * ### Implements:
+ * - \lua{mi_sweepairgap("boundaryname", {innerangles} [, {outerangles}])}
+ *   innerangles and outerangles are tables of the InnerAngle and OuterAngle for each step (in degrees).
+ *   If outerangles is omitted, the OuterAngle of the boundary property is used for all steps.
+ *
+ * This is an xfemm extension.
+ * \endinternal
+ */
+int femmcli::LuaMagneticsCommands::luaSweepAirGap(lua_State *L)
+{
+    auto luaInstance = LuaInstance::instance(L);
+    std::shared_ptr<FemmState> femmState = std::dynamic_pointer_cast<FemmState>(luaInstance->femmState());
+    std::shared_ptr<femm::FemmProblem> doc = femmState->femmDocument();
+
+    luaExpectParameterCount(L, 2,3);
+    const int n = lua_gettop(L);
+    if (!lua_istable(L,2) || (n>2 && !lua_istable(L,3)))
+    {
+        lua_error(L, "mi_sweepairgap(): expected tables of angles!");
+        return 0;
+    }
+
+    AirGapSweepArgs sweep;
+    sweep.bdryName = lua_tostring(L,1);
+    const CBoundaryProp *prop = nullptr;
+    for (const auto &p: doc->lineproplist)
+    {
+        if (p->BdryName == sweep.bdryName)
+            prop = p.get();
+    }
+    if (prop==nullptr || (prop->BdryFormat!=6 && prop->BdryFormat!=7))
+    {
+        std::string msg = "mi_sweepairgap(): no air gap boundary named " + sweep.bdryName;
+        lua_error(L, msg.c_str());
+        return 0;
+    }
+
+    luaToNumberArray(L, 2, sweep.innerAngles);
+    if (n>2)
+        luaToNumberArray(L, 3, sweep.outerAngles);
+    else
+        sweep.outerAngles.assign(sweep.innerAngles.size(), prop->OuterAngle);
+    if (sweep.innerAngles.empty() || sweep.innerAngles.size() != sweep.outerAngles.size())
+    {
+        lua_error(L, "mi_sweepairgap(): expected the same number of inner and outer angles!");
+        return 0;
+    }
+    if (luaInstance->getGlobalString("XFEMM_SOLUTION_SERIES").empty())
+    {
+        lua_error(L, "mi_sweepairgap(): XFEMM_SOLUTION_SERIES must be set!");
+        return 0;
+    }
+
+    return analyze(L, &sweep);
+}
 
 /**
  * @brief Bend the end of the contour line.
@@ -884,6 +1192,13 @@ int femmcli::LuaMagneticsCommands::luaBendContourLine(lua_State *L)
 
 /**
  * @brief Calculate a block integral for the selected blocks.
+ * If the parameter is a table of integral types, all of them are computed
+ * in a single pass over the mesh, and a table of results is returned.
+ * This is an extension to the FEMM Lua API.
+ *
+ * The weighted stress tensor integrals (18-23) reuse cached masks (see FPProc::MakeMask()),
+ * unless the global variable "XFEMM_NO_MASK_CACHE" is set to 1.
+ * If a mask is computed, the global variable "XFEMM_MASK_FROM_CACHE" is set to 1 if it was taken from the cache, and to 0 otherwise.
  * @param L
  * @return 1 on success, 0 otherwise
  * \ingroup LuaMM
@@ -891,6 +1206,7 @@ int femmcli::LuaMagneticsCommands::luaBendContourLine(lua_State *L)
  * \internal
  * ### Implements:
  * - \lua{mo_blockintegral(type)}
+ * - \lua{mo_blockintegral({type1, type2, ...})}
  * ### FEMM source:
  * - \femm42{femm/femmviewLua.cpp,lua_blockintegral()}
  * \endinternal
@@ -914,11 +1230,31 @@ int femmcli::LuaMagneticsCommands::luaBlockIntegral(lua_State *L)
     }
 
     luaExpectParameterCount(L, 1);
-    int type = (int) lua_todouble(L,1);
-    if((type<0) || (type>24))
+    std::vector<int> types;
+    const bool typeTable = lua_istable(L,1);
+    if (typeTable)
     {
-        lua_error(L, "Invalid block integral type selected");
-        return 0;
+        const int n = lua_getn(L,1);
+        for (int k=1; k<=n; k++)
+        {
+            lua_rawgeti(L,1,k);
+            types.push_back((int) lua_todouble(L,-1));
+            lua_pop(L,1);
+        }
+    } else {
+        types.push_back((int) lua_todouble(L,1));
+    }
+
+    bool needsMask = false;
+    for (int type: types)
+    {
+        if((type<0) || (type>24))
+        {
+            lua_error(L, "Invalid block integral type selected");
+            return 0;
+        }
+        if ((type>=18) && (type<=23))
+            needsMask = true;
     }
 
     bool hasSelectedBlocks = false;
@@ -937,14 +1273,31 @@ int femmcli::LuaMagneticsCommands::luaBlockIntegral(lua_State *L)
         return 0;
     }
 
-    if ((type>=18) && (type<=23))
+    if (needsMask && !fpproc->bHasMask)
     {
+        fpproc->bUseMaskCache = (luaInstance->getGlobal("XFEMM_NO_MASK_CACHE") == 0);
         fpproc->MakeMask();
+        luaInstance->setGlobal("XFEMM_MASK_FROM_CACHE", fpproc->bMaskFromCache ? 1 : 0);
     }
 
-    CComplex z = fpproc->BlockIntegral(type);
+    std::vector<CComplex> z(types.size());
+    fpproc->BlockIntegral((int)types.size(), types.data(), z.data());
+
+    if (!typeTable)
+    {
+        lua_pushnumber(L,z[0]);
+        return 1;
+    }
 
-    lua_pushnumber(L,z);
+    lua_newtable(L);
+    for (int k=0; k<(int)z.size(); k++)
+    {
+        lua_pushnumber(L,z[k]);
+        lua_rawseti(L,-2,k+1);
+    }
+    lua_pushstring(L,"n");
+    lua_pushnumber(L,(int)z.size());
+    lua_rawset(L,-3);
     return 1;
 }
 
@@ -1278,7 +1631,7 @@ int femmcli::LuaMagneticsCommands::luaGetCircuitProperties(lua_State *L)
     }
     int idx = searchResult->second;
 
-    CComplex amps = fpproc->circproplist[idx].Amps;
+    CComplex amps = fpproc->GetCircuitCurrent(idx);
     CComplex volts = fpproc->GetVoltageDrop(idx);
     CComplex fluxlinkage = fpproc->GetFluxLinkage(idx);
 
@@ -1384,6 +1737,10 @@ int femmcli::LuaMagneticsCommands::luaGetMeshNode(lua_State *L)
  * ### Implements:
  * - \lua{mo_getpointvalues(X,Y)}
  *
+ * If X and Y are tables of coordinates, the values for all points are computed in one go,
+ * and one table per value is returned. Entries for points outside the mesh are nil.
+ * This is an xfemm extension.
+ *
  * ### FEMM source:
  * - \femm42{femm/femmviewLua.cpp,lua_getpointvals()}
  * \endinternal
@@ -1408,6 +1765,34 @@ int femmcli::LuaMagneticsCommands::luaGetPointValues(lua_State *L)
     }
 
     luaExpectParameterCount(L, 2);
+    if (lua_istable(L,1))
+    {
+        std::vector<double> px,py;
+        if (!luaToPointArrays(L, px, py))
+            return 0;
+        const int n = (int)px.size();
+        std::vector<CMPointVals> u(n);
+        std::unique_ptr<bool[]> inMesh(new bool[n]);
+        fpproc->GetPointValues(n, px.data(), py.data(), u.data(), inMesh.get());
+        luaPushPointValueTables(L, n, inMesh.get(), 14, [&u](int k, CComplex *v) {
+            v[0]=u[k].A;
+            v[1]=u[k].B1;
+            v[2]=u[k].B2;
+            v[3]=u[k].c;
+            v[4]=u[k].E;
+            v[5]=u[k].H1;
+            v[6]=u[k].H2;
+            v[7]=u[k].Je;
+            v[8]=u[k].Js;
+            v[9]=u[k].mu1;
+            v[10]=u[k].mu2;
+            v[11]=u[k].Pe;
+            v[12]=u[k].Ph;
+            v[13]=u[k].ff;
+        });
+        return 14;
+    }
+
     double px,py;
     px=lua_tonumber(L,1).re;
     py=lua_tonumber(L,2).re;
@@ -1666,6 +2051,55 @@ int femmcli::LuaMagneticsCommands::luaLineIntegral(lua_State *L)
     return 0;
 }
 
+/**
+ * @brief Sample the solution on a regular grid, and write the values to a binary file.
+ * The grid has nx times ny points, with corners (x0,y0) and (x1,y1).
+ * The file contains planes of nx*ny values, stored as 32 bit floats in native byte order, without header;
+ * points outside the mesh are NaN.
+ * The grid points are stored row by row, starting at (x0,y0). The planes are A, Bx, By and |B|;
+ * for time harmonic problems, they hold the real parts and are followed by the imaginary parts of A, Bx and By.
+ * Returns the number of planes.
+ * @param L
+ * @return 1 on success, 0 otherwise
+ * \ingroup LuaMM
+ *
+ * \internal
+ * ### Implements:
+ * - \lua{mo_rasterize(x0,y0,x1,y1,nx,ny,"filename")}
+ *
+ * This is an xfemm extension.
+ * \endinternal
+ */
+int femmcli::LuaMagneticsCommands::luaRasterize(lua_State *L)
+{
+    auto luaInstance = LuaInstance::instance(L);
+    std::shared_ptr<FemmState> femmState = std::dynamic_pointer_cast<FemmState>(luaInstance->femmState());
+    std::shared_ptr<FPProc> fpproc = std::dynamic_pointer_cast<FPProc>(femmState->getPostProcessor());
+    if (!fpproc)
+    {
+        lua_error(L,"No magnetics output in focus");
+        return 0;
+    }
+
+    luaExpectParameterCount(L, 7);
+    femm::RasterGrid grid;
+    if (!luaToRasterGrid(L, grid))
+        return 0;
+    std::string fileName = lua_tostring(L,7);
+
+    std::vector<float> values;
+    int numPlanes = fpproc->RasterizeFields(grid, values);
+    if (!femm::writeRaster(fileName, values))
+    {
+        std::string msg = "mo_rasterize(): could not write file " + fileName;
+        lua_error(L, msg.c_str());
+        return 0;
+    }
+
+    lua_pushnumber(L,numPlanes);
+    return 1;
+}
+
 /**
  * @brief Modify a field of a boundary property.
  * @param L
@@ -2647,8 +3081,14 @@ int femmcli::LuaMagneticsCommands::luaSetSmoothing(lua_State *L)
  *
  * Femm42 source documentation:
  *
+ * Returns the radial and tangential flux density on the centerline of the
+ * specified air gap element at the specified angle (in degrees).
+ *
+ * If the angle is a table of angles, tables of radial and tangential flux densities are returned.
+ * This is an xfemm extension.
+ *
  * @param L
- * @return 8
+ * @return 2
  * \ingroup LuaMM
  *
  * \internal
@@ -2673,6 +3113,25 @@ int femmcli::LuaMagneticsCommands::luaGetGapB(lua_State *L)
 
     luaExpectParameterCount(L, 2);
     std::string myBdryName = std::string (lua_tostring(L,1));
+
+    if (lua_istable(L,2))
+    {
+        std::vector<double> angles;
+        luaToNumberArray(L, 2, angles);
+        const int n = (int)angles.size();
+        std::vector<CComplex> br(n);
+        std::vector<CComplex> bt(n);
+        fpproc->getAGEflux(myBdryName, n, angles.data(), br.data(), bt.data());
+
+        std::unique_ptr<bool[]> valid(new bool[n]);
+        std::fill(valid.get(), valid.get()+n, true);
+        luaPushPointValueTables(L, n, valid.get(), 2, [&](int k, CComplex *v) {
+            v[0] = br[k];
+            v[1] = bt[k];
+        });
+        return 2;
+    }
+
     double angle = lua_todouble(L,2);
 
 	CComplex br=0;
@@ -2683,7 +3142,7 @@ int femmcli::LuaMagneticsCommands::luaGetGapB(lua_State *L)
     lua_pushnumber(L,br);
     lua_pushnumber(L,bt);
 
-	return 1;
+	return 2;
 
 }
 
@@ -2692,8 +3151,14 @@ int femmcli::LuaMagneticsCommands::luaGetGapB(lua_State *L)
  *
  * Femm42 source documentation:
  *
+ * Returns the vector potential on the centerline of the
+ * specified air gap element at the specified angle (in degrees).
+ *
+ * If the angle is a table of angles, a table of vector potentials is returned.
+ * This is an xfemm extension.
+ *
  * @param L
- * @return 8
+ * @return 1
  * \ingroup LuaMM
  *
  * \internal
@@ -2718,6 +3183,23 @@ int femmcli::LuaMagneticsCommands::luaGetGapA(lua_State *L)
 
     luaExpectParameterCount(L, 2);
     std::string myBdryName = std::string (lua_tostring(L,1));
+
+    if (lua_istable(L,2))
+    {
+        std::vector<double> angles;
+        luaToNumberArray(L, 2, angles);
+        const int n = (int)angles.size();
+        std::vector<CComplex> ac(n);
+        fpproc->getGapA(myBdryName, n, angles.data(), ac.data());
+
+        std::unique_ptr<bool[]> valid(new bool[n]);
+        std::fill(valid.get(), valid.get()+n, true);
+        luaPushPointValueTables(L, n, valid.get(), 1, [&](int k, CComplex *v) {
+            v[0] = ac[k];
+        });
+        return 1;
+    }
+
     double angle = lua_todouble(L,2);
 
 	CComplex ac=0;
@@ -2748,6 +3230,10 @@ int femmcli::LuaMagneticsCommands::luaGetGapA(lua_State *L)
  * The angle is specified in degrees. If the function is called with just the
  * BdryName, the func-tion returns the number of harmonics available.
  *
+ * If the harmonic number is a table of harmonic numbers, a table is returned for each of the six quantities;
+ * entries for harmonics that are not available are nil.
+ * This is an xfemm extension.
+ *
  * @param L
  * @return 8
  * \ingroup LuaMM
@@ -2789,6 +3275,37 @@ int femmcli::LuaMagneticsCommands::luaGetGapHarmonics(lua_State *L)
 		return 1;
 	}
 
+    if (lua_istable(L,2))
+    {
+        std::vector<double> harmonics;
+        luaToNumberArray(L, 2, harmonics);
+        std::vector<int> nh;
+        std::vector<CComplex> acc, acs, brc, brs, btc, bts;
+        fpproc->getGapHarmonics(myBdryName, nh, acc, acs, brc, brs, btc, bts);
+
+        // the harmonic numbers are sorted in ascending order
+        const int n = (int)harmonics.size();
+        std::unique_ptr<bool[]> found(new bool[n]);
+        std::vector<int> index(n);
+        for (int k=0; k<n; k++)
+        {
+            const int h = (int)harmonics[k];
+            auto it = std::lower_bound(nh.begin(), nh.end(), h);
+            found[k] = (it != nh.end() && *it == h);
+            index[k] = (int)(it - nh.begin());
+        }
+        luaPushPointValueTables(L, n, found.get(), 6, [&](int k, CComplex *v) {
+            const int j = index[k];
+            v[0] = acc[j];
+            v[1] = acs[j];
+            v[2] = brc[j];
+            v[3] = brs[j];
+            v[4] = btc[j];
+            v[5] = bts[j];
+        });
+        return 6;
+    }
+
 	double n = lua_todouble(L,2);
 	CComplex acc=0;
 	CComplex acs=0;
@@ -2810,4 +3327,89 @@ int femmcli::LuaMagneticsCommands::luaGetGapHarmonics(lua_State *L)
 }
 
 
+/**
+ * @brief Open a solution series in the magnetics output in focus.
+ * The problem description and mesh are taken from the base solution of the series,
+ * which is also loaded as current solution.
+ * Returns the number of steps in the series.
+ * @param L
+ * @return 1 on success, 0 otherwise
+ * \ingroup LuaMM
+ *
+ * \internal
+ * ### Implements:
+ * - \lua{mo_openseries("filename")}
+ *
+ * This is an xfemm extension; solution series are written by mi_analyze() if XFEMM_SOLUTION_SERIES is set.
+ * \endinternal
+ */
+int femmcli::LuaMagneticsCommands::luaOpenSeries(lua_State *L)
+{
+    auto luaInstance = LuaInstance::instance(L);
+    std::shared_ptr<FemmState> femmState = std::dynamic_pointer_cast<FemmState>(luaInstance->femmState());
+    std::shared_ptr<FPProc> fpproc = std::dynamic_pointer_cast<FPProc>(femmState->getPostProcessor());
+    if (!fpproc)
+    {
+        lua_error(L,"No magnetics output in focus");
+        return 0;
+    }
+
+    luaExpectParameterCount(L, 1);
+    std::string seriesFile = lua_tostring(L,1);
+    if (!fpproc->OpenSeries(seriesFile))
+    {
+        std::string msg = "mo_openseries(): error while loading solution series:\n";
+        msg += seriesFile;
+        lua_error(L, msg.c_str());
+        return 0;
+    }
+
+    lua_pushnumber(L,fpproc->NumSeriesSteps());
+    return 1;
+}
+
+/**
+ * @brief Load a step of the solution series opened by mo_openseries().
+ * Steps are numbered from 1 to the number of steps.
+ * Returns the label of the step.
+ * @param L
+ * @return 1 on success, 0 otherwise
+ * \ingroup LuaMM
+ *
+ * \internal
+ * ### Implements:
+ * - \lua{mo_loadseriesstep(n)}
+ *
+ * This is an xfemm extension.
+ * \endinternal
+ */
+int femmcli::LuaMagneticsCommands::luaLoadSeriesStep(lua_State *L)
+{
+    auto luaInstance = LuaInstance::instance(L);
+    std::shared_ptr<FemmState> femmState = std::dynamic_pointer_cast<FemmState>(luaInstance->femmState());
+    std::shared_ptr<FPProc> fpproc = std::dynamic_pointer_cast<FPProc>(femmState->getPostProcessor());
+    if (!fpproc)
+    {
+        lua_error(L,"No magnetics output in focus");
+        return 0;
+    }
+
+    luaExpectParameterCount(L, 1);
+    int step = (int)lua_todouble(L,1) - 1;
+    if (step < 0 || step >= fpproc->NumSeriesSteps())
+    {
+        lua_error(L,"mo_loadseriesstep(): invalid step number");
+        return 0;
+    }
+    if (!fpproc->OpenSeriesStep(step))
+    {
+        lua_error(L,"mo_loadseriesstep(): error while loading solution series step");
+        return 0;
+    }
+
+    lua_pushstring(L,fpproc->SeriesStepLabel(step).c_str());
+    return 1;
+}
+
+
 // vi:expandtab:tabstop=4 shiftwidth=4:
@@ -61,12 +61,15 @@ int luaGetPointValues(lua_State *L);
 int luaBGradient(lua_State *L);
 int luaGroupSelectBlock(lua_State *L);
 int luaLineIntegral(lua_State *L);
+int luaLoadSeriesStep(lua_State *L);
 int luaModifyBoundaryProperty(lua_State *L);
 int luaModifyCircuitProperty(lua_State *L);
 int luaModifyMaterialProperty(lua_State *L);
 int luaModifyPointProperty(lua_State *L);
 int luaNewDocument(lua_State *L);
+int luaOpenSeries(lua_State *L);
 int luaProblemDefinition(lua_State *L);
+int luaRasterize(lua_State *L);
 int luaSelectOutputBlocklabel(lua_State *L);
 int luaAddContourPointFromNode(lua_State *L);
 int luaSetArcsegmentProperty(lua_State *L);
@@ -75,6 +78,7 @@ int luaSetNodeProperty(lua_State *L);
 int luaSetPrevious(lua_State *L);
 int luaSetSmoothing(lua_State *L);
 int luaSetSegmentProperty(lua_State *L);
+int luaSweepAirGap(lua_State *L);
 int luaGetGapB(lua_State *L);
 int luaGetGapA(lua_State *L);
 int luaGetGapHarmonics(lua_State *L);
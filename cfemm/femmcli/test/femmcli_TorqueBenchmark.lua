@@ -35,6 +35,9 @@ end
 -- using absolute error margins because reference value for 0° is 0.
 tq_tolerance = 0.000042 -- worst error between FEMM and predicted torque was .000041 at 80°.
 tq_toleranceRel = 0.006 -- worst relative error was 0.0057% at 10°
+-- the weighted stress tensor torque on the rotor is less accurate
+wst_tolerance = 0.0002 -- worst error was .000194 at 0°
+wst_toleranceRel = 0.11 -- worst relative error was 0.108% at 10°
 tq_ref = {}
 tq_ref[0] = 0
 tq_ref[10] = 0.173648
@@ -60,6 +63,11 @@ for deg = 0, 90, 10 do
 
 	tq=mo_gapintegral("AGE", 0)
 	failed= failed +check("Torque_"..deg, tq, tq_ref[deg], tq_tolerance, tq_toleranceRel)
+
+	-- the mesh is the same for all angles, so the mask of the first angle is reused
+	mo_selectblock(0,0)
+	tq=mo_blockintegral(22)
+	failed= failed +check("WST_Torque_"..deg, tq, tq_ref[deg], wst_tolerance, wst_toleranceRel)
 end
 
 assert(failed==0)
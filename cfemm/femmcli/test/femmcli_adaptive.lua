@@ -0,0 +1,55 @@
+-- femmcli_adaptive.lua
+-- Solve the torque benchmark with adaptive mesh refinement (XFEMM_ADAPTIVE_TOLERANCE).
+-- The analytical torque at 30 degrees is 0.5 Nm; the weighted stress tensor torque
+-- of the refined mesh must be closer to it than the torque of the initial mesh.
+-- Output:
+-- SUCCESS
+showconsole()
+
+-- enable for additional output (including the estimated error of each step):
+-- XFEMM_VERBOSE = 1
+
+open("femmcli_TorqueBenchmark.fem")
+mi_saveas("femmcli_adaptive.result.fem")
+mi_modifyboundprop("AGE",10,30)
+
+failed=0
+function check(name, ok)
+	if ok then
+		print("[  ok  ] " .. name)
+	else
+		print("[FAILED] " .. name)
+		failed = failed + 1
+	end
+end
+
+function solve()
+	mi_analyze()
+	mi_loadsolution()
+	mo_selectblock(0,0)
+	local tq = mo_blockintegral(22)
+	mo_clearblock()
+	return mo_numelements(), tq
+end
+
+n1, tq1 = solve()
+
+maxElements = 40000
+XFEMM_ADAPTIVE_TOLERANCE = 0.01
+XFEMM_ADAPTIVE_MAX_ELEMENTS = maxElements
+n2, tq2 = solve()
+print("elements: " .. n1 .. " -> " .. n2 .. ", estimated error: " .. XFEMM_ADAPTIVE_ERROR)
+print("torque error: " .. abs(tq1-0.5) .. " -> " .. abs(tq2-0.5))
+
+check("refined", n2 > n1)
+check("tolerance or budget reached", XFEMM_ADAPTIVE_ERROR <= 0.01 or n2 > 0.5*maxElements)
+check("budget", n2 < 1.5*maxElements)
+check("torque", abs(tq2-0.5) < 0.5*abs(tq1-0.5))
+
+-- without a tolerance, the initial mesh is used again:
+XFEMM_ADAPTIVE_TOLERANCE = 0
+n3, tq3 = solve()
+check("not refined", n3 == n1)
+
+assert(failed==0)
+write("SUCCESS\n")
@@ -0,0 +1,72 @@
+-- femmcli_airgapsweep.lua
+-- Rotor angle sweep of the torque benchmark with mi_sweepairgap.
+-- The torque of each step must match the torque of an individual analysis.
+-- Turning the rotor with mi_modifyboundprop must not need a new mesh, either.
+-- Output:
+-- SUCCESS
+showconsole()
+
+-- check variable <name>,
+-- compare <value> against <expected> value
+-- if the absolute difference is greater than the margin, complain and return 1
+function check(name, value, expected, margin)
+	diff=value - expected
+	if abs(diff) > margin then
+		fail=1
+		result="[FAILED] "
+	else
+		fail=0
+		result="[  ok  ] "
+	end
+	print(result .. name .. ": " .. value .. " (expected: " .. expected .. ", diff: " .. diff .. ", margin: " .. margin .. ")")
+	return fail
+end
+
+-- enable for additional output:
+-- XFEMM_VERBOSE = 1
+
+open("femmcli_TorqueBenchmark.fem")
+mi_saveas("femmcli_airgapsweep.result.fem")
+
+failed=0
+
+-- reference: mesh each angle from scratch
+XFEMM_ALWAYS_REMESH = 1
+tq_ref = {}
+for deg = 0, 90, 30 do
+	mi_modifyboundprop("AGE",10,deg)
+	mi_analyze()
+	mi_loadsolution()
+	tq_ref[deg]=mo_gapintegral("AGE", 0)
+end
+
+-- the air gap angles do not change the mesh, so the solver turns the air gap element of the reused mesh
+XFEMM_ALWAYS_REMESH = 0
+for deg = 0, 90, 30 do
+	mi_modifyboundprop("AGE",10,deg)
+	mi_analyze()
+	mi_loadsolution()
+	failed = failed + check("Reused_mesh_torque_"..deg, mo_gapintegral("AGE", 0), tq_ref[deg], 1e-9)
+end
+
+XFEMM_SOLUTION_SERIES = "femmcli_airgapsweep.result.series"
+remove(XFEMM_SOLUTION_SERIES)
+mi_sweepairgap("AGE", {0, 30, 60, 90}, {0, 0, 0, 0})
+
+-- the first step is the base solution
+mi_loadsolution()
+failed = failed + check("Base_torque", mo_gapintegral("AGE", 0), tq_ref[0], 1e-8)
+
+numSteps = mo_openseries(XFEMM_SOLUTION_SERIES)
+failed = failed + check("steps", numSteps, 4, 0)
+step = numSteps
+for deg = 90, 0, -30 do
+	label = mo_loadseriesstep(step)
+	assert(label == "InnerAngle=" .. deg .. " OuterAngle=0", "unexpected label: " .. label)
+	-- each step starts from the previous solution, so the results are not bit-identical:
+	failed = failed + check("Sweep_torque_"..deg, mo_gapintegral("AGE", 0), tq_ref[deg], 1e-8)
+	step = step - 1
+end
+
+assert(failed==0)
+write("SUCCESS\n")
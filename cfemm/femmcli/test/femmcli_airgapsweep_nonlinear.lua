@@ -0,0 +1,76 @@
+-- femmcli_airgapsweep_nonlinear.lua
+-- Rotor angle sweep of the torque benchmark with a saturating rotor core.
+-- Each step of mi_sweepairgap continues the Newton iteration from the permeabilities of the previous step;
+-- the torque must still match the torque of an individual analysis with a new mesh.
+-- Output:
+-- SUCCESS
+showconsole()
+
+-- check variable <name>,
+-- compare <value> against <expected> value
+-- if the relative difference is greater than the margin, complain and return 1
+function check(name, value, expected, margin)
+	diff=value - expected
+	if abs(diff) > margin*abs(expected) then
+		fail=1
+		result="[FAILED] "
+	else
+		fail=0
+		result="[  ok  ] "
+	end
+	print(result .. name .. ": " .. value .. " (expected: " .. expected .. ", diff: " .. diff .. ", relative margin: " .. margin .. ")")
+	return fail
+end
+
+-- enable for additional output:
+-- XFEMM_VERBOSE = 1
+
+open("femmcli_TorqueBenchmark.fem")
+mi_saveas("femmcli_airgapsweep_nonlinear.result.fem")
+
+-- the rotor region around the magnet is made of saturating iron
+mi_addmaterial("Iron", 1, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0)
+bh = { {0, 0}, {0.3, 60}, {0.6, 100}, {0.9, 150}, {1.1, 250}, {1.3, 600},
+       {1.5, 2000}, {1.7, 8000}, {1.9, 25000}, {2.1, 80000}, {2.3, 200000} }
+for i = 1, getn(bh) do
+	mi_addbhpoint("Iron", bh[i][1], bh[i][2])
+end
+mi_selectlabel(0.23, 0.48)
+mi_setblockprop("Iron", 0, 0.053, "", 0, 0, 0)
+mi_clearselected()
+
+failed=0
+angles = {0, 20, 45, 70, 90}
+
+-- reference: mesh and solve each angle from scratch
+XFEMM_ALWAYS_REMESH = 1
+tq_ref = {}
+for i = 1, getn(angles) do
+	mi_modifyboundprop("AGE", 10, angles[i])
+	mi_analyze()
+	mi_loadsolution()
+	tq_ref[i]=mo_gapintegral("AGE", 0)
+end
+XFEMM_ALWAYS_REMESH = nil
+
+-- the core must actually saturate, i.e. the problem must be nonlinear:
+A, B1, B2, Sig, E, H1, H2, Je, Js, Mu1, Mu2 = mo_getpointvalues(0.23, 0.48)
+print("relative permeability in the rotor core: " .. Mu1)
+assert(Mu1 < 0.5*(0.3/60)/(4e-7*PI), "the rotor core does not saturate")
+
+mi_modifyboundprop("AGE", 10, angles[1])
+XFEMM_SOLUTION_SERIES = "femmcli_airgapsweep_nonlinear.result.series"
+remove(XFEMM_SOLUTION_SERIES)
+mi_sweepairgap("AGE", angles, {0, 0, 0, 0, 0})
+
+numSteps = mo_openseries(XFEMM_SOLUTION_SERIES)
+failed = failed + check("steps", numSteps, getn(angles), 0)
+for i = 1, getn(angles) do
+	label = mo_loadseriesstep(i)
+	assert(label == "InnerAngle=" .. angles[i] .. " OuterAngle=0", "unexpected label: " .. label)
+	-- the Newton iterations start from different permeabilities, so the results are not bit-identical:
+	failed = failed + check("Sweep_torque_"..angles[i], mo_gapintegral("AGE", 0), tq_ref[i], 1e-6)
+end
+
+assert(failed==0)
+write("SUCCESS\n")
@@ -75,6 +75,30 @@ for angle = 0, 90, 10 do
     mi_loadsolution()
 
     xfemm_torque[idx] = mo_gapintegral("AGE", 0)
+
+    -- batch queries of the air gap field: same values as individual queries
+    gapAngles = {0, 17.5, 45, 90}
+    Br, Bt = mo_getgapb("AGE", gapAngles)
+    Ac = mo_getgapa("AGE", gapAngles)
+    for k=1,getn(gapAngles) do
+        br, bt = mo_getgapb("AGE", gapAngles[k])
+        if (br ~= Br[k]) or (bt ~= Bt[k]) or (mo_getgapa("AGE", gapAngles[k]) ~= Ac[k]) then
+            print("[FAILED] batch air gap field differs at " .. gapAngles[k] .. " degrees")
+            failed = failed + 1
+        end
+    end
+    acc, acs, brc, brs, btc, bts = mo_getgapharmonics("AGE", {1, 2, 3, 100000})
+    if (acc[4] ~= nil) then
+        print("[FAILED] batch air gap harmonics: value for a harmonic that is not available")
+        failed = failed + 1
+    end
+    for k=1,3 do
+        acc1, acs1, brc1, brs1, btc1, bts1 = mo_getgapharmonics("AGE", k)
+        if (acc1 ~= acc[k]) or (acs1 ~= acs[k]) or (brc1 ~= brc[k]) or (brs1 ~= brs[k]) or (btc1 ~= btc[k]) or (bts1 ~= bts[k]) then
+            print("[FAILED] batch air gap harmonics differ for harmonic " .. k)
+            failed = failed + 1
+        end
+    end
 		
     mo_close()
 
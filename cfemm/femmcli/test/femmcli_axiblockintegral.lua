@@ -0,0 +1,105 @@
+-- femmcli_axiblockintegral.lua
+-- Block integrals of an axisymmetric problem are evaluated on several threads.
+-- The script is run with XFEMM_NUM_THREADS=1 and with XFEMM_NUM_THREADS=4:
+-- the first run stores its results, and the second run must reproduce them exactly.
+-- Output:
+-- SUCCESS
+showconsole()
+
+-- enable for additional output:
+-- XFEMM_VERBOSE = 1
+
+threads = getenv("XFEMM_NUM_THREADS")
+assert(threads, "XFEMM_NUM_THREADS is not set")
+referenceFile = "femmcli_axiblockintegral.result.txt"
+
+function rectangle(x1, y1, x2, y2)
+	mi_addnode(x1, y1)
+	mi_addnode(x2, y1)
+	mi_addnode(x2, y2)
+	mi_addnode(x1, y2)
+	mi_addsegment(x1, y1, x2, y1)
+	mi_addsegment(x2, y1, x2, y2)
+	mi_addsegment(x2, y2, x1, y2)
+	mi_addsegment(x1, y2, x1, y1)
+end
+
+-- a coil around an iron core, surrounded by air
+newdocument(0)
+mi_probdef(0, "millimeters", "axi", 1e-8, 0, 30)
+mi_addmaterial("Air", 1, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0)
+mi_addmaterial("Core", 1000, 1000, 0, 0, 0, 0, 0, 1, 0, 0, 0)
+mi_addmaterial("Coil", 1, 1, 0, 2, 58, 0, 0, 1, 0, 0, 0)
+mi_addboundprop("A=0", 0, 0, 0, 0, 0, 0, 0, 0, 0)
+
+rectangle(0, -60, 80, 60)
+rectangle(0, -20, 8, 20)
+rectangle(12, -15, 24, 15)
+
+mi_selectsegment(80, 0)
+mi_selectsegment(40, 60)
+mi_selectsegment(40, -60)
+mi_setsegmentprop("A=0", 0, 1, 0, 0)
+mi_clearselected()
+
+mi_addblocklabel(50, 40)
+mi_selectlabel(50, 40)
+mi_setblockprop("Air", 0, 1, "", 0, 0, 0)
+mi_clearselected()
+mi_addblocklabel(4, 0)
+mi_selectlabel(4, 0)
+mi_setblockprop("Core", 0, 0.5, "", 0, 1, 0)
+mi_clearselected()
+mi_addblocklabel(18, 0)
+mi_selectlabel(18, 0)
+mi_setblockprop("Coil", 0, 0.5, "", 0, 2, 0)
+mi_clearselected()
+
+mi_saveas("femmcli_axiblockintegral.result" .. threads .. ".fem")
+mi_analyze()
+mi_loadsolution()
+
+-- A.J, A, Lorentz force, coenergy-like and volume integrals (the ones that use AxiInt()),
+-- plus the stored energy and the Henrotte force over the core
+integrals = {0, 1, 2, 10, 12, 17, 19, 24}
+mo_groupselectblock(1)
+mo_groupselectblock(2)
+
+results = {}
+failed = 0
+for i=1,getn(integrals) do
+	results[i] = format("%.17g", mo_blockintegral(integrals[i]))
+	-- repeated evaluations must give the same result
+	for k=1,5 do
+		local again = format("%.17g", mo_blockintegral(integrals[i]))
+		if again ~= results[i] then
+			print("[FAILED] integral " .. integrals[i] .. " is not reproducible: " .. results[i] .. " / " .. again)
+			failed = failed + 1
+		end
+	end
+end
+mo_clearblock()
+
+if threads == "1" then
+	local f = openfile(referenceFile, "w")
+	for i=1,getn(integrals) do
+		write(f, results[i] .. "\n")
+	end
+	closefile(f)
+else
+	local f = openfile(referenceFile, "r")
+	assert(f, "reference results from XFEMM_NUM_THREADS=1 are missing")
+	for i=1,getn(integrals) do
+		local expected = read(f, "*l")
+		if results[i] == expected then
+			print("[  ok  ] integral " .. integrals[i] .. ": " .. results[i])
+		else
+			print("[FAILED] integral " .. integrals[i] .. ": " .. results[i] .. " (1 thread: " .. expected .. ")")
+			failed = failed + 1
+		end
+	end
+	closefile(f)
+end
+
+assert(failed==0)
+write("SUCCESS\n")
@@ -41,5 +41,21 @@ failed= failed +check("ex", ex, 4, 0.1)
 failed= failed +check("ey", ey, 4, 0.1)
 failed= failed +check("nrg", nrg, 1.900419790445539e-008, 3)
 
+-- vectorised query: same values as individual queries, nil outside the mesh
+X = {0.25, 0.125, 0.375, 1e6}
+Y = {0, 0.125, -0.25, 1e6}
+Vs,Dxs,Dys,Exs,Eys,exs,eys,nrgs = eo_getpointvalues(X,Y)
+for k=1,3 do
+	V,Dx,Dy,Ex,Ey,ex,ey,nrg = eo_getpointvalues(X[k],Y[k])
+	if (V == nil) or (V ~= Vs[k]) or (Dx ~= Dxs[k]) or (Dy ~= Dys[k]) or (Ex ~= Exs[k]) or (Ey ~= Eys[k]) or (ex ~= exs[k]) or (ey ~= eys[k]) or (nrg ~= nrgs[k]) then
+		print("[FAILED] vectorised point values differ at point " .. k)
+		failed = failed + 1
+	end
+end
+if (Vs[4] ~= nil) or (Vs.n ~= 4) then
+	print("[FAILED] vectorised point values outside the mesh")
+	failed = failed + 1
+end
+
 assert(failed==0)
 write("SUCCESS\n")
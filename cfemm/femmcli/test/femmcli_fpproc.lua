@@ -47,5 +47,122 @@ failed = failed + check("Mu2", Mu2, 1, 2)
 failed = failed + check("Pe", Pe, 0, 2)
 failed = failed + check("Ph ", Ph , 0, 2)
 
+-- vectorised query: same values as individual queries, nil outside the mesh
+X = {0.25, 0.125, 0.375, 1e6}
+Y = {0, 0.125, 0.25, 1e6}
+As,B1s,B2s,Sigs,Es,H1s,H2s = mo_getpointvalues(X,Y)
+for k=1,3 do
+	A,B1,B2,Sig,E,H1,H2 = mo_getpointvalues(X[k],Y[k])
+	if (A == nil) or (A ~= As[k]) or (B1 ~= B1s[k]) or (B2 ~= B2s[k]) or (Sig ~= Sigs[k]) or (E ~= Es[k]) or (H1 ~= H1s[k]) or (H2 ~= H2s[k]) then
+		print("[FAILED] vectorised point values differ at point " .. k)
+		failed = failed + 1
+	end
+end
+if (As[4] ~= nil) or (As.n ~= 4) then
+	print("[FAILED] vectorised point values outside the mesh")
+	failed = failed + 1
+end
+
+-- several block integrals in one pass: same values as individual integrals
+mo_groupselectblock()
+types = {0, 2, 5, 7, 10, 24}
+Z = mo_blockintegral(types)
+for k=1,getn(types) do
+	if Z[k] ~= mo_blockintegral(types[k]) then
+		print("[FAILED] block integral " .. types[k] .. " differs when computed together with others")
+		failed = failed + 1
+	end
+end
+
+-- line integrals are evaluated element by element: splitting the contour does not change them
+mo_clearcontour()
+mo_addcontour(0.05,0.05)
+mo_addcontour(0.45,0.3)
+Ht = mo_lineintegral(1)
+Bn2 = mo_lineintegral(5)
+mo_clearcontour()
+for k=0,5 do
+	mo_addcontour(0.05+0.08*k, 0.05+0.05*k)
+end
+if abs(mo_lineintegral(1)-Ht) > 1e-9*abs(Ht) or abs(mo_lineintegral(5)-Bn2) > 1e-9*abs(Bn2) then
+	print("[FAILED] line integrals depend on the contour subdivision")
+	failed = failed + 1
+end
+
+-- raster export: one float per grid point and plane
+-- the two rightmost grid columns are outside the mesh
+nx = 5
+ny = 4
+x0 = 0.011
+y0 = 0.013
+dx = 0.25
+dy = 0.1
+if mo_rasterize(x0,y0,x0+(nx-1)*dx,y0+(ny-1)*dy,nx,ny,"femmcli_fpproc_raster.bin") ~= 4 then
+	print("[FAILED] mo_rasterize plane count")
+	failed = failed + 1
+end
+readfrom("femmcli_fpproc_raster.bin")
+raster = read("*a")
+readfrom()
+remove("femmcli_fpproc_raster.bin")
+if strlen(raster) ~= 4*nx*ny*4 then
+	print("[FAILED] mo_rasterize file size: " .. strlen(raster))
+	failed = failed + 1
+end
+
+-- decode the little endian 32 bit float at index k (starting at 0); returns nil for NaN
+function rasterValue(k)
+	local b1,b2,b3,b4 = strbyte(raster,4*k+1), strbyte(raster,4*k+2), strbyte(raster,4*k+3), strbyte(raster,4*k+4)
+	local exponent = mod(b4,128)*2 + floor(b3/128)
+	local mantissa = mod(b3,128)*65536 + b2*256 + b1
+	local value
+	if exponent == 255 then
+		return nil
+	elseif exponent == 0 then
+		value = ldexp(mantissa, -149)
+	else
+		value = ldexp(mantissa + 8388608, exponent-150)
+	end
+	if b4 >= 128 then
+		value = -value
+	end
+	return value
+end
+
+-- the raster values must be the point values, rounded to float
+function sameAsFloat(value, expected)
+	return abs(value - expected) <= 1e-6*abs(expected)
+end
+
+numInside = 0
+numOutside = 0
+for j=0,ny-1 do
+	for i=0,nx-1 do
+		local x = x0+i*dx
+		local y = y0+j*dy
+		local p = j*nx+i
+		local A,B1,B2 = mo_getpointvalues(x,y)
+		local rA, rBx, rBy, rB = rasterValue(p), rasterValue(nx*ny+p), rasterValue(2*nx*ny+p), rasterValue(3*nx*ny+p)
+		if A == nil then
+			numOutside = numOutside + 1
+			if rA or rBx or rBy or rB then
+				print("[FAILED] raster value outside the mesh is not NaN at (" .. x .. "," .. y .. ")")
+				failed = failed + 1
+			end
+		else
+			numInside = numInside + 1
+			if not (rA and sameAsFloat(rA,A) and sameAsFloat(rBx,B1) and sameAsFloat(rBy,B2)
+					and sameAsFloat(rB,sqrt(B1*B1+B2*B2))) then
+				print("[FAILED] raster values differ from point values at (" .. x .. "," .. y .. ")")
+				failed = failed + 1
+			end
+		end
+	end
+end
+if numInside == 0 or numOutside == 0 then
+	print("[FAILED] raster grid does not cover points inside and outside the mesh: " .. numInside .. " / " .. numOutside)
+	failed = failed + 1
+end
+
 assert(failed==0)
 write("SUCCESS\n")
@@ -42,5 +42,21 @@ failed = failed + check("Gy", Gy, 5.399252187839117, 4)
 failed = failed + check("kx", kx, 0.02645021728882154, 2)
 failed = failed + check("ky", ky, 0.02645021728882154, 2)
 
+-- vectorised query: same values as individual queries, nil outside the mesh
+X = {1.1, 1.0, 1.2, 1e6}
+Y = {1.1, 1.2, 1.0, 1e6}
+Ts,Fxs,Fys,Gxs,Gys,kxs,kys = ho_getpointvalues(X,Y)
+for k=1,3 do
+	T,Fx,Fy,Gx,Gy,kx,ky = ho_getpointvalues(X[k],Y[k])
+	if (T == nil) or (T ~= Ts[k]) or (Fx ~= Fxs[k]) or (Fy ~= Fys[k]) or (Gx ~= Gxs[k]) or (Gy ~= Gys[k]) or (kx ~= kxs[k]) or (ky ~= kys[k]) then
+		print("[FAILED] vectorised point values differ at point " .. k)
+		failed = failed + 1
+	end
+end
+if (Ts[4] ~= nil) or (Ts.n ~= 4) then
+	print("[FAILED] vectorised point values outside the mesh")
+	failed = failed + 1
+end
+
 assert(failed==0)
 write("SUCCESS\n")
@@ -0,0 +1,90 @@
+-- femmcli_maskcache.lua
+-- Weighted stress tensor masks are cached across selections and documents (see FPProc::MakeMask()).
+-- Results with a cached mask must be exactly the same as with a newly computed mask,
+-- and changes to the mask problem (material, geometry) must not use a stale mask.
+-- Output:
+-- SUCCESS
+showconsole()
+
+-- enable for additional output:
+-- XFEMM_VERBOSE = 1
+
+failed=0
+function check(name, ok)
+	if ok then
+		print("[  ok  ] " .. name)
+	else
+		print("[FAILED] " .. name)
+		failed = failed + 1
+	end
+end
+
+-- solve the torque benchmark at the given rotor angle
+function solve(deg)
+	mi_modifyboundprop("AGE",10,deg)
+	mi_modifyboundprop("AGE",11,0)
+	mi_saveas("femmcli_maskcache.result" .. deg .. ".fem")
+	mi_analyze()
+	mi_loadsolution()
+end
+
+-- weighted stress tensor torque on the rotor; returns the torque and whether the mask came from the cache
+function wstTorque(useCache)
+	if useCache then
+		XFEMM_NO_MASK_CACHE = nil
+	else
+		XFEMM_NO_MASK_CACHE = 1
+	end
+	mo_clearblock()
+	mo_selectblock(0,0)
+	local tq = mo_blockintegral(22)
+	XFEMM_NO_MASK_CACHE = nil
+	return format("%.17g", tq), XFEMM_MASK_FROM_CACHE
+end
+
+open("femmcli_TorqueBenchmark.fem")
+
+-- the first mask is computed, selecting the same blocks again uses the cache
+solve(10)
+tqA, cachedA = wstTorque(1)
+tqA2, cachedA2 = wstTorque(1)
+check("first mask is computed", cachedA == 0)
+check("same selection uses the cache", cachedA2 == 1)
+check("same selection, same result: " .. tqA .. " / " .. tqA2, tqA2 == tqA)
+
+-- another document with the same mesh (the AGE angle does not change the mask problem,
+-- as the air gap boundaries are fixed to zero)
+solve(40)
+tqB, cachedB = wstTorque(1)
+tqBnew, cachedBnew = wstTorque(nil)
+check("other document uses the cache", cachedB == 1)
+check("cache disabled", cachedBnew == 0)
+check("other document, cached mask gives the same result: " .. tqB .. " / " .. tqBnew, tqB == tqBnew)
+
+-- and back to the first document
+solve(10)
+tqA3, cachedA3 = wstTorque(1)
+check("first document again uses the cache", cachedA3 == 1)
+check("first document again, same result: " .. tqA .. " / " .. tqA3, tqA3 == tqA)
+
+-- a material change that turns the stator magnet into free space changes the mask problem
+mi_modifymaterial("Ext", 3, 0)
+solve(10)
+tqM, cachedM = wstTorque(1)
+tqMnew = wstTorque(nil)
+check("material change invalidates the cached mask", cachedM == 0)
+check("material change, same result as without cache: " .. tqM .. " / " .. tqMnew, tqM == tqMnew)
+mi_modifymaterial("Ext", 3, 1591549.4309189499)
+
+-- a different mesh size changes the mesh
+mi_selectlabel(0.23, 0.48)
+mi_setblockprop("Air", 0, 0.04, "", 0, 0, 0)
+mi_clearselected()
+solve(10)
+tqG, cachedG = wstTorque(1)
+tqGnew = wstTorque(nil)
+check("geometry change invalidates the cached mask", cachedG == 0)
+check("geometry change, same result as without cache: " .. tqG .. " / " .. tqGnew, tqG == tqGnew)
+
+assert(failed==0)
+write("SUCCESS\n")
@@ -0,0 +1,60 @@
+-- femmcli_meshreuse.lua
+-- Analyses that only differ in material or circuit properties reuse the mesh of the previous analysis.
+-- The results must be the same as with a new mesh, and changing a mesh size must lead to a new mesh.
+-- Output:
+-- SUCCESS
+showconsole()
+
+-- enable for additional output:
+-- XFEMM_VERBOSE = 1
+
+open("femmcli_fpproc.fem")
+mi_saveas("femmcli_meshreuse.result.fem")
+
+function solve()
+	mi_analyze()
+	local reused = XFEMM_MESH_REUSED
+	mi_loadsolution()
+	local A = mo_getpointvalues(0.1, 0.2)
+	return mo_numelements(), A, reused
+end
+
+failed=0
+function check(name, ok)
+	if ok then
+		print("[  ok  ] " .. name)
+	else
+		print("[FAILED] " .. name)
+		failed = failed + 1
+	end
+end
+
+n1, A1, reused1 = solve()
+
+-- only material and circuit properties change: the mesh is reused
+mi_modifymaterial("1117 Steel", 1, 1000)
+mi_modifycircprop("Coil A", 1, 10)
+n2, A2, reused2 = solve()
+
+-- the same problem with a new mesh:
+XFEMM_ALWAYS_REMESH = 1
+n3, A3, reused3 = solve()
+XFEMM_ALWAYS_REMESH = nil
+
+check("first analysis creates a new mesh", reused1 == 0)
+check("mesh is reused after property change", reused2 == 1)
+check("XFEMM_ALWAYS_REMESH creates a new mesh", reused3 == 0)
+check("same mesh after property change: " .. n1 .. " / " .. n2, n2 == n1)
+check("property change has an effect: " .. A1 .. " / " .. A2, A2 ~= A1)
+check("reused mesh gives the same result as a new mesh: " .. A2 .. " / " .. A3, A3 == A2 and n3 == n2)
+
+-- a finer mesh in the air region must result in a new mesh
+mi_selectlabel(0.31593306555236927, 0.20540293473960494)
+mi_setblockprop("Air", 0, 0.002, "", 0, 0, 0)
+mi_clearselected()
+n4, A4, reused4 = solve()
+check("mesh size change creates a new mesh", reused4 == 0)
+check("new mesh after mesh size change: " .. n2 .. " / " .. n4, n4 > n2)
+
+assert(failed==0)
+write("SUCCESS\n")
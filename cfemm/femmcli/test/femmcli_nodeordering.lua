@@ -0,0 +1,46 @@
+-- femmcli_nodeordering.lua
+-- Solve the torque benchmark with each node ordering selectable by XFEMM_NODE_ORDERING.
+-- The ordering only affects the solver's performance, so all torques must agree.
+-- Output:
+-- SUCCESS
+showconsole()
+
+-- check variable <name>,
+-- compare <value> against <expected> value
+-- if the absolute difference is greater than the margin, complain and return 1
+function check(name, value, expected, margin)
+	diff=value - expected
+	if abs(diff) > margin then
+		fail=1
+		result="[FAILED] "
+	else
+		fail=0
+		result="[  ok  ] "
+	end
+	print(result .. name .. ": " .. value .. " (expected: " .. expected .. ", diff: " .. diff .. ", margin: " .. margin .. ")")
+	return fail
+end
+
+-- enable for additional output (including bandwidth and profile):
+-- XFEMM_VERBOSE = 1
+
+open("femmcli_TorqueBenchmark.fem")
+mi_saveas("femmcli_nodeordering.result.fem")
+mi_modifyboundprop("AGE",10,30)
+
+failed=0
+XFEMM_NODE_ORDERING = "cm"
+mi_analyze()
+mi_loadsolution()
+tq_ref=mo_gapintegral("AGE", 0)
+
+orderings = {"rcm", "nd"}
+for k = 1, getn(orderings) do
+	XFEMM_NODE_ORDERING = orderings[k]
+	mi_analyze()
+	mi_loadsolution()
+	failed = failed + check("Torque_"..orderings[k], mo_gapintegral("AGE", 0), tq_ref, 1e-6)
+end
+
+assert(failed==0)
+write("SUCCESS\n")
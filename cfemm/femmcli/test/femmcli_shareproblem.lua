@@ -0,0 +1,62 @@
+-- femmcli_shareproblem.lua
+-- Same as femmcli_fpproc.lua, but the solution only references the problem file.
+-- SUCCESS
+showconsole()
+
+-- check variable <name>,
+-- compare <value> against <expected> value
+-- if the relative difference is greater than the margin (in percent), complain and return 1
+function check(name, value, expected, margin)
+	diff=100*(value - expected) / expected
+	if abs(diff) > margin then
+		fail=1
+		result="[FAILED] "
+	else
+		fail=0
+		result="[  ok  ] "
+	end
+	print(result .. name .. ": " .. value .. " (expected: " .. expected .. ", diff: " .. diff .. "%, margin: " .. margin .. "%)")
+	return fail
+end
+
+-- enable for additional output:
+-- XFEMM_VERBOSE = 1
+XFEMM_SHARE_PROBLEM_FILE = 1
+
+open("femmcli_fpproc.fem")
+mi_saveas("femmcli_shareproblem.result.fem")
+mi_analyze()
+
+-- the solution file must start with the fingerprint of and the reference to the problem file:
+ansfile = openfile("femmcli_shareproblem.result.ans","r")
+assert(not ansfile==nil,"solution file was not written")
+firstline = read(ansfile,"*l")
+secondline = read(ansfile,"*l")
+closefile(ansfile)
+assert(strfind(firstline,"^%[ProblemFileHash%] = \"%d+:%x+\"$"),"unexpected first line: " .. firstline)
+assert(secondline == "[ProblemFile] = \"femmcli_shareproblem.result.fem\"","unexpected second line: " .. secondline)
+
+mi_loadsolution()
+
+A,B1,B2,Sig,E,H1,H2,Je,Js,Mu1,Mu2,Pe,Ph = mo_getpointvalues(0.250, 0)
+
+failed=0
+failed = failed + check("A", A, 1.245741227364988e-014, 2)
+failed = failed + check("B1", B1, -9.855007421888915e-014, 2)
+failed = failed + check("B2", B2, 3.052725906923963e-014, 2)
+failed = failed + check("H1", H1, -7.842365727004682e-008, 2)
+failed = failed + check("H2", H2, 2.429282089958189e-008, 2)
+failed = failed + check("Mu1", Mu1, 1, 2)
+failed = failed + check("Mu2", Mu2, 1, 2)
+
+assert(failed==0)
+
+-- editing the problem file after solving must invalidate the solution:
+mi_addnode(0.5, 0.5)
+mi_saveas("femmcli_shareproblem.result.fem")
+stalefailed = nil
+call(mi_loadsolution, {}, "x", function(msg) stalefailed = msg end)
+assert(stalefailed, "solution was loaded although its problem file has been changed")
+print("[  ok  ] stale solution rejected: " .. stalefailed)
+
+write("SUCCESS\n")
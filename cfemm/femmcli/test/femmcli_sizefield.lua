@@ -0,0 +1,62 @@
+-- femmcli_sizefield.lua
+-- Mesh the torque benchmark with a size field derived from an earlier solution (XFEMM_SIZE_FIELD).
+-- The analytical torque at 30 degrees is 0.5 Nm; the weighted stress tensor torque
+-- with the size field must be closer to it than the torque of the initial mesh.
+-- Output:
+-- SUCCESS
+showconsole()
+
+-- enable for additional output:
+-- XFEMM_VERBOSE = 1
+
+open("femmcli_TorqueBenchmark.fem")
+mi_modifyboundprop("AGE",10,30)
+mi_saveas("femmcli_sizefield.base.fem")
+
+failed=0
+function check(name, ok)
+	if ok then
+		print("[  ok  ] " .. name)
+	else
+		print("[FAILED] " .. name)
+		failed = failed + 1
+	end
+end
+
+function solve()
+	mi_analyze()
+	mi_loadsolution()
+	mo_selectblock(0,0)
+	local tq = mo_blockintegral(22)
+	mo_clearblock()
+	return mo_numelements(), tq
+end
+
+n1, tq1 = solve()
+
+-- size field from a solution file:
+mi_saveas("femmcli_sizefield.result.fem")
+maxElements = 20000
+XFEMM_SIZE_FIELD = "femmcli_sizefield.base.ans"
+XFEMM_SIZE_FIELD_TOLERANCE = 0.01
+XFEMM_SIZE_FIELD_MAX_ELEMENTS = maxElements
+n2, tq2 = solve()
+print("elements: " .. n1 .. " -> " .. n2)
+print("torque error: " .. abs(tq1-0.5) .. " -> " .. abs(tq2-0.5))
+check("refined", n2 > n1)
+check("budget", n2 < 1.5*maxElements)
+check("torque", abs(tq2-0.5) < 0.75*abs(tq1-0.5))
+
+-- size field from the loaded solution:
+XFEMM_SIZE_FIELD = 1
+n3, tq3 = solve()
+print("elements: " .. n3)
+check("loaded solution", n3 > n1 and n3 < 1.5*maxElements)
+
+-- without size field, the initial mesh is used again:
+XFEMM_SIZE_FIELD = 0
+n4, tq4 = solve()
+check("not refined", n4 == n1)
+
+assert(failed==0)
+write("SUCCESS\n")
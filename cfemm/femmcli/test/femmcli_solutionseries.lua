@@ -0,0 +1,57 @@
+-- femmcli_solutionseries.lua
+-- Rotor angle sweep of the torque benchmark, stored in a solution series.
+-- The torque of each step of the series must match the torque of the individual solution.
+-- Output:
+-- SUCCESS
+showconsole()
+
+-- check variable <name>,
+-- compare <value> against <expected> value
+-- if the absolute difference is greater than the margin, complain and return 1
+function check(name, value, expected, margin)
+	diff=value - expected
+	if abs(diff) > margin then
+		fail=1
+		result="[FAILED] "
+	else
+		fail=0
+		result="[  ok  ] "
+	end
+	print(result .. name .. ": " .. value .. " (expected: " .. expected .. ", diff: " .. diff .. ", margin: " .. margin .. ")")
+	return fail
+end
+
+-- enable for additional output:
+-- XFEMM_VERBOSE = 1
+XFEMM_SOLUTION_SERIES = "femmcli_solutionseries.result.series"
+remove(XFEMM_SOLUTION_SERIES)
+
+open("femmcli_TorqueBenchmark.fem")
+mi_saveas("femmcli_solutionseries.result.fem")
+
+tq_ref = {}
+for deg = 0, 90, 30 do
+	mi_modifyboundprop("AGE",10,deg)
+	mi_modifyboundprop("AGE",11,0)
+	XFEMM_SERIES_STEP_LABEL = "angle=" .. deg
+	mi_analyze()
+	mi_loadsolution()
+	tq_ref[deg]=mo_gapintegral("AGE", 0)
+end
+
+failed=0
+numSteps = mo_openseries(XFEMM_SOLUTION_SERIES)
+failed = failed + check("steps", numSteps, 4, 0)
+
+-- load the steps in reverse order to make sure nothing is left over from the previous step
+step = numSteps
+for deg = 90, 0, -30 do
+	label = mo_loadseriesstep(step)
+	assert(label == "angle=" .. deg, "unexpected label: " .. label)
+	tq=mo_gapintegral("AGE", 0)
+	failed = failed + check("Torque_"..deg, tq, tq_ref[deg], 1e-9)
+	step = step - 1
+end
+
+assert(failed==0)
+write("SUCCESS\n")
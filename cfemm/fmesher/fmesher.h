@@ -40,6 +40,7 @@
 #include "CSegment.h"
 #include "femmenums.h"
 #include "FemmProblem.h"
+#include "spatialIndex.h"
 
 #include <memory>
 #include <vector>
@@ -69,6 +70,56 @@
 namespace fmesher
 {
 
+/**
+ * @brief The Triangulation struct holds a mesh as generated by triangle.
+ * It contains everything that is needed to refine the mesh later.
+ */
+struct Triangulation
+{
+    std::vector<double> points;             ///< x and y coordinate of each node
+    std::vector<int> pointMarkers;          ///< marker of each node
+    std::vector<int> triangles;             ///< the three corners of each element
+    std::vector<double> triangleAttributes; ///< regional attribute (i.e. block label number) of each element
+    std::vector<int> segments;              ///< the two end points of each segment
+    std::vector<int> segmentMarkers;        ///< marker of each segment
+    double minAngle = 0;                    ///< minimum angle used for meshing
+    /// \brief If \c true, no nodes may be added on the mesh boundary (e.g. because of periodic boundary conditions)
+    bool suppressExteriorSteinerPoints = false;
+
+    int numberOfTriangles() const { return (int)triangles.size()/3; }
+};
+
+/**
+ * @brief The SizeField class prescribes the maximum element area by means of a background mesh,
+ * e.g. the mesh of an earlier solution of a similar problem.
+ */
+class SizeField
+{
+public:
+    /**
+     * @brief Set the background mesh.
+     * @param points x and y coordinate of each node
+     * @param triangles the three corners of each triangle
+     * @param maxArea maximum element area in each triangle, or a value <=0 if the area is not constrained there
+     */
+    void setMesh(std::vector<double> points, std::vector<int> triangles, std::vector<double> maxArea);
+    void clear();
+    bool empty() const { return m_maxArea.empty(); }
+    /**
+     * @brief Get the maximum element area at a point.
+     * @param x
+     * @param y
+     * @return the maximum area, or -1 if the point is outside of the background mesh or not constrained
+     */
+    double maxArea(double x, double y) const;
+
+private:
+    std::vector<double> m_points;
+    std::vector<int> m_triangles;
+    std::vector<double> m_maxArea;
+    femm::TriangleGrid m_grid;
+};
+
 // FMesher Class
 
 class FMesher
@@ -90,6 +141,12 @@ public:
     std::shared_ptr<femm::FemmProblem> problem;
     bool Verbose = true;
     bool writePolyFiles = false; ///< write .poly files when calling triangle
+    /// \brief If \c true, the triangulation methods keep the mesh in \c triangulation, so that it can be refined by RefineMesh()
+    bool keepTriangulation = false;
+    /// \brief The last mesh, if keepTriangulation is set
+    Triangulation triangulation;
+    /// \brief If not empty, the triangulation methods refine the mesh until it is at least as fine as the size field
+    SizeField sizeField;
 
 	std::string BinDir;
 
@@ -134,6 +191,24 @@ public:
 	bool LoadMesh(std::string PathName);
 	int DoNonPeriodicBCTriangulation(std::string PathName);
 	int DoPeriodicBCTriangulation(std::string PathName);
+	/**
+	 * @brief Refine the mesh kept in \c triangulation, and write the new mesh files.
+	 * Existing nodes keep their numbers, and nodes are only added on the mesh boundary
+	 * if the original triangulation allowed it. Therefore, the \c .pbc file of the original mesh stays valid.
+	 * The refined mesh replaces the mesh in \c triangulation.
+	 * @param PathName the problem file name
+	 * @param maxArea area constraint for each element, or a value <=0 if the element is not constrained
+	 * @return 0 on success, or the error code of the triangulation
+	 */
+	int RefineMesh(std::string PathName, const std::vector<double> &maxArea);
+	/**
+	 * @brief Refine the mesh kept in \c triangulation where its elements are larger than \c sizeField allows.
+	 * The area constraint of an element is the smallest area allowed at its corners and centroid.
+	 * Since this constraint is only evaluated for the existing elements, a few refinement passes are done.
+	 * @param PathName the problem file name
+	 * @return 0 on success, or the error code of the triangulation
+	 */
+	int ApplySizeField(std::string PathName);
 	bool HasPeriodicBC();
 
     // pointer to function to call when issuing warning messages
@@ -177,6 +252,9 @@ double defaultMeshSizeHeuristics(const std::vector<std::unique_ptr<femm::CNode>>
  * Where MaxSideLength is not specified (i.e. -1), the segment is either copied verbatim (if smart meshing is disabled),
  * or further nodes are inserted at distance \p dL from the segment's existing nodes and the segment is split.
  *
+ * The segments are discretized in parallel, but the new nodes and segments are appended in segment order,
+ * so the result does not depend on the number of threads.
+ *
  * @param problem
  * @param nodelst
  * @param linelst
@@ -198,6 +276,8 @@ void discretizeInputSegments(
  * @brief Create a copy of the problem's segment list where the segment length is bounded by their MaxSideLength.
  * All segments in the problem's linelist are copied into \p linelst, and additional segments are added as needed.
  *
+ * Like discretizeInputSegments(), the arc segments are discretized in parallel with a deterministic result.
+ *
  * @param problem
  * @param nodelst
  * @param linelst
@@ -33,6 +33,7 @@
 #include "femmconstants.h"
 #include "CCommonPoint.h"
 #include "CAirGapElement.h"
+#include "parallelTools.h"
 //extern "C" {
 #include "triangle.h"
 #ifndef XFEMM_BUILTIN_TRIANGLE
@@ -41,12 +42,15 @@
 //}
 
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <malloc.h>
+#include <map>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -83,6 +87,116 @@ enum class SegmentMarkerInfo {
     , FromProblem ///< Generate marker info using the problem descripton
 };
 
+/**
+ * @brief The MeshingTimer struct measures the time spent in the stages of a triangulation.
+ * It is used to print a timing breakdown in verbose mode.
+ */
+struct MeshingTimer
+{
+    using Clock = std::chrono::steady_clock;
+
+    double discretization = 0; ///< discretizing the input segments and arc segments
+    double triangleInput = 0; ///< building the input for triangle
+    double triangulation = 0; ///< running triangle
+    double periodicBoundaries = 0; ///< matching the nodes of periodic boundaries and air gap elements
+    Clock::time_point start = Clock::now();
+
+    /// Add the time since the last call to \p stage.
+    void stop(double &stage)
+    {
+        Clock::time_point now = Clock::now();
+        stage += std::chrono::duration<double>(now-start).count();
+        start = now;
+    }
+    std::string summary() const
+    {
+        char buf[256];
+        SNPRINTF(buf, sizeof(buf), "mesher timing (%u threads): discretization %.3fs, triangle input %.3fs, triangulation %.3fs",
+                 femm::threadCount(), discretization, triangleInput, triangulation);
+        std::string msg = buf;
+        if (periodicBoundaries > 0)
+        {
+            SNPRINTF(buf, sizeof(buf), ", periodic boundaries %.3fs", periodicBoundaries);
+            msg += buf;
+        }
+        return msg + "\n";
+    }
+};
+
+/// number of input entities that are discretized into one DiscretizationBuffer
+constexpr int discretizationBlockSize = 256;
+
+/**
+ * @brief The DiscretizationBuffer struct collects the nodes and segments created
+ * while discretizing a block of input entities.
+ *
+ * Segments refer to the nodes of the input geometry by their (non-negative) node number,
+ * and to the k-th node in \c nodes by the provisional number -(k+1).
+ */
+struct DiscretizationBuffer
+{
+    std::vector<std::unique_ptr<CNode>> nodes;
+    std::vector<std::unique_ptr<CSegment>> segments;
+
+    /// Add a new node at \p p and return its provisional node number.
+    int addNode(const CComplex &p)
+    {
+        nodes.push_back(CNode(p.re, p.im).clone());
+        return -(int)nodes.size();
+    }
+    /// Add a copy of \p segm going from \p n0 to \p n1.
+    void addSegment(const CSegment &segm, int n0, int n1)
+    {
+        segments.push_back(segm.clone());
+        segments.back()->n0 = n0;
+        segments.back()->n1 = n1;
+    }
+};
+
+/**
+ * @brief Discretize the entities [0,numEntities) in parallel and append the result to \p nodelst and \p linelst.
+ *
+ * The entities are processed in blocks of discretizationBlockSize entities, each filling its own buffer.
+ * The buffers are merged in block order, so that the resulting node and segment lists
+ * are the same as if the entities had been discretized one after the other.
+ *
+ * @param numEntities
+ * @param discretizeEntity a callable with the signature \c void(int i, DiscretizationBuffer &buffer);
+ *        it is called concurrently for different entities.
+ * @param nodelst
+ * @param linelst
+ */
+template <class Func>
+void discretizeEntities(int numEntities, Func discretizeEntity, std::vector<std::unique_ptr<CNode> > &nodelst, std::vector<std::unique_ptr<CSegment> > &linelst)
+{
+    const int numBlocks = (numEntities + discretizationBlockSize - 1) / discretizationBlockSize;
+    std::vector<DiscretizationBuffer> buffers(numBlocks);
+    femm::parallelFor(numBlocks, [&](int begin, int end) {
+        for (int block=begin; block<end; block++)
+        {
+            const int last = std::min(numEntities, (block+1)*discretizationBlockSize);
+            for (int i=block*discretizationBlockSize; i<last; i++)
+                discretizeEntity(i, buffers[block]);
+        }
+    }, 1);
+
+    for (auto &buffer: buffers)
+    {
+        // provisional node number -(k+1) becomes base+k
+        const int base = (int)nodelst.size();
+        for (auto &segm: buffer.segments)
+        {
+            if (segm->n0 < 0)
+                segm->n0 = base - segm->n0 - 1;
+            if (segm->n1 < 0)
+                segm->n1 = base - segm->n1 - 1;
+            linelst.push_back(std::move(segm));
+        }
+        for (auto &node: buffer.nodes)
+            nodelst.push_back(std::move(node));
+    }
+}
+
 /**
  * @brief The TriangulateHelper class encapsulates the interface to triangle,
  * so that the rest of the code doesn't have to deal with changes in its api.
@@ -148,6 +262,31 @@ public:
      */
     bool writePolyFile(std::string filename, std::string comment) const;
     bool writeTriangulationFiles(std::string Pathname) const;
+    /**
+     * @brief Copy the edges and elements of the triangulation.
+     * This gives access to the mesh topology without writing the \c.edge and \c.ele files.
+     * The order and direction of the edges only depend on the elements (see orderEdgesByElements()).
+     * @param edges receives the two end points of each edge
+     * @param edgeMarkers receives the marker of each edge
+     * @param triangles receives the three corners of each element
+     * @return \c true on success, \c false otherwise.
+     */
+    bool getMeshTopology(std::vector<int> &edges, std::vector<int> &edgeMarkers, std::vector<int> &triangles) const;
+    /**
+     * @brief Copy the triangulation, so that it can be refined later.
+     * Requires that keepSegments() was called before triangulate().
+     * @param mesh receives the triangulation
+     * @return \c true on success, \c false otherwise.
+     */
+    bool getTriangulation(Triangulation &mesh) const;
+    /**
+     * @brief Use an existing triangulation as input, so that triangulate() refines it.
+     * The minimum angle and the handling of the mesh boundary are taken from the triangulation.
+     * @param mesh the triangulation to refine
+     * @param maxArea area constraint of each element (<=0: no constraint)
+     * @return \c true on success, \c false on (allocation) error
+     */
+    bool initFromTriangulation(const Triangulation &mesh, const std::vector<double> &maxArea);
 
     // pointer to function to call when issuing warning messages
     int (*WarnMessage)(const char*, ...);
@@ -166,6 +305,10 @@ public:
      * Therefore only used with nonperiodic triangulation.
      */
     void suppressUnusedVertices();
+    /**
+     * @brief Keep the segments in the triangulation output, as needed by getTriangulation().
+     */
+    void keepSegments();
 
 private:
 #ifdef XFEMM_BUILTIN_TRIANGLE
@@ -178,6 +321,8 @@ private:
     double m_minAngle = 0.;
     bool m_suppressExteriorSteinerPoints = false;
     bool m_suppressUnusedVertices = false;
+    bool m_keepSegments = false;
+    bool m_refine = false;
 };
 
 /**
@@ -222,6 +367,22 @@ void initialize(triangleio &io)
     io.numberofedges = 0;
 }
 
+/**
+ * @brief Copy a vector into a newly allocated array, as expected by triangle.
+ * @param v
+ * @param array receives the array, which has to be released using free()
+ * @return \c true on success, \c false on allocation error
+ */
+template <typename T>
+bool copyToArray(const std::vector<T> &v, T *&array)
+{
+    array = (T *) malloc(std::max<size_t>(v.size(),1) * sizeof(T));
+    if (!array)
+        return false;
+    std::copy(v.begin(), v.end(), array);
+    return true;
+}
+
 }
 
 double FMesher::averageLineLength() const
@@ -262,12 +423,12 @@ double fmesher::defaultMeshSizeHeuristics(const std::vector<std::unique_ptr<CNod
 
 void fmesher::discretizeInputSegments(const FemmProblem &problem, std::vector<std::unique_ptr<CNode> > &nodelst, std::vector<std::unique_ptr<CSegment> > &linelst, double dL, SegmentFilter filter)
 {
-    for(int i=0; i<(int)problem.linelist.size(); i++)
+    discretizeEntities((int)problem.linelist.size(), [&](int i, DiscretizationBuffer &buffer)
     {
         const CSegment &line = *problem.linelist[i];
 
         if (filter == SegmentFilter::OnlyUnselected && line.IsSelected )
-            continue;
+            return;
 
         const CNode &n0 = *problem.nodelist[line.n0];
         const CNode &n1 = *problem.nodelist[line.n1];
@@ -296,119 +457,50 @@ void fmesher::discretizeInputSegments(const FemmProblem &problem, std::vector<st
             if (lineLength < (3. * dL) || problem.DoSmartMesh == false)
             {
                 // line is too short to add extra points
-                linelst.push_back(segm.clone());
+                buffer.segments.push_back(segm.clone());
             }
             else{
-//                // add extra points at a distance of dL from the ends of the line.
-//                // this forces Triangle to finely mesh near corners
-//                int l = (int) nodelst.size();
-//
-//                // first part
-//                CComplex a2 = a0 + dL * (a1-a0) / abs(a1-a0);
-//                CNode node1 (a2.re, a2.im);
-//                nodelst.push_back(node1.clone());
-//                segm.n0 = line.n0;
-//                segm.n1 = l;
-//                linelst.push_back(segm.clone());
-//
-//                // middle part
-//                a2 = a1 + dL * (a0-a1) / abs(a1-a0);
-//                CNode node2 (a2.re, a2.im);
-//                nodelst.push_back(node2.clone());
-//                segm.n0 = l;
-//                segm.n1 = l + 1;
-//                linelst.push_back(segm.clone());
-//
-//                // end part
-//                segm.n0 = l + 2;
-//                segm.n1 = line.n1;
-//                linelst.push_back(segm.clone());
-
-// add extra points at a distance of dL from the ends of the line.
-                CComplex a2;
-                CNode node;
-                int l = 0;
-
-				// this forces Triangle to finely mesh near corners
-				for(int j=0;j<3;j++)
-				{
-					if(j==0)
-					{
-						a2=a0+dL*(a1-a0)/abs(a1-a0);
-						node.x=a2.re; node.y=a2.im;
-						l=(int) nodelst.size();
-						nodelst.push_back (node.clone());
-						segm.n0=line.n0;
-						segm.n1=l;
-						linelst.push_back (segm.clone());
-					}
-
-					if(j==1)
-					{
-						a2=a1+dL*(a0-a1)/abs(a1-a0);
-						node.x=a2.re; node.y=a2.im;
-						l=(int) nodelst.size ();
-						nodelst.push_back(node.clone());
-						segm.n0=l-1;
-						segm.n1=l;
-						linelst.push_back(segm.clone());
-					}
+                // add extra points at a distance of dL from the ends of the line.
+                // this forces Triangle to finely mesh near corners
+                int l0 = buffer.addNode(a0+dL*(a1-a0)/abs(a1-a0));
+                buffer.addSegment(segm, line.n0, l0);
 
-					if(j==2)
-					{
-						l=(int) nodelst.size()-1;
-						segm.n0=l;
-						segm.n1=line.n1;
-						linelst.push_back(segm.clone());
-					}
+                int l1 = buffer.addNode(a1+dL*(a0-a1)/abs(a1-a0));
+                buffer.addSegment(segm, l0, l1);
 
-				}
+                buffer.addSegment(segm, l1, line.n1);
             }
         }
         else{
+            int l = line.n0;
             for(int j=0; j<numParts; j++)
             {
-                CComplex a2 = a0 + (a1-a0)*((double) (j+1)) / ((double) numParts);
-                CNode node (a2.re, a2.im);
-                if(j == 0){
-                    // first part -> n0 == line.n0
-                    int l=nodelst.size();
-                    nodelst.push_back(node.clone());
-                    segm.n0=line.n0;
-                    segm.n1=l;
-                    linelst.push_back(segm.clone());
-                }
-                else if(j == (numParts-1))
+                if(j == (numParts-1))
                 {
                     // last part -> n1 == line.n1 ; endpoint already exists
-                    int l=nodelst.size()-1;
-                    segm.n0=l;
-                    segm.n1=line.n1;
-                    linelst.push_back(segm.clone());
+                    buffer.addSegment(segm, l, line.n1);
                 }
                 else{
-                    int l=nodelst.size();
-                    nodelst.push_back(node.clone());
-                    segm.n0=l-1;
-                    segm.n1=l;
-                    linelst.push_back(segm.clone());
+                    CComplex a2 = a0 + (a1-a0)*((double) (j+1)) / ((double) numParts);
+                    int next = buffer.addNode(a2);
+                    buffer.addSegment(segm, l, next);
+                    l = next;
                 }
             }
         }
-    }
+    }, nodelst, linelst);
 }
 
 void fmesher::discretizeInputArcSegments(const FemmProblem &problem, std::vector<std::unique_ptr<CNode> > &nodelst, std::vector<std::unique_ptr<CSegment> > &linelst, SegmentFilter filter)
 {
-    for(int i=0;i<(int)problem.arclist.size();i++)
+    discretizeEntities((int)problem.arclist.size(), [&](int i, DiscretizationBuffer &buffer)
     {
-
         problem.arclist[i]->mySideLength = problem.arclist[i]->MaxSideLength;
 
         const CArcSegment &arc = *problem.arclist[i];
 
         if (filter == SegmentFilter::OnlyUnselected && arc.IsSelected )
-            continue;
+            return;
 
         // smart meshing does not apply to arc segments
         assert(arc.MaxSideLength != -1);
@@ -435,34 +527,26 @@ void fmesher::discretizeInputArcSegments(const FemmProblem &problem, std::vector
         CComplex a2=problem.nodelist[arc.n0]->CC();
 
         if(numParts==1){
-            linelst.push_back(segm.clone());
+            buffer.segments.push_back(segm.clone());
+            return;
         }
-        else for(int j=0;j<numParts;j++)
+        int l = arc.n0;
+        for(int j=0;j<numParts;j++)
         {
-            // move point along arc
-            a2=(a2-center)*a1+center;
-            CNode node(a2.re,a2.im);
-            int l = (int)nodelst.size();
-            if(j==0){
-                // first part -> n0 == arc.n0
-                nodelst.push_back(node.clone());
-                segm.n0=arc.n0;
-                segm.n1=l;
-            }
-            else if(j==(numParts-1))
+            if(j==(numParts-1))
             {
                 // last part -> n1 == arc.n1 ; endpoint already exists
-                segm.n0=l-1;
-                segm.n1=arc.n1;
+                buffer.addSegment(segm, l, arc.n1);
             }
             else{
-                nodelst.push_back(node.clone());
-                segm.n0=l-1;
-                segm.n1=l;
+                // move point along arc
+                a2=(a2-center)*a1+center;
+                int next = buffer.addNode(a2);
+                buffer.addSegment(segm, l, next);
+                l = next;
             }
-            linelst.push_back(segm.clone());
         }
-    }
+    }, nodelst, linelst);
 }
 
 /**
@@ -540,6 +624,74 @@ bool FMesher::HasPeriodicBC()
 }
 
 
+/**
+ * @brief Put the edges of a triangulation into an order that only depends on its elements.
+ *
+ * Triangle lists each interior edge once, taking it from whichever of the two adjacent elements
+ * has the lower address in memory. Therefore, the order and the direction of the interior edges
+ * can change from one run to the next, even for the same input.
+ * After calling this function, the edges are listed in the order of the elements,
+ * with the direction they have in the first element that contains them.
+ * Boundary edges keep their direction, because they are part of only one element.
+ * This takes linear time, because the edges are looked up by their lower end point.
+ * @param edges the two end points of each edge
+ * @param edgeMarkers the marker of each edge
+ * @param triangles the three corners of each element
+ */
+static void orderEdgesByElements(std::vector<int> &edges, std::vector<int> &edgeMarkers, const std::vector<int> &triangles)
+{
+    const int numEdges = (int)edgeMarkers.size();
+    int numNodes = 0;
+    for (int n: edges)
+        numNodes = std::max(numNodes, n+1);
+
+    // bucket the edges by their lower end point (counting sort),
+    // edges first[n] .. first[n+1]-1 of byLowerNode start at node n
+    std::vector<int> first(numNodes+1, 0);
+    for (int i=0; i<numEdges; i++)
+        first[std::min(edges[2*i], edges[2*i+1])+1]++;
+    for (int n=0; n<numNodes; n++)
+        first[n+1] += first[n];
+    std::vector<int> byLowerNode(numEdges);
+    {
+        std::vector<int> fill(first.begin(), first.end()-1);
+        for (int i=0; i<numEdges; i++)
+            byLowerNode[fill[std::min(edges[2*i], edges[2*i+1])]++] = i;
+    }
+
+    std::vector<char> listed(numEdges, 0);
+    std::vector<int> orderedEdges;
+    std::vector<int> orderedMarkers;
+    orderedEdges.reserve(2*numEdges);
+    orderedMarkers.reserve(numEdges);
+    for (int i=0; i<(int)triangles.size(); i+=3)
+    {
+        for (int j=0; j<3; j++)
+        {
+            const int n0 = triangles[i+j];
+            const int n1 = triangles[i+(j+1)%3];
+            const int lower = std::min(n0,n1);
+            const int upper = std::max(n0,n1);
+            for (int k=first[lower]; k<first[lower+1]; k++)
+            {
+                const int edge = byLowerNode[k];
+                if (std::max(edges[2*edge], edges[2*edge+1]) != upper)
+                    continue;
+                if (!listed[edge])
+                {
+                    listed[edge] = 1;
+                    orderedEdges.push_back(n0);
+                    orderedEdges.push_back(n1);
+                    orderedMarkers.push_back(edgeMarkers[edge]);
+                }
+                break;
+            }
+        }
+    }
+    edges.swap(orderedEdges);
+    edgeMarkers.swap(orderedMarkers);
+}
+
 bool TriangulateHelper::writeTriangulationFiles(string PathName) const
 {
     FILE *fp;
@@ -605,15 +757,25 @@ bool TriangulateHelper::writeTriangulationFiles(string PathName) const
 
     if (out.numberofedges > 0)
     {
+        std::vector<int> edges(out.edgelist, out.edgelist + 2*out.numberofedges);
+        std::vector<int> edgeMarkers(out.edgemarkerlist, out.edgemarkerlist + out.numberofedges);
+        std::vector<int> triangles(3*out.numberoftriangles);
+        for (int i=0; i<out.numberoftriangles; i++)
+        {
+            for (int j=0; j<3; j++)
+                triangles[3*i+j] = out.trianglelist[out.numberofcorners*i+j];
+        }
+        orderEdgesByElements(edges, edgeMarkers, triangles);
+
         // write number of edges, number of boundary markers, 0 or 1
-        fprintf(fp, "%i\t%i\n", out.numberofedges, 1);
+        fprintf(fp, "%i\t%i\n", (int)edgeMarkers.size(), 1);
 
         // write the edges in the format
         // <edge #> <endpoint> <endpoint> [boundary marker]
         // Endpoints are indices into the corresponding .edge file.
-        for(int i=0; i < 2 * (out.numberofedges) - 1; i = i + 2)
+        for(int i=0; i < (int)edgeMarkers.size(); i++)
         {
-            fprintf(fp, "%i\t%i\t%i\t%i\n", i/2, out.edgelist[i], out.edgelist[i+1], out.edgemarkerlist[i/2]);
+            fprintf(fp, "%i\t%i\t%i\t%i\n", i, edges[2*i], edges[2*i+1], edgeMarkers[i]);
         }
 
         fclose(fp);
@@ -726,6 +888,7 @@ int FMesher::DoNonPeriodicBCTriangulation(string PathName)
     WarnMessage("writepoly: beginning NON periodic boundary triangulation\n");
 #endif // DEBUG
 
+    MeshingTimer timer;
     nodelst.clear();
     linelst.clear();
     // calculate length used to kludge fine meshing near input node points
@@ -741,6 +904,7 @@ int FMesher::DoNonPeriodicBCTriangulation(string PathName)
 
     // discretize input arc segments
     discretizeInputArcSegments(*problem, nodelst, linelst);
+    timer.stop(timer.discretization);
 
     // create correct output filename;
     string pn = PathName;
@@ -792,8 +956,11 @@ int FMesher::DoNonPeriodicBCTriangulation(string PathName)
             return -1;
         if (!triHelper.initHolesAndRegions(*problem, problem->DoForceMaxMeshArea, DefaultMeshSize))
             return -1;
+        timer.stop(timer.triangleInput);
         triHelper.setMinAngle(std::min(problem->MinAngle+MINANGLE_BUMP,MINANGLE_MAX));
         triHelper.suppressUnusedVertices();
+        if (keepTriangulation || !sizeField.empty())
+            triHelper.keepSegments();
         if (writePolyFiles)
         {
             string plyname = PathName.substr(0, PathName.find_last_of('.')) + ".poly";
@@ -802,8 +969,21 @@ int FMesher::DoNonPeriodicBCTriangulation(string PathName)
         int tristatus = triHelper.triangulate(Verbose);
         if (tristatus != 0)
             return tristatus;
+        timer.stop(timer.triangulation);
 
         triHelper.writeTriangulationFiles(PathName);
+        if ((keepTriangulation || !sizeField.empty()) && !triHelper.getTriangulation(triangulation))
+            return -1;
+    }
+    if (Verbose)
+        WarnMessage(timer.summary().c_str());
+    if (!sizeField.empty())
+    {
+        int sizeFieldStatus = ApplySizeField(PathName);
+        if (!keepTriangulation)
+            triangulation = Triangulation();
+        if (sizeFieldStatus != 0)
+            return sizeFieldStatus;
     }
     problem->clearNotationTags();
 
@@ -832,7 +1012,6 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
     double z,R,dL;
     CComplex a0,a1,a2,c;
     CComplex b0,b1,b2;
-    char instring[1024];
     //string s;
     string plyname;
     std::vector < std::unique_ptr<CNode> >              nodelst;
@@ -841,6 +1020,10 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
     std::vector < std::unique_ptr<CPeriodicBoundary> >  pbclst;
     std::vector < std::unique_ptr<CAirGapElement> >     agelst;
     std::vector < std::unique_ptr<CCommonPoint> >       ptlst;
+    // topology of the trial mesh
+    std::vector <int> edgelst;
+    std::vector <int> edgemarkerlst;
+    std::vector <int> elelst;
     CNode node;
     CSegment segm;
     CCommonPoint pt;
@@ -853,6 +1036,7 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
 
     problem->updateUndo();
 
+    MeshingTimer timer;
     // calculate length used to kludge fine meshing near input node points
     dL = averageLineLength() / LineFraction;
 
@@ -866,6 +1050,7 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
 
     // discretize input arc segments
     discretizeInputArcSegments(*problem, nodelst, linelst);
+    timer.stop(timer.discretization);
 
 
     // create correct output filename;
@@ -892,6 +1077,7 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
             return -1;
         if (!triHelper.initHolesAndRegions(*problem, true, DefaultMeshSize))
             return -1;
+        timer.stop(timer.triangleInput);
 
         triHelper.setMinAngle(problem->MinAngle);
         if (writePolyFiles)
@@ -902,42 +1088,35 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
         int tristatus = triHelper.triangulate(Verbose);
         if (tristatus != 0)
             return tristatus;
+        timer.stop(timer.triangulation);
 
-        triHelper.writeTriangulationFiles(PathName);
+        // The trial mesh is only needed to find out how triangle
+        // subdivides the segments and arc segments, so we take its
+        // edges and elements directly from the triangulation instead
+        // of writing the mesh files and reading them back in.
+        if (!triHelper.getMeshTopology(edgelst, edgemarkerlst, elelst))
+        {
+            WarnMessage("Call to triangle was unsuccessful\n");
+            problem->undo();  problem->unselectAll();
+            return -1;
+        }
     }
 
 #ifdef DEBUG
     WarnMessage("writepoly: finished calling triangle\n");
 #endif // DEBUG
 
-    // So far, so good.  Now, read back in the .edge file
-    // to make sure the points in the segments and arc
+    // So far, so good.  Now, go through the edges of the
+    // trial mesh to make sure the points in the segments and arc
     // segments are ordered in a consistent way so that
     // the (anti)periodic boundary conditions can be applied.
 
-#ifdef DEBUG
-    WarnMessage("writepoly: 876\n");
-#endif // DEBUG
-
-    // read meshlines;
-    plyname = pn.substr(0,pn.find_last_of('.')) + ".edge";
-    if((fp=fopen(plyname.c_str(),"rt"))==NULL){
-        WarnMessage("Call to triangle was unsuccessful\n");
-        problem->undo();  problem->unselectAll();
-        return -1;
-    }
-    fgets(instring,1024,fp);
-    sscanf(instring,"%i",&k);
     problem->clearNotationTags();
     // use cnt again to keep a
     // tally of how many subsegments each
     // entity is sliced into.
     for(auto &arc: problem->arclist) arc->cnt=0;
 
-#ifdef DEBUG
-    WarnMessage("writepoly: 898\n");
-#endif // DEBUG
-
     // resize initializes the new elements using the default ctor:
     ptlst.clear();
     ptlst.shrink_to_fit();
@@ -946,17 +1125,13 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
     for(i=0; i<npt; i++)
         ptlst.push_back(std::unique_ptr <CCommonPoint> (new CCommonPoint()));
 
-#ifdef DEBUG
-    WarnMessage("writepoly: 910\n");
-#endif // DEBUG
-
-    for(i=0;i<k;i++)
+    for(i=0;i<(int)edgemarkerlst.size();i++)
     {
-        // get the next edge from the file
-        fgets(instring,1024,fp);
-        // get the edge number, start and end points (n0 and n1) and the
-        // segment/arc marker j
-        sscanf(instring,"%i    %i    %i    %i",&l,&n0,&n1,&j);
+        // get the start and end points (n0 and n1) of the next edge
+        // and the segment/arc marker j
+        n0 = edgelst[2*i];
+        n1 = edgelst[2*i+1];
+        j = edgemarkerlst[i];
         // if j != 0, this edge is part of a segment/arc
         if(j!=0)
         {
@@ -1008,11 +1183,6 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
             }
         }
     }
-    fclose(fp);
-
-#ifdef DEBUG
-    WarnMessage("writepoly: 974\n");
-#endif // DEBUG
 
     // figure out which segments / arcsegments are on the
     // boundary and force an appropriate mesh density on
@@ -1023,23 +1193,20 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
     // elements each reference segment appears in.  If a
     // segment is on the boundary, it ought to appear in just
     // one element.  Otherwise, it appears in two.
-    plyname = pn.substr(0,pn.find_last_of('.')) + ".ele";
-    if((fp=fopen(plyname.c_str(),"rt"))==NULL){
-        WarnMessage("Call to triangle was unsuccessful");
-        problem->undo();  problem->unselectAll();
-        return -1;
+    // The reference segments are looked up by their (sorted) end points,
+    // so that each element side is checked only once.
+    std::map<std::pair<int,int>,int> refEdges;
+    for(j=0;j<(int)ptlst.size();j++)
+    {
+        if (ptlst[j]->t==1)
+            refEdges[std::make_pair(ptlst[j]->x,ptlst[j]->y)] = j;
     }
-    fgets(instring,1024,fp);
-    sscanf(instring,"%i",&k);
-
-#ifdef DEBUG
-    WarnMessage("writepoly: 996\n");
-#endif // DEBUG
 
-    for(i=0;i<k;i++)
+    for(i=0;i<(int)elelst.size();i+=3)
     {
-        fgets(instring,1024,fp);
-        sscanf(instring,"%i    %i    %i    %i",&j,&n0,&n1,&n2);
+        n0 = elelst[i];
+        n1 = elelst[i+1];
+        n2 = elelst[i+2];
 
         // Sort out the three nodes...
         if (n0>n1) { n=n0; n0=n1; n1=n; }
@@ -1048,18 +1215,14 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
 
         // now, check to see if any of the test segments
         // are sides of this node...
-        for(j=0;j<(int)ptlst.size();j++)
+        for (const auto &side: { std::make_pair(n0,n1), std::make_pair(n0,n2), std::make_pair(n1,n2) })
         {
-            if ((n0==ptlst[j]->x) && (n1==ptlst[j]->y)) ptlst[j]->t--;
-            if ((n0==ptlst[j]->x) && (n2==ptlst[j]->y)) ptlst[j]->t--;
-            if ((n1==ptlst[j]->x) && (n2==ptlst[j]->y)) ptlst[j]->t--;
+            auto ref = refEdges.find(side);
+            if (ref != refEdges.end())
+                ptlst[ref->second]->t--;
         }
     }
-    fclose(fp);
 
-#ifdef DEBUG
-    WarnMessage("writepoly: 1021\n");
-#endif // DEBUG
 
     // impose "new" mesh constraints on bdry arcs and segments....
     for(i=0; i < (int)problem->linelist.size(); i++)
@@ -1726,11 +1889,13 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
     // Then, do the rest of the lines and arcs in the
     // "normal" way and write .poly file.
 
+    timer.stop(timer.periodicBoundaries);
     // discretize input segments
     discretizeInputSegments(*problem, nodelst, linelst, dL, SegmentFilter::OnlyUnselected);
 
     // discretize input arc segments
     discretizeInputArcSegments(*problem, nodelst, linelst, SegmentFilter::OnlyUnselected);
+    timer.stop(timer.discretization);
 
     // create correct output filename;
     pn = PathName;
@@ -1994,9 +2159,12 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
             return -1;
         if (!triHelper.initHolesAndRegions(*problem, true, DefaultMeshSize))
             return -1;
+        timer.stop(timer.triangleInput);
 
         triHelper.setMinAngle(std::min(problem->MinAngle+MINANGLE_BUMP,MINANGLE_MAX));
         triHelper.suppressExteriorSteinerPoints();
+        if (keepTriangulation || !sizeField.empty())
+            triHelper.keepSegments();
         if (writePolyFiles)
         {
             string plyname = PathName.substr(0, PathName.find_last_of('.')) + ".poly";
@@ -2005,8 +2173,21 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
         int tristatus = triHelper.triangulate(Verbose);
         if (tristatus != 0)
             return tristatus;
+        timer.stop(timer.triangulation);
 
         triHelper.writeTriangulationFiles(PathName);
+        if ((keepTriangulation || !sizeField.empty()) && !triHelper.getTriangulation(triangulation))
+            return -1;
+    }
+    if (Verbose)
+        WarnMessage(timer.summary().c_str());
+    if (!sizeField.empty())
+    {
+        int sizeFieldStatus = ApplySizeField(PathName);
+        if (!keepTriangulation)
+            triangulation = Triangulation();
+        if (sizeFieldStatus != 0)
+            return sizeFieldStatus;
     }
 
     problem->unselectAll();
@@ -2025,6 +2206,237 @@ int FMesher::DoPeriodicBCTriangulation(string PathName)
     return 0;
 }
 
+int FMesher::RefineMesh(string PathName, const std::vector<double> &maxArea)
+{
+    if ((int)maxArea.size() != triangulation.numberOfTriangles())
+    {
+        WarnMessage("RefineMesh: the number of area constraints does not match the mesh!\n");
+        return -1;
+    }
+
+    TriangulateHelper triHelper;
+    triHelper.WarnMessage = WarnMessage;
+    triHelper.TriMessage = this->TriMessage;
+    if (!triHelper.initFromTriangulation(triangulation, maxArea))
+        return -1;
+    int tristatus = triHelper.triangulate(Verbose);
+    if (tristatus != 0)
+        return tristatus;
+
+    Triangulation refined;
+    if (!triHelper.getTriangulation(refined))
+        return -1;
+    // triangle appends new nodes, but make sure that the .pbc file stays valid:
+    if (refined.points.size() < triangulation.points.size()
+            || !std::equal(triangulation.points.begin(), triangulation.points.end(), refined.points.begin()))
+    {
+        WarnMessage("RefineMesh: refinement changed the numbers of existing nodes!\n");
+        return -1;
+    }
+    if (!triHelper.writeTriangulationFiles(PathName))
+        return -1;
+    triangulation = std::move(refined);
+    return 0;
+}
+
+int FMesher::ApplySizeField(string PathName)
+{
+    // a few passes are enough, because triangle splits each constrained element
+    // into elements that satisfy the constraint of the original element:
+    const int maxPasses = 4;
+    for (int pass=0; pass<maxPasses; pass++)
+    {
+        const int numTriangles = triangulation.numberOfTriangles();
+        const std::vector<double> &p = triangulation.points;
+        std::vector<double> maxArea(numTriangles, -1);
+        int numConstrained = 0;
+        for (int i=0; i<numTriangles; i++)
+        {
+            const int *t = &triangulation.triangles[3*i];
+            double area = ((p[2*t[1]]-p[2*t[0]])*(p[2*t[2]+1]-p[2*t[0]+1])
+                           - (p[2*t[2]]-p[2*t[0]])*(p[2*t[1]+1]-p[2*t[0]+1])) / 2.;
+            double target = sizeField.maxArea((p[2*t[0]]+p[2*t[1]]+p[2*t[2]])/3.,
+                                              (p[2*t[0]+1]+p[2*t[1]+1]+p[2*t[2]+1])/3.);
+            for (int j=0; j<3; j++)
+            {
+                double cornerTarget = sizeField.maxArea(p[2*t[j]], p[2*t[j]+1]);
+                if (cornerTarget > 0 && (target <= 0 || cornerTarget < target))
+                    target = cornerTarget;
+            }
+            if (target > 0 && target < std::fabs(area))
+            {
+                maxArea[i] = target;
+                numConstrained++;
+            }
+        }
+        if (numConstrained == 0)
+            break;
+
+        int status = RefineMesh(PathName, maxArea);
+        if (status != 0)
+            return status;
+    }
+    if (Verbose)
+    {
+        std::string msg = "size field: refined mesh has " + std::to_string(triangulation.numberOfTriangles()) + " elements\n";
+        WarnMessage(msg.c_str());
+    }
+    return 0;
+}
+
+void SizeField::setMesh(std::vector<double> points, std::vector<int> triangles, std::vector<double> maxArea)
+{
+    m_points = std::move(points);
+    m_triangles = std::move(triangles);
+    m_maxArea = std::move(maxArea);
+    m_grid.build((int)m_maxArea.size(), [this](int i, int j) {
+        const int n = m_triangles[3*i+j];
+        return CComplex(m_points[2*n], m_points[2*n+1]);
+    });
+}
+
+void SizeField::clear()
+{
+    m_points.clear();
+    m_triangles.clear();
+    m_maxArea.clear();
+    m_grid.clear();
+}
+
+double SizeField::maxArea(double x, double y) const
+{
+    const int i = m_grid.find(x, y, [this,x,y](int i) {
+        // barycentric test with a small tolerance, so that points on the edges are found:
+        const int *t = &m_triangles[3*i];
+        double c[3];
+        for (int j=0; j<3; j++)
+        {
+            const int a = t[(j+1)%3];
+            const int b = t[(j+2)%3];
+            c[j] = (m_points[2*b]-m_points[2*a])*(y-m_points[2*a+1]) - (m_points[2*b+1]-m_points[2*a+1])*(x-m_points[2*a]);
+        }
+        const double twiceArea = c[0]+c[1]+c[2];
+        const double tol = 1e-10*std::fabs(twiceArea);
+        if (twiceArea < 0)
+            return c[0] <= tol && c[1] <= tol && c[2] <= tol;
+        return c[0] >= -tol && c[1] >= -tol && c[2] >= -tol;
+    });
+    if (i < 0 || m_maxArea[i] <= 0)
+        return -1;
+    return m_maxArea[i];
+}
+
+bool TriangulateHelper::getMeshTopology(std::vector<int> &edges, std::vector<int> &edgeMarkers, std::vector<int> &triangles) const
+{
+#ifdef XFEMM_BUILTIN_TRIANGLE
+    const struct triangulateio &mesh = out;
+#else
+    if (triangle_check_mesh(ctx)!=0)
+    {
+        WarnMessage("Mesh has topological inconsistencies!\n");
+        return false;
+    }
+    triangleio mesh;
+    initialize(mesh);
+    if (triangle_mesh_copy(ctx, &mesh, 1, 0) != TRI_OK)
+    {
+        WarnMessage("Could not retrieve the triangulation!\n");
+        return false;
+    }
+#endif
+    bool ok = (mesh.edgelist && mesh.edgemarkerlist && mesh.trianglelist);
+    if (ok)
+    {
+        edges.assign(mesh.edgelist, mesh.edgelist + 2*mesh.numberofedges);
+        edgeMarkers.assign(mesh.edgemarkerlist, mesh.edgemarkerlist + mesh.numberofedges);
+        triangles.resize(3*mesh.numberoftriangles);
+        for (int i=0; i<mesh.numberoftriangles; i++)
+        {
+            // only the corner nodes are of interest
+            for (int j=0; j<3; j++)
+                triangles[3*i+j] = mesh.trianglelist[mesh.numberofcorners*i+j];
+        }
+        orderEdgesByElements(edges, edgeMarkers, triangles);
+    } else {
+        WarnMessage("No edges or elements in triangulation!\n");
+    }
+#ifndef XFEMM_BUILTIN_TRIANGLE
+    if (mesh.pointlist) { free(mesh.pointlist); }
+    if (mesh.pointattributelist) { free(mesh.pointattributelist); }
+    if (mesh.pointmarkerlist) { free(mesh.pointmarkerlist); }
+    if (mesh.trianglelist) { free(mesh.trianglelist); }
+    if (mesh.triangleattributelist) { free(mesh.triangleattributelist); }
+    if (mesh.neighborlist) { free(mesh.neighborlist); }
+    if (mesh.segmentlist) { free(mesh.segmentlist); }
+    if (mesh.segmentmarkerlist) { free(mesh.segmentmarkerlist); }
+    if (mesh.edgelist) { free(mesh.edgelist); }
+    if (mesh.edgemarkerlist) { free(mesh.edgemarkerlist); }
+#endif
+    return ok;
+}
+
+bool TriangulateHelper::getTriangulation(Triangulation &mesh) const
+{
+#ifdef XFEMM_BUILTIN_TRIANGLE
+    if (!out.pointlist || !out.pointmarkerlist || !out.trianglelist || !out.segmentlist || !out.segmentmarkerlist
+            || out.numberoftriangleattributes != 1)
+    {
+        WarnMessage("Triangulation is incomplete!\n");
+        return false;
+    }
+    mesh.points.assign(out.pointlist, out.pointlist + 2*out.numberofpoints);
+    mesh.pointMarkers.assign(out.pointmarkerlist, out.pointmarkerlist + out.numberofpoints);
+    mesh.triangles.resize(3*out.numberoftriangles);
+    for (int i=0; i<out.numberoftriangles; i++)
+    {
+        for (int j=0; j<3; j++)
+            mesh.triangles[3*i+j] = out.trianglelist[out.numberofcorners*i+j];
+    }
+    mesh.triangleAttributes.assign(out.triangleattributelist, out.triangleattributelist + out.numberoftriangles);
+    mesh.segments.assign(out.segmentlist, out.segmentlist + 2*out.numberofsegments);
+    mesh.segmentMarkers.assign(out.segmentmarkerlist, out.segmentmarkerlist + out.numberofsegments);
+    mesh.minAngle = m_minAngle;
+    mesh.suppressExteriorSteinerPoints = m_suppressExteriorSteinerPoints;
+    return true;
+#else
+    (void)mesh;
+    WarnMessage("Mesh refinement requires the builtin version of triangle!\n");
+    return false;
+#endif
+}
+
+bool TriangulateHelper::initFromTriangulation(const Triangulation &mesh, const std::vector<double> &maxArea)
+{
+    // calling this method on an already initialized object would leak memory
+    if (in.numberofpoints!=0 || in.numberofsegments!=0)
+    {
+        WarnMessage("initFromTriangulation called on initialized input!\n");
+        return false;
+    }
+
+    in.numberofpoints = mesh.points.size()/2;
+    in.numberoftriangles = mesh.numberOfTriangles();
+    in.numberofcorners = 3;
+    in.numberoftriangleattributes = 1;
+    in.numberofsegments = mesh.segmentMarkers.size();
+    if (!copyToArray(mesh.points, in.pointlist)
+            || !copyToArray(mesh.pointMarkers, in.pointmarkerlist)
+            || !copyToArray(mesh.triangles, in.trianglelist)
+            || !copyToArray(mesh.triangleAttributes, in.triangleattributelist)
+            || !copyToArray(maxArea, in.trianglearealist)
+            || !copyToArray(mesh.segments, in.segmentlist)
+            || !copyToArray(mesh.segmentMarkers, in.segmentmarkerlist))
+    {
+        WarnMessage("Could not allocate the mesh for refinement!\n");
+        return false;
+    }
+
+    m_refine = true;
+    m_minAngle = mesh.minAngle;
+    m_suppressExteriorSteinerPoints = mesh.suppressExteriorSteinerPoints;
+    return true;
+}
+
 TriangulateHelper::TriangulateHelper()
     : WarnMessage(&PrintWarningMsg)
     , TriMessage(nullptr)
@@ -2046,6 +2458,9 @@ TriangulateHelper::~TriangulateHelper()
     if (in.segmentlist) { free(in.segmentlist); }
     if (in.segmentmarkerlist) { free(in.segmentmarkerlist); }
     if (in.holelist) { free(in.holelist); }
+    if (in.trianglelist) { free(in.trianglelist); }
+    if (in.triangleattributelist) { free(in.triangleattributelist); }
+    if (in.trianglearealist) { free(in.trianglearealist); }
 
 #ifdef XFEMM_BUILTIN_TRIANGLE
     if (out.pointlist) { free(out.pointlist); }
@@ -2081,12 +2496,6 @@ bool TriangulateHelper::initPointsWithMarkers(const TriangulateHelper::nodelist_
         return false;
     }
 
-    for(int i=0; i < in.numberofpoints; i++)
-    {
-        in.pointlist[2*i] = nodelst[i]->x;
-        in.pointlist[2*i+1] = nodelst[i]->y;
-    }
-
     // Initialise the pointmarkerlist
     in.pointmarkerlist = (int *) malloc(in.numberofpoints * sizeof(int));
     if (!in.pointmarkerlist) {
@@ -2094,30 +2503,35 @@ bool TriangulateHelper::initPointsWithMarkers(const TriangulateHelper::nodelist_
         return false;
     }
 
-    // write out node marker list
-    for(int i=0; i<in.numberofpoints; i++)
-    {
-        int t=0;
-        if (info==PointMarkerInfo::FromProblem)
+    // write out point list and node marker list
+    femm::parallelFor(in.numberofpoints, [&](int begin, int end) {
+        for(int i=begin; i<end; i++)
         {
-            for(int j=0; j<(int)problem.nodeproplist.size(); j++)
-                if(problem.nodeproplist[j]->PointName==nodelst[i]->BoundaryMarkerName)
-                    t = j + 2;
+            in.pointlist[2*i] = nodelst[i]->x;
+            in.pointlist[2*i+1] = nodelst[i]->y;
 
-            if (problem.filetype != femm::FileType::MagneticsFile)
+            int t=0;
+            if (info==PointMarkerInfo::FromProblem)
             {
-                // include conductor number;
-                for(int j = 0; j < (int)problem.circproplist.size(); j++)
+                for(int j=0; j<(int)problem.nodeproplist.size(); j++)
+                    if(problem.nodeproplist[j]->PointName==nodelst[i]->BoundaryMarkerName)
+                        t = j + 2;
+
+                if (problem.filetype != femm::FileType::MagneticsFile)
                 {
-                    // add the conductor number using a mask
-                    if(problem.circproplist[j]->CircName == nodelst[i]->InConductorName)
-                        t += ((j+1) * 0x10000);
+                    // include conductor number;
+                    for(int j = 0; j < (int)problem.circproplist.size(); j++)
+                    {
+                        // add the conductor number using a mask
+                        if(problem.circproplist[j]->CircName == nodelst[i]->InConductorName)
+                            t += ((j+1) * 0x10000);
+                    }
                 }
             }
-        }
 
-        in.pointmarkerlist[i] = t;
-    }
+            in.pointmarkerlist[i] = t;
+        }
+    });
     return true;
 }
 
@@ -2145,44 +2559,41 @@ bool TriangulateHelper::initSegmentsWithMarkers(const TriangulateHelper::linelis
         return false;
     }
 
-    // build the segmentlist
-    for(int i=0; i<in.numberofsegments; i++)
-    {
-        in.segmentlist[2*i] = linelst[i]->n0;
-        in.segmentlist[2*i+1] = linelst[i]->n1;
-    }
-
-    // now build the segment marker list
-    // construct the segment list
-    for(int i=0; i<in.numberofsegments; i++)
-    {
-        int t=0;
-        if (info==SegmentMarkerInfo::FromProblem)
+    // build the segmentlist and the segment marker list
+    femm::parallelFor(in.numberofsegments, [&](int begin, int end) {
+        for(int i=begin; i<end; i++)
         {
-            for(int j=0; j <(int)problem.lineproplist.size(); j++)
+            in.segmentlist[2*i] = linelst[i]->n0;
+            in.segmentlist[2*i+1] = linelst[i]->n1;
+
+            int t=0;
+            if (info==SegmentMarkerInfo::FromProblem)
             {
-                if (problem.lineproplist[j]->BdryName == linelst[i]->BoundaryMarkerName)
+                for(int j=0; j <(int)problem.lineproplist.size(); j++)
                 {
-                    t = -(j+2);
+                    if (problem.lineproplist[j]->BdryName == linelst[i]->BoundaryMarkerName)
+                    {
+                        t = -(j+2);
+                    }
                 }
-            }
 
-            if (problem.filetype != femm::FileType::MagneticsFile)
-            {
-                // include conductor number;
-                for (int j=0; j <(int)problem.circproplist.size(); j++)
+                if (problem.filetype != femm::FileType::MagneticsFile)
                 {
-                    if (problem.circproplist[j]->CircName == linelst[i]->InConductorName)
+                    // include conductor number;
+                    for (int j=0; j <(int)problem.circproplist.size(); j++)
                     {
-                        t -= ((j+1) * 0x10000);
+                        if (problem.circproplist[j]->CircName == linelst[i]->InConductorName)
+                        {
+                            t -= ((j+1) * 0x10000);
+                        }
                     }
                 }
+            } else {
+                t = -(linelst[i]->cnt+2);
             }
-        } else {
-            t = -(linelst[i]->cnt+2);
+            in.segmentmarkerlist[i] = t;
         }
-        in.segmentmarkerlist[i] = t;
-    }
+    });
     return true;
 }
 
@@ -2338,9 +2749,16 @@ string TriangulateHelper::triangulateParams(bool verbose) const
     //    have exactly the same coordinates, only the first appears in the
     //    output.
     // -Y Suppresses the creation of Steiner points on the exterior boundary.
+    // -r Refines a previously generated mesh.
+    //    Regional attributes and area constraints are given per triangle (-A is ignored),
+    //    and triangle refuses to refine without iteration numbers (-I).
     //
     // See http://www.cs.cmu.edu/~quake/triangle.switch.html for more info
-    std::string triArgs = "-pPq" + to_string(m_minAngle) + "eAaz" + (verbose?"":"Q") + "I";
+    std::string triArgs;
+    if (m_refine)
+        triArgs = "-rpq" + to_string(m_minAngle) + "eaz" + (verbose?"":"Q");
+    else
+        triArgs = std::string(m_keepSegments ? "-p" : "-pP") + "q" + to_string(m_minAngle) + "eAaz" + (verbose?"":"Q") + "I";
     if (m_suppressUnusedVertices)
         triArgs += "j";
     if (m_suppressExteriorSteinerPoints)
@@ -2405,4 +2823,9 @@ void TriangulateHelper::suppressUnusedVertices()
     m_suppressUnusedVertices = true;
 }
 
+void TriangulateHelper::keepSegments()
+{
+    m_keepSegments = true;
+}
+
 
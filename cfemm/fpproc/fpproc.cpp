@@ -27,15 +27,20 @@
 // fpproc.cpp : implementation of the FPProc class
 //
 
+#include <algorithm>
 #include <cstdlib>
 #include <string>
 #include <cstring>
 #include <cstdio>
 #include <cmath>
+#include <mutex>
 #include <regex>
 #include "femmcomplex.h"
 #include "femmconstants.h"
+#include "errorEstimate.h"
 #include "fparse.h"
+#include "hashTools.h"
+#include "parallelTools.h"
 #include "lua.h"
 #include "lualib.h"
 #include "fpproc.h"
@@ -75,6 +80,106 @@ double sqr(double x)
 {
     return x*x;
 }
+
+/**
+ * @brief Read the next \p n lines from \p fp into a single buffer.
+ * @param fp input file
+ * @param n number of lines
+ * @param buffer receives the null-terminated lines
+ * @param start receives the offset of each line within \p buffer
+ * @return \c false, if the file ends prematurely
+ */
+bool readRecords(FILE *fp, int n, std::vector<char> &buffer, std::vector<size_t> &start)
+{
+    char s[1024];
+    buffer.clear();
+    start.resize(n);
+    for(int i=0; i<n; i++)
+    {
+        if (fgets(s,1024,fp) == NULL)
+            return false;
+        start[i] = buffer.size();
+        buffer.insert(buffer.end(), s, s+strlen(s)+1);
+    }
+    return true;
+}
+
+/**
+ * @brief Parse up to \p n integers from \p s, as sscanf() with "%i" conversions would.
+ * @param s the text to parse; advanced past the parsed numbers
+ * @param v receives the parsed numbers
+ * @return the number of integers parsed
+ */
+int scanInts(const char *&s, int *v, int n)
+{
+    int i;
+    for(i=0; i<n; i++)
+    {
+        char *end;
+        long x = strtol(s, &end, 0);
+        if (end == s)
+            break;
+        v[i] = (int)x;
+        s = end;
+    }
+    return i;
+}
+
+/**
+ * @brief Parse up to \p n floating point numbers from \p s, as sscanf() with "%lf" conversions would.
+ * @param s the text to parse; advanced past the parsed numbers
+ * @param v receives the parsed numbers
+ * @return the number of numbers parsed
+ */
+int scanDoubles(const char *&s, double *v, int n)
+{
+    int i;
+    for(i=0; i<n; i++)
+    {
+        char *end;
+        double x = strtod(s, &end);
+        if (end == s)
+            break;
+        v[i] = x;
+        s = end;
+    }
+    return i;
+}
+
+/**
+ * @brief Evaluate cos(n*tta) and sin(n*tta) for the equally spaced harmonics n = n0+k*step, k=0..count-1.
+ * The angle is advanced by a rotation from one harmonic to the next,
+ * and cos and sin are only evaluated directly every 64 harmonics to limit the accumulation of rounding errors.
+ * @param f a callable with the signature \c void(int k,double c,double s)
+ */
+template <class HarmonicFunc>
+void forEachHarmonic(int count, double n0, double step, double tta, HarmonicFunc f)
+{
+    const double cstep = cos(step*tta);
+    const double sstep = sin(step*tta);
+    double c = 0;
+    double s = 0;
+    for (int k=0; k<count; k++)
+    {
+        if (k%64 == 0)
+        {
+            c = cos((n0+k*step)*tta);
+            s = sin((n0+k*step)*tta);
+        }
+        f(k, c, s);
+        const double cn = c*cstep - s*sstep;
+        s = s*cstep + c*sstep;
+        c = cn;
+    }
+}
+
+/**
+ * @brief Get the spacing of the harmonic numbers of an air gap element.
+ */
+int harmonicStep(const CAirGapElement &age)
+{
+    return (age.nn>1) ? age.nh[1]-age.nh[0] : 0;
+}
 } // anonymous namespace
 
 /**
@@ -100,10 +205,15 @@ FPProc::FPProc()
     PrevSoln = "";
     PrevType = 0;
     Smooth = true;
+    bMultiplyDefinedLabels = false;
+    PreloadQuantities = LabelCheck;
+    computedQuantities = 0;
     NumList = NULL;
     ConList = NULL;
     WeightingScheme = 0;
     bHasMask = false;
+    bUseMaskCache = true;
+    bMaskFromCache = false;
     bIncremental = MS_LEGACY_FALSE;
     LengthConv = (double *)calloc(6,sizeof(double));
     LengthConv[0] = 0.0254;   //inches
@@ -143,6 +253,246 @@ FPProc::~FPProc()
 
 }
 
+/**
+ * @brief Compute the flux density along the centerline of the air gap elements
+ * and its harmonic components from the current nodal potentials.
+ */
+void FPProc::ComputeAGEHarmonics()
+{
+    int i,j,k;
+
+    #ifdef DEBUG_FPPROC
+    printf("agelist.size: %d\n",agelist.size());
+    fflush(stdout);
+    #endif
+	for (i=0;i<(int)agelist.size();i++)
+	{
+		int m;
+		double R,dr,ri,ro,n,dt;
+		CComplex brc,brs,btc,bts;
+		double brcPrev,brsPrev,btcPrev,btsPrev;
+
+		R=(agelist[i].ri + agelist[i].ro)/2.;
+		dr=(agelist[i].ro - agelist[i].ri);
+		ri=agelist[i].ri/R;
+		ro=agelist[i].ro/R;
+		dt=(PI/180.)*agelist[i].totalArcLength/((double) agelist[i].totalArcElements);
+
+		if (agelist[i].BdryFormat==0)
+		{
+			agelist[i].nn=(agelist[i].totalArcElements/2)+1; // periodic AGE
+			m = (int) round(360./agelist[i].totalArcLength);
+		}
+		else
+		{
+			agelist[i].nn=(agelist[i].totalArcElements+1)/2; // antiperiodic AGE
+			m = (int) round(180./agelist[i].totalArcLength);
+		}
+
+		// the arrays are allocated once and reused when another solution step is loaded
+		if (agelist[i].nh==NULL)
+		{
+			// for present solution
+			agelist[i].brc=(CComplex *)calloc(agelist[i].nn,sizeof(CComplex));
+			agelist[i].brs=(CComplex *)calloc(agelist[i].nn,sizeof(CComplex));
+			agelist[i].btc=(CComplex *)calloc(agelist[i].nn,sizeof(CComplex));
+			agelist[i].bts=(CComplex *)calloc(agelist[i].nn,sizeof(CComplex));
+			agelist[i].br=(CComplex *)calloc(agelist[i].totalArcElements,sizeof(CComplex));
+			agelist[i].bt=(CComplex *)calloc(agelist[i].totalArcElements,sizeof(CComplex));
+			agelist[i].nh=(int *)calloc(agelist[i].nn,sizeof(int));
+
+			// for previous solution;
+			if (bIncremental == MS_LEGACY_FALSE)
+			{
+				agelist[i].brcPrev=NULL;
+				agelist[i].brsPrev=NULL;
+				agelist[i].btcPrev=NULL;
+				agelist[i].btsPrev=NULL;
+				agelist[i].brPrev=NULL;
+				agelist[i].btPrev=NULL;
+			}
+			else{
+				agelist[i].brcPrev=(double *)calloc(agelist[i].nn,sizeof(double));
+				agelist[i].brsPrev=(double *)calloc(agelist[i].nn,sizeof(double));
+				agelist[i].btcPrev=(double *)calloc(agelist[i].nn,sizeof(double));
+				agelist[i].btsPrev=(double *)calloc(agelist[i].nn,sizeof(double));
+				agelist[i].brPrev=(double *)calloc(agelist[i].totalArcElements,sizeof(double));
+				agelist[i].btPrev=(double *)calloc(agelist[i].totalArcElements,sizeof(double));
+			}
+		}
+
+		// compute A and B at center of each gap element
+		agelist[i].aco=0;
+		for(k=0;k<agelist[i].totalArcElements;k++)
+		{
+			int nn[10];
+			double ww[10];
+			int kk;
+			CComplex a[10];
+			CComplex ac;
+
+			double ci=agelist[i].InnerShift;
+			double co=agelist[i].OuterShift;
+
+
+			// inner nodes
+			if ((k-1)<0){
+				nn[0]=agelist[i].quadNode[agelist[i].totalArcElements-1].n0;
+				ww[0]=agelist[i].quadNode[agelist[i].totalArcElements-1].w0;
+			}
+			else{
+				nn[0]=agelist[i].quadNode[k-1].n0;
+				ww[0]=agelist[i].quadNode[k-1].w0;
+			}
+
+			nn[1]=agelist[i].quadNode[k].n0;
+			nn[2]=agelist[i].quadNode[k].n1;
+			nn[3]=agelist[i].quadNode[k+1].n1;
+			ww[1]=agelist[i].quadNode[k].w0;
+			ww[2]=agelist[i].quadNode[k].w1;
+			ww[3]=agelist[i].quadNode[k+1].w1;
+
+			if((k+2)>agelist[i].totalArcElements){
+				nn[4]=agelist[i].quadNode[1].n1;
+				ww[4]=agelist[i].quadNode[1].w1;
+			}
+			else{
+				nn[4]=agelist[i].quadNode[k+2].n1;
+				ww[4]=agelist[i].quadNode[k+2].w1;
+			}
+
+			// outer nodes
+			if ((k-1)<0){
+				nn[5]=agelist[i].quadNode[agelist[i].totalArcElements-1].n2;
+				ww[5]=agelist[i].quadNode[agelist[i].totalArcElements-1].w2;
+			}
+			else{
+				nn[5]=agelist[i].quadNode[k-1].n2;
+				ww[5]=agelist[i].quadNode[k-1].w2;
+			}
+
+			nn[6]=agelist[i].quadNode[k].n2;
+			nn[7]=agelist[i].quadNode[k].n3;
+			nn[8]=agelist[i].quadNode[k+1].n3;
+			ww[6]=agelist[i].quadNode[k].w2;
+			ww[7]=agelist[i].quadNode[k].w3;
+			ww[8]=agelist[i].quadNode[k+1].w3;
+
+			if((k+2)>agelist[i].totalArcElements){
+				nn[9]=agelist[i].quadNode[1].n3;
+				ww[9]=agelist[i].quadNode[1].w3;
+			}
+			else{
+				nn[9]=agelist[i].quadNode[k+2].n3;
+				ww[9]=agelist[i].quadNode[k+2].w3;
+			}
+
+			// fix antiperiodic weights...
+			if ((k==0) && (agelist[i].BdryFormat==1))
+			{
+				ww[0]=-ww[0];
+				ww[5]=-ww[5];
+			}
+			if (((k+1)==agelist[i].totalArcElements) && (agelist[i].BdryFormat==1))
+			{
+				ww[4]=-ww[4];
+				ww[9]=-ww[9];
+			}
+
+			for(kk=0;kk<10;kk++)
+				a[kk]=meshnode[nn[kk]].A*ww[kk];
+
+			// A at the center of the element
+			if (agelist[i].BdryFormat==0)
+			{
+				ac = (2*a[2]+2*a[3]+2*a[7]+2*a[8]+a[1]*ci+(a[2]-a[3]-a[4])*ci-(a[0]-3*a[1]+a[2]+3*a[3]-2*a[4])*std::pow(ci,2)+(a[0]-2*a[1]+2*a[3]-a[4])*std::pow(ci,3)+(a[6]+a[7]-a[8]-a[9])*co-
+					 (a[5]-3*a[6]+a[7]+3*a[8]-2*a[9])*std::pow(co,2)+(a[5]-2*a[6]+2*a[8]-a[9])*std::pow(co,3))/8.;
+				agelist[i].aco += ac /((double) agelist[i].totalArcElements);
+			}
+
+			// flux density for this element
+			agelist[i].br[k]=(-(ci*a[1])-2*a[2]+2*a[3]+ci*(a[2]+a[3]-a[4])-ci*ci*ci*(a[0]-4*a[1]+6*a[2]-4*a[3]+a[4])+ci*ci*(a[0]-5*a[1]+9*a[2]-7*a[3]+2*a[4])-2*a[7]+
+				2*a[8]+co*(-a[6]+a[7]+a[8]-a[9])-co*co*co*(a[5]-4*a[6]+6*a[7]-4*a[8]+a[9])+co*co*(a[5]-5*a[6]+9*a[7]-7*a[8]+2*a[9]))/(4*dt*R);
+			agelist[i].bt[k]=(ci*a[1]+2*a[2]+2*a[3]-ci*ci*(a[0]-3*a[1]+a[2]+3*a[3]-2*a[4])+ci*(a[2]-a[3]-a[4])+ci*ci*ci*(a[0]-2*a[1]+2*a[3]-a[4])-co*a[6]+
+				(-2+co)*(1+co)*a[7]-2*a[8]+co*(a[8]+co*(a[5]-3*a[6]+3*a[8]-2*a[9])+a[9]+co*co*(-a[5]+2*a[6]-2*a[8]+a[9])))/(4*dr);
+			if (bIncremental)
+			{
+				for(kk=0;kk<10;kk++){
+					a[kk]=meshnode[nn[kk]].Aprev*ww[kk];
+				}
+
+                agelist[i].brPrev[k]=Re((-(ci*a[1])-2*a[2]+2*a[3]+ci*(a[2]+a[3]-a[4])-ci*ci*ci*(a[0]-4*a[1]+6*a[2]-4*a[3]+a[4])+ci*ci*(a[0]-5*a[1]+9*a[2]-7*a[3]+2*a[4])-2*a[7]+
+                    2*a[8]+co*(-a[6]+a[7]+a[8]-a[9])-co*co*co*(a[5]-4*a[6]+6*a[7]-4*a[8]+a[9])+co*co*(a[5]-5*a[6]+9*a[7]-7*a[8]+2*a[9]))/(4*dt*R));
+                agelist[i].btPrev[k]=Re((ci*a[1]+2*a[2]+2*a[3]-ci*ci*(a[0]-3*a[1]+a[2]+3*a[3]-2*a[4])+ci*(a[2]-a[3]-a[4])+ci*ci*ci*(a[0]-2*a[1]+2*a[3]-a[4])-co*a[6]+
+                    (-2+co)*(1+co)*a[7]-2*a[8]+co*(a[8]+co*(a[5]-3*a[6]+3*a[8]-2*a[9])+a[9]+co*co*(-a[5]+2*a[6]-2*a[8]+a[9])))/(4*dr));
+			}
+		}
+
+		// Convolve with sines and cosines to get amplitudes of each harmonic
+		for(j=0;j<agelist[i].nn;j++)
+		{
+			if (agelist[i].BdryFormat==0) agelist[i].nh[j]=m*j;
+			else agelist[i].nh[j]=m*(2*j+1);
+
+			n=agelist[i].nh[j];
+			brc=0; brs=0; btc=0; bts=0;
+			brcPrev=0; brsPrev=0; btcPrev=0; btsPrev=0;
+			// element k is centered at angle (k+0.5)*dt
+			const CAirGapElement &age = agelist[i];
+			forEachHarmonic(age.totalArcElements, 0.5, 1., n*dt, [&](int k, double c, double s) {
+				brc += age.br[k] * c;
+				brs += age.br[k] * s;
+				btc += age.bt[k] * c;
+				bts += age.bt[k] * s;
+
+				if (bIncremental)
+				{
+					brcPrev += age.brPrev[k] * c;
+					brsPrev += age.brPrev[k] * s;
+					btcPrev += age.btPrev[k] * c;
+					btsPrev += age.btPrev[k] * s;
+				}
+			});
+
+			if ((agelist[i].nh[j] == 0) ||
+				(((j==(agelist[i].nn-1)) && (agelist[i].BdryFormat==0)) && ((agelist[i].totalArcElements%2)==0)))
+			{
+				brc /= agelist[i].totalArcElements;
+				brs /= agelist[i].totalArcElements;
+				btc /= agelist[i].totalArcElements;
+				bts /= agelist[i].totalArcElements;
+				brcPrev /= agelist[i].totalArcElements;
+				brsPrev /= agelist[i].totalArcElements;
+				btcPrev /= agelist[i].totalArcElements;
+				btsPrev /= agelist[i].totalArcElements;
+			}
+			else{
+				brc /= ((double) agelist[i].totalArcElements)/2.;
+				brs /= ((double) agelist[i].totalArcElements)/2.;
+				btc /= ((double) agelist[i].totalArcElements)/2.;
+				bts /= ((double) agelist[i].totalArcElements)/2.;
+				brcPrev /= ((double) agelist[i].totalArcElements)/2.;
+				brsPrev /= ((double) agelist[i].totalArcElements)/2.;
+				btcPrev /= ((double) agelist[i].totalArcElements)/2.;
+				btsPrev /= ((double) agelist[i].totalArcElements)/2.;
+			}
+
+			agelist[i].brc[j]=brc;
+			agelist[i].brs[j]=brs;
+			agelist[i].btc[j]=btc;
+			agelist[i].bts[j]=bts;
+
+			if (bIncremental)
+			{
+				agelist[i].brcPrev[j]=brcPrev;
+				agelist[i].brsPrev[j]=brsPrev;
+				agelist[i].btcPrev[j]=btcPrev;
+				agelist[i].btsPrev[j]=btsPrev;
+			}
+		}
+	}
+}
+
 /**
  * Clear out all data associated with the last document to be loaded
  *
@@ -189,6 +539,17 @@ void FPProc::ClearDocument()
     contour.shrink_to_fit();
     agelist.clear();
     agelist.shrink_to_fit();
+    hasNodalB.clear();
+    elementGrid.clear();
+    nodeTree.clear();
+    arcTree.clear();
+    labelElements.clear();
+    circuitElements.clear();
+    elementNeighbours.clear();
+    computedQuantities = 0;
+    SeriesFile.clear();
+    seriesStepOffset.clear();
+    seriesStepLabel.clear();
 
 }
 
@@ -223,10 +584,14 @@ bool FPProc::OpenDocument(string pathname)
 {
 
     FILE *fp;
-    int i,j,k,t, sscnt;
+    // the solution file, while a referenced problem file is read (see [ProblemFile])
+    FILE *ansfp = NULL;
+    // fingerprint of the referenced problem file at solution time (see [ProblemFileHash])
+    string problemFileHash;
+    int i,j,k,t;
     char s[1024],q[1024];
     char *v;
-    double b,bi,br;
+    double b;
     double zr,zi;
     bool flag = false;
     CMPointProp    PProp;
@@ -236,9 +601,7 @@ bool FPProc::OpenDocument(string pathname)
     CNode         node;
     CSegment      segm;
     CArcSegment   asegm;
-    femmpostproc::CPostProcMElement      elm;
     CMBlockLabel   blk;
-    femmsolver::CMMeshNode     mnode;
     //CPoint        mline;
 
     // clear out all the document data and set defaults to standard values
@@ -252,28 +615,72 @@ bool FPProc::OpenDocument(string pathname)
     }
 
     // parse the file
-    while ((flag==false) && (fgets(s,1024,fp) != NULL))
+    while (flag==false)
     {
+        if (fgets(s,1024,fp) == NULL)
+        {
+            // continue with the solution file after the referenced problem file has been read
+            if (ansfp == NULL) break;
+            fclose(fp);
+            fp = ansfp;
+            ansfp = NULL;
+            continue;
+        }
         sscanf(s,"%s",q);
 
-        // Deal with flag for file format version
-        if( _strnicmp(q,"[format]",8)==0 )
+        if( _strnicmp(q,"[problemfilehash]",17)==0)
         {
-            double vers;
             v=StripKey(s);
-            sscanf(v,"%lf",&vers);
-            vers = 10.*vers + 0.5;
-            if( ((int) vers)!=40 )
-            {
-                WarnMessage("This file is from a different version of FEMM\nRe-analyze the problem using the current version.\n");
-                fclose(fp);
-                return false;
-            }
+            parseString(v,&problemFileHash);
             q[0] = '\0';
         }
 
-        // Frequency of the problem
-        if( _strnicmp(q,"[frequency]",11)==0)
+        // The problem description is stored in a separate file
+        if( _strnicmp(q,"[problemfile]",13)==0)
+        {
+            string problemFile;
+            v=StripKey(s);
+            parseString(v,&problemFile);
+            problemFile = resolveRelativePath(problemFile, pathname);
+            if (ansfp == NULL && !problemFileHash.empty()
+                    && fileFingerprint(problemFile) != problemFileHash)
+            {
+                WarnMessage("The problem file referenced by the .ans file has been changed since the solution was computed.\nRe-analyze the problem.\n");
+                fclose(fp);
+                return false;
+            }
+            FILE *pfp = (ansfp == NULL) ? fopen(problemFile.c_str(),"rt") : NULL;
+            if (pfp == NULL)
+            {
+                WarnMessage("Couldn't read from the problem file referenced by the .ans file\n");
+                fclose(fp);
+                if (ansfp != NULL) fclose(ansfp);
+                return false;
+            }
+            ansfp = fp;
+            fp = pfp;
+            q[0] = '\0';
+        }
+
+        // Deal with flag for file format version
+        if( _strnicmp(q,"[format]",8)==0 )
+        {
+            double vers;
+            v=StripKey(s);
+            sscanf(v,"%lf",&vers);
+            vers = 10.*vers + 0.5;
+            if( ((int) vers)!=40 )
+            {
+                WarnMessage("This file is from a different version of FEMM\nRe-analyze the problem using the current version.\n");
+                fclose(fp);
+                if (ansfp != NULL) fclose(ansfp);
+                return false;
+            }
+            q[0] = '\0';
+        }
+
+        // Frequency of the problem
+        if( _strnicmp(q,"[frequency]",11)==0)
         {
             v=StripKey(s);
             sscanf(v,"%lf",&Frequency);
@@ -1113,118 +1520,77 @@ bool FPProc::OpenDocument(string pathname)
     }
 
     // read in meshnodes;
+    // The node and element records are read sequentially, but parsed in parallel.
+    // The fixed record layouts are parsed with strtol()/strtod() directly,
+    // which is several times faster than sscanf() on large meshes.
+    std::vector<char> records;
+    std::vector<size_t> recordStart;
+    std::mutex errorMutex;
+    int badRecord;
+    int badCount;
+
     fscanf(fp,"%i\n",&k);
 #ifdef DEBUG_FPPROC
     printf("numnodes: %d\n", k);
 #endif // DEBUG_FPPROC
     meshnode.resize(k);
-    for(i=0; i<k; i++)
+    if (!readRecords(fp, k, records, recordStart))
     {
-        if ( fgets(s,1024,fp) != NULL )
-        {
-            if (Frequency!=0)
-            {
-                if (!bIncremental)
-                {
-                    sscnt = sscanf(s,"%lf\t%lf\t%lf\t%lf",
-                                   &mnode.x,
-                                   &mnode.y,
-                                   &mnode.A.re,
-                                   &mnode.A.im) ;
-
-                    if (sscnt != 4)
-                    {
-                        std::string msg = "An error occured while reading mesh nodes section of file, wrong number of inputs ("
-                                + std::to_string(sscnt) + ") for node " + std::to_string(i)
-                                + " (expected 4).\n";
-                        WarnMessage(msg.c_str()); /* Error */
-                        fclose(fp);
-                        return false;
-                    }
-                }
-                else
-                {
-                    int bc;
-
-                    sscanf(s,"%lf\t%lf\t%lf\t%lf\t%i\t%lf",
-                           &mnode.x,
-                           &mnode.y,
-                           &mnode.A.re,
-                           &mnode.A.im,
-                           &bc,
-                           &mnode.Aprev);
+        // There was some read error while trying to read the file
+        WarnMessage("An error occured while reading mesh nodes section of file.\n"); /* Error */
+        fclose(fp);
+        return false;
+    }
 
-                    if (sscnt != 6)
-                    {
-                        std::string msg = "An error occured while reading mesh nodes section of file, wrong number of inputs ("
-                                + std::to_string(sscnt) + ") for node " + std::to_string(i)
-                                + " (expected 6).\n";
-                        WarnMessage(msg.c_str()); /* Error */
-                        fclose(fp);
-                        return false;
-                    }
-                }
-            }
-            else
+    int expectedNodeFields;
+    if (Frequency!=0)
+        expectedNodeFields = bIncremental ? 6 : 4;
+    else
+        expectedNodeFields = bIncremental ? 5 : 3;
+    badRecord = k;
+    badCount = 0;
+    parallelFor(k, [&](int begin, int end) {
+        femmsolver::CMMeshNode mnode;
+        // x, y, A.re and, for harmonic problems, A.im
+        const int valueFields = (Frequency!=0) ? 4 : 3;
+        double v[4] = {0, 0, 0, 0};
+        int bc;
+        for(int n=begin; n<end; n++)
+        {
+            const char *line = &records[recordStart[n]];
+            int cnt = scanDoubles(line, v, valueFields);
+            if (bIncremental && cnt==valueFields)
+                cnt += scanInts(line, &bc, 1);
+            if (bIncremental && cnt==valueFields+1)
+                cnt += scanDoubles(line, &mnode.Aprev, 1);
+            mnode.x = v[0];
+            mnode.y = v[1];
+            mnode.A.re = v[2];
+            mnode.A.im = v[3];
+            if (cnt != expectedNodeFields)
             {
-                if (!bIncremental)
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (n < badRecord)
                 {
-                    sscnt = sscanf(s,"%lf\t%lf\t%lf",
-                                   &mnode.x,
-                                   &mnode.y,
-                                   &mnode.A.re);
-
-
-                    if (sscnt != 3)
-                    {
-                        std::string msg = "An error occured while reading mesh nodes section of file, wrong number of inputs ("
-                                + std::to_string(sscnt) + ") for node " + std::to_string(i)
-                                + " (expected 3).\n";
-                        WarnMessage(msg.c_str()); /* Error */
-    #ifdef DEBUG_FPPROC
-                        printf("s: %s\n", s);
-    #endif // DEBUG_FPPROC
-                        fclose(fp);
-                        return false;
-                    }
+                    badRecord = n;
+                    badCount = cnt;
                 }
-                else
-                {
-                    int bc;
-
-                    sscnt = sscanf(s, "%lf\t%lf\t%lf\t%i\t%lf",
-                                   &mnode.x,
-                                   &mnode.y,
-                                   &mnode.A.re,
-                                   &bc,
-                                   &mnode.Aprev);
-
-                    if (sscnt != 5)
-                    {
-                        std::string msg = "An error occured while reading mesh nodes section of file, wrong number of inputs ("
-                                + std::to_string(sscnt) + ") for node " + std::to_string(i)
-                                + " (expected 5).\n";
-                        WarnMessage(msg.c_str()); /* Error */
-    #ifdef DEBUG_FPPROC
-                        printf("s: %s\n", s);
-    #endif // DEBUG_FPPROC
-                        fclose(fp);
-                        return false;
-                    }
-
-                }
-                mnode.A.im=0;
+                return;
             }
-            meshnode[i] = mnode;
+            meshnode[n] = mnode;
         }
-        else
-        {
-            // There was some read error while trying to read the file
-            WarnMessage("An error occured while reading mesh nodes section of file.\n"); /* Error */
-            fclose(fp);
-            return false;
-        }
-
+    });
+    if (badRecord < k)
+    {
+        std::string msg = "An error occured while reading mesh nodes section of file, wrong number of inputs ("
+                + std::to_string(badCount) + ") for node " + std::to_string(badRecord)
+                + " (expected " + std::to_string(expectedNodeFields) + ").\n";
+        WarnMessage(msg.c_str()); /* Error */
+#ifdef DEBUG_FPPROC
+        printf("s: %s\n", &records[recordStart[badRecord]]);
+#endif // DEBUG_FPPROC
+        fclose(fp);
+        return false;
     }
 
     // read in elements;
@@ -1235,59 +1601,54 @@ bool FPProc::OpenDocument(string pathname)
 #ifdef DEBUG_FPPROC
     printf("numelement: %d\n", k);
 #endif // DEBUG_FPPROC
-    for(i=0; i<k; i++)
+    if (!readRecords(fp, k, records, recordStart))
     {
-        if ( fgets(s,1024,fp) != NULL )
-        {
-            if (!bIncremental)
-            {
-                sscnt = sscanf(s,"%i\t%i\t%i\t%i",&elm.p[0],&elm.p[1],&elm.p[2],&elm.lbl);
-#ifdef DEBUG_FPPROC
-                printf("s[%d]: %s", i,s);
-                //getchar();
-#endif // DEBUG_FPPROC
-                if (sscnt != 4)
-                {
-                    std::string msg = "An error occured while reading mesh nodes section of file, wrong number of inputs ("
-                            + std::to_string(sscnt) + ") for element " + std::to_string(i) + ".\n";
-                    WarnMessage(msg.c_str()); /* Error */
-                    fclose(fp);
-                    return false;
-                }
-            }
-            else
-            {
-                sscanf(s,"%i	%i	%i	%i	%lf",&elm.p[0],&elm.p[1],&elm.p[2],&elm.lbl,&elm.Jprev);
+        // There was some read error while trying to read the file
+        WarnMessage("An error occured while reading mesh elements section of file.\n"); /* Error */
+        fclose(fp);
+        return false;
+    }
 
-#ifdef DEBUG_FPPROC
-                printf("s: %s\n", s);
-                //getchar();
-#endif // DEBUG_FPPROC
-                if (sscnt != 5)
+    const int expectedElementFields = bIncremental ? 5 : 4;
+    badRecord = k;
+    badCount = 0;
+    parallelFor(k, [&](int begin, int end) {
+        femmpostproc::CPostProcMElement elm;
+        for(int n=begin; n<end; n++)
+        {
+            const char *line = &records[recordStart[n]];
+            int cnt = scanInts(line, elm.p, 3);
+            if (cnt==3)
+                cnt += scanInts(line, &elm.lbl, 1);
+            if (bIncremental && cnt==4)
+                cnt += scanDoubles(line, &elm.Jprev, 1);
+            if (cnt != expectedElementFields)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (n < badRecord)
                 {
-                    std::string msg = "An error occured while reading mesh nodes section of file, wrong number of inputs ("
-                            + std::to_string(sscnt) + ") for element " + std::to_string(i) + ".\n";
-                    WarnMessage(msg.c_str()); /* Error */
-                    fclose(fp);
-                    return false;
+                    badRecord = n;
+                    badCount = cnt;
                 }
+                return;
             }
-
             elm.blk=blocklist[elm.lbl].BlockType;
-            meshelem[i] = elm;
-#ifdef DEBUG_FPPROC
-            //printf("numelement: %d\n", k); //###note: this debug line make no sense here, is already before the loop...
-#endif // DEBUG_FPPROC
-        }
-        else
-        {
-            // There was some read error while trying to read the file
-            WarnMessage("An error occured while reading mesh elements section of file.\n"); /* Error */
-            fclose(fp);
-            return false;
+            meshelem[n] = elm;
         }
+    });
+    if (badRecord < k)
+    {
+        std::string msg = "An error occured while reading mesh elements section of file, wrong number of inputs ("
+                + std::to_string(badCount) + ") for element " + std::to_string(badRecord) + ".\n";
+        WarnMessage(msg.c_str()); /* Error */
+        fclose(fp);
+        return false;
     }
-    
+    records.clear();
+    records.shrink_to_fit();
+    recordStart.clear();
+    recordStart.shrink_to_fit();
+
     // read in circuit data;
     fscanf(fp,"%i\n",&k);
     #ifdef DEBUG_FPPROC
@@ -1413,234 +1774,7 @@ bool FPProc::OpenDocument(string pathname)
     #endif
 
 	// figure out amplitudes of harmonics for AGE boundary conditions
-    #ifdef DEBUG_FPPROC
-    printf("agelist.size: %d\n",agelist.size());
-    fflush(stdout);
-    #endif
-	for (i=0;i<(int)agelist.size();i++)
-	{
-		int m;
-		double tta,R,dr,ri,ro,n,dt;
-		CComplex brc,brs,btc,bts;
-		double brcPrev,brsPrev,btcPrev,btsPrev;
-
-		R=(agelist[i].ri + agelist[i].ro)/2.;
-		dr=(agelist[i].ro - agelist[i].ri);
-		ri=agelist[i].ri/R;
-		ro=agelist[i].ro/R;
-		dt=(PI/180.)*agelist[i].totalArcLength/((double) agelist[i].totalArcElements);
-
-		if (agelist[i].BdryFormat==0)
-		{
-			agelist[i].nn=(agelist[i].totalArcElements/2)+1; // periodic AGE
-			m = (int) round(360./agelist[i].totalArcLength);
-		}
-		else
-		{
-			agelist[i].nn=(agelist[i].totalArcElements+1)/2; // antiperiodic AGE
-			m = (int) round(180./agelist[i].totalArcLength);
-		}
-
-		// for present solution
-		agelist[i].brc=(CComplex *)calloc(agelist[i].nn,sizeof(CComplex));
-		agelist[i].brs=(CComplex *)calloc(agelist[i].nn,sizeof(CComplex));
-		agelist[i].btc=(CComplex *)calloc(agelist[i].nn,sizeof(CComplex));
-		agelist[i].bts=(CComplex *)calloc(agelist[i].nn,sizeof(CComplex));
-		agelist[i].br=(CComplex *)calloc(agelist[i].totalArcElements,sizeof(CComplex));
-		agelist[i].bt=(CComplex *)calloc(agelist[i].totalArcElements,sizeof(CComplex));
-		agelist[i].nh=(int *)calloc(agelist[i].nn,sizeof(int));
-
-		// for previous solution;
-		if (bIncremental == MS_LEGACY_FALSE)
-		{
-			agelist[i].brcPrev=NULL;
-			agelist[i].brsPrev=NULL;
-			agelist[i].btcPrev=NULL;
-			agelist[i].btsPrev=NULL;
-			agelist[i].brPrev=NULL;
-			agelist[i].btPrev=NULL;
-		}
-		else{
-			agelist[i].brcPrev=(double *)calloc(agelist[i].nn,sizeof(double));
-			agelist[i].brsPrev=(double *)calloc(agelist[i].nn,sizeof(double));
-			agelist[i].btcPrev=(double *)calloc(agelist[i].nn,sizeof(double));
-			agelist[i].btsPrev=(double *)calloc(agelist[i].nn,sizeof(double));
-			agelist[i].brPrev=(double *)calloc(agelist[i].totalArcElements,sizeof(double));
-			agelist[i].btPrev=(double *)calloc(agelist[i].totalArcElements,sizeof(double));
-		}
-
-		// compute A and B at center of each gap element
-		agelist[i].aco=0;
-		for(k=0;k<agelist[i].totalArcElements;k++)
-		{
-			int nn[10];
-			double ww[10];
-			int kk;
-			CComplex a[10];
-			CComplex ac;
-
-			double ci=agelist[i].InnerShift;
-			double co=agelist[i].OuterShift;
-
-
-			// inner nodes
-			if ((k-1)<0){
-				nn[0]=agelist[i].quadNode[agelist[i].totalArcElements-1].n0;
-				ww[0]=agelist[i].quadNode[agelist[i].totalArcElements-1].w0;
-			}
-			else{
-				nn[0]=agelist[i].quadNode[k-1].n0;
-				ww[0]=agelist[i].quadNode[k-1].w0;
-			}
-
-			nn[1]=agelist[i].quadNode[k].n0;
-			nn[2]=agelist[i].quadNode[k].n1;
-			nn[3]=agelist[i].quadNode[k+1].n1;
-			ww[1]=agelist[i].quadNode[k].w0;
-			ww[2]=agelist[i].quadNode[k].w1;
-			ww[3]=agelist[i].quadNode[k+1].w1;
-
-			if((k+2)>agelist[i].totalArcElements){
-				nn[4]=agelist[i].quadNode[1].n1;
-				ww[4]=agelist[i].quadNode[1].w1;
-			}
-			else{
-				nn[4]=agelist[i].quadNode[k+2].n1;
-				ww[4]=agelist[i].quadNode[k+2].w1;
-			}
-
-			// outer nodes
-			if ((k-1)<0){
-				nn[5]=agelist[i].quadNode[agelist[i].totalArcElements-1].n2;
-				ww[5]=agelist[i].quadNode[agelist[i].totalArcElements-1].w2;
-			}
-			else{
-				nn[5]=agelist[i].quadNode[k-1].n2;
-				ww[5]=agelist[i].quadNode[k-1].w2;
-			}
-
-			nn[6]=agelist[i].quadNode[k].n2;
-			nn[7]=agelist[i].quadNode[k].n3;
-			nn[8]=agelist[i].quadNode[k+1].n3;
-			ww[6]=agelist[i].quadNode[k].w2;
-			ww[7]=agelist[i].quadNode[k].w3;
-			ww[8]=agelist[i].quadNode[k+1].w3;
-
-			if((k+2)>agelist[i].totalArcElements){
-				nn[9]=agelist[i].quadNode[1].n3;
-				ww[9]=agelist[i].quadNode[1].w3;
-			}
-			else{
-				nn[9]=agelist[i].quadNode[k+2].n3;
-				ww[9]=agelist[i].quadNode[k+2].w3;
-			}
-
-			// fix antiperiodic weights...
-			if ((k==0) && (agelist[i].BdryFormat==1))
-			{
-				ww[0]=-ww[0];
-				ww[5]=-ww[5];
-			}
-			if (((k+1)==agelist[i].totalArcElements) && (agelist[i].BdryFormat==1))
-			{
-				ww[4]=-ww[4];
-				ww[9]=-ww[9];
-			}
-
-			for(kk=0;kk<10;kk++)
-				a[kk]=meshnode[nn[kk]].A*ww[kk];
-
-			// A at the center of the element
-			if (agelist[i].BdryFormat==0)
-			{
-				ac = (2*a[2]+2*a[3]+2*a[7]+2*a[8]+a[1]*ci+(a[2]-a[3]-a[4])*ci-(a[0]-3*a[1]+a[2]+3*a[3]-2*a[4])*std::pow(ci,2)+(a[0]-2*a[1]+2*a[3]-a[4])*std::pow(ci,3)+(a[6]+a[7]-a[8]-a[9])*co-
-					 (a[5]-3*a[6]+a[7]+3*a[8]-2*a[9])*std::pow(co,2)+(a[5]-2*a[6]+2*a[8]-a[9])*std::pow(co,3))/8.;
-				agelist[i].aco += ac /((double) agelist[i].totalArcElements);
-			}
-
-			// flux density for this element
-			agelist[i].br[k]=(-(ci*a[1])-2*a[2]+2*a[3]+ci*(a[2]+a[3]-a[4])-ci*ci*ci*(a[0]-4*a[1]+6*a[2]-4*a[3]+a[4])+ci*ci*(a[0]-5*a[1]+9*a[2]-7*a[3]+2*a[4])-2*a[7]+
-				2*a[8]+co*(-a[6]+a[7]+a[8]-a[9])-co*co*co*(a[5]-4*a[6]+6*a[7]-4*a[8]+a[9])+co*co*(a[5]-5*a[6]+9*a[7]-7*a[8]+2*a[9]))/(4*dt*R);
-			agelist[i].bt[k]=(ci*a[1]+2*a[2]+2*a[3]-ci*ci*(a[0]-3*a[1]+a[2]+3*a[3]-2*a[4])+ci*(a[2]-a[3]-a[4])+ci*ci*ci*(a[0]-2*a[1]+2*a[3]-a[4])-co*a[6]+
-				(-2+co)*(1+co)*a[7]-2*a[8]+co*(a[8]+co*(a[5]-3*a[6]+3*a[8]-2*a[9])+a[9]+co*co*(-a[5]+2*a[6]-2*a[8]+a[9])))/(4*dr);
-			if (bIncremental)
-			{
-				for(kk=0;kk<10;kk++){
-					a[kk]=meshnode[nn[kk]].Aprev*ww[kk];
-				}
-
-                agelist[i].brPrev[k]=Re((-(ci*a[1])-2*a[2]+2*a[3]+ci*(a[2]+a[3]-a[4])-ci*ci*ci*(a[0]-4*a[1]+6*a[2]-4*a[3]+a[4])+ci*ci*(a[0]-5*a[1]+9*a[2]-7*a[3]+2*a[4])-2*a[7]+
-                    2*a[8]+co*(-a[6]+a[7]+a[8]-a[9])-co*co*co*(a[5]-4*a[6]+6*a[7]-4*a[8]+a[9])+co*co*(a[5]-5*a[6]+9*a[7]-7*a[8]+2*a[9]))/(4*dt*R));
-                agelist[i].btPrev[k]=Re((ci*a[1]+2*a[2]+2*a[3]-ci*ci*(a[0]-3*a[1]+a[2]+3*a[3]-2*a[4])+ci*(a[2]-a[3]-a[4])+ci*ci*ci*(a[0]-2*a[1]+2*a[3]-a[4])-co*a[6]+
-                    (-2+co)*(1+co)*a[7]-2*a[8]+co*(a[8]+co*(a[5]-3*a[6]+3*a[8]-2*a[9])+a[9]+co*co*(-a[5]+2*a[6]-2*a[8]+a[9])))/(4*dr));
-			}
-		}
-
-		// Convolve with sines and cosines to get amplitudes of each harmonic
-		for(j=0;j<agelist[i].nn;j++)
-		{
-			if (agelist[i].BdryFormat==0) agelist[i].nh[j]=m*j;
-			else agelist[i].nh[j]=m*(2*j+1);
-
-			n=agelist[i].nh[j];
-			brc=0; brs=0; btc=0; bts=0;
-			brcPrev=0; brsPrev=0; btcPrev=0; btsPrev=0;
-			for(k=0;k<agelist[i].totalArcElements;k++)
-			{
-				tta=(((double) k) + 0.5)*dt;
-				tta*=n; // multiply times # of harmonic under consideration
-
-				brc += agelist[i].br[k] * cos(tta);
-				brs += agelist[i].br[k] * sin(tta);
-				btc += agelist[i].bt[k] * cos(tta);
-				bts += agelist[i].bt[k] * sin(tta);
-
-				if (bIncremental)
-				{
-					brcPrev += agelist[i].brPrev[k] * cos(tta);
-					brsPrev += agelist[i].brPrev[k] * sin(tta);
-					btcPrev += agelist[i].btPrev[k] * cos(tta);
-					btsPrev += agelist[i].btPrev[k] * sin(tta);
-				}
-			}
-
-			if ((agelist[i].nh[j] == 0) ||
-				(((j==(agelist[i].nn-1)) && (agelist[i].BdryFormat==0)) && ((agelist[i].totalArcElements%2)==0)))
-			{
-				brc /= agelist[i].totalArcElements;
-				brs /= agelist[i].totalArcElements;
-				btc /= agelist[i].totalArcElements;
-				bts /= agelist[i].totalArcElements;
-				brcPrev /= agelist[i].totalArcElements;
-				brsPrev /= agelist[i].totalArcElements;
-				btcPrev /= agelist[i].totalArcElements;
-				btsPrev /= agelist[i].totalArcElements;
-			}
-			else{
-				brc /= ((double) agelist[i].totalArcElements)/2.;
-				brs /= ((double) agelist[i].totalArcElements)/2.;
-				btc /= ((double) agelist[i].totalArcElements)/2.;
-				bts /= ((double) agelist[i].totalArcElements)/2.;
-				brcPrev /= ((double) agelist[i].totalArcElements)/2.;
-				brsPrev /= ((double) agelist[i].totalArcElements)/2.;
-				btcPrev /= ((double) agelist[i].totalArcElements)/2.;
-				btsPrev /= ((double) agelist[i].totalArcElements)/2.;
-			}
-
-			agelist[i].brc[j]=brc;
-			agelist[i].brs[j]=brs;
-			agelist[i].btc[j]=btc;
-			agelist[i].bts[j]=bts;
-
-			if (bIncremental)
-			{
-				agelist[i].brcPrev[j]=brcPrev;
-				agelist[i].brsPrev[j]=brsPrev;
-				agelist[i].btcPrev[j]=btcPrev;
-				agelist[i].btsPrev[j]=btsPrev;
-			}
-		}
-	}
+	ComputeAGEHarmonics();
     
     #ifdef DEBUG_FPPROC
     printf("Scaling length units\n");
@@ -1667,6 +1801,35 @@ bool FPProc::OpenDocument(string pathname)
         }
     }
 
+    // spatial index for point location
+    elementGrid.build((int)meshelem.size(), [this](int i, int j) {
+        const femmsolver::CMMeshNode &node = meshnode[meshelem[i].p[j]];
+        return CComplex(node.x, node.y);
+    });
+
+    // spatial indices for snapping to input nodes and arcs
+    nodeTree.buildPoints((int)nodelist.size(), [this](int i) {
+        return CComplex(nodelist[i].x, nodelist[i].y);
+    });
+    arcTree.build((int)arclist.size(), [this](int i, double &xmin, double &ymin, double &xmax, double &ymax) {
+        GetArcBounds(arclist[i], xmin, ymin, xmax, ymax);
+    });
+
+    // elements of each block label and of each circuit,
+    // for integrals over the selected blocks and for circuit properties
+    labelElements.assign(blocklist.size(), std::vector<int>());
+    circuitElements.assign(circproplist.size(), std::vector<int>());
+    for(i=0; i<(int)meshelem.size(); i++)
+    {
+        if((meshelem[i].lbl>=0) && (meshelem[i].lbl<(int)blocklist.size()))
+        {
+            labelElements[meshelem[i].lbl].push_back(i);
+            const int circ = blocklist[meshelem[i].lbl].InCircuit;
+            if((circ>=0) && (circ<(int)circproplist.size()))
+                circuitElements[circ].push_back(i);
+        }
+    }
+
     // Compute magnetization direction in each element
     #ifdef DEBUG_FPPROC
     printf("Computing magnetization direction\n");
@@ -1720,12 +1883,160 @@ bool FPProc::OpenDocument(string pathname)
     }
     lua_close(LocalLua);
 
+    // Find flux density in each element and extreme values of A;
+    ComputeSolutionFields();
+
+    if(Frequency!=0)  // compute frequency-dependent permeabilities for linear blocks;
+    {
+        #ifdef DEBUG_FPPROC
+        printf("compute frequency-dependent permeabilities for linear blocks\n");
+        fflush(stdout);
+        #endif
+
+        CComplex deg45;
+        deg45=1+I;
+        CComplex K,halflag;
+        double ds;
+        double w=2.*PI*Frequency;
+
+        for(k=0; k<(int)blockproplist.size(); k++)
+        {
+            if (blockproplist[k].LamType==0)
+            {
+                blockproplist[k].mu_fdx = blockproplist[k].mu_x*
+                                          exp(-I*blockproplist[k].Theta_hx*PI/180.);
+                blockproplist[k].mu_fdy = blockproplist[k].mu_y*
+                                          exp(-I*blockproplist[k].Theta_hy*PI/180.);
+
+                if(blockproplist[k].Lam_d!=0)
+                {
+
+                    halflag = exp(-I*blockproplist[k].Theta_hx*PI/360.);
+
+                    ds = sqrt(2. / (0.4 * PI * w * blockproplist[k].Cduct * blockproplist[k].mu_x));
+
+                    K = halflag*deg45*blockproplist[k].Lam_d*0.001/(2.*ds);
+
+                    if (blockproplist[k].Cduct!=0)
+                    {
+                        blockproplist[k].mu_fdx=(blockproplist[k].mu_fdx*tanh(K)/K)*
+                                                blockproplist[k].LamFill+(1.-blockproplist[k].LamFill);
+                    }
+                    else
+                    {
+                        blockproplist[k].mu_fdx=(blockproplist[k].mu_fdx)*
+                                                blockproplist[k].LamFill+(1.-blockproplist[k].LamFill);
+                    }
+
+                    halflag=exp(-I*blockproplist[k].Theta_hy*PI/360.);
+                    ds=sqrt(2./(0.4*PI*w*blockproplist[k].Cduct*blockproplist[k].mu_y));
+                    K=halflag*deg45*blockproplist[k].Lam_d*0.001/(2.*ds);
+                    if (blockproplist[k].Cduct!=0)
+                    {
+                        blockproplist[k].mu_fdy=(blockproplist[k].mu_fdy*tanh(K)/K)*
+                                                blockproplist[k].LamFill+(1.-blockproplist[k].LamFill);
+                    }
+                    else
+                    {
+                        blockproplist[k].mu_fdy=(blockproplist[k].mu_fdy)*
+                                                blockproplist[k].LamFill+(1.-blockproplist[k].LamFill);
+                    }
+                }
+            }
+
+        }
+    }
+
+    // compute fill factor associated with each block label
+    #ifdef DEBUG_FPPROC
+    printf("compute fill factor associated with each block label\n");
+    fflush(stdout);
+    #endif
+    for(k=0; k<(int)blocklist.size(); k++)
+    {
+        GetFillFactor(k);
+    }
+
+    // build list of elements connected to each node;
+    // allocate connections list;
+    #ifdef DEBUG_FPPROC
+    printf("build list of elements connected to each node, allocate connections list\n");
+    fflush(stdout);
+    #endif
+    NumList=(int *)calloc(meshnode.size(),sizeof(int));
+    ConList=(int **)calloc(meshnode.size(),sizeof(int *));
+    // find out number of connections to each node;
+    for(i=0; i<(int)meshelem.size(); i++)
+        for(j=0; j<3; j++)
+            NumList[meshelem[i].p[j]]++;
+    // allocate space for connections lists;
+    for(i=0; i<(int)meshnode.size(); i++)
+        ConList[i]=(int *)calloc(NumList[i],sizeof(int));
+    // build list;
+    for(i=0; i<(int)meshnode.size(); i++) NumList[i]=0;
+    for(i=0; i<(int)meshelem.size(); i++)
+        for(j=0; j<3; j++)
+        {
+            k=meshelem[i].p[j];
+            ConList[k][NumList[k]]=i;
+            NumList[k]++;
+        }
+
+//    // Choose bounds based on the type of contour plot
+//    // currently in play
+//    POSITION pos = GetFirstViewPosition();
+//    CFemmviewView *theView=(CFemmviewView *)GetNextView(pos);
+//
+//    if(Frequency==0)
+//    {
+//        if (theView->DensityPlot==2) theView->DensityPlot=1;
+//        if (theView->DensityPlot>1)  theView->DensityPlot=0;
+//    }
+
+    // derived quantities are computed on first use, unless requested here:
+    computedQuantities = 0;
+    bMultiplyDefinedLabels = false;
+    hasNodalB.assign(meshelem.size(), false);
+    PreloadDerivedQuantities();
+
+    // Get some information needed to compute energy stored in
+    // permanent magnets with a nonlinear demagnetization curve
+    #ifdef DEBUG_FPPROC
+    printf("Get some information needed to compute energy stored in permanent magnets with a nonlinear demagnetization curve.\n");
+    fflush(stdout);
+    #endif
+    if (Frequency==0)
+    {
+        for(k=0; k<(int)blockproplist.size(); k++)
+        {
+            if ((blockproplist[k].H_c>0) && (blockproplist[k].BHpoints>0))
+            {
+                blockproplist[k].Nrg = blockproplist[k].GetCoEnergy(blockproplist[k].GetB(blockproplist[k].H_c));
+            }
+        }
+    }
+    
+    #ifdef DEBUG_FPPROC
+    printf("FPProc::OpenDocument() done!\n");
+    fflush(stdout);
+    #endif
+
+    return true;
+}
+
+/**
+ * @brief Compute the flux density in each element and the extreme values of A from the nodal potentials.
+ */
+void FPProc::ComputeSolutionFields()
+{
     // Find flux density in each element;
     #ifdef DEBUG_FPPROC
     printf("Find flux density in each element\n");
     fflush(stdout);
     #endif
-    for(i=0; i<(int)meshelem.size(); i++) GetElementB(meshelem[i]);
+    parallelFor((int)meshelem.size(), [this](int begin, int end) {
+        for(int n=begin; n<end; n++) GetElementB(meshelem[n]);
+    });
 
     // Find extreme values of A;
     #ifdef DEBUG_FPPROC
@@ -1734,116 +2045,297 @@ bool FPProc::OpenDocument(string pathname)
     #endif
     A_Low = meshnode[0].A.re;
     A_High = meshnode[0].A.re;
-    for(i=1; i<(int)meshnode.size(); i++)
+    for(int i=1; i<(int)meshnode.size(); i++)
     {
         if (meshnode[i].A.re>A_High) A_High=meshnode[i].A.re;
         if (meshnode[i].A.re<A_Low)  A_Low =meshnode[i].A.re;
 
         if(Frequency!=0)
         {
-            if (meshnode[i].A.im<A_Low)  A_Low =meshnode[i].A.im;
-            if (meshnode[i].A.im>A_High) A_High=meshnode[i].A.im;
+            if (meshnode[i].A.im<A_Low)  A_Low =meshnode[i].A.im;
+            if (meshnode[i].A.im>A_High) A_High=meshnode[i].A.im;
+        }
+    }
+    // save default values for extremes of A
+    A_lb=A_Low;
+    A_ub=A_High;
+}
+
+/**
+ * @brief Compute the derived quantities requested by PreloadQuantities.
+ */
+void FPProc::PreloadDerivedQuantities()
+{
+    if (PreloadQuantities & NodalFluxDensity)
+    {
+        for(int i=0; i<(int)meshelem.size(); i++) EnsureNodalB(i);
+    }
+    if (PreloadQuantities & PlotBoundaries) EnsurePlotBounds();
+    if (PreloadQuantities & CircuitCurrents) EnsureCircuitCurrents();
+    if (PreloadQuantities & BoundaryEdges) EnsureBoundaryEdges();
+    if (PreloadQuantities & LabelCheck) EnsureLabelCheck();
+}
+
+uint64_t FPProc::MeshFingerprint() const
+{
+    // see FSolver::MeshFingerprint()
+    femm::FNV1aHash hash;
+    hash.add((int64_t)meshnode.size());
+    for (const auto &node: meshnode)
+    {
+        hash.add(node.x);
+        hash.add(node.y);
+    }
+    hash.add((int64_t)meshelem.size());
+    for (const auto &elm: meshelem)
+    {
+        hash.add(elm.p[0]);
+        hash.add(elm.p[1]);
+        hash.add(elm.p[2]);
+        hash.add(elm.lbl);
+    }
+    return hash.value();
+}
+
+bool FPProc::OpenSeries(std::string seriesFile)
+{
+    char s[1024];
+    std::string baseSolution;
+    unsigned long long meshHash = 0;
+    std::vector<long> stepOffset;
+    std::vector<std::string> stepLabel;
+
+    // see FSolver::WriteSeriesStep() for the file format
+    FILE *fp = fopen(seriesFile.c_str(),"rb");
+    if (fp==NULL)
+    {
+        std::string msg = "Couldn't read from solution series " + seriesFile + "\n";
+        WarnMessage(msg.c_str());
+        return false;
+    }
+    while (fgets(s,1024,fp)!=NULL)
+    {
+        if (_strnicmp(s,"[basesolution]",14)==0)
+        {
+            parseString(StripKey(s),&baseSolution);
+        }
+        else if (_strnicmp(s,"[meshhash]",10)==0)
+        {
+            sscanf(StripKey(s),"%llx",&meshHash);
+        }
+        else if (_strnicmp(s,"[step]",6)==0)
+        {
+            // only read the label, and skip over the data:
+            unsigned long stepSize = 0;
+            sscanf(StripKey(s),"%lu",&stepSize);
+            stepOffset.push_back(ftell(fp));
+            std::string label;
+            if (fgets(s,1024,fp)!=NULL && _strnicmp(s,"[label]",7)==0)
+                parseString(StripKey(s),&label);
+            stepLabel.push_back(label);
+            if (fseek(fp, stepOffset.back() + (long)stepSize, SEEK_SET)!=0)
+                break;
         }
     }
-    // save default values for extremes of A
-    A_lb=A_Low;
-    A_ub=A_High;
+    fclose(fp);
 
-    if(Frequency!=0)  // compute frequency-dependent permeabilities for linear blocks;
+    if (baseSolution.empty())
     {
-        #ifdef DEBUG_FPPROC
-        printf("compute frequency-dependent permeabilities for linear blocks\n");
-        fflush(stdout);
-        #endif
-
-        CComplex deg45;
-        deg45=1+I;
-        CComplex K,halflag;
-        double ds;
-        double w=2.*PI*Frequency;
-
-        for(k=0; k<(int)blockproplist.size(); k++)
-        {
-            if (blockproplist[k].LamType==0)
-            {
-                blockproplist[k].mu_fdx = blockproplist[k].mu_x*
-                                          exp(-I*blockproplist[k].Theta_hx*PI/180.);
-                blockproplist[k].mu_fdy = blockproplist[k].mu_y*
-                                          exp(-I*blockproplist[k].Theta_hy*PI/180.);
-
-                if(blockproplist[k].Lam_d!=0)
-                {
+        std::string msg = seriesFile + " is not a solution series\n";
+        WarnMessage(msg.c_str());
+        return false;
+    }
+    if (!OpenDocument(resolveRelativePath(baseSolution, seriesFile)))
+        return false;
+    // the base solution must not have been replaced by a solution with a different mesh:
+    if (MeshFingerprint() != meshHash)
+    {
+        std::string msg = "The mesh of " + baseSolution + " does not match solution series " + seriesFile + "\n";
+        WarnMessage(msg.c_str());
+        return false;
+    }
 
-                    halflag = exp(-I*blockproplist[k].Theta_hx*PI/360.);
+    SeriesFile = seriesFile;
+    seriesStepOffset = stepOffset;
+    seriesStepLabel = stepLabel;
+    return true;
+}
 
-                    ds = sqrt(2. / (0.4 * PI * w * blockproplist[k].Cduct * blockproplist[k].mu_x));
+int FPProc::NumSeriesSteps() const
+{
+    return (int)seriesStepOffset.size();
+}
 
-                    K = halflag*deg45*blockproplist[k].Lam_d*0.001/(2.*ds);
+std::string FPProc::SeriesStepLabel(int k) const
+{
+    if (k<0 || k>=(int)seriesStepLabel.size())
+        return std::string();
+    return seriesStepLabel[k];
+}
 
-                    if (blockproplist[k].Cduct!=0)
-                    {
-                        blockproplist[k].mu_fdx=(blockproplist[k].mu_fdx*tanh(K)/K)*
-                                                blockproplist[k].LamFill+(1.-blockproplist[k].LamFill);
-                    }
-                    else
-                    {
-                        blockproplist[k].mu_fdx=(blockproplist[k].mu_fdx)*
-                                                blockproplist[k].LamFill+(1.-blockproplist[k].LamFill);
-                    }
+bool FPProc::OpenSeriesStep(int k)
+{
+    char s[1024];
+    int n;
 
-                    halflag=exp(-I*blockproplist[k].Theta_hy*PI/360.);
-                    ds=sqrt(2./(0.4*PI*w*blockproplist[k].Cduct*blockproplist[k].mu_y));
-                    K=halflag*deg45*blockproplist[k].Lam_d*0.001/(2.*ds);
-                    if (blockproplist[k].Cduct!=0)
-                    {
-                        blockproplist[k].mu_fdy=(blockproplist[k].mu_fdy*tanh(K)/K)*
-                                                blockproplist[k].LamFill+(1.-blockproplist[k].LamFill);
-                    }
-                    else
-                    {
-                        blockproplist[k].mu_fdy=(blockproplist[k].mu_fdy)*
-                                                blockproplist[k].LamFill+(1.-blockproplist[k].LamFill);
-                    }
+    if (k<0 || k>=NumSeriesSteps())
+    {
+        WarnMessage("Invalid solution series step.\n");
+        return false;
+    }
+    FILE *fp = fopen(SeriesFile.c_str(),"rb");
+    if (fp==NULL || fseek(fp, seriesStepOffset[k], SEEK_SET)!=0)
+    {
+        std::string msg = "Couldn't read from solution series " + SeriesFile + "\n";
+        WarnMessage(msg.c_str());
+        if (fp!=NULL) fclose(fp);
+        return false;
+    }
+    std::string errMsg = "An error occured while reading step " + std::to_string(k)
+            + " of solution series " + SeriesFile + "\n";
+
+    // The step data is parsed completely before anything is changed,
+    // so that a damaged step does not leave us with a partially updated solution.
+    bool ok = (fgets(s,1024,fp)!=NULL && _strnicmp(s,"[label]",7)==0);
+
+    // nodal potentials:
+    std::vector<char> records;
+    std::vector<size_t> recordStart;
+    std::vector<CComplex> A;
+    ok = ok && (fgets(s,1024,fp)!=NULL) && (sscanf(s,"%i",&n)==1)
+            && (n==(int)meshnode.size()) && readRecords(fp, n, records, recordStart);
+    if (ok)
+    {
+        A.resize(n);
+        const int expectedFields = (Frequency!=0) ? 2 : 1;
+        std::mutex errorMutex;
+        parallelFor(n, [&](int begin, int end) {
+            for(int i=begin; i<end; i++)
+            {
+                const char *line = &records[recordStart[i]];
+                double v[2] = {0, 0};
+                int cnt = scanDoubles(line, v, expectedFields);
+                A[i] = CComplex(v[0], v[1]);
+                if (cnt != expectedFields)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    ok = false;
+                    return;
                 }
             }
+        });
+    }
 
-        }
+    // circuit currents:
+    std::vector<CComplex> amps;
+    ok = ok && (fgets(s,1024,fp)!=NULL) && (sscanf(s,"%i",&n)==1) && (n>=0);
+    for (int i=0; ok && i<n; i++)
+    {
+        CComplex a;
+        ok = (fgets(s,1024,fp)!=NULL) && (sscanf(s,"%lf\t%lf",&a.re,&a.im)==2);
+        amps.push_back(a);
     }
 
-    // compute fill factor associated with each block label
-    #ifdef DEBUG_FPPROC
-    printf("compute fill factor associated with each block label\n");
-    fflush(stdout);
-    #endif
-    for(k=0; k<(int)blocklist.size(); k++)
+    // circuit info per block label:
+    std::vector<std::pair<int,CComplex> > blockCircuit;
+    ok = ok && (fgets(s,1024,fp)!=NULL) && (sscanf(s,"%i",&n)==1) && (n==(int)blocklist.size());
+    for (int i=0; ok && i<n; i++)
     {
-        GetFillFactor(k);
+        int circCase;
+        CComplex z = 0;
+        if (Frequency==0)
+            ok = (fgets(s,1024,fp)!=NULL) && (sscanf(s,"%i\t%lf",&circCase,&z.re)==2);
+        else
+            ok = (fgets(s,1024,fp)!=NULL) && (sscanf(s,"%i\t%lf\t%lf",&circCase,&z.re,&z.im)==3);
+        blockCircuit.push_back(std::make_pair(circCase,z));
     }
 
-    // build list of elements connected to each node;
-    // allocate connections list;
-    #ifdef DEBUG_FPPROC
-    printf("build list of elements connected to each node, allocate connections list\n");
-    fflush(stdout);
-    #endif
-    NumList=(int *)calloc(meshnode.size(),sizeof(int));
-    ConList=(int **)calloc(meshnode.size(),sizeof(int *));
-    // find out number of connections to each node;
-    for(i=0; i<(int)meshelem.size(); i++)
-        for(j=0; j<3; j++)
-            NumList[meshelem[i].p[j]]++;
-    // allocate space for connections lists;
-    for(i=0; i<(int)meshnode.size(); i++)
-        ConList[i]=(int *)calloc(NumList[i],sizeof(int));
-    // build list;
-    for(i=0; i<(int)meshnode.size(); i++) NumList[i]=0;
-    for(i=0; i<(int)meshelem.size(); i++)
-        for(j=0; j<3; j++)
-        {
-            k=meshelem[i].p[j];
-            ConList[k][NumList[k]]=i;
-            NumList[k]++;
-        }
+    // air gap elements:
+    std::vector<femmsolver::CAirGapElement> age;
+    ok = ok && (fgets(s,1024,fp)!=NULL) && (sscanf(s,"%i",&n)==1);
+    for (int i=0; ok && i<n; i++)
+    {
+        femmsolver::CAirGapElement a;
+        ok = (fgets(s,1024,fp)!=NULL)
+                && (sscanf(s,"%i %lf %lf %lf %lf",&a.totalArcElements,
+                           &a.InnerAngle,&a.OuterAngle,&a.InnerShift,&a.OuterShift)==5);
+        for (int j=0; ok && j<=a.totalArcElements; j++)
+        {
+            CQuadPoint q;
+            ok = (fgets(s,1024,fp)!=NULL)
+                    && (sscanf(s,"%i %lf %i %lf %i %lf %i %lf",
+                               &q.n0, &q.w0, &q.n1, &q.w1,
+                               &q.n2, &q.w2, &q.n3, &q.w3)==8)
+                    && q.n0>=0 && q.n1>=0 && q.n2>=0 && q.n3>=0;
+            a.quadNode.push_back(q);
+        }
+        // as in OpenDocument(), air gap elements without elements are dropped
+        if (a.totalArcElements>0)
+            age.push_back(a);
+    }
+    fclose(fp);
+    ok = ok && (age.size()==agelist.size());
+    for (int i=0; ok && i<(int)age.size(); i++)
+        ok = (age[i].totalArcElements == agelist[i].totalArcElements);
+    if (!ok)
+    {
+        WarnMessage(errMsg.c_str());
+        return false;
+    }
+
+    // replace the solution:
+    for (int i=0; i<(int)meshnode.size(); i++)
+        meshnode[i].A = A[i];
+    for (int i=0; i<(int)amps.size() && i<(int)circproplist.size(); i++)
+        circproplist[i].Amps = amps[i];
+    for (int i=0; i<(int)blocklist.size(); i++)
+    {
+        blocklist[i].Case = blockCircuit[i].first;
+        if (blockCircuit[i].first==0) blocklist[i].dVolts = blockCircuit[i].second;
+        else blocklist[i].J = blockCircuit[i].second;
+    }
+    for (int i=0; i<(int)agelist.size(); i++)
+    {
+        agelist[i].InnerAngle = age[i].InnerAngle;
+        agelist[i].OuterAngle = age[i].OuterAngle;
+        agelist[i].InnerShift = age[i].InnerShift;
+        agelist[i].OuterShift = age[i].OuterShift;
+        agelist[i].quadNode = age[i].quadNode;
+    }
+
+    // the mesh is unchanged, but everything derived from the potentials needs to be recomputed:
+    ComputeAGEHarmonics();
+    ComputeSolutionFields();
+    computedQuantities &= (BoundaryEdges | LabelCheck);
+    hasNodalB.assign(meshelem.size(), false);
+    bHasMask = false;
+    PreloadDerivedQuantities();
+    return true;
+}
+
+/**
+ * @brief Compute the smoothed nodal flux density (b1, b2) of element \p i, unless it is already known.
+ * @param i element index
+ */
+void FPProc::EnsureNodalB(int i)
+{
+    if (hasNodalB[i])
+        return;
+    GetNodalB(meshelem[i].b1,meshelem[i].b2,meshelem[i]);
+    hasNodalB[i] = true;
+}
+
+/**
+ * @brief Find the extreme values of J, B and H, unless they are already known.
+ * Fills in PlotBounds, d_PlotBounds, B_Low, B_High and H_High.
+ */
+void FPProc::EnsurePlotBounds()
+{
+    if (computedQuantities & PlotBoundaries)
+        return;
+
+    int i,j,k;
+    double b,bi,br;
 
     // find extreme values of J;
     {
@@ -1989,7 +2481,7 @@ bool FPProc::OpenDocument(string pathname)
 
         for(i=0; i<(int)meshelem.size(); i++)
         {
-            GetNodalB(meshelem[i].b1,meshelem[i].b2,meshelem[i]);
+            EnsureNodalB(i);
             for(j=0; j<3; j++)
             {
                 br=sqrt(sqr(meshelem[i].b1[j].re) +
@@ -2059,16 +2551,18 @@ bool FPProc::OpenDocument(string pathname)
         }
     }
 
-//    // Choose bounds based on the type of contour plot
-//    // currently in play
-//    POSITION pos = GetFirstViewPosition();
-//    CFemmviewView *theView=(CFemmviewView *)GetNextView(pos);
-//
-//    if(Frequency==0)
-//    {
-//        if (theView->DensityPlot==2) theView->DensityPlot=1;
-//        if (theView->DensityPlot>1)  theView->DensityPlot=0;
-//    }
+    computedQuantities |= PlotBoundaries;
+}
+
+/**
+ * @brief Compute the total current of circuits with an a priori defined voltage gradient, unless already done.
+ */
+void FPProc::EnsureCircuitCurrents()
+{
+    if (computedQuantities & CircuitCurrents)
+        return;
+
+    int i,k;
 
     // compute total resulting current for circuits with an a priori defined
     // voltage gradient;  Need this to display circuit results & impedance.
@@ -2082,20 +2576,36 @@ bool FPProc::OpenDocument(string pathname)
         double a;
 
         if(circproplist[i].CircType>1)
-            for(j=0,circproplist[i].Amps=0.; j<(int)meshelem.size(); j++)
+        {
+            circproplist[i].Amps=0.;
+            for(int j: circuitElements[i])
             {
-                if(blocklist[meshelem[j].lbl].InCircuit==i)
-                {
-
-                    GetJA(j,Jelm,Aelm);
-                    // Convert area units to metres
-                    a = ElmArea(j) * sqr(LengthConv[LengthUnits]);
-                    // Add the current in the element (J * Elemnet Area) to the total
-                    for(k=0; k<3; k++) circproplist[i].Amps += a * Jelm[k]/3;
-                }
+                GetJA(j,Jelm,Aelm);
+                // Convert area units to metres
+                a = ElmArea(j) * sqr(LengthConv[LengthUnits]);
+                // Add the current in the element (J * Elemnet Area) to the total
+                for(k=0; k<3; k++) circproplist[i].Amps += a * Jelm[k]/3;
             }
+        }
     }
 
+    computedQuantities |= CircuitCurrents;
+}
+
+CComplex FPProc::GetCircuitCurrent(int circnum)
+{
+    EnsureCircuitCurrents();
+    return circproplist[circnum].Amps;
+}
+
+/**
+ * @brief Flag the boundary edges of all mesh elements, unless already done.
+ */
+void FPProc::EnsureBoundaryEdges()
+{
+    if (computedQuantities & BoundaryEdges)
+        return;
+
     // Build adjacency information for each element.
     #ifdef DEBUG_FPPROC
     printf("Build adjacency information for each element.\n");
@@ -2103,6 +2613,20 @@ bool FPProc::OpenDocument(string pathname)
     #endif
     FindBoundaryEdges();
 
+    computedQuantities |= BoundaryEdges;
+}
+
+/**
+ * @brief Check for regions that are defined by more than one block label, unless already done.
+ * Sets bMultiplyDefinedLabels, selects the offending blocks and issues a warning.
+ */
+void FPProc::EnsureLabelCheck()
+{
+    if (computedQuantities & LabelCheck)
+        return;
+
+    int i,k;
+
     // Check to see if any regions are multiply defined
     // (i.e. tagged by more than one block label). If so,
     // display an error message and mark the problem blocks.
@@ -2153,30 +2677,7 @@ bool FPProc::OpenDocument(string pathname)
         }
     }
 
-
-    // Get some information needed to compute energy stored in
-    // permanent magnets with a nonlinear demagnetization curve
-    #ifdef DEBUG_FPPROC
-    printf("Get some information needed to compute energy stored in permanent magnets with a nonlinear demagnetization curve.\n");
-    fflush(stdout);
-    #endif
-    if (Frequency==0)
-    {
-        for(k=0; k<(int)blockproplist.size(); k++)
-        {
-            if ((blockproplist[k].H_c>0) && (blockproplist[k].BHpoints>0))
-            {
-                blockproplist[k].Nrg = blockproplist[k].GetCoEnergy(blockproplist[k].GetB(blockproplist[k].H_c));
-            }
-        }
-    }
-    
-    #ifdef DEBUG_FPPROC
-    printf("FPProc::OpenDocument() done!\n");
-    fflush(stdout);
-    #endif
-
-    return true;
+    computedQuantities |= LabelCheck;
 }
 
 //bool FPProc::LoadPBCFromSolution(FILE* fp)
@@ -2280,79 +2781,197 @@ int FPProc::numNodes() const
 
 int FPProc::InTriangle(double x, double y) const
 {
-    static int k;
-    int j,hi,lo,sz;
-    double z;
+    return elementGrid.find(x, y, [this,x,y](int i) {
+        return InTriangleTest(x,y,i);
+    });
+}
+
+bool FPProc::GetPointValues(double x, double y, CMPointVals &u)
+{
+    int k;
+
+    // find the mesh triangle in which x,y resides, if any
+    k = InTriangle(x,y);
+
+    if (k<0)
+    {
+        // we are not in a triangle so return false
+        return false;
+    }
+
+    // we are in a triangle 'k', we can interpolate the point
+    // values in the triangle
+    GetPointValues(x,y,k,u);
+
+    return true;
+}
 
-    sz = meshelem.size();
+int FPProc::GetPointValues(int n, const double *x, const double *y, CMPointVals *u, bool *inMesh)
+{
+    std::vector<int> elm(n);
+    std::vector<int> found = elementGrid.findAll(n, x, y, [this,x,y](int k, int i) {
+        return InTriangleTest(x[k],y[k],i);
+    }, elm.data());
 
-    if ((k < 0) || (k >= sz)) k = 0;
+    // smoothed B is computed on first use, which must not happen concurrently:
+    if (Smooth)
+    {
+        for (int k: found)
+            EnsureNodalB(elm[k]);
+    }
 
-    // In most applications, the triangle we're looking
-    // for is nearby the last one we found.  Since the elements
-    // are ordered in a banded structure, we want to check the
-    // elements nearby the last one selected first.
-    if (InTriangleTest(x,y,k)) return k;
+    for (int k=0; k<n; k++)
+        inMesh[k] = (elm[k]>=0);
+    parallelFor((int)found.size(), [&](int begin, int end) {
+        for (int q=begin; q<end; q++)
+        {
+            const int k = found[q];
+            GetPointValues(x[k],y[k],elm[k],u[k]);
+        }
+    }, 256);
 
-    // wasn't in the last searched triangle, so look through all the
-    // elements
-    hi = k;
-    lo = k;
+    return (int)found.size();
+}
 
-    for(j=0; j<sz; j+=2)
+int FPProc::RasterizeFields(const femm::RasterGrid &grid, std::vector<float> &values)
+{
+    std::vector<int> owner(grid.size());
+    femm::rasterizeTriangles((int)meshelem.size(), grid, [this](int i, int j) {
+        const femmsolver::CMMeshNode &node = meshnode[meshelem[i].p[j]];
+        return CComplex(node.x, node.y);
+    }, [this](double x, double y, int i) {
+        return InTriangleTest(x,y,i);
+    }, owner.data());
+
+    // smoothed B is computed on first use, which must not happen concurrently:
+    if (Smooth)
     {
-        hi++;
-        if (hi >= sz) hi = 0;
-        lo--;
-        if (lo < 0)   lo = sz - 1;
+        for (int elm: owner)
+            if (elm>=0) EnsureNodalB(elm);
+    }
 
-        z = (meshelem[hi].ctr.re - x) * (meshelem[hi].ctr.re - x) +
-            (meshelem[hi].ctr.im - y) * (meshelem[hi].ctr.im - y);
+    const int numPlanes = (Frequency==0) ? 4 : 7;
+    femm::evaluateRaster(grid, owner.data(), numPlanes, [this](double x, double y, int elm, float *v) {
+        CMPointVals u;
+        GetPointValues(x,y,elm,u);
+        v[0] = (float)u.A.re;
+        v[1] = (float)u.B1.re;
+        v[2] = (float)u.B2.re;
+        v[3] = (float)sqrt(sqr(abs(u.B1)) + sqr(abs(u.B2)));
+        if (Frequency!=0)
+        {
+            v[4] = (float)u.A.im;
+            v[5] = (float)u.B1.im;
+            v[6] = (float)u.B2.im;
+        }
+    }, values);
+    return numPlanes;
+}
 
-        if (z <= meshelem[hi].rsqr)
+double FPProc::ElementSizeField(double tolerance, int maxElements, std::vector<double> &maxArea)
+{
+    EnsureBoundaryEdges();
+    const int numElements = (int)meshelem.size();
+
+    // field intensity and permeability of each element, and the magnetic energy:
+    std::vector<CComplex> H1(numElements), H2(numElements);
+    std::vector<double> mu(numElements);
+    double energy = 0;
+    for (int i=0; i<numElements; i++)
+    {
+        femmpostproc::CPostProcMElement &elm = meshelem[i];
+        CComplex mu1, mu2;
+        if (Frequency==0)
         {
-            if (InTriangleTest(x,y,hi))
-            {
-                k = hi;
-                return k;
-            }
+            double m1, m2;
+            GetMu(elm.B1.re, elm.B2.re, m1, m2, i);
+            mu1 = m1;
+            mu2 = m2;
+        } else {
+            GetMu(elm.B1, elm.B2, mu1, mu2, i);
+        }
+        H1[i] = elm.B1/(mu1*muo);
+        H2[i] = elm.B2/(mu2*muo);
+        if (Frequency==0)
+        {
+            const double Hc = blockproplist[elm.blk].H_c;
+            H1[i] -= Hc*cos(elm.magdir*PI/180.);
+            H2[i] -= Hc*sin(elm.magdir*PI/180.);
         }
+        mu[i] = (abs(mu1)+abs(mu2))/2.;
+        energy += ElmArea(i)*(sqr(abs(elm.B1))/abs(mu1) + sqr(abs(elm.B2))/abs(mu2))/muo;
+    }
 
-        z = (meshelem[lo].ctr.re-x)*(meshelem[lo].ctr.re-x) +
-            (meshelem[lo].ctr.im-y)*(meshelem[lo].ctr.im-y);
+    // error indicator of each element, from the jumps of the tangential field intensity across its edges:
+    std::vector<double> eta(numElements, 0.);
+    femm::addTangentialFieldJumps(numElements, [this](int i, int j) {
+        return elementNeighbours[3*i+j];
+    }, [this](int i, int j) {
+        return meshnode[meshelem[i].p[j]].CC();
+    }, H1, H2, mu, muo, eta);
+    double sumEta = 0;
+    for (int i=0; i<numElements; i++)
+    {
+        eta[i] = sqrt(eta[i]);
+        sumEta += eta[i];
+    }
 
-        if (z <= meshelem[lo].rsqr)
+    maxArea.assign(numElements, -1);
+    if (sumEta <= 0 || energy <= 0)
+        return tolerance;
+
+    // The indicators scale with the element area, so splitting element i into m = eta_i/c elements
+    // (but at least one) gives them an indicator of c each. Such a mesh has sum(max(eta_i/c,1)) elements,
+    // and its squared error is sum(eta_i*min(eta_i,c)). Find the largest c that meets the tolerance,
+    // or the smallest one that meets the element budget, by bisection:
+    auto squaredError = [&eta](double c) {
+        double e2 = 0;
+        for (double e: eta)
+            e2 += e*std::min(e,c);
+        return e2;
+    };
+    // (new elements count three times, since triangle adds about twice as many around them to keep the mesh quality)
+    auto numberOfElements = [&eta](double c) {
+        double n = 0;
+        for (double e: eta)
+            n += 1. + 3.*std::max(e/c-1., 0.);
+        return n;
+    };
+    double c = sumEta/numElements;
+    double lo = 1.e-6*c;
+    double hi = *std::max_element(eta.begin(), eta.end());
+    for (int k=0; k<60; k++)
+    {
+        c = sqrt(lo*hi);
+        if (squaredError(c) > tolerance*tolerance*energy)
+            hi = c;
+        else
+            lo = c;
+    }
+    c = lo;
+    if (maxElements > 0 && numberOfElements(c) > maxElements)
+    {
+        hi = *std::max_element(eta.begin(), eta.end());
+        for (int k=0; k<60; k++)
         {
-            if (InTriangleTest(x,y,lo))
-            {
-                k = lo;
-                return k;
-            }
+            const double m = sqrt(lo*hi);
+            if (numberOfElements(m) > maxElements)
+                lo = m;
+            else
+                hi = m;
         }
-
+        c = hi;
+        tolerance = sqrt(squaredError(c)/energy);
     }
 
-    return (-1);
-}
-
-bool FPProc::GetPointValues(double x, double y, CMPointVals &u)
-{
-    int k;
-
-    // find the mesh triangle in which x,y resides, if any
-    k = InTriangle(x,y);
-
-    if (k<0)
+    for (int i=0; i<numElements; i++)
     {
-        // we are not in a triangle so return false
-        return false;
+        if (eta[i] <= 0)
+            continue;
+        const double a = ElmArea(i);
+        maxArea[i] = std::max(a*c/eta[i], a/64.);
     }
-
-    // we are in a triangle 'k', we can interpolate the point
-    // values in the triangle
-    GetPointValues(x,y,k,u);
-
-    return true;
+    return tolerance;
 }
 
 bool FPProc::GetPointValues(double x, double y, int k, CMPointVals &u)
@@ -2382,6 +3001,7 @@ bool FPProc::GetPointValues(double x, double y, int k, CMPointVals &u)
            (meshnode[n[0]].x + meshnode[n[1]].x + meshnode[n[2]].x)/3.;
 
     // interpolate the flux density B at the given point in the element
+    if (Smooth) EnsureNodalB(k);
     GetPointB(x,y,u.B1,u.B2,meshelem[k]);
 
     u.Hc=0;
@@ -3185,24 +3805,9 @@ void FPProc::GetElementB(femmpostproc::CPostProcMElement &elm)
 
 int FPProc::ClosestNode(const double x, const double y) const
 {
-    int i,j;
-    double d0,d1;
-
-    if(nodelist.size()==0) return -1;
-
-    j=0;
-    d0=nodelist[0].GetDistance(x,y);
-    for(i=0; i<(int)nodelist.size(); i++)
-    {
-        d1=nodelist[i].GetDistance(x,y);
-        if(d1<d0)
-        {
-            d0=d1;
-            j=i;
-        }
-    }
-
-    return j;
+    return nodeTree.nearest(x, y, [this,x,y](int i) {
+        return nodelist[i].GetDistance(x,y);
+    });
 }
 
 //void FPProc::GetLineValues(CXYPlot &p,int PlotType,int NumPlotPoints)
@@ -3694,7 +4299,7 @@ CComplex FPProc::PlnInt(double a, CComplex *u, CComplex *v) const
 CComplex FPProc::AxiInt(double a, CComplex *u, CComplex *v,double *r) const
 {
     int i;
-    static CComplex M[3][3];
+    CComplex M[3][3];
     CComplex x, z[3];
 
     M[0][0]=6.*r[0]+2.*r[1]+2.*r[2];
@@ -3740,456 +4345,544 @@ CComplex FPProc::HenrotteVector(int k) const
     return v;
 }
 
-CComplex FPProc::BlockIntegral(const int inttype)
+std::vector<int> FPProc::SelectedElements() const
 {
-    int i,k;
+    std::vector<int> elements;
+    for(int lbl=0; lbl<(int)labelElements.size(); lbl++)
+    {
+        if(blocklist[lbl].IsSelected)
+            elements.insert(elements.end(), labelElements[lbl].begin(), labelElements[lbl].end());
+    }
+    return elements;
+}
+
+/**
+ * @brief Check whether a block integral uses the current density or vector potential of the elements.
+ * @param inttype The identifier of the block integral.
+ * @return \c false, if BlockIntegralElement::J, Jn and A are not needed.
+ */
+static bool BlockIntegralNeedsJA(int inttype)
+{
+    switch(inttype)
+    {
+    case 3: case 5: case 8: case 9: case 10:
+    case 18: case 19: case 20: case 21: case 22: case 23:
+    case 24: case 25:
+        return false;
+    default:
+        return true;
+    }
+}
+
+void FPProc::GetBlockIntegralElement(int i, bool withJA, BlockIntegralElement &e) const
+{
+    e.i=i;
+    if(withJA) e.J=GetJA(i,e.Jn,e.A);
+    else
+    {
+        e.J=0;
+        for(int k=0; k<3; k++)
+        {
+            e.Jn[k]=0;
+            e.A[k]=0;
+        }
+    }
+    e.a=ElmArea(i)*std::pow(LengthConv[LengthUnits],2.);
+    e.R=0;
+    for(int k=0; k<3; k++) e.r[k]=0;
+    if(problemType==AXISYMMETRIC)
+    {
+        for(int k=0; k<3; k++)
+            e.r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
+        e.R=(e.r[0]+e.r[1]+e.r[2])/3.;
+    }
+}
+
+CComplex FPProc::BlockIntegrand(int inttype, const BlockIntegralElement &e)
+{
+    int i=e.i;
+    int k;
     CComplex c,y,z,J,mu1,mu2,B1,B2,H1,H2,F1,F2;
     CComplex A[3],Jn[3],U[3],V[3];
-    double a,sig,R = 0;
-    double r[3] = {0, 0, 0};
+    double a,sig,R;
+    double r[3];
 
     z=0;
-    y.re = 0.; y.im = 0.;
-    for(i=0; i<3; i++) U[i]=1.;
+    y=0;
+    J=e.J;
+    a=e.a;
+    R=e.R;
+    for(k=0; k<3; k++)
+    {
+        A[k]=e.A[k];
+        Jn[k]=e.Jn[k];
+        r[k]=e.r[k];
+        U[k]=1.;
+    }
 
-    if(inttype==6)
+    // the weighted stress tensor integrals are computed per unit volume
+    if((inttype>=18) && (inttype<=23))
     {
-        z = BlockIntegral(3) + BlockIntegral(4); //total losses
+        if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
+        else a*=Depth;
     }
-    else
+
+    switch(inttype)
     {
-        for(i=0; i<(int)meshelem.size(); i++)
-        {
-            if(blocklist[meshelem[i].lbl].IsSelected==true)
-            {
+    case 0: //  A.J
+        for(k=0; k<3; k++) V[k]=Jn[k].Conj();
+        if(problemType==PLANAR)
+            y=PlnInt(a,A,V)*Depth;
+        else
+            y=AxiInt(a,A,V,r);
+        z+=y;
 
-                // compute some useful quantities employed by most integrals...
-                J=GetJA(i,Jn,A);
-                a=ElmArea(i)*std::pow(LengthConv[LengthUnits],2.);
-                if(problemType==AXISYMMETRIC)
-                {
-                    for(k=0; k<3; k++)
-                        r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
-                    R=(r[0]+r[1]+r[2])/3.;
-                }
+        break;
 
-                // now, compute the desired integral;
-                switch(inttype)
-                {
-                case 0: //  A.J
-                    for(k=0; k<3; k++) V[k]=Jn[k].Conj();
-                    if(problemType==PLANAR)
-                        y=PlnInt(a,A,V)*Depth;
-                    else
-                        y=AxiInt(a,A,V,r);
-                    z+=y;
+    case 11: // x (or r) direction Lorentz force, SS part.
+        B2=meshelem[i].B2;
+        y= -(B2.re*J.re + B2.im*J.im);
+        if (problemType==AXISYMMETRIC) y=0;
+        else y*=Depth;
+        if(Frequency!=0) y*=0.5;
+        z+=(a*y);
+        break;
 
-                    break;
+    case 12: // y (or z) direction Lorentz force, SS part.
+        for(k=0; k<3; k++) V[k]=Re(meshelem[i].B1*Jn[k].Conj());
+        if(problemType==PLANAR)
+            y=PlnInt(a,U,V)*Depth;
+        else
+            y=AxiInt(-a,U,V,r);
+        if(Frequency!=0) y*=0.5;
+        z+=y;
 
-                case 11: // x (or r) direction Lorentz force, SS part.
-                    B2=meshelem[i].B2;
-                    y= -(B2.re*J.re + B2.im*J.im);
-                    if (problemType==AXISYMMETRIC) y=0;
-                    else y*=Depth;
-                    if(Frequency!=0) y*=0.5;
-                    z+=(a*y);
-                    break;
+        break;
 
-                case 12: // y (or z) direction Lorentz force, SS part.
-                    for(k=0; k<3; k++) V[k]=Re(meshelem[i].B1*Jn[k].Conj());
-                    if(problemType==PLANAR)
-                        y=PlnInt(a,U,V)*Depth;
-                    else
-                        y=AxiInt(-a,U,V,r);
-                    if(Frequency!=0) y*=0.5;
-                    z+=y;
+    case 13: // x (or r) direction Lorentz force, 2x part.
+        if((Frequency!=0) && (problemType==PLANAR))
+        {
+            B2=meshelem[i].B2;
+            y= -(B2.re*J.re - B2.im*J.im) - I*(B2.re*J.im+B2.im*J.re);
+            z+=0.5*(a*y*Depth);
+        }
+        break;
 
-                    break;
+    case 14: // y (or z) direction Lorentz force, 2x part.
+        if (Frequency!=0)
+        {
+            B1=meshelem[i].B1;
+            B2=meshelem[i].B2;
+            y= (B1.re*J.re - B1.im*J.im) + I*(B1.re*J.im+B1.im*J.re);
+            if(problemType==AXISYMMETRIC) y=(-y*2.*PI*R);
+            else y*=Depth;
+            z+=(a*y)/2.;
+        }
+        break;
 
-                case 13: // x (or r) direction Lorentz force, 2x part.
-                    if((Frequency!=0) && (problemType==PLANAR))
-                    {
-                        B2=meshelem[i].B2;
-                        y= -(B2.re*J.re - B2.im*J.im) - I*(B2.re*J.im+B2.im*J.re);
-                        z+=0.5*(a*y*Depth);
-                    }
-                    break;
+    case 16: // Lorentz Torque, 2x
+        if ((Frequency!=0) && (problemType==PLANAR))
+        {
+            B1=meshelem[i].B1;
+            B2=meshelem[i].B2;
+            c=Ctr(i)*LengthConv[LengthUnits];
+            y= c.re*((B1.re*J.re - B1.im*J.im) + I*(B1.re*J.im+B1.im*J.re))
+               +c.im*((B2.re*J.re - B2.im*J.im) + I*(B2.re*J.im+B2.im*J.re));
+            z+=0.5*(a*y*Depth);
+        }
+        break;
 
-                case 14: // y (or z) direction Lorentz force, 2x part.
-                    if (Frequency!=0)
-                    {
-                        B1=meshelem[i].B1;
-                        B2=meshelem[i].B2;
-                        y= (B1.re*J.re - B1.im*J.im) + I*(B1.re*J.im+B1.im*J.re);
-                        if(problemType==AXISYMMETRIC) y=(-y*2.*PI*R);
-                        else y*=Depth;
-                        z+=(a*y)/2.;
-                    }
-                    break;
+    case 15: // Lorentz Torque, SS part.
+        if(problemType==PLANAR)
+        {
+            B1=meshelem[i].B1;
+            B2=meshelem[i].B2;
+            c=Ctr(i)*LengthConv[LengthUnits];
+            y= c.im*(B2.re*J.re + B2.im*J.im) + c.re*(B1.re*J.re + B1.im*J.im);
+            if(Frequency!=0) y*=0.5;
+            z+=(a*y*Depth);
+        }
+        break;
 
-                case 16: // Lorentz Torque, 2x
-                    if ((Frequency!=0) && (problemType==PLANAR))
-                    {
-                        B1=meshelem[i].B1;
-                        B2=meshelem[i].B2;
-                        c=Ctr(i)*LengthConv[LengthUnits];
-                        y= c.re*((B1.re*J.re - B1.im*J.im) + I*(B1.re*J.im+B1.im*J.re))
-                           +c.im*((B2.re*J.re - B2.im*J.im) + I*(B2.re*J.im+B2.im*J.re));
-                        z+=0.5*(a*y*Depth);
-                    }
-                    break;
+    case 1: // integrate A over the element;
+        if(problemType==AXISYMMETRIC)
+            y=AxiInt(a,U,A,r);
+        else
+            for(k=0,y=0; k<3; k++) y+=a*Depth*A[k]/3.;
 
-                case 15: // Lorentz Torque, SS part.
-                    if(problemType==PLANAR)
-                    {
-                        B1=meshelem[i].B1;
-                        B2=meshelem[i].B2;
-                        c=Ctr(i)*LengthConv[LengthUnits];
-                        y= c.im*(B2.re*J.re + B2.im*J.im) + c.re*(B1.re*J.re + B1.im*J.im);
-                        if(Frequency!=0) y*=0.5;
-                        z+=(a*y*Depth);
-                    }
-                    break;
+        z+=y;
+        break;
 
-                case 1: // integrate A over the element;
-                    if(problemType==AXISYMMETRIC)
-                        y=AxiInt(a,U,A,r);
-                    else
-                        for(k=0,y=0; k<3; k++) y+=a*Depth*A[k]/3.;
+    case 2: // stored energy
+        if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
+        else a*=Depth;
+        B1=meshelem[i].B1;
+        B2=meshelem[i].B2;
+        if(Frequency!=0)
+        {
+            // have to compute the energy stored in a special way for
+            // wound regions subject to prox and skin effects
+            if (blockproplist[meshelem[i].blk].LamType>2)
+            {
+                CComplex mu;
+                mu=muo*blocklist[meshelem[i].lbl].mu;
+                double u=Im(1./blocklist[meshelem[i].lbl].o)/(2.e6*PI*Frequency);
+                y=a*Re(B1*conj(B1)+B2*conj(B2))*Re(1./mu)/4.;
+                y+=a*Re(J*conj(J))*u/4.;
+            }
+            else y=a*blockproplist[meshelem[i].blk].DoEnergy(B1,B2);
+        }
+        else
+        {
+            // correct H and energy stored in magnet for second-quadrant
+            // representation of a PM.
+            if (blockproplist[meshelem[i].blk].H_c!=0)
+            {
+                int bk=meshelem[i].blk;
 
-                    z+=y;
-                    break;
+                // in the linear case:
+                if (blockproplist[bk].BHpoints==0)
+                {
+                    CComplex Hc;
+                    mu1=blockproplist[bk].mu_x;
+                    mu2=blockproplist[bk].mu_y;
+                    H1=B1/(mu1*muo);
+                    H2=B2/(mu2*muo);
+                    Hc = blockproplist[bk].H_c*exp(I*PI*meshelem[i].magdir/180.);
+                    H1=H1-Re(Hc);
+                    H2=H2-Im(Hc);
+                    y = a*0.5*muo*(mu1.re*H1.re*H1.re + mu2.re*H2.re*H2.re);
+                }
+                else  // the material is nonlinear
+                {
+                    y=blockproplist[bk].DoEnergy(B1.re,B2.re);
+                    y = y + blockproplist[bk].Nrg
+                        - blockproplist[bk].H_c*Re((B1.re+I*B2.re)/exp(I*PI*meshelem[i].magdir/180.));
+                    y*=a;
+                }
+            }
+            else y=a*blockproplist[meshelem[i].blk].DoEnergy(B1.re,B2.re);
 
-                case 2: // stored energy
-                    if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
-                    else a*=Depth;
-                    B1=meshelem[i].B1;
-                    B2=meshelem[i].B2;
-                    if(Frequency!=0)
-                    {
-                        // have to compute the energy stored in a special way for
-                        // wound regions subject to prox and skin effects
-                        if (blockproplist[meshelem[i].blk].LamType>2)
-                        {
-                            CComplex mu;
-                            mu=muo*blocklist[meshelem[i].lbl].mu;
-                            double u=Im(1./blocklist[meshelem[i].lbl].o)/(2.e6*PI*Frequency);
-                            y=a*Re(B1*conj(B1)+B2*conj(B2))*Re(1./mu)/4.;
-                            y+=a*Re(J*conj(J))*u/4.;
-                        }
-                        else y=a*blockproplist[meshelem[i].blk].DoEnergy(B1,B2);
-                    }
-                    else
-                    {
-                        // correct H and energy stored in magnet for second-quadrant
-                        // representation of a PM.
-                        if (blockproplist[meshelem[i].blk].H_c!=0)
-                        {
-                            int bk=meshelem[i].blk;
-
-                            // in the linear case:
-                            if (blockproplist[bk].BHpoints==0)
-                            {
-                                CComplex Hc;
-                                mu1=blockproplist[bk].mu_x;
-                                mu2=blockproplist[bk].mu_y;
-                                H1=B1/(mu1*muo);
-                                H2=B2/(mu2*muo);
-                                Hc = blockproplist[bk].H_c*exp(I*PI*meshelem[i].magdir/180.);
-                                H1=H1-Re(Hc);
-                                H2=H2-Im(Hc);
-                                y = a*0.5*muo*(mu1.re*H1.re*H1.re + mu2.re*H2.re*H2.re);
-                            }
-                            else  // the material is nonlinear
-                            {
-                                y=blockproplist[bk].DoEnergy(B1.re,B2.re);
-                                y = y + blockproplist[bk].Nrg
-                                    - blockproplist[bk].H_c*Re((B1.re+I*B2.re)/exp(I*PI*meshelem[i].magdir/180.));
-                                y*=a;
-                            }
-                        }
-                        else y=a*blockproplist[meshelem[i].blk].DoEnergy(B1.re,B2.re);
+            // add in "local" stored energy for wound that would be subject to
+            // prox and skin effect for nonzero frequency cases.
+            if (blockproplist[meshelem[i].blk].LamType>2)
+            {
+                double u=Im(blocklist[meshelem[i].lbl].o);
+                y+=a*Re(J*J)*u/2.;
+            }
+        }
+        y*=AECF(i); // correction for axisymmetric external region;
 
-                        // add in "local" stored energy for wound that would be subject to
-                        // prox and skin effect for nonzero frequency cases.
-                        if (blockproplist[meshelem[i].blk].LamType>2)
-                        {
-                            double u=Im(blocklist[meshelem[i].lbl].o);
-                            y+=a*Re(J*J)*u/2.;
-                        }
-                    }
-                    y*=AECF(i); // correction for axisymmetric external region;
+        z+=y;
+        break;
 
-                    z+=y;
-                    break;
+    case 3:  // Hysteresis & Laminated eddy current losses
+        if(Frequency!=0)
+        {
+            if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
+            else a*=Depth;
+            B1=meshelem[i].B1;
+            B2=meshelem[i].B2;
+            GetMu(B1,B2,mu1,mu2,i);
+            H1=B1/(mu1*muo);
+            H2=B2/(mu2*muo);
 
-                case 3:  // Hysteresis & Laminated eddy current losses
-                    if(Frequency!=0)
-                    {
-                        if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
-                        else a*=Depth;
-                        B1=meshelem[i].B1;
-                        B2=meshelem[i].B2;
-                        GetMu(B1,B2,mu1,mu2,i);
-                        H1=B1/(mu1*muo);
-                        H2=B2/(mu2*muo);
-
-                        y=a*PI*Frequency*Im(H1*B1.Conj() + H2*B2.Conj());
-                        z+=y;
-                    }
-                    break;
+            y=a*PI*Frequency*Im(H1*B1.Conj() + H2*B2.Conj());
+            z+=y;
+        }
+        break;
 
-                case 4: // Resistive Losses
-                    sig=1.e06/Re(1./blocklist[meshelem[i].lbl].o);
-                    if((blockproplist[meshelem[i].blk].Lam_d!=0) &&
-                            (blockproplist[meshelem[i].blk].LamType==0)) sig=0;
-                    if(sig!=0)
-                    {
+    case 4: // Resistive Losses
+        sig=1.e06/Re(1./blocklist[meshelem[i].lbl].o);
+        if((blockproplist[meshelem[i].blk].Lam_d!=0) &&
+                (blockproplist[meshelem[i].blk].LamType==0)) sig=0;
+        if(sig!=0)
+        {
 
-                        if (problemType==PLANAR)
-                        {
-                            for(k=0; k<3; k++) V[k]=Jn[k].Conj()/sig;
-                            y=PlnInt(a,Jn,V)*Depth;
-                        }
+            if (problemType==PLANAR)
+            {
+                for(k=0; k<3; k++) V[k]=Jn[k].Conj()/sig;
+                y=PlnInt(a,Jn,V)*Depth;
+            }
 
-                        if(problemType==AXISYMMETRIC)
-                            y=2.*PI*R*a*J*conj(J)/sig;
+            if(problemType==AXISYMMETRIC)
+                y=2.*PI*R*a*J*conj(J)/sig;
 
-                        if(Frequency!=0) y/=2.;
-                        z+=y;
-                    }
-                    break;
+            if(Frequency!=0) y/=2.;
+            z+=y;
+        }
+        break;
 
-                case 5: // cross-section area
-                    z+=a;
-                    break;
+    case 5: // cross-section area
+        z+=a;
+        break;
 
-                case 10: // volume
-                    if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
-                    else a*=Depth;
-                    z+=a;
-                    break;
+    case 10: // volume
+        if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
+        else a*=Depth;
+        z+=a;
+        break;
 
-                case 7: // total current in block;
-                    z+=a*J;
+    case 7: // total current in block;
+        z+=a*J;
 
-                    break;
+        break;
 
-                case 8: // integrate x or r part of b over the block
-                    if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
-                    else a*=Depth;
-                    z+=(a*meshelem[i].B1);
-                    break;
+    case 8: // integrate x or r part of b over the block
+        if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
+        else a*=Depth;
+        z+=(a*meshelem[i].B1);
+        break;
 
-                case 9: // integrate y or z part of b over the block
-                    if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
-                    else a*=Depth;
-                    z+=(a*meshelem[i].B2);
-                    break;
+    case 9: // integrate y or z part of b over the block
+        if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
+        else a*=Depth;
+        z+=(a*meshelem[i].B2);
+        break;
 
-                case 17: // Coenergy
-                    if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
-                    else a*=Depth;
-                    B1=meshelem[i].B1;
-                    B2=meshelem[i].B2;
-                    if(Frequency!=0)
-                    {
-                        // have to compute the energy stored in a special way for
-                        // wound regions subject to prox and skin effects
-                        if (blockproplist[meshelem[i].blk].LamType>2)
-                        {
-                            CComplex mu;
-                            mu=muo*blocklist[meshelem[i].lbl].mu;
-                            double u=Im(1./blocklist[meshelem[i].lbl].o)/(2.e6*PI*Frequency);
-                            y=a*Re(B1*conj(B1)+B2*conj(B2))*Re(1./mu)/4.;
-                            y+=a*Re(J*conj(J))*u/4.;
-                        }
-                        else y=a*blockproplist[meshelem[i].blk].DoCoEnergy(B1,B2);
-                    }
-                    else
-                    {
-                        y=a*blockproplist[meshelem[i].blk].DoCoEnergy(B1.re,B2.re);
+    case 17: // Coenergy
+        if(problemType==AXISYMMETRIC) a*=(2.*PI*R);
+        else a*=Depth;
+        B1=meshelem[i].B1;
+        B2=meshelem[i].B2;
+        if(Frequency!=0)
+        {
+            // have to compute the energy stored in a special way for
+            // wound regions subject to prox and skin effects
+            if (blockproplist[meshelem[i].blk].LamType>2)
+            {
+                CComplex mu;
+                mu=muo*blocklist[meshelem[i].lbl].mu;
+                double u=Im(1./blocklist[meshelem[i].lbl].o)/(2.e6*PI*Frequency);
+                y=a*Re(B1*conj(B1)+B2*conj(B2))*Re(1./mu)/4.;
+                y+=a*Re(J*conj(J))*u/4.;
+            }
+            else y=a*blockproplist[meshelem[i].blk].DoCoEnergy(B1,B2);
+        }
+        else
+        {
+            y=a*blockproplist[meshelem[i].blk].DoCoEnergy(B1.re,B2.re);
 
-                        // add in "local" stored energy for wound that would be subject to
-                        // prox and skin effect for nonzero frequency cases.
-                        if (blockproplist[meshelem[i].blk].LamType>2)
-                        {
-                            double u=Im(blocklist[meshelem[i].lbl].o);
-                            y+=a*Re(J*J)*u/2.;
-                        }
-                    }
-                    y*=AECF(i); // correction for axisymmetric external region;
+            // add in "local" stored energy for wound that would be subject to
+            // prox and skin effect for nonzero frequency cases.
+            if (blockproplist[meshelem[i].blk].LamType>2)
+            {
+                double u=Im(blocklist[meshelem[i].lbl].o);
+                y+=a*Re(J*J)*u/2.;
+            }
+        }
+        y*=AECF(i); // correction for axisymmetric external region;
 
-                    z+=y;
-                    break;
+        z+=y;
+        break;
 
-                case 24: // Moment of Inertia-like integral
+    case 24: // Moment of Inertia-like integral
 
-                    // For axisymmetric problems, compute the moment
-                    // of inertia about the r=0 axis.
-                    if(problemType==AXISYMMETRIC)
-                    {
-                        for(k=0; k<3; k++) V[k]=r[k];
-                        y=AxiInt(a,V,V,r);
-                    }
+        // For axisymmetric problems, compute the moment
+        // of inertia about the r=0 axis.
+        if(problemType==AXISYMMETRIC)
+        {
+            for(k=0; k<3; k++) V[k]=r[k];
+            y=AxiInt(a,V,V,r);
+        }
 
-                    // For planar problems, compute the moment of
-                    // inertia about the z=axis.
-                    else
-                    {
-                        for(k=0; k<3; k++)
-                        {
-                            U[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
-                            V[k]=meshnode[meshelem[i].p[k]].y*LengthConv[LengthUnits];
-                        }
-                        y =U[0]*U[0] + U[1]*U[1] + U[2]*U[2];
-                        y+=U[0]*U[1] + U[0]*U[2] + U[1]*U[2];
-                        y+=V[0]*V[0] + V[1]*V[1] + V[2]*V[2];
-                        y+=V[0]*V[1] + V[0]*V[2] + V[1]*V[2];
-                        y*=(a*Depth/6.);
-                    }
+        // For planar problems, compute the moment of
+        // inertia about the z=axis.
+        else
+        {
+            for(k=0; k<3; k++)
+            {
+                U[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
+                V[k]=meshnode[meshelem[i].p[k]].y*LengthConv[LengthUnits];
+            }
+            y =U[0]*U[0] + U[1]*U[1] + U[2]*U[2];
+            y+=U[0]*U[1] + U[0]*U[2] + U[1]*U[2];
+            y+=V[0]*V[0] + V[1]*V[1] + V[2]*V[2];
+            y+=V[0]*V[1] + V[0]*V[2] + V[1]*V[2];
+            y*=(a*Depth/6.);
+        }
 
-                    z+=y;
-                    break;
+        z+=y;
+        break;
 
-                case 25: // 2D Shape centroid
+    case 25: // 2D Shape centroid
 
-                    y.re += meshelem[i].ctr.re * a;
-                    y.im += meshelem[i].ctr.im * a;
+        z.re = meshelem[i].ctr.re * a;
+        z.im = meshelem[i].ctr.im * a;
 
-                    break;
+        break;
 
-                default:
-                    break;
-                }
-            }
+    case 6: // total losses
+        z=BlockIntegrand(3,e)+BlockIntegrand(4,e);
+        break;
 
-CComplex temp;
-            // integrals that need to be evaluated over all elements,
-            // regardless of which elements are actually selected.
-            if((inttype>=18) || (inttype<=23))
-            {
-                a=ElmArea(i)*std::pow(LengthConv[LengthUnits],2.);
-                if(problemType==AXISYMMETRIC)
-                {
-                    for(k=0; k<3; k++)
-                        r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
-                    R=(r[0]+r[1]+r[2])/3.;
-                    a*=(2.*PI*R);
-                }
-                else a*=Depth;
+    case 18: // x (or r) direction Henrotte force, SS part.
+        if(problemType!=0) break;
 
-                switch(inttype)
-                {
+        B1 = meshelem[i].B1;
 
-                case 18: // x (or r) direction Henrotte force, SS part.
-                    if(problemType!=0) break;
+        B2 = meshelem[i].B2;
 
-                    B1 = meshelem[i].B1;
+        c = HenrotteVector(i);
 
-                    B2 = meshelem[i].B2;
+        y = (((B1*conj(B1)) - (B2*conj(B2)))*Re(c) + 2.*Re(B1*conj(B2))*Im(c))/(2.*muo);
 
-                    c = HenrotteVector(i);
+        if(Frequency!=0)
+        {
+            y/=2.;
+        }
 
-                    y = (((B1*conj(B1)) - (B2*conj(B2)))*Re(c) + 2.*Re(B1*conj(B2))*Im(c))/(2.*muo);
+        y*=AECF(i); // correction for axisymmetric external region;
 
-                    if(Frequency!=0)
-                    {
-                        y/=2.;
-                    }
+        z+=(a*y);
+        break;
 
-                    y*=AECF(i); // correction for axisymmetric external region;
+    case 19: // y (or z) direction Henrotte force, SS part.
 
-                    z+=(a*y);
-                    break;
+        B1=meshelem[i].B1;
+        B2=meshelem[i].B2;
+        c=HenrotteVector(i);
 
-                case 19: // y (or z) direction Henrotte force, SS part.
+        y=(((B2*conj(B2)) - (B1*conj(B1)))*Im(c) + 2.*Re(B1*conj(B2))*Re(c))/(2.*muo);
 
-                    B1=meshelem[i].B1;
-                    B2=meshelem[i].B2;
-                    c=HenrotteVector(i);
+        y*=AECF(i); // correction for axisymmetric external region;
 
-                    y=(((B2*conj(B2)) - (B1*conj(B1)))*Im(c) + 2.*Re(B1*conj(B2))*Re(c))/(2.*muo);
+        if(Frequency!=0) y/=2.;
+        z+=(a*y);
 
-                    y*=AECF(i); // correction for axisymmetric external region;
+        break;
 
-                    if(Frequency!=0) y/=2.;
-                    z+=(a*y);
+    case 20: // x (or r) direction Henrotte force, 2x part.
 
-                    break;
+        if(problemType!=0) break;
+        B1=meshelem[i].B1;
+        B2=meshelem[i].B2;
+        c=HenrotteVector(i);
+        z+=a*((((B1*B1) - (B2*B2))*Re(c) + 2.*B1*B2*Im(c))/(4.*muo)) * AECF(i);
 
-                case 20: // x (or r) direction Henrotte force, 2x part.
+        break;
 
-                    if(problemType!=0) break;
-                    B1=meshelem[i].B1;
-                    B2=meshelem[i].B2;
-                    c=HenrotteVector(i);
-                    z+=a*((((B1*B1) - (B2*B2))*Re(c) + 2.*B1*B2*Im(c))/(4.*muo)) * AECF(i);
+    case 21: // y (or z) direction Henrotte force, 2x part.
 
-                    break;
+        B1=meshelem[i].B1;
+        B2=meshelem[i].B2;
+        c=HenrotteVector(i);
+        z+= a*((((B2*B2) - (B1*B1))*Im(c) + 2.*B1*B2*Re(c))/(4.*muo)) * AECF(i);
 
-                case 21: // y (or z) direction Henrotte force, 2x part.
+        break;
 
-                    B1=meshelem[i].B1;
-                    B2=meshelem[i].B2;
-                    c=HenrotteVector(i);
-                    z+= a*((((B2*B2) - (B1*B1))*Im(c) + 2.*B1*B2*Re(c))/(4.*muo)) * AECF(i);
+    case 22: // Henrotte torque, SS part.
+        if(problemType!=PLANAR) break;
+        B1=meshelem[i].B1;
+        B2=meshelem[i].B2;
+        c=HenrotteVector(i);
 
-                    break;
+        F1 = (((B1*conj(B1)) - (B2*conj(B2)))*Re(c) +
+              2.*Re(B1*conj(B2))*Im(c))/(2.*muo);
+        F2 = (((B2*conj(B2)) - (B1*conj(B1)))*Im(c) +
+              2.*Re(B1*conj(B2))*Re(c))/(2.*muo);
 
-                case 22: // Henrotte torque, SS part.
-                    if(problemType!=PLANAR) break;
-                    B1=meshelem[i].B1;
-                    B2=meshelem[i].B2;
-                    c=HenrotteVector(i);
+        for(c=0,k=0; k<3; k++)
+            c+=meshnode[meshelem[i].p[k]].CC()*LengthConv[LengthUnits]/3.;
 
-                    F1 = (((B1*conj(B1)) - (B2*conj(B2)))*Re(c) +
-                          2.*Re(B1*conj(B2))*Im(c))/(2.*muo);
-                    F2 = (((B2*conj(B2)) - (B1*conj(B1)))*Im(c) +
-                          2.*Re(B1*conj(B2))*Re(c))/(2.*muo);
+        y=Re(c)*F2 -Im(c)*F1;
+        if(Frequency!=0) y/=2.;
+        y*=AECF(i);
+        z+=(a*y);
 
-                    for(c=0,k=0; k<3; k++)
-                        c+=meshnode[meshelem[i].p[k]].CC()*LengthConv[LengthUnits]/3.;
+        break;
 
-                    y=Re(c)*F2 -Im(c)*F1;
-                    if(Frequency!=0) y/=2.;
-                    y*=AECF(i);
-                    z+=(a*y);
+    case 23: // Henrotte torque, 2x part.
 
-                    break;
+        if(problemType!=PLANAR) break;
+        B1=meshelem[i].B1;
+        B2=meshelem[i].B2;
+        c=HenrotteVector(i);
+        F1 = (((B1*B1) - (B2*B2))*Re(c) + 2.*B1*B2*Im(c))/(4.*muo);
+        F2 = (((B2*B2) - (B1*B1))*Im(c) + 2.*B1*B2*Re(c))/(4.*muo);
 
-                case 23: // Henrotte torque, 2x part.
+        for(c=0,k=0; k<3; k++)
+            c+=meshnode[meshelem[i].p[k]].CC()*LengthConv[LengthUnits]/3;
 
-                    if(problemType!=PLANAR) break;
-                    B1=meshelem[i].B1;
-                    B2=meshelem[i].B2;
-                    c=HenrotteVector(i);
-                    F1 = (((B1*B1) - (B2*B2))*Re(c) + 2.*B1*B2*Im(c))/(4.*muo);
-                    F2 = (((B2*B2) - (B1*B1))*Im(c) + 2.*B1*B2*Re(c))/(4.*muo);
+        z+=a*(Re(c)*F2 -Im(c)*F1)*AECF(i);
 
-                    for(c=0,k=0; k<3; k++)
-                        c+=meshnode[meshelem[i].p[k]].CC()*LengthConv[LengthUnits]/3;
+        break;
 
-                    z+=a*(Re(c)*F2 -Im(c)*F1)*AECF(i);
+    default:
+        break;
+    }
 
-                    break;
+    return z;
+}
 
-                default:
-                    break;
-                }
-            }
+CComplex FPProc::BlockIntegral(const int inttype)
+{
+    CComplex z;
+    BlockIntegral(1,&inttype,&z);
+    return z;
+}
+
+void FPProc::BlockIntegral(int n, const int *inttypes, CComplex *z)
+{
+    // the shape centroid is divided by the block area, which is computed in the same pass
+    std::vector<int> types(inttypes,inttypes+n);
+    int areaIndex=-1;
+    for(int j=0; j<n; j++)
+    {
+        if(inttypes[j]==5) areaIndex=j;
+    }
+    for(int j=0; j<n; j++)
+    {
+        if((inttypes[j]==25) && (areaIndex<0))
+        {
+            areaIndex=(int)types.size();
+            types.push_back(5);
         }
     }
 
-    if (inttype == 25) // 2D shape centroid
+    bool withJA=false;
+    bool overAllElements=false;
+    for(int t: types)
     {
-        // divide sum of Cx*A and Cy*A by sum of A
-        CComplex temp = BlockIntegral(5);
-        z.re = y.Re() / temp.Re();
-        z.im = y.Im() / temp.Re();
+        if(BlockIntegralNeedsJA(t)) withJA=true;
+        if((t>=18) && (t<=23)) overAllElements=true;
     }
 
-    return z;
+    // the weighted stress tensor integrals need to be evaluated over all elements,
+    // regardless of which elements are actually selected.
+    std::vector<int> elements;
+    if(overAllElements)
+    {
+        elements.resize(meshelem.size());
+        for(int i=0; i<(int)meshelem.size(); i++) elements[i]=i;
+    }
+    else elements=SelectedElements();
+
+    std::vector<CComplex> sum(types.size());
+    femm::parallelSums<CComplex>((int)elements.size(), (int)types.size(), [&](int k, CComplex *terms) {
+        int i=elements[k];
+        bool selected=blocklist[meshelem[i].lbl].IsSelected;
+        BlockIntegralElement e;
+        GetBlockIntegralElement(i,withJA && selected,e);
+        for(int j=0; j<(int)types.size(); j++)
+        {
+            if(selected || ((types[j]>=18) && (types[j]<=23)))
+                terms[j]=BlockIntegrand(types[j],e);
+            else
+                terms[j]=0;
+        }
+    }, sum.data());
+
+    for(int j=0; j<n; j++)
+    {
+        z[j]=sum[j];
+        if (inttypes[j] == 25) // 2D shape centroid
+        {
+            // divide sum of Cx*A and Cy*A by sum of A
+            z[j].re = sum[j].Re() / sum[areaIndex].Re();
+            z[j].im = sum[j].Im() / sum[areaIndex].Re();
+        }
+    }
 }
 
 void FPProc::LineIntegral(int inttype, CComplex *z)
@@ -4237,53 +4930,29 @@ void FPProc::LineIntegral(int inttype, CComplex *z)
     // inttype==1 => H.t
     if(inttype==1)
     {
-        CComplex n,t,pt,Ht;
+        CComplex n,t,Ht;
         CMPointVals v;
-        double dz,u,l;
-        int i,j,k,m,elm;
-        int NumPlotPoints=d_LineIntegralPoints;
-        bool flag;
+        double l;
+        int i,k;
 
+        EnsureBoundaryEdges();
         z[0]=0;
         for(k=1; k<(int)contour.size(); k++)
         {
-            dz=abs(contour[k]-contour[k-1])/((double) NumPlotPoints);
-            for(i=0,elm=-1; i<NumPlotPoints; i++)
-            {
-                u=(((double) i)+0.5)/((double) NumPlotPoints);
-                pt=contour[k-1] + u*(contour[k] - contour[k-1]);
-                t=contour[k]-contour[k-1];
-                t/=abs(t);
-                n=I*t;
-                pt+=n*1.e-06;
-
-                if (elm<0) elm=InTriangle(pt.re,pt.im);
-                else if (InTriangleTest(pt.re,pt.im,elm)==false)
-                {
-                    flag=false;
-                    for(j=0; j<3; j++)
-                        for(m=0; m<NumList[meshelem[elm].p[j]]; m++)
-                        {
-                            elm=ConList[meshelem[elm].p[j]][m];
-                            if (InTriangleTest(pt.re,pt.im,elm)==true)
-                            {
-                                flag=true;
-                                m=100;
-                                j=3;
-                            }
-                        }
-                    if (flag==false) elm=InTriangle(pt.re,pt.im);
-                }
-                if(elm>=0)
-                    flag=GetPointValues(pt.re,pt.im,elm,v);
-                else flag=false;
+            t=contour[k]-contour[k-1];
+            t/=abs(t);
+            n=I*t;
 
-                if(flag==true)
+            // integrate element by element along the segment,
+            // shifted a little in the normal direction
+            IntegrateContourSegment(contour[k-1]+n*1.e-06, contour[k]+n*1.e-06,
+                                    [&](int elm, CComplex pt, double dz) {
+                if(GetPointValues(pt.re,pt.im,elm,v))
                 {
                     Ht = t.re*v.H1 + t.im*v.H2;
                     z[0]+=(Ht*dz*LengthConv[LengthUnits]);
                 }
-            }
+            });
 
 
             for(i=0,l=0; i<(int)contour.size()-1; i++)
@@ -4318,49 +4987,23 @@ void FPProc::LineIntegral(int inttype, CComplex *z)
     // inttype==3 => Stress Tensor Force
     if(inttype==3)
     {
-        CComplex n,t,pt,Hn,Bn,BH,dF1,dF2;
+        CComplex n,t,Hn,Bn,BH,dF1,dF2;
         CMPointVals v;
-        double dz,dza,u;
-        int i,j,k,m,elm;
-        int NumPlotPoints=d_LineIntegralPoints;
-        bool flag;
+        double dza;
+        int i,k;
 
+        EnsureBoundaryEdges();
         for(i=0; i<4; i++) z[i]=0;
 
         for(k=1; k<(int)contour.size(); k++)
         {
-            dz=abs(contour[k]-contour[k-1])/((double) NumPlotPoints);
-            for(i=0,elm=-1; i<NumPlotPoints; i++)
-            {
-                u=(((double) i)+0.5)/((double) NumPlotPoints);
-                pt=contour[k-1] + u*(contour[k] - contour[k-1]);
-                t=contour[k]-contour[k-1];
-                t/=abs(t);
-                n=I*t;
-                pt+=n*1.e-06;
-
-                if (elm<0) elm=InTriangle(pt.re,pt.im);
-                else if (InTriangleTest(pt.re,pt.im,elm)==false)
-                {
-                    flag=false;
-                    for(j=0; j<3; j++)
-                        for(m=0; m<NumList[meshelem[elm].p[j]]; m++)
-                        {
-                            elm=ConList[meshelem[elm].p[j]][m];
-                            if (InTriangleTest(pt.re,pt.im,elm)==true)
-                            {
-                                flag=true;
-                                m=100;
-                                j=3;
-                            }
-                        }
-                    if (flag==false) elm=InTriangle(pt.re,pt.im);
-                }
-                if(elm>=0)
-                    flag=GetPointValues(pt.re,pt.im,elm,v);
-                else flag=false;
+            t=contour[k]-contour[k-1];
+            t/=abs(t);
+            n=I*t;
 
-                if(flag==true)
+            IntegrateContourSegment(contour[k-1]+n*1.e-06, contour[k]+n*1.e-06,
+                                    [&](int elm, CComplex pt, double dz) {
+                if(GetPointValues(pt.re,pt.im,elm,v))
                 {
                     if(Frequency==0)
                     {
@@ -4411,7 +5054,7 @@ void FPProc::LineIntegral(int inttype, CComplex *z)
                         z[3]+=(dF2*dza/4.);
                     }
                 }
-            }
+            });
 
         }
     }
@@ -4419,55 +5062,23 @@ void FPProc::LineIntegral(int inttype, CComplex *z)
     // inttype==4 => Stress Tensor Torque
     if(inttype==4)
     {
-        CComplex n,t,pt,Hn,Bn,BH,dF1,dF2,dT;
+        CComplex n,t,Hn,Bn,BH,dF1,dF2,dT;
         CMPointVals v;
-        double dz,dza,u;
-        int i,j,k,m,elm;
-        int NumPlotPoints=d_LineIntegralPoints;
-        bool flag;
+        double dza;
+        int i,k;
 
+        EnsureBoundaryEdges();
         for(i=0; i<2; i++) z[i].Set(0,0);
 
         for(k=1; k<(int)contour.size(); k++)
         {
-            dz=abs(contour[k]-contour[k-1])/((double) NumPlotPoints);
-            for(i=0,elm=-1; i<NumPlotPoints; i++)
-            {
-                u=(((double) i)+0.5)/((double) NumPlotPoints);
-                pt=contour[k-1]+ u*(contour[k] - contour[k-1]);
-                t=contour[k]-contour[k-1];
-                t/=abs(t);
-                n=I*t;
-                pt+=n*1.e-6;
-
-                if (elm<0) elm=InTriangle(pt.re,pt.im);
-                else if (InTriangleTest(pt.re,pt.im,elm)==false)
-                {
-                    flag=false;
-                    for(j=0; j<3; j++)
-                        for(m=0; m<NumList[meshelem[elm].p[j]]; m++)
-                        {
-                            elm=ConList[meshelem[elm].p[j]][m];
-                            if (InTriangleTest(pt.re,pt.im,elm)==true)
-                            {
-                                flag=true;
-                                m=100;
-                                j=3;
-                            }
-                        }
-                    if (flag==false) elm=InTriangle(pt.re,pt.im);
-                }
-
-                if(elm>=0)
-                {
-                    flag=GetPointValues(pt.re,pt.im,elm,v);
-                }
-                else
-                {
-                    flag=false;
-                }
+            t=contour[k]-contour[k-1];
+            t/=abs(t);
+            n=I*t;
 
-                if(flag==true)
+            IntegrateContourSegment(contour[k-1]+n*1.e-6, contour[k]+n*1.e-6,
+                                    [&](int elm, CComplex pt, double dz) {
+                if(GetPointValues(pt.re,pt.im,elm,v))
                 {
                     if(Frequency==0)
                     {
@@ -4502,7 +5113,7 @@ void FPProc::LineIntegral(int inttype, CComplex *z)
 
                     }
                 }
-            }
+            });
         }
 
     }
@@ -4510,89 +5121,36 @@ void FPProc::LineIntegral(int inttype, CComplex *z)
     // inttype==5 => (B.n)^2
     if(inttype==5)
     {
-        CComplex n,t,pt,Ht;
+        CComplex n,t,Ht;
         CMPointVals pvals;
-        double dz,u,l;
-        int i,j,k,m,elm;
-        int NumPlotPoints = d_LineIntegralPoints;
-        bool flag;
+        double l;
+        int i,k;
 
+        EnsureBoundaryEdges();
         z[0] = 0;
         // loop through each segment in the contour intgrating over each in turn
         for(k=1; k<(int)contour.size(); k++)
         {
-            // break the segment up into differential subsegments for the integral
-            dz = abs(contour[k]-contour[k-1]) / ((double) NumPlotPoints);
-
-            // loop through each subsegment performing the integral
-            for(i=0,elm=-1; i<NumPlotPoints; i++)
-            {
-                // get a point location in the middle of the subsegment
-                u = (((double) i) + 0.5) / ((double) NumPlotPoints);
-                pt = contour[k-1] + u*(contour[k] - contour[k-1]);
-                // get a unit vector tangential to the segment at the sample point
-                t = contour[k]-contour[k-1];
-                t /= abs(t);
-                // get a unit vector normal to the segment at the sample point
-                n = I * t;
-                // shift the sample point a little in the normal direction
-                pt += n * 1.e-06;
-
-                if (elm < 0)
-                {
-                    // This is the first run and we must find which mesh element we are in
-                    elm = InTriangle(pt.re,pt.im);
-                }
-                else if (InTriangleTest(pt.re,pt.im,elm) == false)
-                {
-                    // This is not the first run, but we are no longer in the same element
-                    // and must rediscover what element we are in
-                    flag = false;
-                    // first check neighbouring elements to the last element as it will
-                    // save time over checking the whole mesh
-                    for(j=0; j<3; j++)
-                    {
-                        for(m=0; m < NumList[meshelem[elm].p[j]]; m++)
-                        {
-                            elm = ConList[meshelem[elm].p[j]][m];
-
-                            if (InTriangleTest(pt.re,pt.im,elm) == true)
-                            {
-                                // the current element was a neighbour of the previous element
-                                flag = true;
-                                m = 100;
-                                j = 3;
-                            }
-                        }
-                    }
-
-                    if (flag == false)
-                    {
-                        // new element was not a neighbour of the old element, so we must
-                        // search the whole mesh
-                        elm = InTriangle(pt.re,pt.im);
-                    }
-                } // if (elm < 0)
-
-                if (elm >= 0)
-                {
-                    // Get the point values at the sample location
-                    flag = GetPointValues(pt.re,pt.im,elm,pvals);
-                }
-                else
-                {
-                    flag = false;
-                }
-
-                if(flag == true)
+            // get a unit vector tangential to the segment
+            t = contour[k]-contour[k-1];
+            t /= abs(t);
+            // get a unit vector normal to the segment
+            n = I * t;
+
+            // integrate over the parts of the segment in each mesh element it crosses;
+            // the segment is shifted a little in the normal direction, so that
+            // segments along element edges use the elements on one side
+            IntegrateContourSegment(contour[k-1] + n * 1.e-06, contour[k] + n * 1.e-06,
+                                    [&](int elm, CComplex pt, double dz) {
+                // Get the point values at the integration point
+                if(GetPointValues(pt.re,pt.im,elm,pvals))
                 {
-                    // get the dot product of the normal and the B field at the sample point
+                    // get the dot product of the normal and the B field at the integration point
                     Ht = n.re * pvals.B1 + n.im * pvals.B2;
                     // add the square of the field times the
                     z[0] += (Ht * Ht.Conj() * dz * LengthConv[LengthUnits]);
                 }
-
-            } // for(i=0,elm=-1; i<NumPlotPoints; i++)
+            });
 
             // now we will also calculate the average over the contour
             for(i=0,l=0; i<(int)contour.size()-1; i++)
@@ -4615,27 +5173,49 @@ void FPProc::LineIntegral(int inttype, CComplex *z)
     return;
 }
 
-
 int FPProc::ClosestArcSegment(double x, double y) const
 {
-    double d0,d1;
-    int i,j;
+    return arcTree.nearest(x, y, [this,x,y](int i) {
+        return ShortestDistanceFromArc(CComplex(x,y),arclist[i]);
+    });
+}
+
+void FPProc::GetArcBounds(const CArcSegment &arc, double &xmin, double &ymin, double &xmax, double &ymax) const
+{
+    CComplex a0,a1,c;
+    double R;
+
+    a0.Set(nodelist[arc.n0].x,nodelist[arc.n0].y);
+    a1.Set(nodelist[arc.n1].x,nodelist[arc.n1].y);
+    xmin=std::min(a0.re,a1.re);
+    xmax=std::max(a0.re,a1.re);
+    ymin=std::min(a0.im,a1.im);
+    ymax=std::max(a0.im,a1.im);
 
-    if(arclist.size()==0) return -1;
+    GetCircle(arc,c,R);
+    if (!std::isfinite(R) || !std::isfinite(c.re) || !std::isfinite(c.im))
+        return;
 
-    j=0;
-    d0=ShortestDistanceFromArc(CComplex(x,y),arclist[0]);
-    for(i=0; i<(int)arclist.size(); i++)
+    // add the points where the arc crosses the axes through its centre
+    static const CComplex axis[4]={CComplex(1,0),CComplex(0,1),CComplex(-1,0),CComplex(0,-1)};
+    double tta0=arg(a0-c)*180/PI;
+    for(int k=0; k<4; k++)
     {
-        d1=ShortestDistanceFromArc(CComplex(x,y),arclist[i]);
-        if(d1<d0)
-        {
-            d0=d1;
-            j=i;
-        }
+        double z=fmod(90.*k-tta0+720.,360.);
+        if (z>arc.ArcLength) continue;
+        CComplex p=c+R*axis[k];
+        xmin=std::min(xmin,p.re);
+        xmax=std::max(xmax,p.re);
+        ymin=std::min(ymin,p.im);
+        ymax=std::max(ymax,p.im);
     }
 
-    return j;
+    // allow for rounding errors in ShortestDistanceFromArc()
+    double tol=1.e-08*R;
+    xmin-=tol;
+    ymin-=tol;
+    xmax+=tol;
+    ymax+=tol;
 }
 
 void FPProc::GetCircle(const CArcSegment &arc, CComplex &c, double &R) const
@@ -4805,7 +5385,7 @@ CComplex FPProc::GetStrandedVoltageDrop(int lbl) const
     // Derive the voltage drop associated with a stranded and
     // current-carrying region.
 
-    int i,k;
+    int k;
     CComplex dVolts,rho;
     CComplex A[3],J[3],U[3],V[3];
     double a,atot;
@@ -4815,28 +5395,27 @@ CComplex FPProc::GetStrandedVoltageDrop(int lbl) const
     U[1]=1;
     U[2]=1;
 
-    for(i=0,dVolts=0,atot=0; i<(int)meshelem.size(); i++)
+    dVolts=0;
+    atot=0;
+    for(int i: labelElements[lbl])
     {
-        if(meshelem[i].lbl==lbl)
-        {
-            rho=blocklist[meshelem[i].lbl].o*1.e6;
-            if(Frequency==0) rho=Re(rho);
-            if (rho!=0) rho=(1./rho);
-
-            GetJA(i,J,A);
-            a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
-            atot+=a;
+        rho=blocklist[meshelem[i].lbl].o*1.e6;
+        if(Frequency==0) rho=Re(rho);
+        if (rho!=0) rho=(1./rho);
 
-            if(problemType==AXISYMMETRIC)
-            {
-                for(k=0; k<3; k++)
-                    r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
-            }
+        GetJA(i,J,A);
+        a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
+        atot+=a;
 
-            for(k=0; k<3; k++) V[k]=(2.*PI*I*Frequency*A[k] + rho*J[k]);
-            if(problemType==PLANAR) dVolts+=PlnInt(a,V,U)*Depth;
-            else dVolts+=AxiInt(a,V,U,r);
+        if(problemType==AXISYMMETRIC)
+        {
+            for(k=0; k<3; k++)
+                r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
         }
+
+        for(k=0; k<3; k++) V[k]=(2.*PI*I*Frequency*A[k] + rho*J[k]);
+        if(problemType==PLANAR) dVolts+=PlnInt(a,V,U)*Depth;
+        else dVolts+=AxiInt(a,V,U,r);
     }
     dVolts*=( ((double) blocklist[lbl].Turns) / atot);
 
@@ -4856,7 +5435,7 @@ void FPProc::GetFillFactor(int lbl)
     double lc=LengthConv[LengthUnits]*LengthConv[LengthUnits];
     double atot,awire,w,d,o,fill,dd,W,R,c1,c2,c3,c4;
     atot=awire=w=d=o=fill=dd=W=R=c1=c2=c3=c4=0;
-    int i,wiretype;
+    int wiretype;
     CComplex ufd,ueff,ofd;
 
     // default values
@@ -4870,8 +5449,9 @@ void FPProc::GetFillFactor(int lbl)
     if (blockproplist[blocklist[lbl].BlockType].LamType<3) return;
 
     // compute total area of associated block
-    for(i=0,atot=0; i<(int)meshelem.size(); i++)
-        if(meshelem[i].lbl==lbl) atot+=ElmArea(i)*lc;
+    atot=0;
+    for(int i: labelElements[lbl])
+        atot+=ElmArea(i)*lc;
     if (atot==0) return;
 
     wiretype=bp->LamType-3;
@@ -4993,7 +5573,7 @@ CComplex FPProc::GetStrandedLinkage(int lbl) const
     // This is a routine for the special case of determining
     // the flux linkage of a stranded conductor at zero frequency
     // when the conductor is carrying zero current.
-    int i,k;
+    int k;
     CComplex FluxLinkage;
     CComplex A[3],J[3],U[3];//,V[3];
     double a,atot;
@@ -5003,23 +5583,22 @@ CComplex FPProc::GetStrandedLinkage(int lbl) const
     U[1]=1;
     U[2]=1;
 
-    for(i=0,FluxLinkage=0,atot=0; i<(int)meshelem.size(); i++)
+    FluxLinkage=0;
+    atot=0;
+    for(int i: labelElements[lbl])
     {
-        if(meshelem[i].lbl==lbl)
-        {
-            GetJA(i,J,A);
-            a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
-            atot+=a;
-
-            if(problemType==AXISYMMETRIC)
-            {
-                for(k=0; k<3; k++)
-                    r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
-            }
+        GetJA(i,J,A);
+        a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
+        atot+=a;
 
-            if(problemType==PLANAR) FluxLinkage+=PlnInt(a,A,U)*Depth;
-            else FluxLinkage+=AxiInt(a,A,U,r);
+        if(problemType==AXISYMMETRIC)
+        {
+            for(k=0; k<3; k++)
+                r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
         }
+
+        if(problemType==PLANAR) FluxLinkage+=PlnInt(a,A,U)*Depth;
+        else FluxLinkage+=AxiInt(a,A,U,r);
     }
     FluxLinkage*=( ((double) blocklist[lbl].Turns) / atot);
 
@@ -5038,7 +5617,7 @@ CComplex FPProc::GetSolidAxisymmetricLinkage(int lbl) const
     // edges, because the length of conductor that the current has
     // to traverse is smaller on the inner edge.
 
-    int i,k;
+    int k;
     CComplex FluxLinkage;
     CComplex Aa,A[3],J[3],U[3];//,V[3];
     double a,atot,R;
@@ -5048,21 +5627,20 @@ CComplex FPProc::GetSolidAxisymmetricLinkage(int lbl) const
     U[1]=1;
     U[2]=1;
 
-    for(i=0,FluxLinkage=0,atot=0; i<(int)meshelem.size(); i++)
+    FluxLinkage=0;
+    atot=0;
+    for(int i: labelElements[lbl])
     {
-        if(meshelem[i].lbl==lbl)
-        {
-            GetJA(i,J,A);
-            Aa=(A[0]+A[1]+A[2])/3.;
-            a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
+        GetJA(i,J,A);
+        Aa=(A[0]+A[1]+A[2])/3.;
+        a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
 
-            for(k=0; k<3; k++)
-                r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
-            R=(r[0]+r[1]+r[2])/3.;
+        for(k=0; k<3; k++)
+            r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
+        R=(r[0]+r[1]+r[2])/3.;
 
-            atot+=a/R;
-            FluxLinkage+=2.*PI*R*a*(Aa/R);
-        }
+        atot+=a/R;
+        FluxLinkage+=2.*PI*R*a*(Aa/R);
     }
     FluxLinkage*=( ((double) blocklist[lbl].Turns) / atot);
 
@@ -5077,7 +5655,7 @@ CComplex FPProc::GetParallelLinkage(int numcirc) const
     // This routine takes care of the case in which the current is divvied
     // up based on the conductivity and size of the various regions
 
-    int i,k;
+    int k;
     CComplex FluxLinkage;
     CComplex Aa,A[3],J[3],U[3];//,V[3];
     double a,atot,R,c;
@@ -5088,32 +5666,31 @@ CComplex FPProc::GetParallelLinkage(int numcirc) const
     U[1]=1;
     U[2]=1;
 
-    for(i=0,FluxLinkage=0,atot=0; i<(int)meshelem.size(); i++)
+    FluxLinkage=0;
+    atot=0;
+    for(int i: circuitElements[numcirc])
     {
-        if(blocklist[meshelem[i].lbl].InCircuit==numcirc)
-        {
-            c=blockproplist[meshelem[i].blk].Cduct;
-            GetJA(i,J,A);
-            a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
+        c=blockproplist[meshelem[i].blk].Cduct;
+        GetJA(i,J,A);
+        a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
 
-            if(problemType==AXISYMMETRIC)
-            {
-                for(k=0; k<3; k++)
-                    r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
-                R=(r[0]+r[1]+r[2])/3.;
-                Aa=(A[0]+A[1]+A[2])/3.;
-            }
+        if(problemType==AXISYMMETRIC)
+        {
+            for(k=0; k<3; k++)
+                r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
+            R=(r[0]+r[1]+r[2])/3.;
+            Aa=(A[0]+A[1]+A[2])/3.;
+        }
 
-            if(problemType==PLANAR)
-            {
-                FluxLinkage+=PlnInt(a,A,U)*Depth*c;
-                atot+=(a*c);
-            }
-            else
-            {
-                FluxLinkage+=2.*PI*R*c*(Aa/R);
-                atot+=(a*c/R);
-            }
+        if(problemType==PLANAR)
+        {
+            FluxLinkage+=PlnInt(a,A,U)*Depth*c;
+            atot+=(a*c);
+        }
+        else
+        {
+            FluxLinkage+=2.*PI*R*c*(Aa/R);
+            atot+=(a*c/R);
         }
     }
     FluxLinkage/=atot;
@@ -5131,7 +5708,7 @@ CComplex FPProc::GetParallelLinkageAlt(int numcirc) const
     // In this case, an even current density is applied to all regions
     // that are marked with the circuit (for both axi and planar cases).
 
-    int i,k;
+    int k;
     CComplex FluxLinkage;
     CComplex Aa,A[3],J[3],U[3];//,V[3];
     double a,atot; //c,R;
@@ -5141,26 +5718,25 @@ CComplex FPProc::GetParallelLinkageAlt(int numcirc) const
     U[1]=1;
     U[2]=1;
 
-    for(i=0,FluxLinkage=0,atot=0; i<(int)meshelem.size(); i++)
+    FluxLinkage=0;
+    atot=0;
+    for(int i: circuitElements[numcirc])
     {
-        if(blocklist[meshelem[i].lbl].InCircuit==numcirc)
-        {
 //            c=blockproplist[meshelem[i].blk].Cduct;
-            GetJA(i,J,A);
-            a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
-            atot+=a;
+        GetJA(i,J,A);
+        a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
+        atot+=a;
 
-            if(problemType==AXISYMMETRIC)
-            {
-                for(k=0; k<3; k++)
-                    r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
+        if(problemType==AXISYMMETRIC)
+        {
+            for(k=0; k<3; k++)
+                r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
 //                R=(r[0]+r[1]+r[2])/3.;
-                Aa=(A[0]+A[1]+A[2])/3.;
-            }
-
-            if(problemType==PLANAR)    FluxLinkage+=PlnInt(a,A,U)*Depth;
-            else FluxLinkage+=AxiInt(a,A,U,r);
+            Aa=(A[0]+A[1]+A[2])/3.;
         }
+
+        if(problemType==PLANAR)    FluxLinkage+=PlnInt(a,A,U)*Depth;
+        else FluxLinkage+=AxiInt(a,A,U,r);
     }
     FluxLinkage/=atot;
 
@@ -5230,23 +5806,22 @@ CComplex FPProc::GetVoltageDrop(int circnum) const
             U[1]=1;
             U[2]=1;
 
-            for(i=0,FluxLinkage=0,atot=0; i<(int)meshelem.size(); i++)
+            FluxLinkage=0;
+            atot=0;
+            for(int i: circuitElements[circnum])
             {
-                if(blocklist[meshelem[i].lbl].InCircuit==circnum)
-                {
-                    GetJA(i,J,A);
-                    a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
-                    atot+=a;
+                GetJA(i,J,A);
+                a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
+                atot+=a;
 
-                    if(problemType==AXISYMMETRIC)
-                    {
-                        for(k=0; k<3; k++)
-                            r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
-                    }
-                    if(problemType==PLANAR)
-                        FluxLinkage+=PlnInt(a,A,U)*Depth;
-                    else FluxLinkage+=AxiInt(a,A,U,r);
+                if(problemType==AXISYMMETRIC)
+                {
+                    for(k=0; k<3; k++)
+                        r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
                 }
+                if(problemType==PLANAR)
+                    FluxLinkage+=PlnInt(a,A,U)*Depth;
+                else FluxLinkage+=AxiInt(a,A,U,r);
             }
             Volts=(2.*PI*Frequency/atot)*FluxLinkage;
         }
@@ -5255,45 +5830,43 @@ CComplex FPProc::GetVoltageDrop(int circnum) const
     return Volts;
 }
 
-CComplex FPProc::GetFluxLinkage(int circnum) const
+CComplex FPProc::GetFluxLinkage(int circnum)
 {
     int i,k;
     CComplex FluxLinkage;
     CComplex A[3],J[3];
     double a,r[3];
 
+    EnsureCircuitCurrents();
+
     // in the "normal" case, we can just use Integral of A.J
     // and divide through by i.conj to get the flux linkage.
     if((circproplist[circnum].Amps.re!=0) || (circproplist[circnum].Amps.im!=0))
     {
-        for(i=0,FluxLinkage=0; i<(int)meshelem.size(); i++)
+        FluxLinkage=0;
+        for(int i: circuitElements[circnum])
         {
-            if(blocklist[meshelem[i].lbl].InCircuit==circnum)
+            GetJA(i,J,A);
+            a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
+            if(problemType==AXISYMMETRIC)
             {
-                GetJA(i,J,A);
-                a=ElmArea(i)*LengthConv[LengthUnits]*LengthConv[LengthUnits];
-                if(problemType==AXISYMMETRIC)
-                {
-                    for(k=0; k<3; k++)
-                        r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
-                }
-
-                // for a multiturn region, there can be some "local" flux linkage due to the complex-valued
-                // part of the conductivity.
-                if(Im(blocklist[meshelem[i].lbl].o)!=0)
-                {
-                    double u;
-                    if(Frequency==0) u=Im(blocklist[meshelem[i].lbl].o);
-                    else u=Im(1.e-6/blocklist[meshelem[i].lbl].o)/(2.*PI*Frequency);
-                    for(k=0; k<3; k++) A[k]+=u*J[k];
-                }
-
-                for(k=0; k<3; k++) J[k]=J[k].Conj();
-                if(problemType==PLANAR) FluxLinkage+=PlnInt(a,A,J)*Depth;
-                else FluxLinkage+=AxiInt(a,A,J,r);
-
+                for(k=0; k<3; k++)
+                    r[k]=meshnode[meshelem[i].p[k]].x*LengthConv[LengthUnits];
+            }
 
+            // for a multiturn region, there can be some "local" flux linkage due to the complex-valued
+            // part of the conductivity.
+            if(Im(blocklist[meshelem[i].lbl].o)!=0)
+            {
+                double u;
+                if(Frequency==0) u=Im(blocklist[meshelem[i].lbl].o);
+                else u=Im(1.e-6/blocklist[meshelem[i].lbl].o)/(2.*PI*Frequency);
+                for(k=0; k<3; k++) A[k]+=u*J[k];
             }
+
+            for(k=0; k<3; k++) J[k]=J[k].Conj();
+            if(problemType==PLANAR) FluxLinkage+=PlnInt(a,A,J)*Depth;
+            else FluxLinkage+=AxiInt(a,A,J,r);
         }
 
         FluxLinkage/=conj(circproplist[circnum].Amps);
@@ -5345,11 +5918,11 @@ CComplex FPProc::GetFluxLinkage(int circnum) const
                 // if there is at least one nonzero conductivity block, we can use
                 // the GetParallelLinkage routine, which is more or less driving
                 // all the blocks with a ficticious voltage gradient.
-                if (flag) FluxLinkage=GetParallelLinkage(i);
+                if (flag) FluxLinkage=GetParallelLinkage(circnum);
                 // otherwise, treat the "punt" case, where every part of the
                 // parallel "circuit" is just assumed to have the same applied
                 // current density;
-                else FluxLinkage=GetParallelLinkageAlt(i);
+                else FluxLinkage=GetParallelLinkageAlt(circnum);
             }
         }
     }
@@ -5466,6 +6039,7 @@ void FPProc::FindBoundaryEdges()
         for(j = 0; j < 3; j ++)
             meshelem[i].n[j] = 0;
     }
+    elementNeighbours.assign(3*meshelem.size(), -1);
 
     int orgi, desti;
     int ei, ni;
@@ -5505,6 +6079,7 @@ void FPProc::FindBoundaryEdges()
                         break;
                     }
                 }
+                if(done) elementNeighbours[3*i+j] = ei;
                 if(!done)
                 {
                     // This edge must be a Boundary Edge.
@@ -6036,12 +6611,22 @@ FPProcError FPProc::gapTimeAvgStoredEnergyIntegral(const std::string myBdryName,
 
 FPProcError FPProc::getAGEflux(const std::string myBdryName, const double angle, CComplex &br, CComplex &bt) const
 {
+    return getAGEflux(myBdryName, 1, &angle, &br, &bt);
+}
 
-    int i, k, n;
-    double tta;
-
-	// figure out which AGE is being asked for
-	i=-1;
+/**
+ * @brief Get the flux density on the centerline of an air gap element at several angles.
+ * The flux density is rolled up from the harmonics that are computed when the solution is loaded.
+ * @param myBdryName name of the air gap boundary
+ * @param n number of angles
+ * @param angles the angles, in degrees
+ * @param br receives the \p n radial flux densities
+ * @param bt receives the \p n tangential flux densities
+ * @return FPProcError::NoError, or FPProcError::AGENameNotFound
+ */
+FPProcError FPProc::getAGEflux(const std::string myBdryName, int n, const double *angles, CComplex *br, CComplex *bt) const
+{
+    int i;
     bool found_bound = AGEBoundNumFromName(myBdryName, i);
 
     if (found_bound == false)
@@ -6049,30 +6634,39 @@ FPProcError FPProc::getAGEflux(const std::string myBdryName, const double angle,
         return FPProcError::AGENameNotFound;
     }
 
-	// if the requested AGE exists, roll up the flux density
-	// at the specified angle.  Note: angle is specified in degrees
-	br = 0;
-	bt = 0;
-	if (i>=0){
-		tta=angle*PI/180.0;
-		for(k=0;k<agelist[i].nn;k++)
-		{
-			n=agelist[i].nh[k];
-			br += agelist[i].brc[k]*cos(n*tta) + agelist[i].brs[k]*sin(n*tta);
-			bt += agelist[i].btc[k]*cos(n*tta) + agelist[i].bts[k]*sin(n*tta);
-		}
-	}
+    const CAirGapElement &age = agelist[i];
+    const int step = harmonicStep(age);
+    for (int p=0; p<n; p++)
+    {
+        br[p] = 0;
+        bt[p] = 0;
+        if (age.nn==0)
+            continue;
+        forEachHarmonic(age.nn, age.nh[0], step, angles[p]*PI/180.0, [&](int k, double c, double s) {
+            br[p] += age.brc[k]*c + age.brs[k]*s;
+            bt[p] += age.btc[k]*c + age.bts[k]*s;
+        });
+    }
 
-	return FPProcError::NoError;
+    return FPProcError::NoError;
 }
 
 FPProcError FPProc::getGapA(const std::string myBdryName, double tta, CComplex &ac) const
 {
-	int i,k;
-	double n,R;
+    return getGapA(myBdryName, 1, &tta, &ac);
+}
 
-	// figure out which AGE is being asked for
-	i=-1;
+/**
+ * @brief Get the vector potential on the centerline of an air gap element at several angles.
+ * @param myBdryName name of the air gap boundary
+ * @param n number of angles
+ * @param angles the angles, in degrees
+ * @param ac receives the \p n vector potentials
+ * @return FPProcError::NoError, or FPProcError::AGENameNotFound
+ */
+FPProcError FPProc::getGapA(const std::string myBdryName, int n, const double *angles, CComplex *ac) const
+{
+    int i;
     bool found_bound = AGEBoundNumFromName(myBdryName, i);
 
     if (found_bound == false)
@@ -6080,31 +6674,23 @@ FPProcError FPProc::getGapA(const std::string myBdryName, double tta, CComplex &
         return FPProcError::AGENameNotFound;
     }
 
-	// if the requested AGE exists, roll up the flux density
-	// at the specified angle.  Note: angle is specified in degrees
-	if (i>=0)
+    const CAirGapElement &age = agelist[i];
+    const double R = (age.ri+age.ro)/2.;
+    const int step = harmonicStep(age);
+    for (int p=0; p<n; p++)
     {
-        ac = 0;
-
-		R=(agelist[i].ri+agelist[i].ro)/2.;
-
-		tta = tta * PI / 180;
-
-		for(k=0;k<agelist[i].nn;k++)
-		{
-			n=agelist[i].nh[k];
-			if (n==0)
-			{
-			    ac+=agelist[i].aco;
-            }
-			else
-            {
-                ac += (R/n)*(-agelist[i].brs[k]*cos(n*tta) + agelist[i].brc[k]*sin(n*tta));
-			}
-		}
-	}
+        ac[p] = 0;
+        if (age.nn==0)
+            continue;
+        forEachHarmonic(age.nn, age.nh[0], step, angles[p]*PI/180.0, [&](int k, double c, double s) {
+            if (age.nh[k]==0)
+                ac[p] += age.aco;
+            else
+                ac[p] += (R/age.nh[k])*(-age.brs[k]*c + age.brc[k]*s);
+        });
+    }
 
-	return FPProcError::NoError;
+    return FPProcError::NoError;
 }
 
 FPProcError FPProc::numGapHarmonics(const std::string myBdryName, int &nh) const
@@ -6215,3 +6801,51 @@ FPProcError FPProc::getGapHarmonics(const std::string myBdryName, const int n, C
 	return FPProcError::NoError;
 }
 
+/**
+ * @brief Get the coefficients of all harmonics of an air gap element in one call.
+ * The vectors are resized to the number of harmonics; entry \c k belongs to harmonic number \c nh[k].
+ * For harmonic 0, \c brc and \c btc hold the mean radial and tangential flux densities.
+ * @return FPProcError::NoError, FPProcError::AGENameNotFound, or FPProcError::AGENoHarmonics
+ */
+FPProcError FPProc::getGapHarmonics(const std::string myBdryName, std::vector<int> &nh,
+                                    std::vector<CComplex> &acc, std::vector<CComplex> &acs,
+                                    std::vector<CComplex> &brc, std::vector<CComplex> &brs,
+                                    std::vector<CComplex> &btc, std::vector<CComplex> &bts) const
+{
+    int i;
+    bool found_bound = AGEBoundNumFromName(myBdryName, i);
+
+    if (found_bound == false)
+    {
+        return FPProcError::AGENameNotFound;
+    }
+
+    const CAirGapElement &age = agelist[i];
+    if (age.nn==0)
+    {
+        return FPProcError::AGENoHarmonics;
+    }
+
+    const double R = (age.ri+age.ro)/2.;
+    nh.assign(age.nh, age.nh+age.nn);
+    brc.assign(age.brc, age.brc+age.nn);
+    brs.assign(age.brs, age.brs+age.nn);
+    btc.assign(age.btc, age.btc+age.nn);
+    bts.assign(age.bts, age.bts+age.nn);
+    acc.resize(age.nn);
+    acs.resize(age.nn);
+    for (int k=0; k<age.nn; k++)
+    {
+        if (nh[k]==0)
+        {
+            acc[k] = age.aco;
+            acs[k] = 0;
+        } else {
+            acc[k] = -(R/nh[k])*brs[k];
+            acs[k] =  (R/nh[k])*brc[k];
+        }
+    }
+
+    return FPProcError::NoError;
+}
+
@@ -49,7 +49,11 @@
 #include "CPointProp.h"
 #include "CSegment.h"
 #include "PostProcessor.h"
+#include "meshWalk.h"
+#include "rasterTools.h"
+#include "spatialIndex.h"
 
+#include <cstdint>
 #include <vector>
 
 //#ifndef PLANAR
@@ -114,15 +118,41 @@ public:
 //    double  Bi_High,Bi_Low;
     double  B_High, B_Low;
     double  H_High;
+    // note: PlotBounds, B_High, B_Low, and H_High are only valid after EnsurePlotBounds()
 //    double  B_lb, B_ub;
 //    double  Jr_High,Jr_Low;
 //    double  Ji_High,Ji_Low;
 //    double  J_High, J_Low;
 
+    /**
+     * @brief Derived quantities that are computed on first use.
+     * Clients that know which outputs they need can request them
+     * to be computed by OpenDocument() using PreloadQuantities.
+     */
+    enum DerivedQuantity {
+        /// \brief Smoothed flux density at the element nodes (b1, b2)
+        NodalFluxDensity = 0x01,
+        /// \brief Extreme values of J, B and H (PlotBounds)
+        PlotBoundaries = 0x02,
+        /// \brief Total current of circuits with a prescribed voltage gradient
+        CircuitCurrents = 0x04,
+        /// \brief Boundary edge flags of the mesh elements
+        BoundaryEdges = 0x08,
+        /// \brief Check for regions tagged by more than one block label (bMultiplyDefinedLabels)
+        LabelCheck = 0x10,
+        AllDerivedQuantities = 0x1f
+    };
+    /// \brief Bit mask of DerivedQuantity values computed by OpenDocument(). Default: LabelCheck
+    int PreloadQuantities;
+
     // Some default behaviors
     int  d_LineIntegralPoints;
     bool d_ShiftH;
     bool bHasMask;
+    /// \brief Look up masks in the process-wide cache of MakeMask(). Default: true
+    bool bUseMaskCache;
+    /// \brief \c true, if the mask computed by the last MakeMask() was taken from the cache
+    bool bMaskFromCache;
     int bIncremental;
 
     // lists of nodes, segments, and block labels
@@ -164,6 +194,44 @@ public:
     bool InTriangleTest(double x, double y, int i) const;
     bool GetPointValues(double x, double y, CMPointVals &u);
     bool GetPointValues(double x, double y, int k, CMPointVals &u);
+    /**
+     * @brief Get the point values for several points at once.
+     * This is considerably faster than calling GetPointValues(x,y,u) for each point,
+     * because the points are located in one pass and evaluated on several threads.
+     * @param n the number of points
+     * @param x array of \p n x coordinates
+     * @param y array of \p n y coordinates
+     * @param u array of \p n point values; u[i] is only set if the point is inside the mesh.
+     * @param inMesh array of \p n flags, set to \c true for points inside the mesh.
+     * @return the number of points inside the mesh
+     */
+    int GetPointValues(int n, const double *x, const double *y, CMPointVals *u, bool *inMesh);
+    /**
+     * @brief Sample the vector potential and flux density on a regular grid.
+     * Instead of locating every grid point, the mesh elements are scan converted onto the grid (see femm::rasterizeTriangles()),
+     * and the values are interpolated like in GetPointValues(), i.e. using the smoothed nodal flux density if smoothing is enabled.
+     * @param grid the grid
+     * @param values receives planes of grid.size() values: A, B1, B2 and |B|,
+     * followed by Im(A), Im(B1) and Im(B2) for time harmonic problems (where the first planes hold the real parts).
+     * Points outside the mesh are NaN.
+     * @return the number of planes (4 or 7)
+     */
+    int RasterizeFields(const femm::RasterGrid &grid, std::vector<float> &values);
+    /**
+     * @brief Derive a mesh size field from the solution, for meshing a similar problem.
+     * The error of each element is estimated from the jumps of the tangential field intensity across its edges
+     * (see femm::addTangentialFieldJumps()),
+     * relative to the magnetic energy. Since this estimate scales with the element area,
+     * the target areas are chosen so that the elements that are split all end up with the same error
+     * (but each element is split into at most 64 elements), and the error and size of the resulting mesh can be predicted.
+     * @param tolerance target for the estimated relative error
+     * @param maxElements if >0, the tolerance is raised if needed so that a mesh following the size field
+     * has about this many elements
+     * @param maxArea receives the target area of each element (in the length units of the solution),
+     * or -1 where the field is constant and the area is not constrained
+     * @return the tolerance that was used
+     */
+    double ElementSizeField(double tolerance, int maxElements, std::vector<double> &maxArea);
     // void GetLineValues(CXYPlot &p, int PlotType, int npoints);
     // void GetGapValues(CXYPlot &p, int PlotType, int npoints, int myAGE);
     void GetElementB(femmpostproc::CPostProcMElement &elm);
@@ -175,6 +243,19 @@ public:
     //double ElmVolume(CElement *elm);
     void GetPointB(const double x, const double y, CComplex &B1, CComplex &B2, const femmpostproc::CPostProcMElement &elm);
     void GetNodalB(CComplex *b1, CComplex *b2,femmpostproc::CPostProcMElement &elm);
+    void EnsureNodalB(int i);
+    void EnsurePlotBounds();
+    void EnsureCircuitCurrents();
+    void EnsureBoundaryEdges();
+    void EnsureLabelCheck();
+    /**
+     * @brief Get the total current of a circuit.
+     * Use this instead of reading circproplist[circnum].Amps directly,
+     * because the current of some circuits is only computed on demand.
+     * @param circnum circuit index
+     * @return the circuit current
+     */
+    CComplex GetCircuitCurrent(int circnum);
     /**
      * @brief Compute the block integral over selected blocks.
      *
@@ -215,16 +296,38 @@ public:
      *  29    | no  | y (or z) part of 1× Lorentz force
      *  30    | no  | 1× component of Lorentz torque
      *
+     * The elements are processed on several threads (see femm::threadCount()).
+     * Partial sums are combined in a fixed order, so the result does not depend on the number of threads.
+     *
      * @param inttype The identifier of the block integral.
      * @return the requested block integral
      */
     CComplex BlockIntegral(const int inttype);
+    /**
+     * @brief Compute several block integrals in a single pass over the mesh.
+     * Quantities that are used by several integrals, such as the element area
+     * and current density, are only computed once per element.
+     * @param n the number of integrals
+     * @param inttypes array of \p n block integral identifiers (see BlockIntegral(const int))
+     * @param z array of \p n results
+     */
+    void BlockIntegral(int n, const int *inttypes, CComplex *z);
+    /**
+     * @brief Get the elements of all selected blocks.
+     * @return the element indices, grouped by block label
+     */
+    std::vector<int> SelectedElements() const;
     void LineIntegral(int inttype, CComplex *z);
 
     int ClosestNode(const double x, const double y) const;
     int ClosestArcSegment(double x, double y) const;
     void GetCircle(const femm::CArcSegment &asegm,CComplex &c, double &R) const;
     double ShortestDistanceFromArc(const CComplex p, const femm::CArcSegment &arc) const;
+    /**
+     * @brief Get the bounding box of an arc segment.
+     * The box contains the whole arc, and is slightly enlarged to allow for rounding errors.
+     */
+    void GetArcBounds(const femm::CArcSegment &arc, double &xmin, double &ymin, double &xmax, double &ymax) const;
     double ShortestDistanceFromSegment(double p, double q, int segm) const;
 
     CComplex GetJA(int k,CComplex *J,CComplex *A) const;
@@ -244,7 +347,7 @@ public:
 
     CComplex GetStrandedVoltageDrop(int lbl) const;
     CComplex GetVoltageDrop(int circnum) const;
-    CComplex GetFluxLinkage(int circnum) const;
+    CComplex GetFluxLinkage(int circnum);
     CComplex GetStrandedLinkage(int lbl) const;
     CComplex GetSolidAxisymmetricLinkage(int lbl) const;
     CComplex GetParallelLinkage(int numcirc) const;
@@ -259,8 +362,14 @@ public:
     FPProcError getGapHarmonics(const std::string myBdryName, const int n, CComplex &acc, CComplex &acs, CComplex &brc, CComplex &brs, CComplex &btc, CComplex &bts) const;
     bool AGEBoundNumFromName(const std::string myBdryName, int &n) const;
     FPProcError numGapHarmonics(const std::string myBdryName, int &nh) const;
+    FPProcError getGapHarmonics(const std::string myBdryName, std::vector<int> &nh,
+                                std::vector<CComplex> &acc, std::vector<CComplex> &acs,
+                                std::vector<CComplex> &brc, std::vector<CComplex> &brs,
+                                std::vector<CComplex> &btc, std::vector<CComplex> &bts) const;
     FPProcError getAGEflux(const std::string myBdryName, const double angle, CComplex &br, CComplex &bt) const;
+    FPProcError getAGEflux(const std::string myBdryName, int n, const double *angles, CComplex *br, CComplex *bt) const;
     FPProcError getGapA(const std::string myBdryName, double tta, CComplex &ac) const;
+    FPProcError getGapA(const std::string myBdryName, int n, const double *angles, CComplex *ac) const;
     FPProcError gapTimeAvgStoredEnergyIntegral(const std::string myBdryName, CComplex &W) const;
     FPProcError gapIncrementalForceIntegral(const std::string myBdryName, CComplex &fx, CComplex &fy) const;
     FPProcError gapIncrementalTorqueIntegral(const std::string myBdryName, CComplex &tq) const;
@@ -275,6 +384,37 @@ public:
     bool NewDocument();
 //     virtual void Serialize(CArchive& ar);
     bool OpenDocument(std::string lpszPathName) override;
+    /**
+     * @brief Open a solution series written by FSolver::WriteSeriesStep().
+     * The problem description and mesh are read once from the base solution of the series.
+     * The base solution is loaded as the current solution; use OpenSeriesStep() to load the steps.
+     * @param seriesFile
+     * @return \c true on success, \c false otherwise.
+     */
+    bool OpenSeries(std::string seriesFile);
+    /// \brief Number of steps of the solution series opened by OpenSeries()
+    int NumSeriesSteps() const;
+    /// \brief Label of step \p k of the solution series opened by OpenSeries()
+    std::string SeriesStepLabel(int k) const;
+    /**
+     * @brief Replace the current solution by step \p k of the solution series opened by OpenSeries().
+     * Only the nodal potentials, circuit data and air gap element data are read; the mesh is kept.
+     * @param k the step index (0-based)
+     * @return \c true on success, \c false otherwise.
+     */
+    bool OpenSeriesStep(int k);
+    /**
+     * @brief Compute the mask used by the weighted stress tensor integrals for the selected blocks.
+     *
+     * Masks are kept in a small process-wide cache, keyed by the selected block labels and
+     * a hash of the mesh and of all other inputs of the mask problem.
+     * If the same blocks are selected again, even in another document with the same mesh,
+     * the cached mask is reused. If the weights depend on the solution (WeightingScheme 3 and 4),
+     * the mask is computed anew, but the solver starts from the cached solution.
+     * The cache lookup can be disabled with bUseMaskCache.
+     *
+     * @return \c true on success, \c false if the selection is invalid or the solver failed.
+     */
     bool MakeMask();
     //bool LoadMeshNodesFromSolution(bool loadA, FILE* fp);
     //bool LoadMeshElementsFromSolution(FILE* fp);
@@ -289,6 +429,80 @@ public:
 private:
 
     char warnBuf [1028];
+    /// \brief Bit mask of DerivedQuantity values that have already been computed
+    int computedQuantities;
+    /// \brief hasNodalB[i] is set if meshelem[i].b1 and meshelem[i].b2 are valid
+    std::vector<bool> hasNodalB;
+
+    // solution series opened by OpenSeries()
+    std::string SeriesFile;
+    std::vector<long> seriesStepOffset;
+    std::vector<std::string> seriesStepLabel;
+
+    /// \brief Spatial index over meshelem, used by InTriangle()
+    femm::TriangleGrid elementGrid;
+    /// \brief Spatial indices over nodelist and arclist, used by ClosestNode() and ClosestArcSegment()
+    femm::BoxTree nodeTree;
+    femm::BoxTree arcTree;
+    /// \brief labelElements[lbl] lists the elements of block label lbl, in ascending order
+    std::vector<std::vector<int>> labelElements;
+    /// \brief circuitElements[c] lists the elements in block labels of circuit c, in ascending order
+    std::vector<std::vector<int>> circuitElements;
+    /// \brief elementNeighbours[3*i+j] is the element across the edge opposite corner j of element i, or -1 (set by FindBoundaryEdges())
+    std::vector<int> elementNeighbours;
+
+    /// \brief Per-element quantities shared by the block integrals
+    struct BlockIntegralElement {
+        int i;            ///< element index
+        CComplex J;       ///< average current density (only set if requested)
+        CComplex Jn[3];   ///< nodal current density (only set if requested)
+        CComplex A[3];    ///< nodal vector potential (only set if requested)
+        double a;         ///< element area in m^2
+        double r[3];      ///< nodal radius in m (axisymmetric problems)
+        double R;         ///< element radius in m (axisymmetric problems)
+    };
+    void GetBlockIntegralElement(int i, bool withJA, BlockIntegralElement &e) const;
+    /**
+     * @brief Compute the contribution of one element to a block integral.
+     * Must be safe to call concurrently.
+     */
+    CComplex BlockIntegrand(int inttype, const BlockIntegralElement &e);
+
+    /**
+     * @brief Integrate along a straight contour segment, element by element (see femm::integrateLine()).
+     * Requires the element neighbours, i.e. EnsureBoundaryEdges() must have been called.
+     * @param p0 start of the segment
+     * @param p1 end of the segment
+     * @param integrand a callable with the signature \c void(int elm,CComplex p,double dz)
+     */
+    template <class IntegrandFunc>
+    void IntegrateContourSegment(CComplex p0, CComplex p1, IntegrandFunc integrand) const
+    {
+        femm::integrateLine(p0, p1, d_LineIntegralPoints,
+            [this](int elm, int j) {
+                const femmsolver::CMMeshNode &node = meshnode[meshelem[elm].p[j]];
+                return CComplex(node.x, node.y);
+            },
+            [this](int elm, int j) { return elementNeighbours[3*elm+j]; },
+            [this](CComplex p) { return InTriangle(p.re, p.im); },
+            integrand);
+    }
+
+    void ComputeAGEHarmonics();
+    void ComputeSolutionFields();
+    void PreloadDerivedQuantities();
+    /**
+     * @brief Compute a hash of the mesh.
+     * Needs to match FSolver::MeshFingerprint().
+     * @return the mesh hash
+     */
+    uint64_t MeshFingerprint() const;
+    /**
+     * @brief Compute a hash of everything that determines the mask problem, except for the block selection.
+     * @param lblflag lblflag[i] is non-zero, if block label i is not free space.
+     * @return the hash
+     */
+    uint64_t MaskProblemHash(const int *lblflag) const;
 
 //#ifdef _DEBUG
     //virtual void AssertValid() const;
@@ -1,7 +1,11 @@
 #include <cstdlib>
+#include <list>
+#include <mutex>
 #include <string>
 #include <cmath>
+#include <vector>
 #include "fpproc.h"
+#include "hashTools.h"
 //#include "femm.h"
 //#include "xyplot.h"
 //#include "femmviewDoc.h"
@@ -19,6 +23,54 @@
 
 using namespace femm;
 
+namespace {
+
+/// \brief A mask computed by FPProc::MakeMask()
+struct CachedMask
+{
+    /// \brief see FPProc::MaskProblemHash()
+    uint64_t problemHash;
+    /// \brief the selected block labels
+    std::vector<int> selection;
+    /// \brief false, if the mask depends on the solution
+    bool reusable;
+    /// \brief solution of the mask problem, used as initial guess for the next solve
+    std::vector<double> potential;
+    /// \brief the resulting meshnode[i].msk values
+    std::vector<double> mask;
+};
+
+// most recently used masks first
+std::list<CachedMask> maskCache;
+std::mutex maskCacheMutex;
+const size_t maskCacheSize = 4;
+
+} // anonymous namespace
+
+uint64_t FPProc::MaskProblemHash(const int *lblflag) const
+{
+    femm::FNV1aHash hash;
+    hash.add(MeshFingerprint());
+    hash.add((int)problemType);
+    hash.add(WeightingScheme);
+    hash.add(Precision);
+    for(int i=0;i<(int)blocklist.size();i++)
+    {
+        hash.add(lblflag[i]);
+        hash.add(blocklist[i].MaxArea);
+    }
+    // nodes with point currents are fixed to zero
+    for(const auto &node: nodelist)
+    {
+        if(node.BoundaryMarker>=0)
+        {
+            hash.add(node.x);
+            hash.add(node.y);
+        }
+    }
+    return hash.value();
+}
+
 #ifdef SIMPLE
 
 bool FPProc::MakeMask()
@@ -105,6 +157,9 @@ bool FPProc::MakeMask()
 				if (bOnAxis) break;
 			}
 
+	// the boundary edges are needed to fix the exterior nodes
+	EnsureBoundaryEdges();
+
 	// Sort through materials to see if they denote air;
 	matflag=(int*)calloc(blockproplist.size(),sizeof(int));
 	lblflag=(int*)calloc(blocklist.size(),sizeof(int));
@@ -131,6 +186,37 @@ bool FPProc::MakeMask()
 		if(blocklist[i].InCircuit>=0) lblflag[i]=1;
 	}
 
+	// Look for a mask of the same selection in the cache;
+	// The error weighted schemes depend on the solution, and can only use it as initial guess.
+	const uint64_t problemHash = MaskProblemHash(lblflag);
+	const bool reusable = (WeightingScheme!=3) && (WeightingScheme!=4);
+	std::vector<int> selection;
+	for(i=0;i<(int)blocklist.size();i++)
+		if(blocklist[i].IsSelected) selection.push_back(i);
+	std::vector<double> initialGuess;
+	bMaskFromCache=false;
+	if(bUseMaskCache)
+	{
+		std::lock_guard<std::mutex> lock(maskCacheMutex);
+		for(auto it=maskCache.begin(); it!=maskCache.end(); ++it)
+		{
+			if((it->problemHash!=problemHash) || (it->selection!=selection))
+				continue;
+			if(it->reusable && reusable)
+			{
+				for(i=0;i<NumNodes;i++) meshnode[i].msk=it->mask[i];
+				maskCache.splice(maskCache.begin(), maskCache, it);
+				free(matflag);
+				free(lblflag);
+				bHasMask=true;
+				bMaskFromCache=true;
+				return true;
+			}
+			initialGuess=it->potential;
+			break;
+		}
+	}
+
 	// Determine which nodal values should be fixed
 	// and what values they should be fixed at;
 	for(i=0;i<NumNodes;i++) L.V[i]=-1;
@@ -268,6 +354,7 @@ bool FPProc::MakeMask()
 			case 3:
 				// determine a weighting for the element
 				// based on an error measure;
+				EnsureNodalB(i);
 				for(j=0,bsq=0,dbsq=0;j<3;j++)
 				{
 					dbsq+=Re((meshelem[i].B1-meshelem[i].b1[j])*
@@ -342,7 +429,16 @@ bool FPProc::MakeMask()
 	//bLinehook=BuildMask;
 	L.Precision = Precision;
 
-    if (L.PCGSolve(0)==false)
+	// warm start from a previous solution for the same selection;
+	// the prescribed nodal values are kept.
+	bool warmStart = !initialGuess.empty();
+	if (warmStart)
+	{
+		for(i=0;i<NumNodes;i++)
+			if(L.V[i]<0) L.V[i]=initialGuess[i];
+	}
+
+    if (L.PCGSolve(warmStart ? 1 : 0)==false)
 	{
 	    free(matflag);
         free(lblflag);
@@ -375,6 +471,23 @@ bool FPProc::MakeMask()
 	free(lblflag);
     bHasMask=true;
 
+	// remember the mask for the next time this selection is used
+	CachedMask entry;
+	entry.problemHash = problemHash;
+	entry.selection = selection;
+	entry.reusable = reusable;
+	entry.potential.assign(L.V, L.V+NumNodes);
+	entry.mask.resize(NumNodes);
+	for(i=0;i<NumNodes;i++) entry.mask[i]=meshnode[i].msk;
+	{
+		std::lock_guard<std::mutex> lock(maskCacheMutex);
+		maskCache.remove_if([&](const CachedMask &m) {
+			return (m.problemHash==problemHash) && (m.selection==selection);
+		});
+		maskCache.push_front(std::move(entry));
+		if(maskCache.size()>maskCacheSize) maskCache.pop_back();
+	}
+
     return true;
 }
 
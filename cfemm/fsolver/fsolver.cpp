@@ -34,6 +34,7 @@
 #include <femmcomplex.h>
 #include <fparse.h>
 #include <fsolver.h>
+#include <hashTools.h>
 #include <LuaInstance.h>
 #include <spars.h>
 
@@ -350,9 +351,20 @@ bool FSolver::LoadProblemFile ()
 LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
 {
     int i,j,k,q,n0,n1;
-    char infile[256];
+    std::string infile;
     FILE *fp;
-    char s[1024];
+    std::string s;
+
+    // removes the triangle files once they are no longer needed
+    auto removeMeshFiles = [this](bool withEdges)
+    {
+        remove((PathName + ".ele").c_str());
+        remove((PathName + ".node").c_str());
+        remove((PathName + ".pbc").c_str());
+        remove((PathName + ".poly").c_str());
+        if (withEdges)
+            remove((PathName + ".edge").c_str());
+    };
 
     if (meshLoadedFromPrevSolution)
     {
@@ -360,20 +372,21 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
     }
 
     //read meshnodes;
-    sprintf(infile,"%s.node",PathName.c_str());
-    if((fp=fopen(infile,"rt"))==NULL)
+    infile = PathName + ".node";
+    if((fp=fopen(infile.c_str(),"rt"))==NULL)
     {
         return BADNODEFILE;
     }
-    fgets(s,1024,fp);
-    sscanf(s,"%i",&k);
-    NumNodes = k;
+    readLine(fp,s);
+    long long count = 0;
+    sscanf(s.c_str(),"%lld",&count);
+    NumNodes = count;
 
     meshnode.clear();
     meshnode.shrink_to_fit();
-    meshnode.reserve(k);
+    meshnode.reserve(NumNodes);
     CNode node;
-    for(i=0; i<k; i++)
+    for(i=0; i<NumNodes; i++)
     {
         fscanf(fp,"%i",&j);
         fscanf(fp,"%lf",&node.x);
@@ -392,13 +405,13 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
     fclose(fp);
 
     //read in periodic boundary conditions;
-    sprintf(infile,"%s.pbc",PathName.c_str());
-    if((fp=fopen(infile,"rt"))==NULL)
+    infile = PathName + ".pbc";
+    if((fp=fopen(infile.c_str(),"rt"))==NULL)
     {
         return BADPBCFILE;
     }
-    fgets(s,1024,fp);
-    sscanf(s,"%i",&NumPBCs);
+    readLine(fp,s);
+    sscanf(s.c_str(),"%i",&NumPBCs);
 
     if (NumPBCs!=0)
     {
@@ -409,8 +422,8 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
     CCommonPoint pbc;
     for(i=0; i<NumPBCs; i++)
     {
-        fgets(s,1024,fp);
-        sscanf(s,"%i %i %i %i",&j,&pbc.x,&pbc.y,&pbc.t);
+        readLine(fp,s);
+        sscanf(s.c_str(),"%i %i %i %i",&j,&pbc.x,&pbc.y,&pbc.t);
         pbclist.push_back(pbc);
     }
 
@@ -422,12 +435,12 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
 #endif // DEBUG
 
     // read in air gap element info
-    fgets(s,1024,fp);
-    sscanf(s,"%i", &NumAirGapElems);
+    readLine(fp,s);
+    sscanf(s.c_str(),"%i", &NumAirGapElems);
 
 #ifdef DEBUG
     {
-        char buf[1048]; SNPRINTF(buf, sizeof(buf), "Found %i ages, line was: \"%s\"\n", NumAirGapElems, s);
+        char buf[1048]; SNPRINTF(buf, sizeof(buf), "Found %i ages, line was: \"%s\"\n", NumAirGapElems, s.c_str());
         WarnMessage(buf);
     }
 #endif // DEBUG
@@ -440,18 +453,18 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
 
     for(i=0;i<NumAirGapElems;i++)
     {
-        fgets(s,80,fp);
+        readLine(fp,s);
 #ifdef DEBUG
         {
-            char buf[1048]; SNPRINTF( buf, sizeof(buf), "Read line:\n%s\n", s);
+            char buf[1048]; SNPRINTF( buf, sizeof(buf), "Read line:\n%s\n", s.c_str());
             WarnMessage(buf);
         }
 #endif // DEBUG
         age.BdryName = std::string (s);
 
-        fgets(s,1024,fp);
+        readLine(fp,s);
 
-        sscanf(s,"%i %lf %lf %lf %lf %lf %lf %lf %i %lf %lf",
+        sscanf(s.c_str(),"%i %lf %lf %lf %lf %lf %lf %lf %i %lf %lf",
                 &age.BdryFormat,
                 &age.InnerAngle,
                 &age.OuterAngle,
@@ -480,11 +493,11 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
 
         for(k=0;k<=age.totalArcElements;k++)
         {
-            fgets(s,1024,fp);
+            readLine(fp,s);
 
             CQuadPoint qp;
 
-            sscanf(s,"%i %lf %i %lf %i %lf %i %lf",
+            sscanf(s.c_str(),"%i %lf %i %lf %i %lf %i %lf",
                 &qp.n0, &qp.w0,
                 &qp.n1, &qp.w1,
                 &qp.n2, &qp.w2,
@@ -496,7 +509,7 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
                   || (qp.n3 < 0) )
             {
                 std::string msg = std::string("An error occured while reading file, quadNode has negative node number. ")
-                            + std::string("\nFile: ") + std::string(infile)
+                            + std::string("\nFile: ") + infile
                             + std::string("\nq number: ") + std::to_string(k)
                             + std::string(" n0: ") + std::to_string(qp.n0)
                             + std::string(" n1: ") + std::to_string(qp.n1)
@@ -517,24 +530,25 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
     fclose(fp);
 
     // read in elements;
-    sprintf(infile,"%s.ele",PathName.c_str());
+    infile = PathName + ".ele";
 #ifdef DEBUG
     {
-        char buf[1028]; SNPRINTF(buf, sizeof(buf), "Reading in elements from %s\n", infile);
+        char buf[1028]; SNPRINTF(buf, sizeof(buf), "Reading in elements from %s\n", infile.c_str());
         WarnMessage(buf);
     }
 #endif // DEBUG
-    if((fp=fopen(infile,"rt"))==NULL)
+    if((fp=fopen(infile.c_str(),"rt"))==NULL)
     {
         return BADELEMENTFILE;
     }
-    fgets(s,1024,fp);
-    sscanf(s,"%i",&k);
-    NumEls = k;
+    readLine(fp,s);
+    count = 0;
+    sscanf(s.c_str(),"%lld",&count);
+    NumEls = count;
 
     meshele.clear();
     meshele.shrink_to_fit();
-    meshele.reserve(k);
+    meshele.reserve(NumEls);
     femmsolver::CMElement elm;
 
     // get the default label for unlabelled blocks
@@ -547,7 +561,7 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
         }
     }
 
-    for(i=0; i<k; i++)
+    for(i=0; i<NumEls; i++)
     {
         fscanf(fp,"%i",&j);
         fscanf(fp,"%i",&elm.p[0]);
@@ -571,16 +585,7 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
             fclose(fp);
             if (deleteFiles)
             {
-                sprintf(infile,"%s.ele",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.node",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.pbc",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.poly",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.edge",PathName.c_str());
-                remove(infile);
+                removeMeshFiles(true);
             }
             return MISSINGMATPROPS;
         }
@@ -593,16 +598,7 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
             fclose(fp);
             if (deleteFiles)
             {
-                sprintf(infile,"%s.ele",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.node",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.pbc",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.poly",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.edge",PathName.c_str());
-                remove(infile);
+                removeMeshFiles(true);
             }
             return ELMLABELTOOBIG;
         }
@@ -656,8 +652,8 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
             nmbr[k]++;
         }
 
-    sprintf(infile,"%s.edge",PathName.c_str());
-    if((fp=fopen(infile,"rt"))==NULL)
+    infile = PathName + ".edge";
+    if((fp=fopen(infile.c_str(),"rt"))==NULL)
     {
         return BADEDGEFILE;
     }
@@ -704,14 +700,7 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
     if (deleteFiles)
     {
         // clear out temporary files
-        sprintf(infile,"%s.ele",PathName.c_str());
-        remove(infile);
-        sprintf(infile,"%s.node",PathName.c_str());
-        remove(infile);
-        sprintf(infile,"%s.pbc",PathName.c_str());
-        remove(infile);
-        sprintf(infile,"%s.poly",PathName.c_str());
-        remove(infile);
+        removeMeshFiles(false);
     }
 
     return NOERROR;
@@ -801,11 +790,13 @@ LoadMeshErr FSolver::LoadMesh(bool deleteFiles)
 bool FSolver::LoadMeshNodesFromSolution(bool loadAprev, FILE* fp)
 {
     double tmpAprev;
-    char s[1024];
+    std::string s;
 
     // read in nodes
-    fgets(s,1024,fp);
-    sscanf(s,"%i",&NumNodes);
+    readLine(fp,s);
+    long long count = 0;
+    sscanf(s.c_str(),"%lld",&count);
+    NumNodes = count;
 
     Aprev.clear();
     Aprev.shrink_to_fit();
@@ -821,8 +812,8 @@ bool FSolver::LoadMeshNodesFromSolution(bool loadAprev, FILE* fp)
     CNode node;
     for(int i=0;i<NumNodes;i++)
     {
-        fgets(s,1024,fp);
-        sscanf(s,"%lf   %lf     %lf     %i\n",&node.x,&node.y,&tmpAprev,&node.BoundaryMarker);
+        readLine(fp,s);
+        sscanf(s.c_str(),"%lf   %lf     %lf     %i\n",&node.x,&node.y,&tmpAprev,&node.BoundaryMarker);
 
         // convert all lengths to centimeters (better conditioning this way...)
         node.x *= 100 * LengthConvMeters[LengthUnits];
@@ -841,11 +832,13 @@ bool FSolver::LoadMeshNodesFromSolution(bool loadAprev, FILE* fp)
 
 bool FSolver::LoadMeshElementsFromSolution(FILE* fp)
 {
-    char s[1024];
+    std::string s;
 
-    fgets (s, 1024, fp);
+    readLine(fp,s);
 
-    sscanf (s,"%i", &NumEls);
+    long long count = 0;
+    sscanf(s.c_str(),"%lld", &count);
+    NumEls = count;
 
     using CMElement = femmsolver::CMElement;
 
@@ -857,9 +850,9 @@ bool FSolver::LoadMeshElementsFromSolution(FILE* fp)
     {
         CMElement elm;
 
-        fgets(s,1024,fp);
+        readLine(fp,s);
 
-        sscanf ( s,
+        sscanf(s.c_str(),
                  "%i    %i      %i      %i      %i      %i      %i      %lf\n",
                  &elm.p[0],
                  &elm.p[1],
@@ -881,7 +874,7 @@ bool FSolver::LoadMeshElementsFromSolution(FILE* fp)
 
 bool FSolver::LoadPBCFromSolution(FILE* fp)
 {
-    char s[1024];
+    std::string s;
 
     // clear the existing pbc list
     pbclist.clear();
@@ -889,9 +882,9 @@ bool FSolver::LoadPBCFromSolution(FILE* fp)
     // remove any previously reserved capacity
     pbclist.shrink_to_fit();
 
-    if (fgets(s,1024,fp)!=0)
+    if (readLine(fp,s))
     {
-        sscanf(s,"%i",&NumPBCs);
+        sscanf(s.c_str(),"%i",&NumPBCs);
 
         // reserve enough capacity for the declared number of pbc's in the file
         pbclist.reserve(NumPBCs);
@@ -899,8 +892,8 @@ bool FSolver::LoadPBCFromSolution(FILE* fp)
         for(int i=0;i<NumPBCs;i++)
         {
             CCommonPoint pbc;
-            fgets(s,1024,fp);
-            sscanf(s,"%i    %i      %i\n",&pbc.x,&pbc.y,&pbc.t);
+            readLine(fp,s);
+            sscanf(s.c_str(),"%i    %i      %i\n",&pbc.x,&pbc.y,&pbc.t);
             pbclist.push_back(pbc);
         }
     }
@@ -910,11 +903,11 @@ bool FSolver::LoadPBCFromSolution(FILE* fp)
 
 bool FSolver::LoadAGEsFromSolution(FILE* fp)
 {
-    char s[1024];
+    std::string s;
     CAirGapElement age;
 
-    fgets(s,1024,fp);
-    sscanf(s,"%i",&NumAirGapElems);
+    readLine(fp,s);
+    sscanf(s.c_str(),"%i",&NumAirGapElems);
 
     agelist.clear();
     agelist.shrink_to_fit();
@@ -923,13 +916,13 @@ bool FSolver::LoadAGEsFromSolution(FILE* fp)
     for(int i=0; i<NumAirGapElems; i++)
     {
 
-        fgets(s,80,fp);
+        readLine(fp,s);
 
         age.BdryName = std::string (s);
 
-        fgets(s,1024,fp);
+        readLine(fp,s);
 
-        sscanf( s, "%i %lf %lf %lf %lf %lf %lf %lf %i %lf %lf",
+        sscanf(s.c_str(), "%i %lf %lf %lf %lf %lf %lf %lf %i %lf %lf",
                 &age.BdryFormat,
                 &age.InnerAngle,
                 &age.OuterAngle,
@@ -950,8 +943,8 @@ bool FSolver::LoadAGEsFromSolution(FILE* fp)
         {
             CQuadPoint qp;
 
-            fgets(s,1024,fp);
-            sscanf ( s,"%i %lf %i %lf %i %lf %i %lf",
+            readLine(fp,s);
+            sscanf(s.c_str(),"%i %lf %i %lf %i %lf %i %lf",
                      &qp.n0,
                      &qp.w0,
                      &qp.n1,
@@ -1008,16 +1001,16 @@ bool FSolver::loadPreviousSolution(bool loadAprev)
 
     // parse the file
     bool hasSolution=false;
-    char s[1024];
-    while (fgets(s,1024,fp)!=0)
+    std::string s;
+    while (readLine(fp,s))
     {
         char q[256];
-        sscanf(s,"%s",q);
+        sscanf(s.c_str(),"%255s",q);
 
         // Frequency of the problem
         if( _strnicmp(q,"[frequency]",11)==0){
             double prevFreq=0;
-            char *v=StripKey(s);
+            char *v=StripKey(&s[0]);
             sscanf(v,"%lf",&prevFreq);
 
             // case were previous solution is an AC problem.
@@ -1033,7 +1026,7 @@ bool FSolver::loadPreviousSolution(bool loadAprev)
             }
         }
 
-        sscanf(s,"%s",q);
+        sscanf(s.c_str(),"%255s",q);
         if( _strnicmp(q,"[solution]",11)==0){
             hasSolution=true;
             break;
@@ -1062,10 +1055,10 @@ bool FSolver::loadPreviousSolution(bool loadAprev)
     LoadMeshElementsFromSolution(fp);
 
     // scroll through block label info
-    fgets(s,1024,fp);
+    readLine(fp,s);
     int numLabels;
-    sscanf(s,"%i",&numLabels);
-    for(int i=0;i<numLabels;i++) fgets(s,1024,fp);
+    sscanf(s.c_str(),"%i",&numLabels);
+    for(int i=0;i<numLabels;i++) readLine(fp,s);
 
     // read in PBC list
     LoadPBCFromSolution(fp);
@@ -1210,7 +1203,7 @@ double FSolver::ElmArea(int i)
 
 }
 
-bool FSolver::runSolver(bool verbose)
+bool FSolver::prepareMesh(bool verbose)
 {
     // load mesh
     LoadMeshErr err = LoadMesh();
@@ -1220,6 +1213,14 @@ bool FSolver::runSolver(bool verbose)
         return false;
     }
 
+    // the mesh may have been reused from an analysis with different air gap angles:
+    for (const auto &prop : lineproplist)
+    {
+        int k = findAirGapElement(prop.BdryName);
+        if (k >= 0 && (agelist[k].InnerAngle != prop.InnerAngle || agelist[k].OuterAngle != prop.OuterAngle))
+            setAirGapAngles(agelist[k], prop.InnerAngle, prop.OuterAngle);
+    }
+
     // renumber using Cuthill-McKee
     if (previousSolutionFile.empty ())
     {
@@ -1238,9 +1239,24 @@ bool FSolver::runSolver(bool verbose)
         std::string stats = "Problem Statistics:\n";
         stats += to_string(NumNodes) + " nodes\n";
         stats += to_string(NumEls) + " elements\n";
+        stats += "bandwidth " + to_string(BandWidth) + ", profile " + to_string(Profile) + "\n";
         PrintMessage(stats.c_str());
         std::cout << "Precision: " << Precision << "\n";
     }
+    return true;
+}
+
+bool FSolver::runSolver(bool verbose)
+{
+    Adaptive.MaxArea.clear();
+    if (Adaptive.Tolerance > 0 && (Frequency != 0 || ProblemType != PLANAR))
+    {
+        WarnMessage("Adaptive mesh refinement is only supported for static planar problems.\n");
+        return false;
+    }
+
+    if (!prepareMesh(verbose))
+        return false;
 
     if (Frequency == 0)
     {
@@ -1270,6 +1286,19 @@ bool FSolver::runSolver(bool verbose)
             }
             if (verbose)
                 PrintMessage("Static 2-D problem solved\n");
+
+            if (Adaptive.Tolerance > 0)
+            {
+                estimateStatic2DError(L.b);
+                if (verbose)
+                {
+                    std::string msg = "estimated relative error " + to_string(Adaptive.RelativeError) + "\n";
+                    PrintMessage(msg.c_str());
+                }
+                // the solution of a mesh that is refined further is not needed:
+                if (!Adaptive.MaxArea.empty())
+                    return true;
+            }
         } else {
             if (StaticAxisymmetric(L) == false)
             {
@@ -1285,6 +1314,11 @@ bool FSolver::runSolver(bool verbose)
             WarnMessage("couldn't write results to disk\n");
             return false;
         }
+        if (!SeriesFile.empty() && !WriteSeriesStep(std::vector<CComplex>(L.b, L.b+L.n)))
+        {
+            WarnMessage("couldn't append results to solution series\n");
+            return false;
+        }
         if (verbose)
             PrintMessage("results written to disk\n");
     } else {
@@ -1332,11 +1366,348 @@ bool FSolver::runSolver(bool verbose)
             WarnMessage("couldn't write results to disk\n");
             return false;
         }
+        if (!SeriesFile.empty() && !WriteSeriesStep(std::vector<CComplex>(L.b, L.b+L.n)))
+        {
+            WarnMessage("couldn't append results to solution series\n");
+            return false;
+        }
         if (verbose){ PrintMessage("results written to disk.\n"); }
     }
     return true;
 }
 
+bool FSolver::runAirGapSweep(const std::string &bdryName,
+                             const std::vector<double> &innerAngles,
+                             const std::vector<double> &outerAngles,
+                             bool verbose)
+{
+    if (Frequency != 0 || ProblemType != PLANAR || !previousSolutionFile.empty())
+    {
+        WarnMessage("Air gap sweeps are only supported for static planar problems.\n");
+        return false;
+    }
+    if (SeriesFile.empty())
+    {
+        WarnMessage("Air gap sweeps need a solution series file.\n");
+        return false;
+    }
+    if (innerAngles.size() != outerAngles.size())
+    {
+        WarnMessage("Air gap sweep: the number of inner and outer angles differs.\n");
+        return false;
+    }
+
+    if (!prepareMesh(verbose))
+        return false;
+
+    const int k = findAirGapElement(bdryName);
+    if (k < 0)
+    {
+        std::string msg = "No air gap element named " + bdryName + "\n";
+        WarnMessage(msg.c_str());
+        return false;
+    }
+
+    CBigLinProb L;
+    L.Precision = Precision;
+
+    // initialize the problem, allocating the space required to solve it.
+    if (L.Create(NumNodes, BandWidth) == false)
+    {
+        WarnMessage("couldn't allocate enough space for matrices\n");
+        return false;
+    }
+
+    sweep = AirGapSweep();
+    sweep.active = true;
+    const double initialRelax = Relax;
+    for (std::size_t step=0; step<innerAngles.size(); step++)
+    {
+        setAirGapAngles(agelist[k], innerAngles[step], outerAngles[step]);
+        Relax = initialRelax;
+
+        bool ok = Static2D(L);
+        sweep.warmStart = true;
+        if (!ok)
+        {
+            WarnMessage("Couldn't solve the problem\n");
+            sweep = AirGapSweep();
+            return false;
+        }
+        if (verbose)
+        {
+            std::string msg = "Air gap sweep step " + to_string(step+1)
+                    + " of " + to_string(innerAngles.size()) + " solved\n";
+            PrintMessage(msg.c_str());
+        }
+
+        // the first step is the base solution of the series:
+        if (step==0 && WriteStatic2D(L) == false)
+        {
+            WarnMessage("couldn't write results to disk\n");
+            sweep = AirGapSweep();
+            return false;
+        }
+        char label[128];
+        snprintf(label, sizeof(label), "InnerAngle=%.17g OuterAngle=%.17g",
+                 innerAngles[step], outerAngles[step]);
+        SeriesStepLabel = label;
+        if (!WriteSeriesStep(std::vector<CComplex>(L.b, L.b+L.n)))
+        {
+            WarnMessage("couldn't append results to solution series\n");
+            sweep = AirGapSweep();
+            return false;
+        }
+    }
+    sweep = AirGapSweep();
+    if (verbose)
+        PrintMessage("results written to disk\n");
+    return true;
+}
+
+int FSolver::findAirGapElement(const std::string &bdryName) const
+{
+    for (int k=0; k<NumAirGapElems; k++)
+    {
+        // the boundary name is read from the .pbc file including its quotes:
+        std::string name = agelist[k].BdryName;
+        name.erase(std::remove_if(name.begin(), name.end(),
+                                  [](char c) { return c=='"' || c=='\r' || c=='\n'; }),
+                   name.end());
+        if (name == bdryName)
+            return k;
+    }
+    return -1;
+}
+
+void FSolver::setAirGapAngles(femmsolver::CAirGapElement &age, double innerAngle, double outerAngle)
+{
+    const int n = age.totalArcElements;
+    const double dtta = age.totalArcLength/n;
+    const int n0 = (int) round(360./dtta); // total elements in a 360deg annular ring
+    const int n1 = (int) round(360./age.totalArcLength); // number of copied segments
+    // node coordinates are in cm, the centre is in drawing units:
+    const CComplex agc = age.agc * (100 * LengthConvMeters[LengthUnits]);
+
+    // any n consecutive ring points contain each boundary node exactly once:
+    std::vector<int> innerNodes(n), outerNodes(n);
+    for (int i=0; i<n; i++)
+    {
+        innerNodes[i] = age.quadNode[i].n1;
+        outerNodes[i] = age.quadNode[i].n3;
+    }
+
+    // map each boundary node onto points on the ring, and sort them by angle:
+    auto makeRing = [&](const std::vector<int> &nodes, double angle) {
+        std::vector<femm::CQuadPoint> ring;
+        ring.reserve(n0);
+        for (int j=0; j<n1; j++) // do each slice
+        {
+            const double dL = ((age.BdryFormat==1) && (j % 2 != 0)) ? -1 : 1; // antiperiodic
+            const CComplex a1 = exp(I*(j*age.totalArcLength+angle)*DEG);
+            for (int node : nodes)
+            {
+                const CComplex a0 = a1*(CComplex(meshnode[node].x,meshnode[node].y)-agc);
+                femm::CQuadPoint qp;
+                qp.n0 = node;
+                qp.w0 = ((Im(a0)>=0) ? arg(a0) : (arg(a0) + 2.*PI))*(180./PI)/dtta;
+                qp.w1 = dL;
+                ring.push_back(qp);
+            }
+        }
+        std::stable_sort(ring.begin(), ring.end(),
+                         [](const femm::CQuadPoint &a, const femm::CQuadPoint &b) { return a.w0 < b.w0; });
+        return ring;
+    };
+    const std::vector<femm::CQuadPoint> innerRing = makeRing(innerNodes, innerAngle);
+    const std::vector<femm::CQuadPoint> outerRing = makeRing(outerNodes, outerAngle);
+
+    age.InnerAngle = innerAngle;
+    age.OuterAngle = outerAngle;
+    age.InnerShift = innerRing[0].w0;
+    age.OuterShift = outerRing[0].w0;
+    for (int i=0; i<=n; i++)
+    {
+        // ring points that bracket points in the annulus mesh
+        // and their sign, for the purposes of periodicity/antiperiodicity
+        int p1 = (i==n0) ? 0 : i;
+        int p0 = (p1==0) ? n0-1 : p1-1;
+        age.quadNode[i].n0 = innerRing[p0].n0;
+        age.quadNode[i].w0 = innerRing[p0].w1;
+        age.quadNode[i].n1 = innerRing[p1].n0;
+        age.quadNode[i].w1 = innerRing[p1].w1;
+        age.quadNode[i].n2 = outerRing[p0].n0;
+        age.quadNode[i].w2 = outerRing[p0].w1;
+        age.quadNode[i].n3 = outerRing[p1].n0;
+        age.quadNode[i].w3 = outerRing[p1].w1;
+    }
+}
+
+uint64_t FSolver::MeshFingerprint() const
+{
+    double unitconv[]= {2.54,0.1,1.,100.,0.00254,1.e-04};
+    double cf = unitconv[LengthUnits];
+
+    // node coordinates are hashed as written to the solution file,
+    // so that FPProc can compute the same hash after reading them:
+    femm::FNV1aHash hash;
+    hash.add((int64_t)NumNodes);
+    for (int i=0; i<NumNodes; i++)
+    {
+        hash.add(meshnode[i].x/cf);
+        hash.add(meshnode[i].y/cf);
+    }
+    hash.add((int64_t)NumEls);
+    for (int i=0; i<NumEls; i++)
+    {
+        hash.add(meshele[i].p[0]);
+        hash.add(meshele[i].p[1]);
+        hash.add(meshele[i].p[2]);
+        hash.add(meshele[i].lbl);
+    }
+    return hash.value();
+}
+
+bool FSolver::WriteSeriesStep(const std::vector<CComplex> &b)
+{
+    char s[1024];
+    const unsigned long long meshHash = MeshFingerprint();
+
+    if (!Aprev.empty())
+    {
+        WarnMessage("Solution series are not supported for incremental problems.\n");
+        return false;
+    }
+
+    // The series file is read and written in binary mode,
+    // so that the step sizes are the same on all platforms.
+    FILE *fp = fopen(SeriesFile.c_str(),"rb");
+    if (fp==NULL)
+    {
+        // start a new series, based on the solution we just wrote:
+        fp = fopen(SeriesFile.c_str(),"wb");
+        if (fp==NULL)
+        {
+            std::string msg = "Couldn't write to " + SeriesFile + "\n";
+            WarnMessage(msg.c_str());
+            return false;
+        }
+        std::string baseSolution = PathName + ".ans";
+        std::string::size_type pos = baseSolution.find_last_of("/\\");
+        std::string::size_type seriesPos = SeriesFile.find_last_of("/\\");
+        // store the base solution relative to the series file, if possible:
+        if (pos == seriesPos && baseSolution.compare(0,pos+1,SeriesFile,0,pos+1)==0)
+            baseSolution = baseSolution.substr(pos+1);
+        fprintf(fp,"[SolutionSeries] = 1\n");
+        fprintf(fp,"[BaseSolution]   = \"%s\"\n", baseSolution.c_str());
+        fprintf(fp,"[NumNodes]       = %lld\n", (long long)NumNodes);
+        fprintf(fp,"[NumElements]    = %lld\n", (long long)NumEls);
+        fprintf(fp,"[MeshHash]       = %016llx\n", meshHash);
+    } else {
+        // appending to an existing series only makes sense if the mesh is still the same:
+        unsigned long long seriesHash = 0;
+        std::string line;
+        while (readLine(fp,line))
+        {
+            if (_strnicmp(line.c_str(),"[MeshHash]",10)==0)
+            {
+                sscanf(StripKey(&line[0]),"%llx",&seriesHash);
+                break;
+            }
+        }
+        fclose(fp);
+        if (seriesHash != meshHash)
+        {
+            std::string msg = "The mesh does not match the mesh of solution series " + SeriesFile + "\n";
+            WarnMessage(msg.c_str());
+            return false;
+        }
+        fp = fopen(SeriesFile.c_str(),"ab");
+        if (fp==NULL)
+        {
+            std::string msg = "Couldn't write to " + SeriesFile + "\n";
+            WarnMessage(msg.c_str());
+            return false;
+        }
+    }
+
+    // Assemble the step in memory first, so that we can write its size into the header.
+    // This allows readers to skip from one step to the next without parsing the data.
+    std::string step;
+    auto append = [&step, &s](int len) { step.append(s, std::min(len, (int)sizeof(s)-1)); };
+
+    step = "[Label] = \"" + SeriesStepLabel + "\"\n";
+    append(snprintf(s,sizeof(s),"%lld\n",(long long)NumNodes));
+    for (int i=0; i<NumNodes; i++)
+    {
+        if (Frequency==0)
+            append(snprintf(s,sizeof(s),"%.17g\n",b[i].re));
+        else
+            append(snprintf(s,sizeof(s),"%.17g\t%.17g\n",b[i].re,b[i].im));
+    }
+
+    // circuit currents:
+    append(snprintf(s,sizeof(s),"%i\n",NumCircPropsOrig));
+    for (int i=0; i<NumCircPropsOrig; i++)
+    {
+        append(snprintf(s,sizeof(s),"%.17g\t%.17g\n",circproplist[i].Amps.re,circproplist[i].Amps.im));
+    }
+
+    // circuit info on a blocklabel by blocklabel basis, as in the solution file:
+    append(snprintf(s,sizeof(s),"%i\n",NumBlockLabels));
+    for (int k=0; k<NumBlockLabels; k++)
+    {
+        int i = labellist[k].InCircuit;
+        int circCase = 1;
+        CComplex val = 0;
+        if (i>=0)
+        {
+            circCase = circproplist[i].Case;
+            if (circCase==0)
+                val = circproplist[i].dV;
+            else if (circCase==1)
+                val = circproplist[i].J;
+            else {
+                circCase = 0;
+                val = b[NumNodes+i];
+            }
+        }
+        if (Frequency==0)
+            append(snprintf(s,sizeof(s),"%i\t%.17g\n",circCase,val.re));
+        else
+            append(snprintf(s,sizeof(s),"%i\t%.17g\t%.17g\n",circCase,val.re,val.im));
+    }
+
+    // air gap element data changes with the rotor angle:
+    append(snprintf(s,sizeof(s),"%i\n",NumAirGapElems));
+    for (int i=0; i<NumAirGapElems; i++)
+    {
+        append(snprintf(s,sizeof(s),"%i %.17g %.17g %.17g %.17g\n",
+                        agelist[i].totalArcElements,
+                        agelist[i].InnerAngle,
+                        agelist[i].OuterAngle,
+                        agelist[i].InnerShift,
+                        agelist[i].OuterShift ));
+        for (int k=0; k<=agelist[i].totalArcElements; k++)
+        {
+            append(snprintf(s,sizeof(s),"%i %.17g %i %.17g %i %.17g %i %.17g\n",
+                            agelist[i].quadNode[k].n0,
+                            agelist[i].quadNode[k].w0,
+                            agelist[i].quadNode[k].n1,
+                            agelist[i].quadNode[k].w1,
+                            agelist[i].quadNode[k].n2,
+                            agelist[i].quadNode[k].w2,
+                            agelist[i].quadNode[k].n3,
+                            agelist[i].quadNode[k].w3 ));
+        }
+    }
+
+    fprintf(fp,"[Step] = %lu\n",(unsigned long)step.size());
+    bool ok = (fwrite(step.data(),1,step.size(),fp) == step.size());
+    ok = (fclose(fp)==0) && ok;
+    return ok;
+}
+
 // SortNodes: sorts mesh nodes based on a new numbering
 void FSolver::SortNodes (std::vector<int> newnum)
 {
@@ -32,6 +32,7 @@
 #ifndef FSOLVER_H
 #define FSOLVER_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "feasolver.h"
@@ -71,6 +72,34 @@ public:
     std::vector <femm::CNode> meshnode;
     int NumCircPropsOrig;
 
+    /**
+     * @brief If not empty, runSolver() appends the solution as a new step to this solution series file.
+     * All steps of a series share the problem description and mesh of the base solution,
+     * which is the first solution written to the series.
+     */
+    std::string SeriesFile;
+    /// \brief Free-form label of the step appended to SeriesFile (e.g. "angle=10")
+    std::string SeriesStepLabel;
+
+    /// \brief Settings and state of adaptive mesh refinement, see runSolver()
+    struct AdaptiveRefinement
+    {
+        double Tolerance = 0;     ///< target for the estimated relative error; 0 disables adaptive refinement
+        int MaxElements = 0;      ///< element budget, or 0 for no limit
+        bool LastStep = false;    ///< write the solution regardless of the estimated error
+        double RelativeError = 0; ///< estimated relative error of the last solution
+        /// new elements created per marked element by the last refinement (including quality refinement around it)
+        double GrowthPerMark = 8;
+        int MarkedElements = 0;   ///< number of elements marked for refinement after the last solution
+        int MarkedMeshSize = 0;   ///< number of elements of the mesh on which they were marked
+        /**
+         * @brief Area constraint for each element of the \c .ele file (in problem units, <=0: no constraint).
+         * If not empty, the last solution has not been written, because the mesh should be refined and solved again.
+         */
+        std::vector<double> MaxArea;
+    };
+    AdaptiveRefinement Adaptive;
+
 
 // Operations
 public:
@@ -104,6 +133,14 @@ public:
     int WriteStatic2D(CBigLinProb &L);
     int Harmonic2D(CBigComplexLinProb &L,bool verbose=false);
     int WriteHarmonic2D(CBigComplexLinProb &L);
+    /**
+     * @brief Append the solution as a new step to the solution series file SeriesFile.
+     * If the series file does not exist yet, it is created with the current solution file (PathName.ans) as base solution.
+     * Otherwise, the mesh must be identical to the mesh of the base solution.
+     * @param b solution vector: nodal potentials, followed by the circuit unknowns
+     * @return \c true on success, \c false otherwise.
+     */
+    bool WriteSeriesStep(const std::vector<CComplex> &b);
     int StaticAxisymmetric(CBigLinProb &L);
     int HarmonicAxisymmetric(CBigComplexLinProb &L,bool verbose=false);
     void GetFillFactor(int lbl);
@@ -111,10 +148,92 @@ public:
 
     virtual bool runSolver(bool verbose=false) override;
 
+    /**
+     * @brief Solve a static planar problem for a sequence of air gap element angles.
+     * The mesh is loaded and renumbered only once.
+     * For each step, only the contributions of the air gap element are updated,
+     * and the solver starts from the solution of the previous step.
+     * For linear problems, the assembled element part of the system is kept as well.
+     *
+     * The solution of the first step is written to PathName.ans,
+     * and all steps are appended to the solution series SeriesFile.
+     * @param bdryName name of the air gap element boundary
+     * @param innerAngles InnerAngle for each step [deg]
+     * @param outerAngles OuterAngle for each step [deg]
+     * @param verbose
+     * @return \c true on success, \c false otherwise.
+     */
+    bool runAirGapSweep(const std::string &bdryName,
+                        const std::vector<double> &innerAngles,
+                        const std::vector<double> &outerAngles,
+                        bool verbose=false);
+
 private:
 
     virtual void CleanUp() override;
 
+    /**
+     * @brief Load the mesh and renumber the nodes, as needed by runSolver() and runAirGapSweep().
+     * If the air gap angles of the mesh files differ from the problem description,
+     * the air gap elements are turned to the angles of the problem description.
+     * @param verbose
+     * @return \c true on success, \c false otherwise.
+     */
+    bool prepareMesh(bool verbose);
+
+    /**
+     * @brief Add the contributions of the air gap elements to the linear system.
+     * @param L
+     */
+    void AddAirGapElements(CBigLinProb &L);
+
+    /**
+     * @brief Estimate the error of a static planar solution, and select the elements to refine.
+     * The error indicator of an element combines the jumps of the tangential field intensity H
+     * across its edges (see femm::addTangentialFieldJumps()) with the current density in the element (explicit residual estimator),
+     * weighted so that the sum over all elements compares to the magnetic energy.
+     *
+     * Sets Adaptive.RelativeError. Unless the error is below Adaptive.Tolerance,
+     * the element budget is used up, or Adaptive.LastStep is set,
+     * the elements that make up half of the estimated error are marked for refinement in Adaptive.MaxArea.
+     * @param A vector potential at each node [Wb/m]
+     */
+    void estimateStatic2DError(const double *A);
+
+    /**
+     * @brief Find an air gap element by its boundary name.
+     * @param bdryName
+     * @return the index into agelist, or -1 if there is no such air gap element
+     */
+    int findAirGapElement(const std::string &bdryName) const;
+
+    /**
+     * @brief Turn the inner and outer ring of an air gap element to the given angles.
+     * This recomputes the mapping of the boundary nodes onto the annulus mesh,
+     * in the same way as the mesher does when writing the .pbc file.
+     * @param age the air gap element
+     * @param innerAngle new InnerAngle [deg]
+     * @param outerAngle new OuterAngle [deg]
+     */
+    void setAirGapAngles(femmsolver::CAirGapElement &age, double innerAngle, double outerAngle);
+
+    /// \brief State of an air gap sweep, see runAirGapSweep()
+    struct AirGapSweep
+    {
+        bool active = false; ///< Static2D() is solving a step of a sweep
+        bool warmStart = false; ///< the linear system holds the solution of the previous step
+        bool haveElementValues = false; ///< elementValues is valid (only for linear problems)
+        CBigLinProbValues elementValues; ///< linear system without air gap elements and boundary conditions
+    };
+    AirGapSweep sweep;
+
+    /**
+     * @brief Compute a hash of the mesh as written to the solution file.
+     * Needs to match FPProc::MeshFingerprint().
+     * @return the mesh hash
+     */
+    uint64_t MeshFingerprint() const;
+
     /**
      * @brief getPrevAxiB
      * @param k
@@ -893,39 +893,33 @@ int FSolver::WriteHarmonic2D(CBigComplexLinProb &L)
 {
     // write solution to disk;
 
-    char c[1024];
-    FILE *fp,*fz;
+    FILE *fp;
     int i,k;
     double cf;
     double unitconv[]= {2.54,0.1,1.,100.,0.00254,1.e-04};
 
-    // first, echo input .fem file to the .ans file;
-    sprintf(c,"%s.fem",PathName.c_str());
-    fz = fopen(c,"rt");
-    if(fz==NULL)
-    {
-        //MsgBox("Couldn't open %s.fem\n",PathName);
-        printf("Couldn't open %s.fem\n",PathName.c_str());
-        return false;
-    }
-
-    sprintf(c,"%s.ans",PathName.c_str());
-    fp = fopen(c,"wt");
+    std::string c = PathName + ".ans";
+    fp = fopen(c.c_str(),"wt");
     if(fp==NULL)
     {
-        if (fz != NULL) fclose(fz);
         //MsgBox("Couldn't write to %s.ans\n",PathName.c_str());
         printf("Couldn't write to %s.ans\n",PathName.c_str());
         return false;
     }
 
-    while(fgets(c,1024,fz)!=NULL) fputs(c,fp);
-    fclose(fz);
+    // first, echo input .fem file to the .ans file;
+    if (!writeProblemDescription(fp, PathName+".fem"))
+    {
+        fclose(fp);
+        //MsgBox("Couldn't open %s.fem\n",PathName);
+        printf("Couldn't open %s.fem\n",PathName.c_str());
+        return false;
+    }
 
     // then print out node, line, and element information
     fprintf(fp,"[Solution]\n");
     cf=unitconv[LengthUnits];
-    fprintf(fp,"%i\n",NumNodes);
+    fprintf(fp,"%lld\n",(long long)NumNodes);
     for(i=0; i<NumNodes; i++)
     {
         fprintf(fp,"%.17g\t%.17g\t%.17g\t%.17g\t%i",meshnode[i].x/cf,
@@ -936,7 +930,7 @@ int FSolver::WriteHarmonic2D(CBigComplexLinProb &L)
         if (!Aprev.empty ()) fprintf(fp,"\t%.17g\n",Aprev[i]);
         else fprintf(fp,"\n");
     }
-    fprintf(fp,"%i\n",NumEls);
+    fprintf(fp,"%lld\n",(long long)NumEls);
     for(i=0; i<NumEls; i++)
     {
         fprintf(fp,"%i\t%i\t%i\t%i\t%i\t%i\t%i",
@@ -27,6 +27,8 @@
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <iostream>
+#include <string>
 #include "femmcomplex.h"
 //#include "spars.h"
 //#include "mmesh.h"
@@ -40,7 +42,7 @@
 int main(int argc, char** argv)
 {
     FSolver theFSolver;
-    char PathName[512];
+    std::string PathName;
 //    int i;
 
     if (argc < 2)
@@ -52,10 +54,7 @@ int main(int argc, char** argv)
 
         //scanf("%s", tempFilePath);
 
-        fgets(PathName, 512, stdin);
-        char *pos;
-        if ((pos=strchr(PathName, '\n')) != NULL)
-            *pos = '\0';
+        std::getline(std::cin, PathName);
 
         //PathName = tempFilePath;
 
@@ -66,7 +65,7 @@ int main(int argc, char** argv)
     }
     else
     {
-        strcpy(PathName, argv[1]);
+        PathName = argv[1];
     }
 
     theFSolver.PathName = PathName;
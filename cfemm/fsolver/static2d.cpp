@@ -22,6 +22,7 @@
 #include "femmcomplex.h"
 #include "femmconstants.h"
 #include "CElement.h"
+#include "errorEstimate.h"
 #include "spars.h"
 #include "fsolver.h"
 #include "lua.h"
@@ -32,6 +33,8 @@
 #include <malloc.h>
 #include <string>
 #include <cstdio>
+#include <algorithm>
+#include <vector>
 
 #include <csignal>
 
@@ -58,7 +61,7 @@ int FSolver::Static2D(CBigLinProb &L)
     double Mx[3][3],My[3][3],Mxy[3][3],Mn[3][3];
     double l[3],p[3],q[3];      // element shape parameters;
     int n[3];                   // numbers of nodes for a particular element;
-    double a,K,Ki,r,t,x,y,B,B1,B2,mu,v[3],u[3],dv,res,lastres,Cduct;
+    double a,K,r,t,x,y,B,B1,B2,mu,v[3],u[3],dv,res,lastres,Cduct;
     double *V_old=nullptr;
     double *CircInt1=nullptr;
     double *CircInt2=nullptr;
@@ -72,6 +75,14 @@ int FSolver::Static2D(CBigLinProb &L)
 
 	if (!previousSolutionFile.empty()) bIncremental = PrevType;
 
+    // in the steps of an air gap sweep after the first one, the linear system
+    // still holds the solution of the previous step, which is used as a starting point:
+    const bool warmStart = sweep.active && sweep.warmStart;
+    const bool reuseElements = warmStart && sweep.haveElementValues;
+    // a nonlinear problem continues the Newton iteration from the previous permeabilities:
+    const bool warmNonlinear = warmStart && !sweep.haveElementValues;
+    if (warmNonlinear) LinearFlag = false;
+
     res=0;
     femmsolver::CMElement *El;
     V_old = (double *) calloc(NumNodes,sizeof(double));
@@ -183,645 +194,512 @@ int FSolver::Static2D(CBigLinProb &L)
 
 //        pctr = 0;
 
-        if(Iter > 0)
+        if(Iter > 0 || warmStart)
         {
             L.Wipe();
         }
 
         // first, tack in air gap element contributions
-        for(i=0;i<NumAirGapElems;i++)
+        // (in a sweep, these are added after the element contributions, see below)
+        if (!sweep.active)
         {
-            double MG[10][10];
-            double ci,co;
-            int nn[10];
-            double ww[10];
-            double dt;
-
-            // K = dr/(R*dtta)
-            dt=(PI/180.)*(agelist[i].totalArcLength/agelist[i].totalArcElements);
-            K=2.*(agelist[i].ro-agelist[i].ri)/
-               (dt*(agelist[i].ro+agelist[i].ri));
-            Ki=1./K;
-            ci=agelist[i].InnerShift;
-            co=agelist[i].OuterShift;
-
-            if (ci>co)
-            {
-                ci=ci-co;
-                co=0;
-            }
-            else{
-                ci=1-co+ci;
-                co=1;
-            }
+            AddAirGapElements(L);
+        }
 
-            // build the element matrix for each quad element in the annulus (same for each element)
-            // matrix for quad element derived from serendipity element
-            MG[0][0] = (5*Power (-1 + ci,2)*Power (ci,4)*(K + Ki))/48.;
-            MG[0][1] = -((-1 + ci)*Power (ci,3)*(5*(-1 + ci*(-5 + 4*ci))*K + (-5 + ci*(-19 + 14*ci))*Ki))/48.;
-            MG[0][2] = ((-1 + ci)*Power (ci,2)*(5*(2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*K + (10 + ci*(1 + 3*ci*(-7 + 4*ci)))*Ki))/48.;
-            MG[0][3] = -(Power (-1 + ci,2)*Power (ci,2)*(5*(-2 + ci*(-3 + 4*ci))*K + (2 + ci*(-3 + 2*ci))*Ki))/48.;
-            MG[0][4] = (Power (-1 + ci,3)*Power (ci,3)*(5*K - Ki))/48.;
-            MG[0][5] = ((-1 + ci)*Power (ci,2)*(-1 + co)*Power (co,2)*(K - 5*Ki))/48.;
-            MG[0][6] = -((-1 + ci)*Power (ci,2)*co*((-1 + co*(-5 + 4*co))*K + (5 + (19 - 14*co)*co)*Ki))/48.;
-            MG[0][7] = ((-1 + ci)*Power (ci,2)*((2 + co*(-1 - 9*co + 6*Power (co,2)))*K - (10 + co*(1 + 3*co*(-7 + 4*co)))*Ki))/48.;
-            MG[0][8] = -((-1 + ci)*Power (ci,2)*(-1 + co)*((-2 + co*(-3 + 4*co))*K + (-2 + (3 - 2*co)*co)*Ki))/48.;
-            MG[0][9] = ((-1 + ci)*Power (ci,2)*Power (-1 + co,2)*co*(K + Ki))/48.;
-            MG[1][1] = (Power (ci,2)*(5*Power (1 + (5 - 4*ci)*ci,2)*K + (5 + ci*(38 + ci*(49 + 4*ci*(-29 + 11*ci))))*Ki))/48.;
-            MG[1][2] = (-5*ci*(-1 + 2*ci)*(-2 + 3*(-1 + ci)*ci)*(-1 + ci*(-5 + 4*ci))*K + ci*(10 + ci*(39 - ci*(50 + ci*(85 + 6*ci*(-23 + 8*ci)))))*Ki)/48.;
-            MG[1][3] = ((-1 + ci)*ci*(5*(2 + ci*(13 + ci*(3 + 16*(-2 + ci)*ci)))*K + (-2 + 5*ci*(1 + ci*(3 + 4*(-2 + ci)*ci)))*Ki))/48.;
-            MG[1][4] = -(Power (-1 + ci,2)*Power (ci,2)*(5*(-1 + ci*(-5 + 4*ci))*K + Ki + ci*(-1 + 2*ci)*Ki))/48.;
-            MG[1][5] = -(ci*(-1 + co)*Power (co,2)*((-1 + ci*(-5 + 4*ci))*K + (5 + (19 - 14*ci)*ci)*Ki))/48.;
-            MG[1][6] = (ci*co*((-1 + ci*(-5 + 4*ci))*(-1 + co*(-5 + 4*co))*K + (-5 + ci*(-19 + 14*ci) - 19*co + ci*(-77 + 58*ci)*co + 2*(7 + (29 - 22*ci)*ci)*Power (co,2))*Ki))/48.;
-            MG[1][7] = (-(ci*(-1 + ci*(-5 + 4*ci))*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K) + ci*(-10 + co*(-1 + 3*(7 - 4*co)*co) + ci*(-38 + co + 99*Power (co,2) - 60*Power (co,3)) + Power (ci,2)*(28 + 2*co*(-1 + 3*co*(-13 + 8*co))))*Ki)/48.;
-            MG[1][8] = (ci*(-1 + co)*((-1 + ci*(-5 + 4*ci))*(-2 + co*(-3 + 4*co))*K + (2 + co*(-3 + 2*co) + Power (ci,2)*(4 + 2*(9 - 10*co)*co) + ci*(-2 + co*(-21 + 22*co)))*Ki))/48.;
-            MG[1][9] = -(ci*Power (-1 + co,2)*co*((-1 + ci*(-5 + 4*ci))*K + (-1 + ci - 2*Power (ci,2))*Ki))/48.;
-            MG[2][2] = (5*Power (-2 + ci + 9*Power (ci,2) - 6*Power (ci,3),2)*K + (20 + (-1 + ci)*ci*(-4 + 3*(-1 + ci)*ci*(-25 + 24*(-1 + ci)*ci)))*Ki)/48.;
-            MG[2][3] = (-5*(4 + Power (ci,2)*(-33 + ci*(18 + ci*(65 + 6*ci*(-13 + 4*ci)))))*K + (4 + Power (ci,2)*(39 - ci*(30 + ci*(115 + 6*ci*(-25 + 8*ci)))))*Ki)/48.;
-            MG[2][4] = (Power (-1 + ci,2)*ci*(5*(2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*K + (-2 + ci*(-5 + 3*ci*(-5 + 4*ci)))*Ki))/48.;
-            MG[2][5] = ((-1 + co)*Power (co,2)*((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*K - (10 + ci*(1 + 3*ci*(-7 + 4*ci)))*Ki))/48.;
-            MG[2][6] = (-((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*co*(-1 + co*(-5 + 4*co))*K) + co*(-10 - 38*co + 28*Power (co,2) + Power (ci,2)*(21 + 99*co - 78*Power (co,2)) + ci*(-1 + co - 2*Power (co,2)) + 12*Power (ci,3)*(-1 + co*(-5 + 4*co)))*Ki)/48.;
-            MG[2][7] = ((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K - (2*(10 + co) + 6*Power (co,2)*(-7 + 4*co) + 3*Power (ci,2)*(-14 + co*(5 + (55 - 36*co)*co)) + ci*(2 + co*(5 + 3*(5 - 4*co)*co)) + 12*Power (ci,3)*(2 + co*(-1 - 9*co + 6*Power (co,2))))*Ki)/48.;
-            MG[2][8] = (-((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*(2 + co - 7*Power (co,2) + 4*Power (co,3))*K) + (-1 + co)*(4 + 2*ci*(5 + 3*(5 - 4*ci)*ci) + 3*(-2 + ci*(3 + (17 - 12*ci)*ci))*co + 2*(2 + ci*(-7 + 3*ci*(-11 + 8*ci)))*Power (co,2))*Ki)/48.;
-            MG[2][9] = (Power (-1 + co,2)*co*((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*K + (2 + ci*(5 + 3*(5 - 4*ci)*ci))*Ki))/48.;
-            MG[3][3] = (Power (-1 + ci,2)*(5*Power (2 + (3 - 4*ci)*ci,2)*K + (20 + ci*(36 + ci*(-35 - 60*ci + 44*Power (ci,2))))*Ki))/48.;
-            MG[3][4] = -(Power (-1 + ci,3)*ci*(5*(-2 + ci*(-3 + 4*ci))*K + (-10 + ci*(-9 + 14*ci))*Ki))/48.;
-            MG[3][5] = -((-1 + ci)*(-1 + co)*Power (co,2)*((-2 + ci*(-3 + 4*ci))*K + (-2 + (3 - 2*ci)*ci)*Ki))/48.;
-            MG[3][6] = ((-1 + ci)*co*((-2 + ci*(-3 + 4*ci))*(-1 + co*(-5 + 4*co))*K + (2 + ci*(-3 + 2*ci) - 2*co + ci*(-21 + 22*ci)*co + 2*(2 + (9 - 10*ci)*ci)*Power (co,2))*Ki))/48.;
-            MG[3][7] = (-((2 + ci - 7*Power (ci,2) + 4*Power (ci,3))*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K) + (-1 + ci)*(4 + 2*co*(5 + 3*(5 - 4*co)*co) + ci*(-6 + 3*co*(3 + (17 - 12*co)*co)) + 2*Power (ci,2)*(2 + co*(-7 + 3*co*(-11 + 8*co))))*Ki)/48.;
-            MG[3][8] = ((-1 + ci)*(-1 + co)*((-2 + ci*(-3 + 4*ci))*(-2 + co*(-3 + 4*co))*K + (-20 + 3*ci*(1 + 2*co)*(-6 + 5*co) + 2*co*(-9 + 14*co) + Power (ci,2)*(28 + 30*co - 44*Power (co,2)))*Ki))/48.;
-            MG[3][9] = -((-1 + ci)*Power (-1 + co,2)*co*((-2 + ci*(-3 + 4*ci))*K + (10 + (9 - 14*ci)*ci)*Ki))/48.;
-            MG[4][4] = (5*Power (-1 + ci,4)*Power (ci,2)*(K + Ki))/48.;
-            MG[4][5] = (Power (-1 + ci,2)*ci*(-1 + co)*Power (co,2)*(K + Ki))/48.;
-            MG[4][6] = -(Power (-1 + ci,2)*ci*co*((-1 + co*(-5 + 4*co))*K + (-1 + co - 2*Power (co,2))*Ki))/48.;
-            MG[4][7] = (Power (-1 + ci,2)*ci*((2 + co*(-1 - 9*co + 6*Power (co,2)))*K + (2 + co*(5 + 3*(5 - 4*co)*co))*Ki))/48.;
-            MG[4][8] = -(Power (-1 + ci,2)*ci*(-1 + co)*((-2 + co*(-3 + 4*co))*K + (10 + (9 - 14*co)*co)*Ki))/48.;
-            MG[4][9] = (Power (-1 + ci,2)*ci*Power (-1 + co,2)*co*(K - 5*Ki))/48.;
-            MG[5][5] = (5*Power (-1 + co,2)*Power (co,4)*(K + Ki))/48.;
-            MG[5][6] = -((-1 + co)*Power (co,3)*(5*(-1 + co*(-5 + 4*co))*K + (-5 + co*(-19 + 14*co))*Ki))/48.;
-            MG[5][7] = ((-1 + co)*Power (co,2)*(5*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K + (10 + co*(1 + 3*co*(-7 + 4*co)))*Ki))/48.;
-            MG[5][8] = -(Power (-1 + co,2)*Power (co,2)*(5*(-2 + co*(-3 + 4*co))*K + (2 + co*(-3 + 2*co))*Ki))/48.;
-            MG[5][9] = (Power (-1 + co,3)*Power (co,3)*(5*K - Ki))/48.;
-            MG[6][6] = (Power (co,2)*(5*Power (1 + (5 - 4*co)*co,2)*K + (5 + co*(38 + co*(49 + 4*co*(-29 + 11*co))))*Ki))/48.;
-            MG[6][7] = (-5*co*(-1 + 2*co)*(-2 + 3*(-1 + co)*co)*(-1 + co*(-5 + 4*co))*K + co*(10 + co*(39 - co*(50 + co*(85 + 6*co*(-23 + 8*co)))))*Ki)/48.;
-            MG[6][8] = ((-1 + co)*co*(5*(2 + co*(13 + co*(3 + 16*(-2 + co)*co)))*K + (-2 + 5*co*(1 + co*(3 + 4*(-2 + co)*co)))*Ki))/48.;
-            MG[6][9] = -(Power (-1 + co,2)*Power (co,2)*(5*(-1 + co*(-5 + 4*co))*K + Ki + co*(-1 + 2*co)*Ki))/48.;
-            MG[7][7] = (5*Power (-2 + co + 9*Power (co,2) - 6*Power (co,3),2)*K + (20 + (-1 + co)*co*(-4 + 3*(-1 + co)*co*(-25 + 24*(-1 + co)*co)))*Ki)/48.;
-            MG[7][8] = (-5*(4 + Power (co,2)*(-33 + co*(18 + co*(65 + 6*co*(-13 + 4*co)))))*K + (4 + Power (co,2)*(39 - co*(30 + co*(115 + 6*co*(-25 + 8*co)))))*Ki)/48.;
-            MG[7][9] = (Power (-1 + co,2)*co*(5*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K + (-2 + co*(-5 + 3*co*(-5 + 4*co)))*Ki))/48.;
-            MG[8][8] = (Power (-1 + co,2)*(5*Power (2 + (3 - 4*co)*co,2)*K + (20 + co*(36 + co*(-35 - 60*co + 44*Power (co,2))))*Ki))/48.;
-            MG[8][9] = -(Power (-1 + co,3)*co*(5*(-2 + co*(-3 + 4*co))*K + (-10 + co*(-9 + 14*co))*Ki))/48.;
-            MG[9][9] = (5*Power (-1 + co,4)*Power (co,2)*(K + Ki))/48.;
-
-            // Add each annulus element to the global stiffness matrix
-            for(k=0;k<agelist[i].totalArcElements;k++)
+        if (reuseElements)
+        {
+            // linear problem: the element part of the system does not depend on the air gap angles
+            L.RestoreValues(sweep.elementValues);
+        }
+        else
+        {
+            for(i = 0; i < NumEls; i++)
             {
 
-                // inner nodes
-                if ((k-1)<0){
-                    nn[0]=agelist[i].quadNode[agelist[i].totalArcElements-1].n0;
-                    ww[0]=agelist[i].quadNode[agelist[i].totalArcElements-1].w0;
-                }
-                else{
-                    nn[0]=agelist[i].quadNode[k-1].n0;
-                    ww[0]=agelist[i].quadNode[k-1].w0;
-                }
-
-                nn[1]=agelist[i].quadNode[k].n0;
-                nn[2]=agelist[i].quadNode[k].n1;
-                nn[3]=agelist[i].quadNode[k+1].n1;
-                ww[1]=agelist[i].quadNode[k].w0;
-                ww[2]=agelist[i].quadNode[k].w1;
-                ww[3]=agelist[i].quadNode[k+1].w1;
-
-                if((k+2)>agelist[i].totalArcElements){
-                    nn[4]=agelist[i].quadNode[1].n1;
-                    ww[4]=agelist[i].quadNode[1].w1;
-                }
-                else{
-                    nn[4]=agelist[i].quadNode[k+2].n1;
-                    ww[4]=agelist[i].quadNode[k+2].w1;
-                }
-
-                // outer nodes
-                if ((k-1)<0){
-                    nn[5]=agelist[i].quadNode[agelist[i].totalArcElements-1].n2;
-                    ww[5]=agelist[i].quadNode[agelist[i].totalArcElements-1].w2;
-                }
-                else{
-                    nn[5]=agelist[i].quadNode[k-1].n2;
-                    ww[5]=agelist[i].quadNode[k-1].w2;
-                }
-
-                nn[6]=agelist[i].quadNode[k].n2;
-                nn[7]=agelist[i].quadNode[k].n3;
-                nn[8]=agelist[i].quadNode[k+1].n3;
-                ww[6]=agelist[i].quadNode[k].w2;
-                ww[7]=agelist[i].quadNode[k].w3;
-                ww[8]=agelist[i].quadNode[k+1].w3;
-
-                if((k+2)>agelist[i].totalArcElements){
-                    nn[9]=agelist[i].quadNode[1].n3;
-                    ww[9]=agelist[i].quadNode[1].w3;
-                }
-                else{
-                    nn[9]=agelist[i].quadNode[k+2].n3;
-                    ww[9]=agelist[i].quadNode[k+2].w3;
-                }
-
-                // fix antiperiodic weights...
-                if ((k==0) && (agelist[i].BdryFormat==1))
-                {
-                    ww[0]=-ww[0];
-                    ww[5]=-ww[5];
-                }
-                if (((k+1)==agelist[i].totalArcElements) && (agelist[i].BdryFormat==1))
+    //            // update ``building matrix'' progress bar...
+    //            j = (i*20) / NumEls + 1;
+    //            if(j > pctr)
+    //            {
+    //                j = pctr * 5;
+    //                if (j>100)
+    //                {
+    //                    j = 100;
+    //                }
+    //                TheView->m_prog1.SetPos(j);
+    //                pctr++;
+    //            }
+
+                // zero out Me, be;
+                for(j = 0; j < 3; j++)
                 {
-                    ww[4]=-ww[4];
-                    ww[9]=-ww[9];
+                    for(k = 0; k < 3; k++)
+                    {
+                        Me[j][k] = 0.;
+                        Mx[j][k] = 0.;
+                        My[j][k] = 0.;
+                        Mn[j][k] = 0.;
+                        Mxy[j][k] = 0.;
+                    }
+                    be[j] = 0.;
                 }
 
-                // scale by weight to get periodic/antiperiodic right and tack into mesh
-                for(int ii=0;ii<10;ii++)
-                    for(int jj=ii;jj<10;jj++)
-                        L.AddTo(MG[ii][jj]*ww[ii]*ww[jj],nn[ii],nn[jj]);
-            }
-
-        }
-
-        for(i = 0; i < NumEls; i++)
-        {
+                // Determine shape parameters.
+                // l == element side lengths;
+                // p corresponds to the `b' parameter in Allaire
+                // q corresponds to the `c' parameter in Allaire
+                El = &meshele[i];
 
-//            // update ``building matrix'' progress bar...
-//            j = (i*20) / NumEls + 1;
-//            if(j > pctr)
-//            {
-//                j = pctr * 5;
-//                if (j>100)
-//                {
-//                    j = 100;
-//                }
-//                TheView->m_prog1.SetPos(j);
-//                pctr++;
-//            }
-
-            // zero out Me, be;
-            for(j = 0; j < 3; j++)
-            {
-                for(k = 0; k < 3; k++)
+                for(k = 0; k<3; k++)
                 {
-                    Me[j][k] = 0.;
-                    Mx[j][k] = 0.;
-                    My[j][k] = 0.;
-                    Mn[j][k] = 0.;
-                    Mxy[j][k] = 0.;
+                    n[k] = El->p[k];
                 }
-                be[j] = 0.;
-            }
 
-            // Determine shape parameters.
-            // l == element side lengths;
-            // p corresponds to the `b' parameter in Allaire
-            // q corresponds to the `c' parameter in Allaire
-            El = &meshele[i];
+                p[0] = meshnode[n[1]].y - meshnode[n[2]].y;
+                p[1] = meshnode[n[2]].y - meshnode[n[0]].y;
+                p[2] = meshnode[n[0]].y - meshnode[n[1]].y;
+                q[0] = meshnode[n[2]].x - meshnode[n[1]].x;
+                q[1] = meshnode[n[0]].x - meshnode[n[2]].x;
+                q[2] = meshnode[n[1]].x - meshnode[n[0]].x;
 
-            for(k = 0; k<3; k++)
-            {
-                n[k] = El->p[k];
-            }
-
-            p[0] = meshnode[n[1]].y - meshnode[n[2]].y;
-            p[1] = meshnode[n[2]].y - meshnode[n[0]].y;
-            p[2] = meshnode[n[0]].y - meshnode[n[1]].y;
-            q[0] = meshnode[n[2]].x - meshnode[n[1]].x;
-            q[1] = meshnode[n[0]].x - meshnode[n[2]].x;
-            q[2] = meshnode[n[1]].x - meshnode[n[0]].x;
-
-            for(j = 0,k = 1; j<3; k++, j++)
-            {
-                if (k == 3)
+                for(j = 0,k = 1; j<3; k++, j++)
                 {
-                    k = 0;
-                }
+                    if (k == 3)
+                    {
+                        k = 0;
+                    }
 
-                l[j] = sqrt( pow(meshnode[n[k]].x-meshnode[n[j]].x,2.) +
-                             pow(meshnode[n[k]].y-meshnode[n[j]].y,2.) );
+                    l[j] = sqrt( pow(meshnode[n[k]].x-meshnode[n[j]].x,2.) +
+                                 pow(meshnode[n[k]].y-meshnode[n[j]].y,2.) );
 
-            }
+                }
 
-            a = (p[0]*q[1] - p[1]*q[0]) / 2.;
+                a = (p[0]*q[1] - p[1]*q[0]) / 2.;
 
-            r = (meshnode[n[0]].x + meshnode[n[1]].x + meshnode[n[2]].x) / 3.;
+                r = (meshnode[n[0]].x + meshnode[n[1]].x + meshnode[n[2]].x) / 3.;
 
-            // x-contribution; only need to do main diagonal and above;
-            K = (-1. / (4.*a));
+                // x-contribution; only need to do main diagonal and above;
+                K = (-1. / (4.*a));
 
-            for(j = 0; j<3; j++)
-            {
-                for(k = j; k<3; k++)
+                for(j = 0; j<3; j++)
                 {
-                    Mx[j][k] += K * p[j] * p[k];
-                    if (j != k)
+                    for(k = j; k<3; k++)
                     {
-                        Mx[k][j] += K * p[j] * p[k];
+                        Mx[j][k] += K * p[j] * p[k];
+                        if (j != k)
+                        {
+                            Mx[k][j] += K * p[j] * p[k];
+                        }
                     }
                 }
-            }
 
-            // y-contribution; only need to do main diagonal and above;
-            K = (-1. / (4.*a));
-            for(j = 0; j < 3; j++)
-            {
-                for(k = j; k < 3; k++)
+                // y-contribution; only need to do main diagonal and above;
+                K = (-1. / (4.*a));
+                for(j = 0; j < 3; j++)
                 {
-                    My[j][k] +=K*q[j]*q[k];
-                    if (j != k)
+                    for(k = j; k < 3; k++)
                     {
-                        My[k][j] += K * q[j] * q[k];
+                        My[j][k] +=K*q[j]*q[k];
+                        if (j != k)
+                        {
+                            My[k][j] += K * q[j] * q[k];
+                        }
                     }
                 }
-            }
 
-            // xy-contribution;
-            K = (-1. / (4.*a));
-            for (j = 0; j < 3; j++)
-            {
-                for (k = j; k < 3; k++)
+                // xy-contribution;
+                K = (-1. / (4.*a));
+                for (j = 0; j < 3; j++)
                 {
-                    Mxy[j][k] += K*(p[j] * q[k] + p[k] * q[j]);
-                    if (j != k)
+                    for (k = j; k < 3; k++)
                     {
-                        Mxy[k][j] += K*(p[j] * q[k] + p[k] * q[j]);
+                        Mxy[j][k] += K*(p[j] * q[k] + p[k] * q[j]);
+                        if (j != k)
+                        {
+                            Mxy[k][j] += K*(p[j] * q[k] + p[k] * q[j]);
+                        }
                     }
                 }
-            }
 
-            // contributions to Me, be from derivative boundary conditions;
-            for(j = 0; j<3; j++)
-            {
-                if (El->e[j] >= 0)
+                // contributions to Me, be from derivative boundary conditions;
+                for(j = 0; j<3; j++)
                 {
-                    if (lineproplist[El->e[j]].BdryFormat==2)
+                    if (El->e[j] >= 0)
                     {
-                        // conversion factor is 10^(-4) (I think...)
-                        K = -0.0001*c*lineproplist[ El->e[j] ].c0.re*l[j]/6.;
-                        k = j+1;
-                        if(k==3) k = 0;
-                        Me[j][j]+=K*2.;
-                        Me[k][k]+=K*2.;
-                        Me[j][k]+=K;
-                        Me[k][j]+=K;
-
-                        K = (lineproplist[ El->e[j] ].c1.re*l[j]/2.)*0.0001;
-                        be[j]+=K;
-                        be[k]+=K;
+                        if (lineproplist[El->e[j]].BdryFormat==2)
+                        {
+                            // conversion factor is 10^(-4) (I think...)
+                            K = -0.0001*c*lineproplist[ El->e[j] ].c0.re*l[j]/6.;
+                            k = j+1;
+                            if(k==3) k = 0;
+                            Me[j][j]+=K*2.;
+                            Me[k][k]+=K*2.;
+                            Me[j][k]+=K;
+                            Me[k][j]+=K;
+
+                            K = (lineproplist[ El->e[j] ].c1.re*l[j]/2.)*0.0001;
+                            be[j]+=K;
+                            be[k]+=K;
+                        }
                     }
                 }
-            }
 
-            // contribution to be from current density in the block
-            for(j = 0; j<3; j++)
-            {
-                t = 0;
-                if ( labellist[El->lbl].InCircuit >= 0 )
+                // contribution to be from current density in the block
+                for(j = 0; j<3; j++)
                 {
-                    k = labellist[El->lbl].InCircuit;
-
-                    if(circproplist[k].Case==1)
+                    t = 0;
+                    if ( labellist[El->lbl].InCircuit >= 0 )
                     {
-                        t = circproplist[k].J.Re();
-                    }
+                        k = labellist[El->lbl].InCircuit;
 
-                    if(circproplist[k].Case==0)
-                    {
-                        t = -circproplist[k].dV.Re()*blockproplist[El->blk].Cduct;
-                    }
-                }
-
-                K = -(blockproplist[El->blk].J.re+t)*a/3.;
-
-                be[j]+=K;
+                        if(circproplist[k].Case==1)
+                        {
+                            t = circproplist[k].J.Re();
+                        }
 
-                // record avg current density in the block for use in incremental solutions
-                if (bIncremental==MS_LEGACY_FALSE) El->Jprev+=(blockproplist[El->blk].J.Re()+t)/3.;
-            }
+                        if(circproplist[k].Case==0)
+                        {
+                            t = -circproplist[k].dV.Re()*blockproplist[El->blk].Cduct;
+                        }
+                    }
 
-            // contribution to be from magnetization in the block;
-            t = labellist[El->lbl].MagDir;
-            // create the formatter object in case of a lua defined mag direction
-//                boost::format fmatter("x=%.17g\ny=%.17g\nr=x\nz=y\ntheta=%.17g\nR=%.17g\nreturn %s");
-            if (!labellist[El->lbl].MagDirFctn.empty()) // functional magnetization direction
-            {
+                    K = -(blockproplist[El->blk].J.re+t)*a/3.;
 
-                char magbuff[4096];
-                std::string str;
-                CComplex X;
-                int top1,top2,lua_error_code;
+                    be[j]+=K;
 
-                for (j = 0,X = 0; j<3; j++)
-                {
-                    X += (CComplex)(meshnode[n[j]].x + I * meshnode[n[j]].y);
+                    // record avg current density in the block for use in incremental solutions
+                    if (bIncremental==MS_LEGACY_FALSE) El->Jprev+=(blockproplist[El->blk].J.Re()+t)/3.;
                 }
-                X = X/units[LengthUnits]/3.;
-                // generate the string using boost::format
-//                    fmatter % (X.re) % (X.im) % (arg(X)*180/PI) % (abs(X)) % (labellist[El->lbl].MagDirFctn);
-                // get the created string
-//                    str = fmatter.str();
-                SNPRINTF(magbuff, sizeof magbuff, "x=%.17g\ny=%.17g\nr=x\nz=y\ntheta=%.17g\nR=%.17g\nreturn %s",
-                              (X.re) , (X.im) , (arg(X)*180/PI) , (abs(X)) , (labellist[El->lbl].MagDirFctn.c_str()));
-                str = magbuff;
-                lua_State * lua = theLua->getLuaState();
 
-                top1 = lua_gettop(lua);
+                // contribution to be from magnetization in the block;
+                t = labellist[El->lbl].MagDir;
+                // create the formatter object in case of a lua defined mag direction
+    //                boost::format fmatter("x=%.17g\ny=%.17g\nr=x\nz=y\ntheta=%.17g\nR=%.17g\nreturn %s");
+                if (!labellist[El->lbl].MagDirFctn.empty()) // functional magnetization direction
+                {
 
-                lua_error_code = theLua->doString(str, femm::LuaInstance::LuaStackMode::Unsafe);
+                    char magbuff[4096];
+                    std::string str;
+                    CComplex X;
+                    int top1,top2,lua_error_code;
 
-                if(lua_error_code != 0)
-                {
-                    if (lua_error_code==LUA_ERRRUN)
-                        WarnMessage("Lua run Error (LUA_ERRRUN) when evaluating magnetization direction function");
-                    if (lua_error_code==LUA_ERRMEM)
-                        WarnMessage("Lua memory Error (LUA_ERRMEM) when evaluating magnetization direction function");
-                    if (lua_error_code==LUA_ERRERR)
-                        WarnMessage("Lua user error error (LUA_ERRERR) when evaluating magnetization direction function");
-                    if (lua_error_code==LUA_ERRFILE)
-                        WarnMessage("Lua file error (LUA_ERRFILE) when evaluating magnetization direction function");
-
-                    SNPRINTF(magbuff, sizeof magbuff,
-                             "Lua error occurred when evaluating:\n\"%s\"",
-                             labellist[El->lbl].MagDirFctn.c_str());
-
-                    WarnMessage (magbuff);
-
-                    return -7;
-                }
+                    for (j = 0,X = 0; j<3; j++)
+                    {
+                        X += (CComplex)(meshnode[n[j]].x + I * meshnode[n[j]].y);
+                    }
+                    X = X/units[LengthUnits]/3.;
+                    // generate the string using boost::format
+    //                    fmatter % (X.re) % (X.im) % (arg(X)*180/PI) % (abs(X)) % (labellist[El->lbl].MagDirFctn);
+                    // get the created string
+    //                    str = fmatter.str();
+                    SNPRINTF(magbuff, sizeof magbuff, "x=%.17g\ny=%.17g\nr=x\nz=y\ntheta=%.17g\nR=%.17g\nreturn %s",
+                                  (X.re) , (X.im) , (arg(X)*180/PI) , (abs(X)) , (labellist[El->lbl].MagDirFctn.c_str()));
+                    str = magbuff;
+                    lua_State * lua = theLua->getLuaState();
 
-                top2 = lua_gettop(lua);
+                    top1 = lua_gettop(lua);
 
-                if (top2!=top1)
-                {
-                    str = lua_tostring(lua,-1);
+                    lua_error_code = theLua->doString(str, femm::LuaInstance::LuaStackMode::Unsafe);
 
-                    if (str.length()==0)
+                    if(lua_error_code != 0)
                     {
+                        if (lua_error_code==LUA_ERRRUN)
+                            WarnMessage("Lua run Error (LUA_ERRRUN) when evaluating magnetization direction function");
+                        if (lua_error_code==LUA_ERRMEM)
+                            WarnMessage("Lua memory Error (LUA_ERRMEM) when evaluating magnetization direction function");
+                        if (lua_error_code==LUA_ERRERR)
+                            WarnMessage("Lua user error error (LUA_ERRERR) when evaluating magnetization direction function");
+                        if (lua_error_code==LUA_ERRFILE)
+                            WarnMessage("Lua file error (LUA_ERRFILE) when evaluating magnetization direction function");
+
                         SNPRINTF(magbuff, sizeof magbuff,
-                                 "\"%s\" does not evaluate to a numerical value",
+                                 "Lua error occurred when evaluating:\n\"%s\"",
                                  labellist[El->lbl].MagDirFctn.c_str());
 
                         WarnMessage (magbuff);
 
                         return -7;
                     }
-                    else
+
+                    top2 = lua_gettop(lua);
+
+                    if (top2!=top1)
                     {
-                        t = Re(lua_tonumber(lua,-1));
-                    }
+                        str = lua_tostring(lua,-1);
 
-                    lua_pop(lua, 1);
-                }
+                        if (str.length()==0)
+                        {
+                            SNPRINTF(magbuff, sizeof magbuff,
+                                     "\"%s\" does not evaluate to a numerical value",
+                                     labellist[El->lbl].MagDirFctn.c_str());
 
-            }
-            for(j = 0; j<3; j++)
-            {
-                k = j+1;
-                if(k==3)
-                {
-                    k = 0;
-                }
-                // need to scale so that everything is in proper units...
-                // conversion is 0.0001
-                K = 0.0001*blockproplist[El->blk].H_c*(
-                        cos(t*PI/180.)*(meshnode[n[k]].x-meshnode[n[j]].x) +
-                        sin(t*PI/180.)*(meshnode[n[k]].y-meshnode[n[j]].y) )/2.;
-                be[j]+=K;
-                be[k]+=K;
-            }
+                            WarnMessage (magbuff);
 
-//////// Nonlinear Part
+                            return -7;
+                        }
+                        else
+                        {
+                            t = Re(lua_tonumber(lua,-1));
+                        }
 
-            // update permeability for the element;
-            if (Iter==0)
-            {
-                k = meshele[i].blk;
+                        lua_pop(lua, 1);
+                    }
 
-                if (blockproplist[k].LamType==0)
-                {
-                    t = blockproplist[k].LamFill;
-                    meshele[i].mu1 = blockproplist[k].mu_x*t + (1.-t);
-                    meshele[i].mu2 = blockproplist[k].mu_y*t + (1.-t);
-                }
-                if (blockproplist[k].LamType==1)
-                {
-                    t = blockproplist[k].LamFill;
-                    mu = blockproplist[k].mu_x;
-                    meshele[i].mu1 = mu*t + (1.-t);
-                    meshele[i].mu2 = mu/(t + mu*(1.-t));
-                }
-                if (blockproplist[k].LamType==2)
-                {
-                    t = blockproplist[k].LamFill;
-                    mu = blockproplist[k].mu_y;
-                    meshele[i].mu2 = mu*t + (1.-t);
-                    meshele[i].mu1 = mu/(t + mu*(1.-t));
                 }
-                if (blockproplist[k].LamType>2)
+                El->magdir = t;
+                for(j = 0; j<3; j++)
                 {
-                    meshele[i].mu1 = 1;
-                    meshele[i].mu2 = 1;
+                    k = j+1;
+                    if(k==3)
+                    {
+                        k = 0;
+                    }
+                    // need to scale so that everything is in proper units...
+                    // conversion is 0.0001
+                    K = 0.0001*blockproplist[El->blk].H_c*(
+                            cos(t*PI/180.)*(meshnode[n[k]].x-meshnode[n[j]].x) +
+                            sin(t*PI/180.)*(meshnode[n[k]].y-meshnode[n[j]].y) )/2.;
+                    be[j]+=K;
+                    be[k]+=K;
                 }
 
-                if (blockproplist[k].BHpoints != 0)
+    //////// Nonlinear Part
+
+                // update permeability for the element;
+                if (Iter==0 && !warmNonlinear)
                 {
-                    if (bIncremental == MS_LEGACY_FALSE)
+                    k = meshele[i].blk;
+
+                    if (blockproplist[k].LamType==0)
+                    {
+                        t = blockproplist[k].LamFill;
+                        meshele[i].mu1 = blockproplist[k].mu_x*t + (1.-t);
+                        meshele[i].mu2 = blockproplist[k].mu_y*t + (1.-t);
+                    }
+                    if (blockproplist[k].LamType==1)
+                    {
+                        t = blockproplist[k].LamFill;
+                        mu = blockproplist[k].mu_x;
+                        meshele[i].mu1 = mu*t + (1.-t);
+                        meshele[i].mu2 = mu/(t + mu*(1.-t));
+                    }
+                    if (blockproplist[k].LamType==2)
                     {
-                        // There's no previous solution.  This is a standard nonlinear problem
-                        LinearFlag = false;
+                        t = blockproplist[k].LamFill;
+                        mu = blockproplist[k].mu_y;
+                        meshele[i].mu2 = mu*t + (1.-t);
+                        meshele[i].mu1 = mu/(t + mu*(1.-t));
+                    }
+                    if (blockproplist[k].LamType>2)
+                    {
+                        meshele[i].mu1 = 1;
+                        meshele[i].mu2 = 1;
                     }
-                    else {
-                        double B1p, B2p;
 
-                        // too lazy to consistently code incremental/frozen formulation for on-edge lams.
-                        // detect this condition, throw an error, and exit.
-                        if (blockproplist[k].LamType > 0)
+                    if (blockproplist[k].BHpoints != 0)
+                    {
+                        if (bIncremental == MS_LEGACY_FALSE)
                         {
-                            PrintMessage("On-edge Lam Types not yet supported in\nincremental/frozen permeability problems");
-                            exit(0);
+                            // There's no previous solution.  This is a standard nonlinear problem
+                            LinearFlag = false;
                         }
+                        else {
+                            double B1p, B2p;
 
-                        //	Get B from previous solution
-                        getPrev2DB(i, B1p, B2p);
-                        B = sqrt(B1p*B1p + B2p*B2p);
+                            // too lazy to consistently code incremental/frozen formulation for on-edge lams.
+                            // detect this condition, throw an error, and exit.
+                            if (blockproplist[k].LamType > 0)
+                            {
+                                PrintMessage("On-edge Lam Types not yet supported in\nincremental/frozen permeability problems");
+                                exit(0);
+                            }
 
-                        // look up incremental permeability and assign it to the element;
-                        blockproplist[k].IncrementalPermeability(B, muinc, murel);
+                            //	Get B from previous solution
+                            getPrev2DB(i, B1p, B2p);
+                            B = sqrt(B1p*B1p + B2p*B2p);
 
-                        if (B == 0)
-                        {
-                            meshele[i].mu1 = muinc;
-                            meshele[i].mu2 = muinc;
-                            meshele[i].v12 = 0;
-                        }
-                        else {
-                            if (bIncremental == 1)
+                            // look up incremental permeability and assign it to the element;
+                            blockproplist[k].IncrementalPermeability(B, muinc, murel);
+
+                            if (B == 0)
                             {
-                                // Need to actually compute B1 and B2 to build incremental permeability tensor
-                                meshele[i].mu1 = B*B*muinc*murel / (B1p*B1p*murel + B2p*B2p*muinc);
-                                meshele[i].mu2 = B*B*muinc*murel / (B1p*B1p*muinc + B2p*B2p*murel);
-                                meshele[i].v12 = -B1p*B2p*(murel - muinc) / (B*B*murel*muinc);
+                                meshele[i].mu1 = muinc;
+                                meshele[i].mu2 = muinc;
+                                meshele[i].v12 = 0;
                             }
                             else {
-                                // Define "frozen permeability"
-                                meshele[i].mu1 = murel;
-                                meshele[i].mu2 = murel;
-                                meshele[i].v12 = 0;
+                                if (bIncremental == 1)
+                                {
+                                    // Need to actually compute B1 and B2 to build incremental permeability tensor
+                                    meshele[i].mu1 = B*B*muinc*murel / (B1p*B1p*murel + B2p*B2p*muinc);
+                                    meshele[i].mu2 = B*B*muinc*murel / (B1p*B1p*muinc + B2p*B2p*murel);
+                                    meshele[i].v12 = -B1p*B2p*(murel - muinc) / (B*B*murel*muinc);
+                                }
+                                else {
+                                    // Define "frozen permeability"
+                                    meshele[i].mu1 = murel;
+                                    meshele[i].mu2 = murel;
+                                    meshele[i].v12 = 0;
+                                }
                             }
                         }
                     }
-                }
-
-            }
-            else
-            {
-                k = meshele[i].blk;
 
-                if ((blockproplist[k].LamType==0) &&
-                        (meshele[i].mu1==meshele[i].mu2)
-                        &&(blockproplist[k].BHpoints>0))
+                }
+                else
                 {
-                    for(j = 0,B1 = 0.,B2 = 0.; j<3; j++)
-                    {
-                        B1+=L.V[n[j]]*q[j];
-                        B2+=L.V[n[j]]*p[j];
-                    }
-                    B = c*sqrt(B1*B1+B2*B2)/(0.02*a);
-                    // correction for lengths in cm of 1/0.02
-
-                    // find out new mu from saturation curve;
-                    blockproplist[k].GetBHProps(B,mu,dv);
-                    mu = 1./(muo*mu);
-                    meshele[i].mu1 = mu;
-                    meshele[i].mu2 = mu;
-                    for(j = 0; j<3; j++)
-                    {
-                        for(w = 0,v[j] = 0; w<3; w++)
-                            v[j]+=(Mx[j][w]+My[j][w])*L.V[n[w]];
-                    }
-                    K = -200.*c*c*c*dv/a;
-                    for(j = 0; j<3; j++)
+                    k = meshele[i].blk;
+
+                    if ((blockproplist[k].LamType==0) &&
+                            (meshele[i].mu1==meshele[i].mu2)
+                            &&(blockproplist[k].BHpoints>0))
                     {
-                        for(w = 0; w<3; w++)
+                        for(j = 0,B1 = 0.,B2 = 0.; j<3; j++)
                         {
-                            Mn[j][w] = K*v[j]*v[w];
+                            B1+=L.V[n[j]]*q[j];
+                            B2+=L.V[n[j]]*p[j];
+                        }
+                        B = c*sqrt(B1*B1+B2*B2)/(0.02*a);
+                        // correction for lengths in cm of 1/0.02
+
+                        // find out new mu from saturation curve;
+                        blockproplist[k].GetBHProps(B,mu,dv);
+                        mu = 1./(muo*mu);
+                        meshele[i].mu1 = mu;
+                        meshele[i].mu2 = mu;
+                        for(j = 0; j<3; j++)
+                        {
+                            for(w = 0,v[j] = 0; w<3; w++)
+                                v[j]+=(Mx[j][w]+My[j][w])*L.V[n[w]];
+                        }
+                        K = -200.*c*c*c*dv/a;
+                        for(j = 0; j<3; j++)
+                        {
+                            for(w = 0; w<3; w++)
+                            {
+                                Mn[j][w] = K*v[j]*v[w];
+                            }
                         }
                     }
-                }
-
-                if ((blockproplist[k].LamType==1) && (blockproplist[k].BHpoints>0))
-                {
-                    t = blockproplist[k].LamFill;
 
-                    for(j = 0,B1 = 0.,B2 = 0.; j<3; j++)
+                    if ((blockproplist[k].LamType==1) && (blockproplist[k].BHpoints>0))
                     {
-                        B1+=L.V[n[j]]*q[j];
-                        B2+=L.V[n[j]]*p[j]/t;
-                    }
+                        t = blockproplist[k].LamFill;
 
-                    B = c*sqrt(B1*B1+B2*B2)/(0.02*a);
+                        for(j = 0,B1 = 0.,B2 = 0.; j<3; j++)
+                        {
+                            B1+=L.V[n[j]]*q[j];
+                            B2+=L.V[n[j]]*p[j]/t;
+                        }
 
-                    blockproplist[k].GetBHProps(B,mu,dv);
+                        B = c*sqrt(B1*B1+B2*B2)/(0.02*a);
 
-                    mu = 1./(muo*mu);
+                        blockproplist[k].GetBHProps(B,mu,dv);
 
-                    meshele[i].mu1 = mu*t;
+                        mu = 1./(muo*mu);
 
-                    meshele[i].mu2 = mu/(t+mu*(1.-t));
+                        meshele[i].mu1 = mu*t;
 
-                    for(j = 0; j<3; j++)
-                    {
-                        for(w = 0,v[j] = 0,u[j] = 0; w<3; w++)
+                        meshele[i].mu2 = mu/(t+mu*(1.-t));
+
+                        for(j = 0; j<3; j++)
                         {
-                            v[j]+=(My[j][w]/t+Mx[j][w])*L.V[n[w]];
-                            u[j]+=(My[j][w]/t + t*Mx[j][w])*L.V[n[w]];
+                            for(w = 0,v[j] = 0,u[j] = 0; w<3; w++)
+                            {
+                                v[j]+=(My[j][w]/t+Mx[j][w])*L.V[n[w]];
+                                u[j]+=(My[j][w]/t + t*Mx[j][w])*L.V[n[w]];
+                            }
                         }
-                    }
 
-                    K = -100.*c*c*c*dv/(a);
+                        K = -100.*c*c*c*dv/(a);
 
-                    for(j = 0; j<3; j++)
-                    {
-                        for(w = 0; w<3; w++)
+                        for(j = 0; j<3; j++)
                         {
-                            Mn[j][w] = K*(v[j]*u[w]+v[w]*u[j]);
+                            for(w = 0; w<3; w++)
+                            {
+                                Mn[j][w] = K*(v[j]*u[w]+v[w]*u[j]);
+                            }
                         }
                     }
-                }
-                if ((blockproplist[k].LamType==2) && (blockproplist[k].BHpoints>0))
-                {
-                    t = blockproplist[k].LamFill;
-
-                    for(j = 0,B1 = 0.,B2 = 0.; j<3; j++)
+                    if ((blockproplist[k].LamType==2) && (blockproplist[k].BHpoints>0))
                     {
-                        B1+=(L.V[n[j]]*q[j])/t;
-                        B2+=L.V[n[j]]*p[j];
-                    }
+                        t = blockproplist[k].LamFill;
 
-                    B = c*sqrt(B1*B1+B2*B2)/(0.02*a);
+                        for(j = 0,B1 = 0.,B2 = 0.; j<3; j++)
+                        {
+                            B1+=(L.V[n[j]]*q[j])/t;
+                            B2+=L.V[n[j]]*p[j];
+                        }
 
-                    blockproplist[k].GetBHProps(B,mu,dv);
+                        B = c*sqrt(B1*B1+B2*B2)/(0.02*a);
 
-                    mu = 1./(muo*mu);
+                        blockproplist[k].GetBHProps(B,mu,dv);
 
-                    meshele[i].mu2 = mu*t;
+                        mu = 1./(muo*mu);
 
-                    meshele[i].mu1 = mu/(t+mu*(1.-t));
+                        meshele[i].mu2 = mu*t;
 
-                    for(j = 0; j<3; j++)
-                    {
-                        for(w = 0,v[j] = 0,u[j] = 0; w<3; w++)
+                        meshele[i].mu1 = mu/(t+mu*(1.-t));
+
+                        for(j = 0; j<3; j++)
                         {
-                            v[j]+=(Mx[j][w]/t + My[j][w])*L.V[n[w]];
-                            u[j]+=(Mx[j][w]/t + t*My[j][w])*L.V[n[w]];
+                            for(w = 0,v[j] = 0,u[j] = 0; w<3; w++)
+                            {
+                                v[j]+=(Mx[j][w]/t + My[j][w])*L.V[n[w]];
+                                u[j]+=(Mx[j][w]/t + t*My[j][w])*L.V[n[w]];
+                            }
                         }
-                    }
 
-                    K = -100.*c*c*c*dv/(a);
+                        K = -100.*c*c*c*dv/(a);
 
-                    for(j = 0; j<3; j++)
-                    {
-                        for(w = 0; w<3; w++)
+                        for(j = 0; j<3; j++)
                         {
-                            Mn[j][w] = K*(v[j]*u[w]+v[w]*u[j]);
+                            for(w = 0; w<3; w++)
+                            {
+                                Mn[j][w] = K*(v[j]*u[w]+v[w]*u[j]);
+                            }
                         }
                     }
                 }
-            }
 
-            // combine block matrices into global matrices;
-            for (j = 0; j<3; j++)
-                for (k = 0; k<3; k++)
+                // combine block matrices into global matrices;
+                for (j = 0; j<3; j++)
+                    for (k = 0; k<3; k++)
+                    {
+                        Me[j][k]+= (Mx[j][k]/Re(El->mu2) + My[j][k]/Re(El->mu1) + Mxy[j][k] * Re(El->v12) + Mn[j][k]);
+                        be[j]+=Mn[j][k]*L.V[n[k]];
+                    }
+
+                for (j = 0; j<3; j++)
                 {
-                    Me[j][k]+= (Mx[j][k]/Re(El->mu2) + My[j][k]/Re(El->mu1) + Mxy[j][k] * Re(El->v12) + Mn[j][k]);
-                    be[j]+=Mn[j][k]*L.V[n[k]];
+                    for (k = j; k<3; k++)
+                    {
+                        L.AddTo(-Me[j][k],n[j],n[k]);
+                    }
+
+                    L.b[n[j]]-=be[j];
                 }
+            }
 
-            for (j = 0; j<3; j++)
+            // add in contribution from point currents;
+            for(i = 0; i<NumNodes; i++)
             {
-                for (k = j; k<3; k++)
+                if(meshnode[i].BoundaryMarker>=0)
                 {
-                    L.AddTo(-Me[j][k],n[j],n[k]);
+                    L.b[i]+=(0.01*nodeproplist[meshnode[i].BoundaryMarker].J.re);
                 }
+            }
 
-                L.b[n[j]]-=be[j];
+            // save the element part of a linear system for the following steps of the sweep
+            if (sweep.active && LinearFlag)
+            {
+                L.SaveValues(sweep.elementValues);
+                sweep.haveElementValues = true;
             }
         }
 
-        // add in contribution from point currents;
-        for(i = 0; i<NumNodes; i++)
+        if (sweep.active)
         {
-            if(meshnode[i].BoundaryMarker>=0)
-            {
-                L.b[i]+=(0.01*nodeproplist[meshnode[i].BoundaryMarker].J.re);
-            }
+            AddAirGapElements(L);
         }
 
         // apply fixed boundary conditions at points;
@@ -945,7 +823,7 @@ int FSolver::Static2D(CBigLinProb &L)
             V_old[j]=L.V[j];
         }
 
-        if (L.PCGSolve(Iter)==false)
+        if (L.PCGSolve(warmStart ? 1 : Iter)==false)
         {
             return false;
         }
@@ -1032,6 +910,302 @@ int FSolver::Static2D(CBigLinProb &L)
     return true;
 }
 
+void FSolver::AddAirGapElements(CBigLinProb &L)
+{
+    int i,k;
+    double K,Ki;
+
+    for(i=0;i<NumAirGapElems;i++)
+    {
+        double MG[10][10];
+        double ci,co;
+        int nn[10];
+        double ww[10];
+        double dt;
+
+        // K = dr/(R*dtta)
+        dt=(PI/180.)*(agelist[i].totalArcLength/agelist[i].totalArcElements);
+        K=2.*(agelist[i].ro-agelist[i].ri)/
+           (dt*(agelist[i].ro+agelist[i].ri));
+        Ki=1./K;
+        ci=agelist[i].InnerShift;
+        co=agelist[i].OuterShift;
+
+        if (ci>co)
+        {
+            ci=ci-co;
+            co=0;
+        }
+        else{
+            ci=1-co+ci;
+            co=1;
+        }
+
+        // build the element matrix for each quad element in the annulus (same for each element)
+        // matrix for quad element derived from serendipity element
+        MG[0][0] = (5*Power (-1 + ci,2)*Power (ci,4)*(K + Ki))/48.;
+        MG[0][1] = -((-1 + ci)*Power (ci,3)*(5*(-1 + ci*(-5 + 4*ci))*K + (-5 + ci*(-19 + 14*ci))*Ki))/48.;
+        MG[0][2] = ((-1 + ci)*Power (ci,2)*(5*(2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*K + (10 + ci*(1 + 3*ci*(-7 + 4*ci)))*Ki))/48.;
+        MG[0][3] = -(Power (-1 + ci,2)*Power (ci,2)*(5*(-2 + ci*(-3 + 4*ci))*K + (2 + ci*(-3 + 2*ci))*Ki))/48.;
+        MG[0][4] = (Power (-1 + ci,3)*Power (ci,3)*(5*K - Ki))/48.;
+        MG[0][5] = ((-1 + ci)*Power (ci,2)*(-1 + co)*Power (co,2)*(K - 5*Ki))/48.;
+        MG[0][6] = -((-1 + ci)*Power (ci,2)*co*((-1 + co*(-5 + 4*co))*K + (5 + (19 - 14*co)*co)*Ki))/48.;
+        MG[0][7] = ((-1 + ci)*Power (ci,2)*((2 + co*(-1 - 9*co + 6*Power (co,2)))*K - (10 + co*(1 + 3*co*(-7 + 4*co)))*Ki))/48.;
+        MG[0][8] = -((-1 + ci)*Power (ci,2)*(-1 + co)*((-2 + co*(-3 + 4*co))*K + (-2 + (3 - 2*co)*co)*Ki))/48.;
+        MG[0][9] = ((-1 + ci)*Power (ci,2)*Power (-1 + co,2)*co*(K + Ki))/48.;
+        MG[1][1] = (Power (ci,2)*(5*Power (1 + (5 - 4*ci)*ci,2)*K + (5 + ci*(38 + ci*(49 + 4*ci*(-29 + 11*ci))))*Ki))/48.;
+        MG[1][2] = (-5*ci*(-1 + 2*ci)*(-2 + 3*(-1 + ci)*ci)*(-1 + ci*(-5 + 4*ci))*K + ci*(10 + ci*(39 - ci*(50 + ci*(85 + 6*ci*(-23 + 8*ci)))))*Ki)/48.;
+        MG[1][3] = ((-1 + ci)*ci*(5*(2 + ci*(13 + ci*(3 + 16*(-2 + ci)*ci)))*K + (-2 + 5*ci*(1 + ci*(3 + 4*(-2 + ci)*ci)))*Ki))/48.;
+        MG[1][4] = -(Power (-1 + ci,2)*Power (ci,2)*(5*(-1 + ci*(-5 + 4*ci))*K + Ki + ci*(-1 + 2*ci)*Ki))/48.;
+        MG[1][5] = -(ci*(-1 + co)*Power (co,2)*((-1 + ci*(-5 + 4*ci))*K + (5 + (19 - 14*ci)*ci)*Ki))/48.;
+        MG[1][6] = (ci*co*((-1 + ci*(-5 + 4*ci))*(-1 + co*(-5 + 4*co))*K + (-5 + ci*(-19 + 14*ci) - 19*co + ci*(-77 + 58*ci)*co + 2*(7 + (29 - 22*ci)*ci)*Power (co,2))*Ki))/48.;
+        MG[1][7] = (-(ci*(-1 + ci*(-5 + 4*ci))*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K) + ci*(-10 + co*(-1 + 3*(7 - 4*co)*co) + ci*(-38 + co + 99*Power (co,2) - 60*Power (co,3)) + Power (ci,2)*(28 + 2*co*(-1 + 3*co*(-13 + 8*co))))*Ki)/48.;
+        MG[1][8] = (ci*(-1 + co)*((-1 + ci*(-5 + 4*ci))*(-2 + co*(-3 + 4*co))*K + (2 + co*(-3 + 2*co) + Power (ci,2)*(4 + 2*(9 - 10*co)*co) + ci*(-2 + co*(-21 + 22*co)))*Ki))/48.;
+        MG[1][9] = -(ci*Power (-1 + co,2)*co*((-1 + ci*(-5 + 4*ci))*K + (-1 + ci - 2*Power (ci,2))*Ki))/48.;
+        MG[2][2] = (5*Power (-2 + ci + 9*Power (ci,2) - 6*Power (ci,3),2)*K + (20 + (-1 + ci)*ci*(-4 + 3*(-1 + ci)*ci*(-25 + 24*(-1 + ci)*ci)))*Ki)/48.;
+        MG[2][3] = (-5*(4 + Power (ci,2)*(-33 + ci*(18 + ci*(65 + 6*ci*(-13 + 4*ci)))))*K + (4 + Power (ci,2)*(39 - ci*(30 + ci*(115 + 6*ci*(-25 + 8*ci)))))*Ki)/48.;
+        MG[2][4] = (Power (-1 + ci,2)*ci*(5*(2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*K + (-2 + ci*(-5 + 3*ci*(-5 + 4*ci)))*Ki))/48.;
+        MG[2][5] = ((-1 + co)*Power (co,2)*((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*K - (10 + ci*(1 + 3*ci*(-7 + 4*ci)))*Ki))/48.;
+        MG[2][6] = (-((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*co*(-1 + co*(-5 + 4*co))*K) + co*(-10 - 38*co + 28*Power (co,2) + Power (ci,2)*(21 + 99*co - 78*Power (co,2)) + ci*(-1 + co - 2*Power (co,2)) + 12*Power (ci,3)*(-1 + co*(-5 + 4*co)))*Ki)/48.;
+        MG[2][7] = ((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K - (2*(10 + co) + 6*Power (co,2)*(-7 + 4*co) + 3*Power (ci,2)*(-14 + co*(5 + (55 - 36*co)*co)) + ci*(2 + co*(5 + 3*(5 - 4*co)*co)) + 12*Power (ci,3)*(2 + co*(-1 - 9*co + 6*Power (co,2))))*Ki)/48.;
+        MG[2][8] = (-((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*(2 + co - 7*Power (co,2) + 4*Power (co,3))*K) + (-1 + co)*(4 + 2*ci*(5 + 3*(5 - 4*ci)*ci) + 3*(-2 + ci*(3 + (17 - 12*ci)*ci))*co + 2*(2 + ci*(-7 + 3*ci*(-11 + 8*ci)))*Power (co,2))*Ki)/48.;
+        MG[2][9] = (Power (-1 + co,2)*co*((2 + ci*(-1 - 9*ci + 6*Power (ci,2)))*K + (2 + ci*(5 + 3*(5 - 4*ci)*ci))*Ki))/48.;
+        MG[3][3] = (Power (-1 + ci,2)*(5*Power (2 + (3 - 4*ci)*ci,2)*K + (20 + ci*(36 + ci*(-35 - 60*ci + 44*Power (ci,2))))*Ki))/48.;
+        MG[3][4] = -(Power (-1 + ci,3)*ci*(5*(-2 + ci*(-3 + 4*ci))*K + (-10 + ci*(-9 + 14*ci))*Ki))/48.;
+        MG[3][5] = -((-1 + ci)*(-1 + co)*Power (co,2)*((-2 + ci*(-3 + 4*ci))*K + (-2 + (3 - 2*ci)*ci)*Ki))/48.;
+        MG[3][6] = ((-1 + ci)*co*((-2 + ci*(-3 + 4*ci))*(-1 + co*(-5 + 4*co))*K + (2 + ci*(-3 + 2*ci) - 2*co + ci*(-21 + 22*ci)*co + 2*(2 + (9 - 10*ci)*ci)*Power (co,2))*Ki))/48.;
+        MG[3][7] = (-((2 + ci - 7*Power (ci,2) + 4*Power (ci,3))*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K) + (-1 + ci)*(4 + 2*co*(5 + 3*(5 - 4*co)*co) + ci*(-6 + 3*co*(3 + (17 - 12*co)*co)) + 2*Power (ci,2)*(2 + co*(-7 + 3*co*(-11 + 8*co))))*Ki)/48.;
+        MG[3][8] = ((-1 + ci)*(-1 + co)*((-2 + ci*(-3 + 4*ci))*(-2 + co*(-3 + 4*co))*K + (-20 + 3*ci*(1 + 2*co)*(-6 + 5*co) + 2*co*(-9 + 14*co) + Power (ci,2)*(28 + 30*co - 44*Power (co,2)))*Ki))/48.;
+        MG[3][9] = -((-1 + ci)*Power (-1 + co,2)*co*((-2 + ci*(-3 + 4*ci))*K + (10 + (9 - 14*ci)*ci)*Ki))/48.;
+        MG[4][4] = (5*Power (-1 + ci,4)*Power (ci,2)*(K + Ki))/48.;
+        MG[4][5] = (Power (-1 + ci,2)*ci*(-1 + co)*Power (co,2)*(K + Ki))/48.;
+        MG[4][6] = -(Power (-1 + ci,2)*ci*co*((-1 + co*(-5 + 4*co))*K + (-1 + co - 2*Power (co,2))*Ki))/48.;
+        MG[4][7] = (Power (-1 + ci,2)*ci*((2 + co*(-1 - 9*co + 6*Power (co,2)))*K + (2 + co*(5 + 3*(5 - 4*co)*co))*Ki))/48.;
+        MG[4][8] = -(Power (-1 + ci,2)*ci*(-1 + co)*((-2 + co*(-3 + 4*co))*K + (10 + (9 - 14*co)*co)*Ki))/48.;
+        MG[4][9] = (Power (-1 + ci,2)*ci*Power (-1 + co,2)*co*(K - 5*Ki))/48.;
+        MG[5][5] = (5*Power (-1 + co,2)*Power (co,4)*(K + Ki))/48.;
+        MG[5][6] = -((-1 + co)*Power (co,3)*(5*(-1 + co*(-5 + 4*co))*K + (-5 + co*(-19 + 14*co))*Ki))/48.;
+        MG[5][7] = ((-1 + co)*Power (co,2)*(5*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K + (10 + co*(1 + 3*co*(-7 + 4*co)))*Ki))/48.;
+        MG[5][8] = -(Power (-1 + co,2)*Power (co,2)*(5*(-2 + co*(-3 + 4*co))*K + (2 + co*(-3 + 2*co))*Ki))/48.;
+        MG[5][9] = (Power (-1 + co,3)*Power (co,3)*(5*K - Ki))/48.;
+        MG[6][6] = (Power (co,2)*(5*Power (1 + (5 - 4*co)*co,2)*K + (5 + co*(38 + co*(49 + 4*co*(-29 + 11*co))))*Ki))/48.;
+        MG[6][7] = (-5*co*(-1 + 2*co)*(-2 + 3*(-1 + co)*co)*(-1 + co*(-5 + 4*co))*K + co*(10 + co*(39 - co*(50 + co*(85 + 6*co*(-23 + 8*co)))))*Ki)/48.;
+        MG[6][8] = ((-1 + co)*co*(5*(2 + co*(13 + co*(3 + 16*(-2 + co)*co)))*K + (-2 + 5*co*(1 + co*(3 + 4*(-2 + co)*co)))*Ki))/48.;
+        MG[6][9] = -(Power (-1 + co,2)*Power (co,2)*(5*(-1 + co*(-5 + 4*co))*K + Ki + co*(-1 + 2*co)*Ki))/48.;
+        MG[7][7] = (5*Power (-2 + co + 9*Power (co,2) - 6*Power (co,3),2)*K + (20 + (-1 + co)*co*(-4 + 3*(-1 + co)*co*(-25 + 24*(-1 + co)*co)))*Ki)/48.;
+        MG[7][8] = (-5*(4 + Power (co,2)*(-33 + co*(18 + co*(65 + 6*co*(-13 + 4*co)))))*K + (4 + Power (co,2)*(39 - co*(30 + co*(115 + 6*co*(-25 + 8*co)))))*Ki)/48.;
+        MG[7][9] = (Power (-1 + co,2)*co*(5*(2 + co*(-1 - 9*co + 6*Power (co,2)))*K + (-2 + co*(-5 + 3*co*(-5 + 4*co)))*Ki))/48.;
+        MG[8][8] = (Power (-1 + co,2)*(5*Power (2 + (3 - 4*co)*co,2)*K + (20 + co*(36 + co*(-35 - 60*co + 44*Power (co,2))))*Ki))/48.;
+        MG[8][9] = -(Power (-1 + co,3)*co*(5*(-2 + co*(-3 + 4*co))*K + (-10 + co*(-9 + 14*co))*Ki))/48.;
+        MG[9][9] = (5*Power (-1 + co,4)*Power (co,2)*(K + Ki))/48.;
+
+        // Add each annulus element to the global stiffness matrix
+        for(k=0;k<agelist[i].totalArcElements;k++)
+        {
+
+            // inner nodes
+            if ((k-1)<0){
+                nn[0]=agelist[i].quadNode[agelist[i].totalArcElements-1].n0;
+                ww[0]=agelist[i].quadNode[agelist[i].totalArcElements-1].w0;
+            }
+            else{
+                nn[0]=agelist[i].quadNode[k-1].n0;
+                ww[0]=agelist[i].quadNode[k-1].w0;
+            }
+
+            nn[1]=agelist[i].quadNode[k].n0;
+            nn[2]=agelist[i].quadNode[k].n1;
+            nn[3]=agelist[i].quadNode[k+1].n1;
+            ww[1]=agelist[i].quadNode[k].w0;
+            ww[2]=agelist[i].quadNode[k].w1;
+            ww[3]=agelist[i].quadNode[k+1].w1;
+
+            if((k+2)>agelist[i].totalArcElements){
+                nn[4]=agelist[i].quadNode[1].n1;
+                ww[4]=agelist[i].quadNode[1].w1;
+            }
+            else{
+                nn[4]=agelist[i].quadNode[k+2].n1;
+                ww[4]=agelist[i].quadNode[k+2].w1;
+            }
+
+            // outer nodes
+            if ((k-1)<0){
+                nn[5]=agelist[i].quadNode[agelist[i].totalArcElements-1].n2;
+                ww[5]=agelist[i].quadNode[agelist[i].totalArcElements-1].w2;
+            }
+            else{
+                nn[5]=agelist[i].quadNode[k-1].n2;
+                ww[5]=agelist[i].quadNode[k-1].w2;
+            }
+
+            nn[6]=agelist[i].quadNode[k].n2;
+            nn[7]=agelist[i].quadNode[k].n3;
+            nn[8]=agelist[i].quadNode[k+1].n3;
+            ww[6]=agelist[i].quadNode[k].w2;
+            ww[7]=agelist[i].quadNode[k].w3;
+            ww[8]=agelist[i].quadNode[k+1].w3;
+
+            if((k+2)>agelist[i].totalArcElements){
+                nn[9]=agelist[i].quadNode[1].n3;
+                ww[9]=agelist[i].quadNode[1].w3;
+            }
+            else{
+                nn[9]=agelist[i].quadNode[k+2].n3;
+                ww[9]=agelist[i].quadNode[k+2].w3;
+            }
+
+            // fix antiperiodic weights...
+            if ((k==0) && (agelist[i].BdryFormat==1))
+            {
+                ww[0]=-ww[0];
+                ww[5]=-ww[5];
+            }
+            if (((k+1)==agelist[i].totalArcElements) && (agelist[i].BdryFormat==1))
+            {
+                ww[4]=-ww[4];
+                ww[9]=-ww[9];
+            }
+
+            // scale by weight to get periodic/antiperiodic right and tack into mesh
+            for(int ii=0;ii<10;ii++)
+                for(int jj=ii;jj<10;jj++)
+                    L.AddTo(MG[ii][jj]*ww[ii]*ww[jj],nn[ii],nn[jj]);
+        }
+
+    }
+}
+
+void FSolver::estimateStatic2DError(const double *A)
+{
+    int i,j,k,m;
+    const double lengthScale = 100*femm::LengthConvMeters[LengthUnits]; // cm per problem unit
+
+    // element-wise field intensity, permeability and current density:
+    std::vector<double> Hx(NumEls), Hy(NumEls), mu(NumEls), err(NumEls);
+    double energy = 0;
+    for(i=0; i<NumEls; i++)
+    {
+        const femmsolver::CMElement &El = meshele[i];
+        double p[3],q[3];
+        for(j=0; j<3; j++)
+        {
+            k = (j+1)%3;
+            m = (j+2)%3;
+            p[j] = meshnode[El.p[k]].y - meshnode[El.p[m]].y;
+            q[j] = meshnode[El.p[m]].x - meshnode[El.p[k]].x;
+        }
+        // area in cm^2:
+        const double a = (p[0]*q[1] - p[1]*q[0]) / 2.;
+        double B1=0, B2=0;
+        for(j=0; j<3; j++)
+        {
+            B1 += A[El.p[j]]*q[j];
+            B2 -= A[El.p[j]]*p[j];
+        }
+        // correction for lengths in cm of 1/0.02
+        B1 /= 0.02*a;
+        B2 /= 0.02*a;
+
+        const femm::CMSolverMaterialProp &prop = blockproplist[El.blk];
+        const double mu1 = muo*El.mu1.re;
+        const double mu2 = muo*El.mu2.re;
+        Hx[i] = B1/mu1 - prop.H_c*cos(El.magdir*PI/180.);
+        Hy[i] = B2/mu2 - prop.H_c*sin(El.magdir*PI/180.);
+        mu[i] = (mu1+mu2)/2.;
+        energy += a*1.e-4 * (B1*B1/mu1 + B2*B2/mu2);
+
+        // the residual within the element is the current density:
+        double J = prop.J.re;
+        if (labellist[El.lbl].InCircuit >= 0)
+        {
+            const femm::CMCircuit &circ = circproplist[labellist[El.lbl].InCircuit];
+            if (circ.Case==1)
+                J += circ.J.re;
+            else
+                J -= circ.dV.re*prop.Cduct;
+        }
+        double h = 0;
+        for(j=0; j<3; j++)
+            h = std::max(h, p[j]*p[j] + q[j]*q[j]);
+        err[i] = h*1.e-4 * a*1.e-4 * (J*J*1.e12) * mu[i];
+    }
+
+    // add the jumps of the tangential field intensity across the interior edges:
+    std::vector<int> first(NumNodes+1, 0);
+    std::vector<int> elementsOfNode(3*NumEls);
+    for(i=0; i<NumEls; i++)
+        for(j=0; j<3; j++)
+            first[meshele[i].p[j]+1]++;
+    for(i=0; i<NumNodes; i++)
+        first[i+1] += first[i];
+    {
+        std::vector<int> next(first.begin(), first.end()-1);
+        for(i=0; i<NumEls; i++)
+            for(j=0; j<3; j++)
+                elementsOfNode[next[meshele[i].p[j]]++] = i;
+    }
+    // find the neighbour across the edge opposite corner j:
+    auto neighbour = [&](int i, int j) {
+        const int n0 = meshele[i].p[(j+1)%3];
+        const int n1 = meshele[i].p[(j+2)%3];
+        for(int k=first[n0]; k<first[n0+1]; k++)
+        {
+            const int e = elementsOfNode[k];
+            if (e!=i && (meshele[e].p[0]==n1 || meshele[e].p[1]==n1 || meshele[e].p[2]==n1))
+                return e;
+        }
+        return -1;
+    };
+    // (lengths in cm)
+    femm::addTangentialFieldJumps(NumEls, neighbour, [this](int i, int j) {
+        return meshnode[meshele[i].p[j]].CC();
+    }, Hx, Hy, mu, 1.e-4, err);
+
+    double total = 0;
+    for(i=0; i<NumEls; i++)
+        total += err[i];
+    Adaptive.RelativeError = (energy > 0) ? sqrt(total/energy) : 0;
+    Adaptive.MaxArea.clear();
+
+    // calibrate the growth of the mesh by the previous refinement step:
+    if (Adaptive.MarkedElements > 0 && NumEls > Adaptive.MarkedMeshSize)
+        Adaptive.GrowthPerMark = std::max(Adaptive.GrowthPerMark,
+                                          double(NumEls - Adaptive.MarkedMeshSize) / Adaptive.MarkedElements);
+    Adaptive.MarkedElements = 0;
+    Adaptive.MarkedMeshSize = NumEls;
+
+    // number of new elements that may still be created:
+    int budget = NumEls;
+    if (Adaptive.MaxElements > 0)
+        budget = Adaptive.MaxElements - NumEls;
+    if (Adaptive.LastStep || Adaptive.RelativeError <= Adaptive.Tolerance || budget <= 0)
+        return;
+
+    // mark the elements with the largest errors that make up half of the total error,
+    // and ask for a quarter of their area:
+    std::vector<int> order(NumEls);
+    for(i=0; i<NumEls; i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&err](int e1, int e2) { return err[e1] > err[e2]; });
+
+    Adaptive.MaxArea.assign(NumEls, -1);
+    double marked = 0;
+    for(k=0; k<NumEls && marked < 0.5*total && (k+1)*Adaptive.GrowthPerMark <= budget; k++)
+    {
+        i = order[k];
+        const femmsolver::CMElement &El = meshele[i];
+        const double a = ((meshnode[El.p[1]].x-meshnode[El.p[0]].x)*(meshnode[El.p[2]].y-meshnode[El.p[0]].y)
+                          - (meshnode[El.p[2]].x-meshnode[El.p[0]].x)*(meshnode[El.p[1]].y-meshnode[El.p[0]].y)) / 2.;
+        const int fileNumber = ElementFileNumber.empty() ? i : ElementFileNumber[i];
+        Adaptive.MaxArea[fileNumber] = 0.25 * a/(lengthScale*lengthScale);
+        marked += err[i];
+    }
+    Adaptive.MarkedElements = k;
+    if (k == 0)
+        Adaptive.MaxArea.clear();
+}
+
 //=========================================================================
 //=========================================================================
 
@@ -1039,48 +1213,35 @@ int FSolver::WriteStatic2D(CBigLinProb &L)
 {
     // write solution to disk;
 
-    char c[1024];
-    char msgbuff[1024];
-    FILE *fp,*fz;
+    FILE *fp;
     int i,k;
     double cf;
     double unitconv[]= {2.54,0.1,1.,100.,0.00254,1.e-04};
 
-    // first, echo input .fem file to the .ans file;
-    sprintf(c,"%s.fem",PathName.c_str());
-    fz = fopen(c,"rt");
-    if(fz==NULL)
-    {
-        //MsgBox("Couldn't open %s.fem\n", PathName.c_str());
-        sprintf(msgbuff,"Couldn't open %s.fem\n", PathName.c_str());
-        WarnMessage(msgbuff);
-        return false;
-    }
-
-    sprintf(c,"%s.ans",PathName.c_str());
-    fp = fopen(c,"wt");
+    std::string c = PathName + ".ans";
+    fp = fopen(c.c_str(),"wt");
     if(fp==NULL)
     {
-        if (fz != NULL) fclose(fz);
         //MsgBox("Couldn't write to %s.ans\n",PathName.c_str());
-        sprintf(msgbuff,"Couldn't write to %s.ans\n",PathName.c_str());
-        WarnMessage(msgbuff);
+        WarnMessage(("Couldn't write to " + PathName + ".ans\n").c_str());
         return false;
     }
 
-    while(fgets(c,1024,fz)!=NULL)
+    // first, echo input .fem file to the .ans file;
+    if (!writeProblemDescription(fp, PathName+".fem"))
     {
-        fputs(c,fp);
+        fclose(fp);
+        //MsgBox("Couldn't open %s.fem\n", PathName.c_str());
+        WarnMessage(("Couldn't open " + PathName + ".fem\n").c_str());
+        return false;
     }
 
-    fclose(fz);
-
     // then print out node, line, and element information
     fprintf(fp,"[Solution]\n");
 
     cf = unitconv[LengthUnits];
 
-    fprintf(fp,"%i\n",NumNodes);
+    fprintf(fp,"%lld\n",(long long)NumNodes);
 
     for(i = 0; i<NumNodes; i++)
     {
@@ -1101,7 +1262,7 @@ int FSolver::WriteStatic2D(CBigLinProb &L)
         }
     }
 
-    fprintf(fp,"%i\n",NumEls);
+    fprintf(fp,"%lld\n",(long long)NumEls);
 
     for(i = 0; i<NumEls; i++)
     {
@@ -38,6 +38,7 @@
 #include "fparse.h"
 #include "stringTools.h"
 #include "make_unique.h"
+#include "parallelTools.h"
 
 #include <cassert>
 #include <cmath>
@@ -173,10 +174,15 @@ bool HPProc::OpenDocument(string solutionFile)
             if(b>e->rsqr) e->rsqr=b;
 		}
 	}
+    buildElementGrid();
+    buildLabelElements();
+    buildNodeTree();
 
 	// Find flux density in each element;
-    for(int i=0;i<(int)meshelems.size();i++)
-        getElementD(i);
+    parallelFor((int)meshelems.size(), [this](int begin, int end) {
+        for(int i=begin;i<end;i++)
+            getElementD(i);
+    });
 
 	// Find extreme values of A;
     CHMeshNode *node = reinterpret_cast<CHMeshNode*>(meshnodes[0].get());
@@ -242,11 +248,13 @@ bool HPProc::OpenDocument(string solutionFile)
 	PlotBounds[0][0]=d_PlotBounds[0][0];
 	PlotBounds[0][1]=d_PlotBounds[0][1];
 
-    for(int i=0;i<(int)meshelems.size();i++)
-    {
-        auto elem = reinterpret_cast<CHSElement*>(meshelems[i].get());
-        getNodalD(elem->d,i);
-    }
+    parallelFor((int)meshelems.size(), [this](int begin, int end) {
+        for(int i=begin;i<end;i++)
+        {
+            auto elem = reinterpret_cast<CHSElement*>(meshelems[i].get());
+            getNodalD(elem->d,i);
+        }
+    });
 
 	// Find extreme values of D and E;
     const auto &labellist = problem->labellist;
@@ -329,6 +337,26 @@ bool HPProc::getPointValues(double x, double y, CHPointVals &u)
     return true;
 }
 
+int HPProc::getPointValues(int n, const double *x, const double *y, CHPointVals *u, bool *inMesh)
+{
+    return evaluatePoints(n, x, y, inMesh, [this,x,y,u](int k, int elm) {
+        getPointValues(x[k],y[k],elm,u[k]);
+    });
+}
+
+int HPProc::rasterizeFields(const femm::RasterGrid &grid, std::vector<float> &values)
+{
+    rasterize(grid, 4, [this](double x, double y, int elm, float *v) {
+        CHPointVals u;
+        getPointValues(x,y,elm,u);
+        v[0] = static_cast<float>(u.T);
+        v[1] = static_cast<float>(u.F.re);
+        v[2] = static_cast<float>(u.F.im);
+        v[3] = static_cast<float>(abs(u.F));
+    }, values);
+    return 4;
+}
+
 bool HPProc::getPointValues(double x, double y, int k, CHPointVals &u)
 {
 	int i,n[3];
@@ -583,60 +611,60 @@ bool HPProc::InTriangleTest(double x, double y, int i) const
 
 CComplex HPProc::blockIntegral(int inttype)
 {
-	CComplex c,z;
-	double T;
-	double a,R;
-	double r[3];
-
-    R=0;
-    z=0;
-    for(int i=0;i<(int)meshelems.size();i++)
-	{
-        if(problem->labellist[meshelems[i]->lbl]->IsSelected==true)
-		{
-			// compute some useful quantities employed by most integrals...
-            a=ElmArea(i)*pow(LengthConv[problem->LengthUnits],2.);
-            if(problem->problemType==1){
-                for(int k=0;k<3;k++)
-                    r[k]=meshnodes[meshelems[i]->p[k]]->x*LengthConv[problem->LengthUnits];
-				R=(r[0]+r[1]+r[2])/3.;
-			}
+    // sum the contributions of the selected elements; the partial sums
+    // are combined in a fixed order, independent of the number of threads.
+    std::vector<int> elements = selectedElements();
+    CComplex z = parallelSum<CComplex>((int)elements.size(), [this,inttype,&elements](int q) {
+        int i = elements[q];
+        CComplex y = 0;
+        double T;
+        double a,R;
+        double r[3];
+
+        R=0;
+        // compute some useful quantities employed by most integrals...
+        a=ElmArea(i)*pow(LengthConv[problem->LengthUnits],2.);
+        if(problem->problemType==1){
+            for(int k=0;k<3;k++)
+                r[k]=meshnodes[meshelems[i]->p[k]]->x*LengthConv[problem->LengthUnits];
+            R=(r[0]+r[1]+r[2])/3.;
+        }
 
-			// now, compute the desired integral;
-			switch(inttype)
-			{
-				case 0: // T
-                    if(problem->problemType==1) a*=(2.*PI*R); else a*=problem->Depth;
-                    T=0;
-                    for (int k=0;k<3;k++)
-                        T+=getMeshNode(meshelems[i]->p[k])->T/3.;
-					z+=a*T;
-					break;
-
-				case 1: // cross-section area
-					z+=a;
-					break;
-
-				case 2: // volume
-                    if(problem->problemType==1) a*=(2.*PI*R); else a*=problem->Depth;
-					z+=a;
-					break;
-
-				case 3: // F
-                    if(problem->problemType==1) a*=(2.*PI*R); else a*=problem->Depth;
-                    z+=a*getMeshElement(i)->D;
-					break;
-
-				case 4: // G
-                    if(problem->problemType==1) a*=(2.*PI*R); else a*=problem->Depth;
-                    z+=a*E(getMeshElement(i));
-					break;
-
-				default:
-					break;
-			}
-		}
-	}
+        // now, compute the desired integral;
+        switch(inttype)
+        {
+            case 0: // T
+                if(problem->problemType==1) a*=(2.*PI*R); else a*=problem->Depth;
+                T=0;
+                for (int k=0;k<3;k++)
+                    T+=getMeshNode(meshelems[i]->p[k])->T/3.;
+                y=a*T;
+                break;
+
+            case 1: // cross-section area
+                y=a;
+                break;
+
+            case 2: // volume
+                if(problem->problemType==1) a*=(2.*PI*R); else a*=problem->Depth;
+                y=a;
+                break;
+
+            case 3: // F
+                if(problem->problemType==1) a*=(2.*PI*R); else a*=problem->Depth;
+                y=a*getMeshElement(i)->D;
+                break;
+
+            case 4: // G
+                if(problem->problemType==1) a*=(2.*PI*R); else a*=problem->Depth;
+                y=a*E(getMeshElement(i));
+                break;
+
+            default:
+                break;
+        }
+        return y;
+    });
 
 	// Integrals 0, 3 and 4 are averages over the selected volume;
 	// Need to divide by the block volme to get the average.
@@ -667,48 +695,23 @@ void HPProc::lineIntegral(int inttype, double *z)
 
 	// inttype==1 => F.n
 	if(inttype==1){
-		CComplex n,t,pt;
+		CComplex n,t;
 		CHPointVals v;
-		double dz,u,d,Fn;
-		int NumPlotPoints=d_LineIntegralPoints;
-		bool flag;
+		double d,Fn;
 
 		z[0]=0;
 		z[1]=0;
         for(int k=1;k<(int)contour.size();k++)
 		{
-			dz=abs(contour[k]-contour[k-1])/((double) NumPlotPoints);
-            for(int i=0,elm=-1;i<NumPlotPoints;i++)
-			{
-				u=(((double) i)+0.5)/((double) NumPlotPoints);
-				pt=contour[k-1] + u*(contour[k] - contour[k-1]);
-				t=contour[k]-contour[k-1];
-				t/=abs(t);
-				n=I*t;
-				pt+=n*1.e-06;
-
-				if (elm<0) elm=InTriangle(pt.re,pt.im);
-                else if (InTriangleTest(pt.re,pt.im,elm)==false)
-				{
-                    flag=false;
-                    for(int j=0;j<3;j++)
-                        for(int m=0;m<NumList[meshelems[elm]->p[j]];m++)
-						{
-                            elm=ConList[meshelems[elm]->p[j]][m];
-                            if (InTriangleTest(pt.re,pt.im,elm)==true)
-							{
-                                flag=true;
-								m=100;
-								j=3;
-							}
-						}
-                    if (flag==false) elm=InTriangle(pt.re,pt.im);
-				}
-				if(elm>=0)
-                    flag=getPointValues(pt.re,pt.im,elm,v);
-                else flag=false;
-
-                if(flag==true){
+			t=contour[k]-contour[k-1];
+			t/=abs(t);
+			n=I*t;
+
+            // integrate element by element along the segment,
+            // shifted a little in the normal direction
+            integrateContourSegment(contour[k-1]+n*1.e-06, contour[k]+n*1.e-06,
+                                    [&](int elm, CComplex pt, double dz) {
+                if(getPointValues(pt.re,pt.im,elm,v)){
 					Fn = Re(v.F/n);
 
                     if (problem->problemType==AXISYMMETRIC)
@@ -719,7 +722,7 @@ void HPProc::lineIntegral(int inttype, double *z)
 					z[0]+=(Fn*dz*d);
 					z[1]+=dz*d;
 				}
-			}
+            });
 		}
 		z[1]=z[0]/z[1]; // Average F.n over the surface;
 	}
@@ -745,44 +748,16 @@ void HPProc::lineIntegral(int inttype, double *z)
 
 	// inttype==3 => Average Temperature
 	if(inttype==3){
-		CComplex pt;
 		CHPointVals v;
-		double dz,u,d;
-		int NumPlotPoints=d_LineIntegralPoints;
-		bool flag;
+		double d;
 
 		z[0]=0;
 		z[1]=0;
         for(int k=1;k<(int)contour.size();k++)
 		{
-			dz=abs(contour[k]-contour[k-1])/((double) NumPlotPoints);
-            for(int i=0,elm=-1;i<NumPlotPoints;i++)
-			{
-				u=(((double) i)+0.5)/((double) NumPlotPoints);
-				pt=contour[k-1] + u*(contour[k] - contour[k-1]);
-
-				if (elm<0) elm=InTriangle(pt.re,pt.im);
-                else if (InTriangleTest(pt.re,pt.im,elm)==false)
-				{
-                    flag=false;
-                    for(int j=0;j<3;j++)
-                        for(int m=0;m<NumList[meshelems[elm]->p[j]];m++)
-						{
-                            elm=ConList[meshelems[elm]->p[j]][m];
-                            if (InTriangleTest(pt.re,pt.im,elm)==true)
-							{
-                                flag=true;
-								m=100;
-								j=3;
-							}
-						}
-                    if (flag==false) elm=InTriangle(pt.re,pt.im);
-				}
-				if(elm>=0)
-                    flag=getPointValues(pt.re,pt.im,elm,v);
-                else flag=false;
-
-                if(flag==true){
+            integrateContourSegment(contour[k-1], contour[k],
+                                    [&](int elm, CComplex pt, double dz) {
+                if(getPointValues(pt.re,pt.im,elm,v)){
                     if (problem->problemType==AXISYMMETRIC)
                         d=2.*PI*pt.re*sqr(LengthConv[problem->LengthUnits]);
 					else
@@ -791,7 +766,7 @@ void HPProc::lineIntegral(int inttype, double *z)
 					z[0]+=(v.T*dz*d);
 					z[1]+=dz*d;
 				}
-			}
+            });
 		}
 		z[0]=z[0]/z[1]; // Average F.n over the surface;
 	}
@@ -807,22 +782,14 @@ ParserResult HPProc::parseSolution(std::istream &input, std::ostream &err)
     int k;
     // read in meshnodes;
     parseValue(input, k, err);
-    meshnodes.reserve(k);
-    for(int i=0;i<k;i++)
-    {
-        meshnodes.push_back(MAKE_UNIQUE<CHMeshNode>(CHMeshNode::fromStream(input,err)));
-    }
+    parseRecords<CHMeshNode>(input, k, meshnodes, err, [](CHMeshNode &){});
 
     // read in elements;
     parseValue(input, k, err);
-    meshelems.reserve(k);
-    auto &labellist = problem->labellist;
-    for(int i=0;i<k;i++)
-    {
-        CHSElement elm = CHSElement::fromStream(input,err);
+    const auto &labellist = problem->labellist;
+    parseRecords<CHSElement>(input, k, meshelems, err, [&labellist](CHSElement &elm) {
         elm.blk = labellist[elm.lbl]->BlockType;
-        meshelems.push_back(MAKE_UNIQUE<CHSElement>(elm));
-    }
+    });
 
     // read in circuit data;
     auto &circproplist = problem->circproplist;
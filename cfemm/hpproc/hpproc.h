@@ -64,6 +64,24 @@ public:
 
     bool getPointValues(double x, double y, CHPointVals &u);
     bool getPointValues(double x, double y, int k, CHPointVals &u);
+    /**
+     * @brief Get the point values for several points at once.
+     * @param n the number of points
+     * @param x array of \p n x coordinates
+     * @param y array of \p n y coordinates
+     * @param u array of \p n point values; u[i] is only set if the point is inside the mesh.
+     * @param inMesh array of \p n flags, set to \c true for points inside the mesh.
+     * @return the number of points inside the mesh
+     */
+    int getPointValues(int n, const double *x, const double *y, CHPointVals *u, bool *inMesh);
+    /**
+     * @brief Sample the temperature and heat flux density on a regular grid.
+     * The values are interpolated like in getPointValues(), i.e. using the smoothed nodal flux density if smoothing is enabled.
+     * @param grid the grid
+     * @param values receives 4 planes of grid.size() values: T, Fx, Fy and |F|; NaN for points outside the mesh.
+     * @return the number of planes
+     */
+    int rasterizeFields(const femm::RasterGrid &grid, std::vector<float> &values);
 
     void lineIntegral(int inttype, double *z);
 
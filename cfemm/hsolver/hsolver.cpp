@@ -139,7 +139,8 @@ int HSolver::LoadPrev()
 	FILE *fp;
     double x,y;
     int k;
-	char s[1024],q[256];
+	std::string s;
+	char q[256];
 
     if ((fp=fopen(previousSolutionFile.c_str(),"rt"))==NULL)
 	{
@@ -148,9 +149,9 @@ int HSolver::LoadPrev()
 
 	// parse the file
 	k=0;
-	while (fgets(s,1024,fp)!=NULL)
+	while (readLine(fp,s))
 	{
-		sscanf(s,"%s",q);
+		sscanf(s.c_str(),"%255s",q);
 		if( _strnicmp(q,"[solution]",11)==0){
 			k=1;
 			break;
@@ -165,9 +166,10 @@ int HSolver::LoadPrev()
 	}
 
 	// read in the solution
-	fgets(s,1024,fp);
-	sscanf(s,"%i",&k);
-	if(k!=NumNodes)
+	readLine(fp,s);
+	long long count = 0;
+	sscanf(s.c_str(),"%lld",&count);
+	if(count!=NumNodes)
 	{
 		fclose(fp);
 		return BADELEMENTFILE;
@@ -177,8 +179,8 @@ int HSolver::LoadPrev()
 
 	for(k=0;k<NumNodes;k++)
 	{
-		fgets(s,1024,fp);
-		sscanf(s,"%lf	%lf	%lf",&x,&y,&Tprev[k]);
+		readLine(fp,s);
+		sscanf(s.c_str(),"%lf	%lf	%lf",&x,&y,&Tprev[k]);
 	}
 
 	return 0;
@@ -187,24 +189,36 @@ int HSolver::LoadPrev()
 LoadMeshErr HSolver::LoadMesh(bool deleteFiles)
 {
 	int i,j,k,q,n0,n1,n;
-	char infile[256];
+	std::string infile;
 	FILE *fp;
-	char s[1024];
+	std::string s;
     double c[]={0.0254,0.001,0.01,1,2.54e-5,1.e-6};
 
+    // removes the triangle files once they are no longer needed
+    auto removeMeshFiles = [this](bool withEdges)
+    {
+        remove((PathName + ".ele").c_str());
+        remove((PathName + ".node").c_str());
+        remove((PathName + ".pbc").c_str());
+        remove((PathName + ".poly").c_str());
+        if (withEdges)
+            remove((PathName + ".edge").c_str());
+    };
+
 
 	//read meshnodes;
-	sprintf(infile,"%s.node",PathName.c_str());
-	if((fp=fopen(infile,"rt"))==NULL){
+	infile = PathName + ".node";
+	if((fp=fopen(infile.c_str(),"rt"))==NULL){
 		return BADELEMENTFILE;
 	}
-	fgets(s,1024,fp);
-	sscanf(s,"%i",&k);
-	NumNodes = k;
+	readLine(fp,s);
+	long long count = 0;
+	sscanf(s.c_str(),"%lld",&count);
+	NumNodes = count;
 
-    meshnode = new CNode[k];
+    meshnode = new CNode[NumNodes];
     CNode node;
-	for(i = 0; i < k; i++)
+	for(i = 0; i < NumNodes; i++)
 	{
 		fscanf(fp,"%i",&j);
 		fscanf(fp,"%lf",&node.x);
@@ -241,12 +255,12 @@ LoadMeshErr HSolver::LoadMesh(bool deleteFiles)
 	fclose(fp);
 
 	//read in periodic boundary conditions;
-	sprintf(infile,"%s.pbc",PathName.c_str());
-	if((fp=fopen(infile,"rt"))==NULL){
+	infile = PathName + ".pbc";
+	if((fp=fopen(infile.c_str(),"rt"))==NULL){
 		return BADPBCFILE;
 	}
-	fgets(s,1024,fp);
-	sscanf(s,"%i",&k);
+	readLine(fp,s);
+	sscanf(s.c_str(),"%i",&k);
 	NumPBCs=k;
 
     if (k!=0) pbclist.reserve(k);
@@ -261,21 +275,22 @@ LoadMeshErr HSolver::LoadMesh(bool deleteFiles)
 	fclose(fp);
 
 	// read in elements;
-	sprintf(infile,"%s.ele",PathName.c_str());
-	if((fp=fopen(infile,"rt"))==NULL){
+	infile = PathName + ".ele";
+	if((fp=fopen(infile.c_str(),"rt"))==NULL){
 		return BADELEMENTFILE;
 	}
-	fgets(s,1024,fp);
-	sscanf(s,"%i",&k); NumEls=k;
+	readLine(fp,s);
+	count = 0;
+	sscanf(s.c_str(),"%lld",&count); NumEls=count;
 
-    meshele.reserve(k);
+    meshele.reserve(NumEls);
     femmsolver::CElement elm;
 
 	int defaultLabel;
 	for(i=0,defaultLabel=-1;i<NumBlockLabels;i++)
 		if (labellist[i].IsDefault) defaultLabel=i;
 
-	for(i=0;i<k;i++){
+	for(i=0;i<NumEls;i++){
 		fscanf(fp,"%i",&j);
 		fscanf(fp,"%i",&elm.p[0]);
 		fscanf(fp,"%i",&elm.p[1]);
@@ -292,16 +307,7 @@ LoadMeshErr HSolver::LoadMesh(bool deleteFiles)
 			fclose(fp);
             if (deleteFiles)
             {
-                sprintf(infile,"%s.ele",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.node",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.pbc",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.poly",PathName.c_str());
-                remove(infile);
-                sprintf(infile,"%s.edge",PathName.c_str());
-                remove(infile);
+                removeMeshFiles(true);
             }
             return MISSINGMATPROPS;
 		}
@@ -349,8 +355,8 @@ LoadMeshErr HSolver::LoadMesh(bool deleteFiles)
 				nmbr[k]++;
 			}
 
-	sprintf(infile,"%s.edge",PathName.c_str());
-	if((fp=fopen(infile,"rt"))==NULL)
+	infile = PathName + ".edge";
+	if((fp=fopen(infile.c_str(),"rt"))==NULL)
 	{
 		return BADEDGEFILE;
 	}
@@ -417,14 +423,7 @@ LoadMeshErr HSolver::LoadMesh(bool deleteFiles)
     if (deleteFiles)
     {
         // clear out temporary files
-        sprintf(infile,"%s.ele",PathName.c_str());
-        remove(infile);
-        sprintf(infile,"%s.node",PathName.c_str());
-        remove(infile);
-        sprintf(infile,"%s.pbc",PathName.c_str());
-        remove(infile);
-        sprintf(infile,"%s.poly",PathName.c_str());
-        remove(infile);
+        removeMeshFiles(false);
     }
 
     return NOERROR;
@@ -882,6 +881,7 @@ bool HSolver::runSolver(bool verbose)
         std::string stats = "Problem Statistics:\n";
         stats += to_string(NumNodes) + " nodes\n";
         stats += to_string(NumEls) + " elements\n";
+        stats += "bandwidth " + to_string(BandWidth) + ", profile " + to_string(Profile) + "\n";
         PrintMessage(stats.c_str());
         std::cout << "Precision: " << Precision << "\n";
     }
@@ -922,46 +922,38 @@ int HSolver::WriteResults(CBigLinProb &L)
 {
 	// write solution to disk;
 
-	char c[1024];
-	FILE *fp,*fz;
+	FILE *fp;
 	int i;
 	double cf;
-	// first, echo input .feh file to the .anh file;
-	sprintf(c,"%s.feh",PathName.c_str());
-
-	fz=fopen(c,"rt");
-	if(fz==NULL)
-    {
-		printf("Couldn't open %s.feh\n", PathName.c_str());
-        return false;
-	}
 
-    sprintf(c,"%s.anh",PathName.c_str());
-    fp=fopen(c,"wt");
+    std::string c = PathName + ".anh";
+    fp = fopen(c.c_str(),"wt");
 	if(fp==NULL)
     {
 		printf("Couldn't write to %s.anh",PathName.c_str());
         return false;
 	}
 
-	while(fgets(c,1024,fz)!=NULL)
+	// first, echo input .feh file to the .anh file;
+	if (!writeProblemDescription(fp, PathName+".feh"))
     {
-        fputs(c,fp);
-    }
-	fclose(fz);
+		fclose(fp);
+		printf("Couldn't open %s.feh\n", PathName.c_str());
+        return false;
+	}
 
 	// then print out node, line, and element information
 	fprintf(fp,"[Solution]\n");
     // get conversion factor for conversion from internal working units of
     // mm to the specified length units
 	cf = units[LengthUnits];
-	fprintf(fp,"%i\n",NumNodes);
+	fprintf(fp,"%lld\n",(long long)NumNodes);
 	for(i=0;i<NumNodes;i++)
     {
 		fprintf(fp,"%.17g	%.17g	%.17g	%i\n",meshnode[i].x/cf,meshnode[i].y/cf,L.V[i],L.Q[i]);
     }
 
-	fprintf(fp,"%i\n",NumEls);
+	fprintf(fp,"%lld\n",(long long)NumEls);
 
 	for(i=0;i<NumEls;i++)
     {
@@ -43,7 +43,24 @@ femmsolver::CAirGapElement::CAirGapElement()
     , ro(0)
     , InnerAngle(0)
     , OuterAngle(0)
+    , InnerShift(0)
+    , OuterShift(0)
     , agc(0)
+    , nn(0)
+    , aco(0)
+    , brc(nullptr)
+    , brs(nullptr)
+    , btc(nullptr)
+    , bts(nullptr)
+    , br(nullptr)
+    , bt(nullptr)
+    , brcPrev(nullptr)
+    , brsPrev(nullptr)
+    , btcPrev(nullptr)
+    , btsPrev(nullptr)
+    , brPrev(nullptr)
+    , btPrev(nullptr)
+    , nh(nullptr)
 {
 }
 
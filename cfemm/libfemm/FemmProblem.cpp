@@ -1,19 +1,105 @@
 #include "FemmProblem.h"
 
 #include "femmconstants.h"
+#include "hashTools.h"
 #include "make_unique.h"
 
+#include <algorithm>
 #include <cassert>
 #include <ctgmath>
 #include <fstream>
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <limits>
 
 #ifdef DEBUG_MEX
 #include "mex.h"
 #endif // DEBUG_MEX
 
+namespace {
+/**
+ * @brief Extra room around the box of a spatial hash query,
+ * so that rounding errors can not drop a candidate.
+ * @param d the search distance
+ * @param x
+ * @param y
+ * @return the padded search distance
+ */
+double paddedDistance(double d, double x, double y)
+{
+    return d + fabs(d)*1.e-6 + (fabs(x)+fabs(y))*1.e-12;
+}
+
+// copies of the geometry entities, as used by FemmProblem::UndoStore:
+std::unique_ptr<femm::CNode> copyEntity(const femm::CNode &node) { return node.clone(); }
+std::unique_ptr<femm::CSegment> copyEntity(const femm::CSegment &segm) { return segm.clone(); }
+std::unique_ptr<femm::CArcSegment> copyEntity(const femm::CArcSegment &arc) { return MAKE_UNIQUE<femm::CArcSegment>(arc); }
+std::unique_ptr<femm::CBlockLabel> copyEntity(const femm::CBlockLabel &label) { return label.clone(); }
+}
+
+template <class T>
+void femm::FemmProblem::UndoStore<T>::reset(std::size_t size)
+{
+    m_saved.clear();
+    m_savedFrom = static_cast<int>(size);
+}
+
+template <class T>
+void femm::FemmProblem::UndoStore<T>::save(int i, const T &entity)
+{
+    if (i < m_savedFrom && m_saved.count(i)==0)
+        m_saved[i] = copyEntity(entity);
+}
+
+template <class T>
+void femm::FemmProblem::UndoStore<T>::save(const std::vector<std::unique_ptr<T>> &list, int i)
+{
+    save(i, *list[i]);
+}
+
+template <class T>
+void femm::FemmProblem::UndoStore<T>::saveFrom(const std::vector<std::unique_ptr<T>> &list, int first)
+{
+    for (int i=first; i<m_savedFrom; i++)
+        save(list, i);
+    m_savedFrom = std::min(m_savedFrom, first);
+}
+
+template <class T>
+void femm::FemmProblem::UndoStore<T>::takeRemaining(std::vector<std::unique_ptr<T>> &oldlist)
+{
+    for (int i=0; i<m_savedFrom && i<(int)oldlist.size(); i++)
+    {
+        if (m_saved.count(i)==0)
+            m_saved[i] = std::move(oldlist[i]);
+    }
+    m_savedFrom = 0;
+}
+
+template <class T>
+void femm::FemmProblem::UndoStore<T>::restore(std::vector<std::unique_ptr<T>> &list)
+{
+    for (auto it = m_saved.begin(); it != m_saved.end(); )
+    {
+        // entities that were erased after the undo point are re-inserted
+        if (it->first >= (int)list.size())
+            list.resize(it->first+1);
+        list[it->first].swap(it->second);
+        if (it->second)
+            ++it;
+        else
+            it = m_saved.erase(it);
+    }
+}
+
+template <class T>
+const T *femm::FemmProblem::UndoStore<T>::saved(int i) const
+{
+    auto it = m_saved.find(i);
+    return (it == m_saved.end()) ? nullptr : it->second.get();
+}
+
 femm::FemmProblem::~FemmProblem()
 {
 }
@@ -327,14 +413,143 @@ void femm::FemmProblem::updateNodeMap()
     }
 }
 
+void femm::FemmProblem::invalidateGeometryHash()
+{
+    nodeHash.reset(0);
+    lineHash.reset(0);
+    arcHash.reset(0);
+    geometryHashBase = 0;
+}
+
+void femm::FemmProblem::updateGeometryHash() const
+{
+    const int numNodes = (int)nodelist.size();
+    if (nodeHash.cellSize()<=0 || numNodes > 2*geometryHashBase+16)
+    {
+        // choose a cell size that gives about one node per cell
+        double x0=0, y0=0, x1=0, y1=0;
+        bool first = true;
+        for (const auto &node: nodelist)
+        {
+            if (!std::isfinite(node->x) || !std::isfinite(node->y))
+                continue;
+            if (first || node->x<x0) x0 = node->x;
+            if (first || node->x>x1) x1 = node->x;
+            if (first || node->y<y0) y0 = node->y;
+            if (first || node->y>y1) y1 = node->y;
+            first = false;
+        }
+        const double w = x1-x0;
+        const double h = y1-y0;
+        double cellSize;
+        if (w>0 && h>0)
+            cellSize = sqrt(w*h/numNodes);
+        else
+            cellSize = std::max(w,h)/std::max(numNodes,1);
+        if (!(cellSize>0) || !std::isfinite(cellSize))
+            cellSize = 1.;
+
+        nodeHash.reset(cellSize);
+        lineHash.reset(cellSize);
+        arcHash.reset(cellSize);
+        geometryHashBase = numNodes;
+    }
+
+    // entities have been removed from the lists:
+    if (nodeHash.size()>numNodes)
+        nodeHash.clear();
+    if (lineHash.size()>(int)linelist.size())
+        lineHash.clear();
+    if (arcHash.size()>(int)arclist.size())
+        arcHash.clear();
+
+    const double invalid = std::numeric_limits<double>::quiet_NaN();
+    for (int i=nodeHash.size(); i<numNodes; i++)
+    {
+        nodeHash.add(nodelist[i]->x, nodelist[i]->y, nodelist[i]->x, nodelist[i]->y);
+    }
+    for (int i=lineHash.size(); i<(int)linelist.size(); i++)
+    {
+        const CSegment &line = *linelist[i];
+        if (line.n0<0 || line.n0>=numNodes || line.n1<0 || line.n1>=numNodes)
+        {
+            lineHash.add(invalid, invalid, invalid, invalid);
+            continue;
+        }
+        const CNode &n0 = *nodelist[line.n0];
+        const CNode &n1 = *nodelist[line.n1];
+        lineHash.addLine(n0.x, n0.y, n1.x, n1.y);
+    }
+    for (int i=arcHash.size(); i<(int)arclist.size(); i++)
+    {
+        double xmin,ymin,xmax,ymax;
+        arcBoundingBox(*arclist[i], xmin, ymin, xmax, ymax);
+        arcHash.add(xmin, ymin, xmax, ymax);
+    }
+}
+
+void femm::FemmProblem::arcBoundingBox(const femm::CArcSegment &arc, double &xmin, double &ymin, double &xmax, double &ymax) const
+{
+    xmin = ymin = xmax = ymax = std::numeric_limits<double>::quiet_NaN();
+    const int numNodes = (int)nodelist.size();
+    if (arc.n0<0 || arc.n0>=numNodes || arc.n1<0 || arc.n1>=numNodes)
+        return;
+
+    CComplex c;
+    double R;
+    getCircle(arc,c,R);
+    if (!std::isfinite(R) || !std::isfinite(c.re) || !std::isfinite(c.im))
+        return;
+
+    const CComplex a0 = nodelist[arc.n0]->CC();
+    const CComplex a1 = nodelist[arc.n1]->CC();
+    xmin = std::min(a0.re,a1.re);
+    ymin = std::min(a0.im,a1.im);
+    xmax = std::max(a0.re,a1.re);
+    ymax = std::max(a0.im,a1.im);
+
+    // add the extreme points of the circle that lie on the arc
+    const double t0 = arg(a0-c);
+    const double span = arc.ArcLength*PI/180.;
+    for (int k=0; k<4; k++)
+    {
+        const double tk = k*PI/2.;
+        double dt = fmod(tk-t0, 2.*PI);
+        if (dt<0)
+            dt += 2.*PI;
+        if (dt<=span || span<=0 || span>PI)
+        {
+            xmin = std::min(xmin, c.re+R*cos(tk));
+            ymin = std::min(ymin, c.im+R*sin(tk));
+            xmax = std::max(xmax, c.re+R*cos(tk));
+            ymax = std::max(ymax, c.im+R*sin(tk));
+        }
+    }
+
+    // leave some room for rounding errors
+    const double pad = fabs(R)*1.e-6;
+    xmin -= pad;
+    ymin -= pad;
+    xmax += pad;
+    ymax += pad;
+}
+
 bool femm::FemmProblem::addArcSegment(femm::CArcSegment &asegm, double tol)
 {
     // don't add if line is degenerate
     if (asegm.n0==asegm.n1)
         return false;
 
+    // the spatial hashes give us the candidates for the following tests
+    updateGeometryHash();
+    std::vector<int> candidates;
+    double xmin,ymin,xmax,ymax;
+    const CComplex end0 = nodelist[asegm.n0]->CC();
+    const CComplex end1 = nodelist[asegm.n1]->CC();
+
     // don't add if the arc is already in the list;
-    for(int i=0; i<(int)arclist.size(); i++){
+    arcHash.query(std::min(end0.re,end1.re), std::min(end0.im,end1.im), std::max(end0.re,end1.re), std::max(end0.im,end1.im), candidates);
+    for(int i: candidates){
         if ((arclist[i]->n0==asegm.n0) && (arclist[i]->n1==asegm.n1) &&
                 (fabs(arclist[i]->ArcLength-asegm.ArcLength)<1.e-02)) return false;
         // arcs are ``the same'' if start and end points are the same, and if
@@ -348,14 +563,17 @@ bool femm::FemmProblem::addArcSegment(femm::CArcSegment &asegm, double tol)
     CComplex p[2];
     std::vector < CComplex > newnodes;
     // check to see if there are intersections
-    for(int i=0; i<(int)linelist.size(); i++)
+    arcBoundingBox(asegm, xmin, ymin, xmax, ymax);
+    lineHash.query(xmin, ymin, xmax, ymax, candidates);
+    for(int i: candidates)
     {
         int j = getLineArcIntersection(*linelist[i],asegm,p);
         if (j>0)
             for(int k=0; k<j; k++)
                 newnodes.push_back(p[k]);
     }
-    for (int i=0; i<(int)arclist.size(); i++)
+    arcHash.query(xmin, ymin, xmax, ymax, candidates);
+    for (int i: candidates)
     {
         int j = getArcArcIntersection(asegm,*arclist[i],p);
         if (j>0)
@@ -364,25 +582,7 @@ bool femm::FemmProblem::addArcSegment(femm::CArcSegment &asegm, double tol)
     }
 
     // add nodes at intersections
-    double t;
-    if (tol==0)
-    {
-        if (nodelist.size()<2) t=1.e-08;
-        else{
-            CComplex p0,p1;
-            p0 = nodelist[0]->CC();
-            p1 = p0;
-            for (int i=1; i<(int)nodelist.size(); i++)
-            {
-                if(nodelist[i]->x<p0.re) p0.re = nodelist[i]->x;
-                if(nodelist[i]->x>p1.re) p1.re = nodelist[i]->x;
-                if(nodelist[i]->y<p0.im) p0.im = nodelist[i]->y;
-                if(nodelist[i]->y>p1.im) p1.im = nodelist[i]->y;
-            }
-            t = abs(p1-p0)*CLOSE_ENOUGH;
-        }
-    }
-    else t = tol;
+    double t = (tol==0) ? defaultTolerance() : tol;
 
     for (int i=0; i<(int)newnodes.size(); i++)
         addNode(newnodes[i].re,newnodes[i].im,t);
@@ -394,7 +594,8 @@ bool femm::FemmProblem::addArcSegment(femm::CArcSegment &asegm, double tol)
     // if so, delete arc and create arcs that link intermediate points;
     // does this by recursive use of AddArcSegment;
 
-    unselectAll();
+    if (!rebuildingGeometry)
+        unselectAll();
     CComplex c;
     double R;
     getCircle(asegm,c,R);
@@ -404,7 +605,10 @@ bool femm::FemmProblem::addArcSegment(femm::CArcSegment &asegm, double tol)
         dmin = fabs(R*PI*asegm.ArcLength/180.)*1.e-05;
 
     int k = (int)arclist.size()-1;
-    for(int i=0; i<(int)nodelist.size(); i++)
+    updateGeometryHash();
+    const double dpad = paddedDistance(dmin, c.re, c.im);
+    nodeHash.query(xmin-dpad, ymin-dpad, xmax+dpad, ymax+dpad, candidates);
+    for(int i: candidates)
     {
         if( (i!=asegm.n0) && (i!=asegm.n1) )
         {
@@ -422,8 +626,9 @@ bool femm::FemmProblem::addArcSegment(femm::CArcSegment &asegm, double tol)
                 a0.Set(nodelist[asegm.n0]->x,nodelist[asegm.n0]->y);
                 a1.Set(nodelist[asegm.n1]->x,nodelist[asegm.n1]->y);
                 a2.Set(nodelist[i]->x,nodelist[i]->y);
-                arclist[k]->ToggleSelect();
-                deleteSelectedArcSegments();
+                // the proposed arc is the last one, so there is no need to go through deleteSelectedArcSegments()
+                arclist.pop_back();
+                arcHash.truncate(k);
 
                 CArcSegment newarc = asegm;
                 newarc.n1 = i;
@@ -435,7 +640,7 @@ bool femm::FemmProblem::addArcSegment(femm::CArcSegment &asegm, double tol)
                 newarc.ArcLength = arg((a1-c)/(a2-c))*180./PI;
                 addArcSegment(newarc,dmin);
 
-                i = nodelist.size();
+                break;
             }
         }
     }
@@ -471,12 +676,18 @@ bool femm::FemmProblem::addBlockLabel(std::unique_ptr<femm::CBlockLabel> &&label
     double x = label->x;
     double y = label->y;
 
+    updateGeometryHash();
+    std::vector<int> candidates;
+    const double dpad = paddedDistance(d,x,y);
+
     // can't put a block label on top of an existing node...
-    for (int i=0; i<(int)nodelist.size(); i++)
+    nodeHash.query(x-dpad, y-dpad, x+dpad, y+dpad, candidates);
+    for (int i: candidates)
         if(nodelist[i]->GetDistance(x,y)<d) return false;
 
     // can't put a block label on a line, either...
-    for (int i=0; i<(int)linelist.size(); i++)
+    lineHash.query(x-dpad, y-dpad, x+dpad, y+dpad, candidates);
+    for (int i: candidates)
         if(shortestDistanceFromSegment(x,y,i)<d) return false;
 
     // test to see if ``too close'' to existing node...
@@ -511,8 +722,13 @@ bool femm::FemmProblem::addNode(std::unique_ptr<femm::CNode> &&node, double d)
     double x = node->x;
     double y = node->y;
 
+    updateGeometryHash();
+    std::vector<int> candidates;
+    const double dpad = paddedDistance(d,x,y);
+
     // test to see if ``too close'' to existing node...
-    for (int i=0; i<(int)nodelist.size(); i++)
+    nodeHash.query(x-dpad, y-dpad, x+dpad, y+dpad, candidates);
+    for (int i: candidates)
         if(nodelist[i]->GetDistance(x,y)<d) return false;
 
     // can't put a node on top of a block label; do same sort of test.
@@ -524,13 +740,15 @@ bool femm::FemmProblem::addNode(std::unique_ptr<femm::CNode> &&node, double d)
 
     // test to see if node is on an existing line; if so,
     // break into two lines;
-
-    for(int i=0, k=(int)linelist.size(); i<k; i++)
+    lineHash.query(x-dpad, y-dpad, x+dpad, y+dpad, candidates);
+    for(int i: candidates)
     {
         if (fabs(shortestDistanceFromSegment(x,y,i))<d)
         {
             std::unique_ptr<CSegment> segm;
             segm = linelist[i]->clone();
+            if (!rebuildingGeometry)
+                undolinelist.save(linelist, i);
             linelist[i]->n1=nodelist.size()-1;
             segm->n0=nodelist.size()-1;
             linelist.push_back(std::move(segm));
@@ -539,7 +757,8 @@ bool femm::FemmProblem::addNode(std::unique_ptr<femm::CNode> &&node, double d)
 
     // test to see if node is on an existing arc; if so,
     // break into two arcs;
-    for(int i=0, k=(int)arclist.size(); i<k; i++)
+    arcHash.query(x-dpad, y-dpad, x+dpad, y+dpad, candidates);
+    for(int i: candidates)
     {
         if (shortestDistanceFromArc(CComplex(x,y),*arclist[i])<d)
         {
@@ -550,6 +769,8 @@ bool femm::FemmProblem::addNode(std::unique_ptr<femm::CNode> &&node, double d)
 
             std::unique_ptr<CArcSegment> asegm;
             asegm = MAKE_UNIQUE<CArcSegment>(*arclist[i]);
+            if (!rebuildingGeometry)
+                undoarclist.save(arclist, i);
             arclist[i]->n1 = nodelist.size()-1;
             arclist[i]->ArcLength = arg((a2-c)/(a0-c))*180./PI;
             asegm->n0 = nodelist.size()-1;
@@ -575,8 +796,16 @@ bool femm::FemmProblem::addSegment(int n0, int n1, const femm::CSegment *parsegm
     // don't add if line is degenerate
     if (n0==n1) return false;
 
+    // the spatial hashes give us the candidates for the following tests
+    updateGeometryHash();
+    std::vector<int> candidates;
+    const CComplex end0 = nodelist[n0]->CC();
+    const CComplex end1 = nodelist[n1]->CC();
+    const double pad = paddedDistance(0, end0.re+end1.re, end0.im+end1.im);
+
     // don't add if the line is already in the list;
-    for (int i=0; i<(int)linelist.size(); i++){
+    lineHash.queryLine(end0.re, end0.im, end1.re, end1.im, pad, candidates);
+    for (int i: candidates){
         if ((linelist[i]->n0==n0) && (linelist[i]->n1==n1)) return false;
         if ((linelist[i]->n0==n1) && (linelist[i]->n1==n0)) return false;
     }
@@ -588,11 +817,12 @@ bool femm::FemmProblem::addSegment(int n0, int n1, const femm::CSegment *parsegm
     segm.n0=n0; segm.n1=n1;
 
     // check to see if there are intersections with segments
-    for (int i=0; i<(int)linelist.size(); i++)
+    for (int i: candidates)
         if(getIntersection(n0,n1,i,&xi,&yi)) newnodes.push_back(CComplex(xi,yi));
 
     // check to see if there are intersections with arcs
-    for (int i=0; i<(int)arclist.size(); i++){
+    arcHash.queryLine(end0.re, end0.im, end1.re, end1.im, pad, candidates);
+    for (int i: candidates){
         int j = getLineArcIntersection(segm,*arclist[i],p);
         if (j>0)
             for(int k=0;k<j;k++)
@@ -600,25 +830,7 @@ bool femm::FemmProblem::addSegment(int n0, int n1, const femm::CSegment *parsegm
     }
 
     // add nodes at intersections
-    if (tol==0)
-    {
-        if (nodelist.size()<2)
-            t = 1.e-08;
-        else{
-            CComplex p0,p1;
-            p0 = nodelist[0]->CC();
-            p1 = p0;
-            for (int i=1; i<(int)nodelist.size(); i++)
-            {
-                if(nodelist[i]->x<p0.re) p0.re=nodelist[i]->x;
-                if(nodelist[i]->x>p1.re) p1.re=nodelist[i]->x;
-                if(nodelist[i]->y<p0.im) p0.im=nodelist[i]->y;
-                if(nodelist[i]->y>p1.im) p1.im=nodelist[i]->y;
-            }
-            t=abs(p1-p0)*CLOSE_ENOUGH;
-        }
-    }
-    else t=tol;
+    t = (tol==0) ? defaultTolerance() : tol;
 
     for (int i=0; i<(int)newnodes.size(); i++)
         addNode(newnodes[i].re,newnodes[i].im,t);
@@ -630,12 +842,17 @@ bool femm::FemmProblem::addSegment(int n0, int n1, const femm::CSegment *parsegm
     // if so, delete line and create lines that link intermediate points;
     // does this by recursive use of AddSegment;
     double d,dmin;
-    unselectAll();
+    if (!rebuildingGeometry)
+        unselectAll();
     if (tol==0)
         dmin = abs(nodelist[n1]->CC()-nodelist[n0]->CC())*1.e-05;
     else dmin = tol;
 
-    for (int i=0, k=linelist.size()-1; i<(int)nodelist.size(); i++)
+    const int k = linelist.size()-1;
+    updateGeometryHash();
+    const double dpad = paddedDistance(dmin, end0.re+end1.re, end0.im+end1.im);
+    nodeHash.queryLine(end0.re, end0.im, end1.re, end1.im, dpad, candidates);
+    for (int i: candidates)
     {
         if( (i!=n0) && (i!=n1) )
         {
@@ -643,8 +860,9 @@ bool femm::FemmProblem::addSegment(int n0, int n1, const femm::CSegment *parsegm
             if (abs(nodelist[i]->CC()-nodelist[n0]->CC())<dmin) d=2.*dmin;
             if (abs(nodelist[i]->CC()-nodelist[n1]->CC())<dmin) d=2.*dmin;
             if (d<dmin){
-                linelist[k]->ToggleSelect();
-                deleteSelectedSegments();
+                // the proposed line is the last one, so there is no need to go through deleteSelectedSegments()
+                linelist.pop_back();
+                lineHash.truncate(k);
                 if(parsegm==NULL)
                 {
                     addSegment(n0,i,dmin);
@@ -654,7 +872,7 @@ bool femm::FemmProblem::addSegment(int n0, int n1, const femm::CSegment *parsegm
                     addSegment(n0,i,&segm,dmin);
                     addSegment(i,n1,&segm,dmin);
                 }
-                i=nodelist.size();
+                break;
             }
         }
     }
@@ -677,24 +895,27 @@ void femm::FemmProblem::clearNotationTags()
 
 
 
+double femm::FemmProblem::defaultTolerance() const
+{
+    if (nodelist.size()<2)
+        return 1.e-08;
+
+    updateGeometryHash();
+    CComplex p0 = nodelist[0]->CC();
+    CComplex p1 = p0;
+    nodeHash.bounds(p0.re, p0.im, p1.re, p1.im);
+    return abs(p1-p0)*CLOSE_ENOUGH;
+}
+
 // identical in fmesher, FPProc and HPProc
 int femm::FemmProblem::closestArcSegment(double x, double y) const
 {
     if(arclist.size()==0) return -1;
 
-    double d0=shortestDistanceFromArc(CComplex(x,y),*arclist[0]);
-    int idx=0;
-    for(int i=0; i<(int)arclist.size(); i++)
-    {
-        double d1=shortestDistanceFromArc(CComplex(x,y),*arclist[i]);
-        if(d1<d0)
-        {
-            d0=d1;
-            idx=i;
-        }
-    }
-
-    return idx;
+    updateGeometryHash();
+    return arcHash.nearest(x,y,[&](int i) {
+        return shortestDistanceFromArc(CComplex(x,y),*arclist[i]);
+    });
 }
 
 int femm::FemmProblem::closestBlockLabel(double x, double y) const
@@ -721,19 +942,10 @@ int femm::FemmProblem::closestNode(double x, double y) const
 {
     if(nodelist.size()==0) return -1;
 
-    int idx=0;
-    double d0=nodelist[0]->GetDistance(x,y);
-    for(int i=0; i<(int)nodelist.size(); i++)
-    {
-        double d1=nodelist[i]->GetDistance(x,y);
-        if(d1<d0)
-        {
-            d0=d1;
-            idx=i;
-        }
-    }
-
-    return idx;
+    updateGeometryHash();
+    return nodeHash.nearest(x,y,[&](int i) {
+        return nodelist[i]->GetDistance(x,y);
+    });
 }
 
 // identical in fmesher, hpproc
@@ -741,19 +953,10 @@ int femm::FemmProblem::closestSegment(double x, double y) const
 {
     if(linelist.size()==0) return -1;
 
-    int idx=0;
-    double d0=shortestDistanceFromSegment(x,y,0);
-    for(int i=0; i<(int)linelist.size(); i++)
-    {
-        double d1=shortestDistanceFromSegment(x,y,i);
-        if(d1<d0)
-        {
-            d0=d1;
-            idx=i;
-        }
-    }
-
-    return idx;
+    updateGeometryHash();
+    return lineHash.nearest(x,y,[&](int i) {
+        return shortestDistanceFromSegment(x,y,i);
+    });
 }
 
 bool femm::FemmProblem::consistencyCheckOK() const
@@ -1039,7 +1242,7 @@ bool femm::FemmProblem::createRadius(int n, double r)
         }
         else j=0;	// The index of the winning case is in j....
 
-        updateUndo();
+        updateUndoIncremental();
         addNode(Re(i1[j]),Im(i1[j]),r/10000.);
         addNode(Re(i2[j]),Im(i2[j]),r/10000.);
         unselectAll();
@@ -1108,7 +1311,7 @@ bool femm::FemmProblem::createRadius(int n, double r)
         ar.InGroup       =linelist[seg[0]]->InGroup;
 
         // add new nodes at ends of radius
-        updateUndo();
+        updateUndoIncremental();
         addNode(Re(p1),Im(p1),len/10000.);
         addNode(Re(p2),Im(p2),len/10000.);
         unselectAll();
@@ -1196,7 +1399,7 @@ bool femm::FemmProblem::createRadius(int n, double r)
         ar.InGroup=arclist[arc[0]]->InGroup;
 
         // add new nodes at ends of radius
-        updateUndo();
+        updateUndoIncremental();
         addNode(Re(i1[j]),Im(i1[j]),c/10000.);
         addNode(Re(i2[j]),Im(i2[j]),c/10000.);
         unselectAll();
@@ -1227,6 +1430,73 @@ bool femm::FemmProblem::createRadius(int n, double r)
     return false;
 }
 
+uint64_t femm::FemmProblem::meshFingerprint() const
+{
+    FNV1aHash hash;
+    auto addString = [&hash](const std::string &s) {
+        hash.add((uint64_t)s.size());
+        hash.add(s.data(), s.size());
+    };
+
+    hash.add(MinAngle);
+    hash.add(DoSmartMesh);
+    hash.add(DoForceMaxMeshArea);
+
+    hash.add((uint64_t)nodelist.size());
+    for (const auto &node: nodelist)
+    {
+        hash.add(node->x);
+        hash.add(node->y);
+        addString(node->BoundaryMarkerName);
+        addString(node->InConductorName);
+    }
+    hash.add((uint64_t)linelist.size());
+    for (const auto &line: linelist)
+    {
+        hash.add(line->n0);
+        hash.add(line->n1);
+        hash.add(line->MaxSideLength);
+        addString(line->BoundaryMarkerName);
+        addString(line->InConductorName);
+    }
+    hash.add((uint64_t)arclist.size());
+    for (const auto &arc: arclist)
+    {
+        hash.add(arc->n0);
+        hash.add(arc->n1);
+        hash.add(arc->ArcLength);
+        hash.add(arc->MaxSideLength);
+        addString(arc->BoundaryMarkerName);
+        addString(arc->InConductorName);
+    }
+    hash.add((uint64_t)labellist.size());
+    for (const auto &label: labellist)
+    {
+        hash.add(label->x);
+        hash.add(label->y);
+        hash.add(label->MaxArea);
+        hash.add(label->isHole());
+    }
+
+    // the mesh files refer to these properties by index:
+    hash.add((uint64_t)nodeproplist.size());
+    for (const auto &prop: nodeproplist)
+        addString(prop->PointName);
+    hash.add((uint64_t)circproplist.size());
+    for (const auto &prop: circproplist)
+        addString(prop->CircName);
+    hash.add((uint64_t)lineproplist.size());
+    for (const auto &prop: lineproplist)
+    {
+        addString(prop->BdryName);
+        // the mesher handles periodic and air gap boundary formats specially.
+        // The air gap angles are written into the .pbc file, too, but the magnetics solver
+        // updates them from the problem file, so that turning the rotor needs no new mesh.
+        hash.add(prop->BdryFormat);
+    }
+    return hash.value();
+}
+
 femm::EditMode femm::FemmProblem::defaultEditMode() const
 {
     return d_EditMode;
@@ -1240,9 +1510,16 @@ void femm::FemmProblem::setDefaultEditMode(femm::EditMode mode)
 bool femm::FemmProblem::deleteSelectedArcSegments()
 {
     size_t oldsize = arclist.size();
+    // if only the last arcs are removed, the spatial hash just needs to be truncated
+    size_t keep = oldsize;
+    while (keep>0 && arclist[keep-1]->IsSelected)
+        keep--;
 
     if (!arclist.empty())
     {
+        auto first = std::find_if(arclist.begin(), arclist.end(),
+                                  [](const std::unique_ptr<femm::CArcSegment>& arc){ return arc->IsSelected;} );
+        undoarclist.saveFrom(arclist, first-arclist.begin());
         // remove selected elements
         arclist.erase(
                     std::remove_if(arclist.begin(),arclist.end(),
@@ -1251,6 +1528,10 @@ bool femm::FemmProblem::deleteSelectedArcSegments()
                     );
     }
     arclist.shrink_to_fit();
+    if (arclist.size()==keep)
+        arcHash.truncate(keep);
+    else
+        arcHash.clear();
 
     return arclist.size() != oldsize;
 }
@@ -1261,6 +1542,9 @@ bool femm::FemmProblem::deleteSelectedBlockLabels()
 
     if (!labellist.empty())
     {
+        auto first = std::find_if(labellist.begin(), labellist.end(),
+                                  [](const std::unique_ptr<femm::CBlockLabel>& label){ return label->IsSelected;} );
+        undolabellist.saveFrom(labellist, first-labellist.begin());
         // remove selected elements
         labellist.erase(
                     std::remove_if(labellist.begin(),labellist.end(),
@@ -1298,11 +1582,14 @@ bool femm::FemmProblem::deleteSelectedNodes()
                 deleteSelectedArcSegments();
 
                 // remove node from the nodelist...
+                undonodelist.saveFrom(nodelist, i);
                 nodelist.erase(nodelist.begin()+i);
 
                 // update lines to point to the new node numbering
                 for (int j=0; j<(int)linelist.size(); j++)
                 {
+                    if (linelist[j]->n0>i || linelist[j]->n1>i)
+                        undolinelist.save(linelist, j);
                     if (linelist[j]->n0>i) linelist[j]->n0--;
                     if (linelist[j]->n1>i) linelist[j]->n1--;
                 }
@@ -1310,6 +1597,8 @@ bool femm::FemmProblem::deleteSelectedNodes()
                 // update arcs to point to the new node numbering
                 for (int j=0; j<(int)arclist.size(); j++)
                 {
+                    if (arclist[j]->n0>i || arclist[j]->n1>i)
+                        undoarclist.save(arclist, j);
                     if (arclist[j]->n0>i) arclist[j]->n0--;
                     if (arclist[j]->n1>i) arclist[j]->n1--;
                 }
@@ -1319,15 +1608,24 @@ bool femm::FemmProblem::deleteSelectedNodes()
     }
 
     nodelist.shrink_to_fit();
+    if (changed)
+        invalidateGeometryHash();
     return changed;
 }
 
 bool femm::FemmProblem::deleteSelectedSegments()
 {
     size_t oldsize = linelist.size();
+    // if only the last segments are removed, the spatial hash just needs to be truncated
+    size_t keep = oldsize;
+    while (keep>0 && linelist[keep-1]->IsSelected)
+        keep--;
 
     if (!linelist.empty())
     {
+        auto first = std::find_if(linelist.begin(), linelist.end(),
+                                  [](const std::unique_ptr<femm::CSegment>& segm){ return segm->IsSelected;} );
+        undolinelist.saveFrom(linelist, first-linelist.begin());
         // remove selected elements
         linelist.erase(
                     std::remove_if(linelist.begin(),linelist.end(),
@@ -1336,6 +1634,10 @@ bool femm::FemmProblem::deleteSelectedSegments()
                     );
     }
     linelist.shrink_to_fit();
+    if (linelist.size()==keep)
+        lineHash.truncate(keep);
+    else
+        lineHash.clear();
 
     return linelist.size() != oldsize;
 }
@@ -1352,6 +1654,9 @@ void femm::FemmProblem::enforcePSLG(double tol)
     newlinelist.swap(linelist);
     newarclist.swap(arclist);
     newlabellist.swap(labellist);
+    invalidateGeometryHash();
+    // the selection is cleared at the end anyway
+    rebuildingGeometry = true;
 
     // find out what tolerance is so that there are not nodes right on
     // top of each other;
@@ -1375,10 +1680,14 @@ void femm::FemmProblem::enforcePSLG(double tol)
         }
     }
 
+    // find out whether the entities that existed at the undo point keep their numbers:
+    bool keepNodes = ((int)newnodelist.size() >= undonodelist.savedFrom());
+
     // put in all of the nodes;
-    for (const auto &node: newnodelist)
+    for (int i=0; i<(int)newnodelist.size(); i++)
     {
-        addNode(node->clone(), d);
+        if (!addNode(newnodelist[i]->clone(), d) && i<undonodelist.savedFrom())
+            keepNodes = false;
     }
 
     // put in all of the lines;
@@ -1409,18 +1718,62 @@ void femm::FemmProblem::enforcePSLG(double tol)
 
         CComplex p0 (newnodelist[arc->n0]->x, newnodelist[arc->n0]->y);
         CComplex p1 (newnodelist[arc->n1]->x, newnodelist[arc->n1]->y);
-        arc->n0 = closestNode(p0.re,p0.im);
-        arc->n1 = closestNode(p1.re,p1.im);
-        // using the raw pointer is ok here, because AddArcSegment creates a copy anyways
-        addArcSegment(*arc.get(), d);
+        // work on a copy, so that newarclist can serve as undo state
+        CArcSegment newarc = *arc;
+        newarc.n0 = closestNode(p0.re,p0.im);
+        newarc.n1 = closestNode(p1.re,p1.im);
+        addArcSegment(newarc, d);
     }
 
     // put in all of the block labels;
+    std::vector<const CBlockLabel*> oldlabels;
+    oldlabels.reserve(newlabellist.size());
     for (auto &label: newlabellist)
     {
+        oldlabels.push_back(label.get());
         addBlockLabel(std::move(label), d);
     }
 
+    rebuildingGeometry = false;
+
+    // Where the rebuilt lists don't start with the old entities in the old order,
+    // the undo state needs the whole list. The old entities serve that purpose,
+    // because they have not been changed since they were saved:
+    if (!keepNodes)
+        undonodelist.takeRemaining(newnodelist);
+    for (int i=0; i<undolinelist.savedFrom(); i++)
+    {
+        if (i>=(int)linelist.size() || i>=(int)newlinelist.size()
+                || linelist[i]->n0!=newlinelist[i]->n0 || linelist[i]->n1!=newlinelist[i]->n1)
+        {
+            undolinelist.takeRemaining(newlinelist);
+            break;
+        }
+    }
+    for (int i=0; i<undoarclist.savedFrom(); i++)
+    {
+        if (i>=(int)arclist.size() || i>=(int)newarclist.size()
+                || arclist[i]->n0!=newarclist[i]->n0 || arclist[i]->n1!=newarclist[i]->n1
+                || arclist[i]->ArcLength!=newarclist[i]->ArcLength)
+        {
+            undoarclist.takeRemaining(newarclist);
+            break;
+        }
+    }
+    for (int i=0; i<undolabellist.savedFrom(); i++)
+    {
+        if (i>=(int)labellist.size() || i>=(int)oldlabels.size() || labellist[i].get()!=oldlabels[i])
+        {
+            // labels that were not rejected have been moved to labellist and need to be copied
+            for (int j=0; j<undolabellist.savedFrom() && j<(int)newlabellist.size(); j++)
+            {
+                if (!newlabellist[j])
+                    undolabellist.save(j, *oldlabels[j]);
+            }
+            undolabellist.takeRemaining(newlabellist);
+            break;
+        }
+    }
     unselectAll();
 }
 
@@ -1948,10 +2301,12 @@ void femm::FemmProblem::rotateMove(CComplex c, double t, femm::EditMode selector
 
     if(selector==EditMode::EditLabels || selector==EditMode::EditGroup)
     {
-        for (auto &label: labellist)
+        for (int i=0; i<(int)labellist.size(); i++)
         {
+            auto &label = labellist[i];
             if (label->IsSelected)
             {
+                undolabellist.save(labellist, i);
                 CComplex x (label->x, label->y);
                 x = (x-c)*z+c;
                 label->x = x.re;
@@ -1975,10 +2330,12 @@ void femm::FemmProblem::rotateMove(CComplex c, double t, femm::EditMode selector
 
     if(processNodes)
     {
-        for (auto &node : nodelist)
+        for (int i=0; i<(int)nodelist.size(); i++)
         {
+            auto &node = nodelist[i];
             if (node->IsSelected)
             {
+                undonodelist.save(nodelist, i);
                 CComplex x(node->x,node->y);
                 x = (x-c)*z+c;
                 node->x = x.re;
@@ -2022,10 +2379,12 @@ void femm::FemmProblem::scaleMove(double bx, double by, double sf, femm::EditMod
 
     if (selector==EditMode::EditLabels || selector==EditMode::EditGroup)
     {
-        for (auto &label: labellist)
+        for (int i=0; i<(int)labellist.size(); i++)
         {
+            auto &label = labellist[i];
             if (label->IsSelected)
             {
+                undolabellist.save(labellist, i);
                 label->x = bx+sf*(label->x - bx);
                 label->y = by+sf*(label->y - by);
                 label->MaxArea *= (sf*sf);
@@ -2035,10 +2394,12 @@ void femm::FemmProblem::scaleMove(double bx, double by, double sf, femm::EditMod
 
     if (processNodes)
     {
-        for (auto &node : nodelist)
+        for (int i=0; i<(int)nodelist.size(); i++)
         {
+            auto &node = nodelist[i];
             if (node->IsSelected)
             {
+                undonodelist.save(nodelist, i);
                 node->x = bx+sf*(node->x - bx);
                 node->y = by+sf*(node->y - by);
             }
@@ -2242,10 +2603,12 @@ void femm::FemmProblem::translateMove(double dx, double dy, femm::EditMode selec
 
     if (selector == EditMode::EditLabels || selector == EditMode::EditGroup)
     {
-        for (auto &lbl: labellist)
+        for (int i=0; i<(int)labellist.size(); i++)
         {
+            auto &lbl = labellist[i];
             if (lbl->IsSelected)
             {
+                undolabellist.save(labellist, i);
                 lbl->x += dx;
                 lbl->y += dy;
             }
@@ -2253,10 +2616,12 @@ void femm::FemmProblem::translateMove(double dx, double dy, femm::EditMode selec
     }
     if (processNodes)
     {
-        for (auto &node: nodelist)
+        for (int i=0; i<(int)nodelist.size(); i++)
         {
+            auto &node = nodelist[i];
             if (node->IsSelected)
             {
+                undonodelist.save(nodelist, i);
                 node->x += dx;
                 node->y += dy;
             }
@@ -2267,47 +2632,13 @@ void femm::FemmProblem::translateMove(double dx, double dy, femm::EditMode selec
 
 int femm::FemmProblem::ClosestNode(const double x, const double y) const
 {
-    int i,j;
-    double d0,d1;
-
-    if(nodelist.size()==0) return -1;
-
-    j=0;
-    d0=nodelist[0]->GetDistance(x,y);
-    for(i=0; i<(int)nodelist.size(); i++)
-    {
-        d1=nodelist[i]->GetDistance(x,y);
-        if(d1<d0)
-        {
-            d0=d1;
-            j=i;
-        }
-    }
-
-    return j;
+    return closestNode(x,y);
 }
 
 
 int femm::FemmProblem::ClosestArcSegment(double x, double y) const
 {
-    double d0,d1;
-    int i,j;
-
-    if(arclist.size()==0) return -1;
-
-    j=0;
-    d0=ShortestDistanceFromArc(CComplex(x,y),*(arclist[0]));
-    for(i=0; i<(int)arclist.size(); i++)
-    {
-        d1=ShortestDistanceFromArc(CComplex(x,y),*(arclist[i]));
-        if(d1<d0)
-        {
-            d0=d1;
-            j=i;
-        }
-    }
-
-    return j;
+    return closestArcSegment(x,y);
 }
 
 void femm::FemmProblem::GetCircle(const CArcSegment &arc, CComplex &c, double &R) const
@@ -2381,20 +2712,17 @@ void femm::FemmProblem::unselectAll()
 
 void femm::FemmProblem::undo()
 {
-    for(int i=0; i<(int)undolinelist.size(); i++)
-        linelist[i].swap(undolinelist[i]);
-    for(int i=0; i<(int)undoarclist.size(); i++)
-        arclist[i].swap(undoarclist[i]);
-    for(int i=0; i<(int)undolabellist.size(); i++)
-        labellist[i].swap(undolabellist[i]);
-    for(int i=0; i<(int)undonodelist.size(); i++)
-        nodelist[i].swap(undonodelist[i]);
+    undolinelist.restore(linelist);
+    undoarclist.restore(arclist);
+    undolabellist.restore(labellist);
+    undonodelist.restore(nodelist);
+    invalidateGeometryHash();
 }
 
 void femm::FemmProblem::undoLines()
 {
-    for(int i=0; i<(int)undolinelist.size(); i++)
-        linelist[i].swap(undolinelist[i]);
+    undolinelist.restore(linelist);
+    lineHash.clear();
 }
 
 void femm::FemmProblem::undoArcs()
@@ -2402,26 +2730,28 @@ void femm::FemmProblem::undoArcs()
 	for(int i=0;i<(int)arclist.size();i++)
 	{
 		arclist[i]->mySideLength=arclist[i]->MaxSideLength;
-		arclist[i]->MaxSideLength=undoarclist[i]->MaxSideLength;
+		if (const CArcSegment *arc = undoarclist.saved(i))
+			arclist[i]->MaxSideLength=arc->MaxSideLength;
 	}
 }
 
 void femm::FemmProblem::updateUndo()
 {
-    undonodelist.clear();
-    undolinelist.clear();
-    undoarclist.clear();
-    undolabellist.clear();
+    updateUndoIncremental();
 
     // copy each entry
-    for(const auto& node: nodelist)
-        undonodelist.push_back(node->clone());
-    for(const auto& line: linelist)
-        undolinelist.push_back(line->clone());
-    for(const auto& arc: arclist)
-        undoarclist.push_back(MAKE_UNIQUE<CArcSegment>(*arc));
-    for(const auto& label: labellist)
-        undolabellist.push_back(label->clone());
+    undonodelist.saveFrom(nodelist, 0);
+    undolinelist.saveFrom(linelist, 0);
+    undoarclist.saveFrom(arclist, 0);
+    undolabellist.saveFrom(labellist, 0);
+}
+
+void femm::FemmProblem::updateUndoIncremental()
+{
+    undonodelist.reset(nodelist.size());
+    undolinelist.reset(linelist.size());
+    undoarclist.reset(arclist.size());
+    undolabellist.reset(labellist.size());
 }
 
 femm::FemmProblem::FemmProblem(FileType ftype)
@@ -2458,6 +2788,11 @@ femm::FemmProblem::FemmProblem(FileType ftype)
     , blockMap()
     , circuitMap()
     , d_EditMode( EditMode::Invalid )
+    , nodeHash()
+    , lineHash()
+    , arcHash()
+    , geometryHashBase(0)
+    , rebuildingGeometry(false)
     , undonodelist()
     , undolinelist()
     , undoarclist()
@@ -31,6 +31,7 @@
 #include "CSegment.h"
 #include "femmenums.h"
 #include "fparse.h"
+#include "spatialIndex.h"
 
 #include <map>
 #include <memory>
@@ -51,6 +52,12 @@ class CMaterialProp;
  * \note
  * Currently, the FemmProblem is only used by the mesher and in lua code.
  *
+ * \note
+ * FemmProblem is not thread-safe, not even for const access:
+ * closestNode(), closestSegment(), closestArcSegment() and defaultTolerance() bring the spatial hashes up to date
+ * on demand, which modifies them.
+ * Concurrent calls of these methods must be serialized by the caller.
+ *
  * \internal
  * In contrast to FEMM42 and older XFemm classes we use vectors of pointers, not vectors of objects.
  * This allows us to use inheritance to have a common data description which can be used for mesher, solver and pproc.
@@ -122,6 +129,16 @@ public:
      * Call this function whenever the node properties change (i.e. whenever a new element is added or a PointName changes).
      */
     void updateNodeMap();
+    /**
+     * @brief Discard the spatial hashes of nodes, lines and arcs.
+     * The hashes are kept up to date by the member functions of FemmProblem,
+     * and entities that are appended to the lists are picked up automatically.
+     * Call this function if you move nodes, or remove entities from the lists directly.
+     *
+     * The hashes are rebuilt by the next query (e.g. closestNode()),
+     * so the queries must not be called concurrently (see the class description).
+     */
+    void invalidateGeometryHash();
 
     /**
      * @brief Add an arc segment to the problem description.
@@ -210,8 +227,26 @@ public:
      * The cnt fields in (arc) segments are used to store notation data by the mesher and other places.
      */
     void clearNotationTags();
+    /**
+     * @brief Compute the default tolerance for adding nodes, lines, arcs and block labels.
+     * @return a small fraction (CLOSE_ENOUGH) of the diagonal of the nodes' bounding box, or 1e-08 if there are less than two nodes.
+     */
+    double defaultTolerance() const;
+    /**
+     * @brief Compute a fingerprint of everything that goes into the mesh.
+     * This covers the nodes, segments, arc segments and block labels with their mesh sizes and boundary/conductor assignments,
+     * the names of the point, boundary and conductor properties (the mesh files refer to them by index),
+     * the boundary formats, and the mesher settings (MinAngle, DoSmartMesh, DoForceMaxMeshArea).
+     *
+     * If two problems have the same fingerprint, meshing them results in the same mesh files,
+     * except for the air gap angles in the .pbc file (see FSolver::runSolver()).
+     * Material and source properties, and boundary values other than the format, do not change the fingerprint.
+     * @return a 64 bit hash value
+     */
+    uint64_t meshFingerprint() const;
     /**
      * @brief Find the closest arc segment for the given coordinates
+     * The spatial hashes are updated on demand, so this method must not be called concurrently.
      * @param x
      * @param y
      * @return an arc segment index, or -1 if the arclist is empty
@@ -228,6 +263,7 @@ public:
 
     /**
      * @brief Find the closest node for the given coordinates
+     * The spatial hashes are updated on demand, so this method must not be called concurrently.
      * @param x
      * @param y
      * @return a node index, or -1 if the nodelist is empty
@@ -236,6 +272,7 @@ public:
 
     /**
      * @brief Find the closest line segment for the given coordinates
+     * The spatial hashes are updated on demand, so this method must not be called concurrently.
      * @param x
      * @param y
      * @return a segment index, or -1 if the linelist is empty
@@ -490,9 +527,19 @@ public:
      */
     void undoArcs();
     /**
-     * @brief Create an undo point.
+     * @brief Create an undo point by copying all nodes, segments, arc segments and block labels.
+     * Use this before changing the entity lists directly.
      */
     void updateUndo();
+    /**
+     * @brief Create an undo point without copying the geometry.
+     * The editing methods (e.g. addNode(), deleteSelectedNodes(), translateMove(), rotateMove() and enforcePSLG())
+     * save a copy of each entity before they change it for the first time,
+     * so that an edit only costs time proportional to the number of entities it touches.
+     *
+     * Changes made directly to the entity lists are not recorded, and neither are the selection and the notation tags.
+     */
+    void updateUndoIncremental();
 public: // data members
     double FileFormat; ///< \brief format version of the file
     double Frequency;  ///< \brief Frequency for harmonic problems [Hz]
@@ -538,12 +585,70 @@ public: // data members
     std::map<std::string, int> nodeMap; ///< \brief a map from PointName to node index. \sa updateNodeMap
 
 private:
+    /**
+     * @brief Bring the spatial hashes up to date with nodelist, linelist and arclist.
+     * New entities are added to the hashes.
+     * The cell size is chosen anew (about one node per cell) whenever the number of nodes has doubled.
+     */
+    void updateGeometryHash() const;
+    /**
+     * @brief Compute a bounding box of an arc segment.
+     * @param arc
+     * @param xmin
+     * @param ymin
+     * @param xmax
+     * @param ymax
+     */
+    void arcBoundingBox(const femm::CArcSegment &arc, double &xmin, double &ymin, double &xmax, double &ymax) const;
+
     femm::EditMode d_EditMode;
-    // lists of nodes, segments, and block labels for undo purposes...
-    std::vector< std::unique_ptr<femm::CNode> >       undonodelist;
-    std::vector< std::unique_ptr<femm::CSegment> >    undolinelist;
-    std::vector< std::unique_ptr<femm::CArcSegment> > undoarclist;
-    std::vector< std::unique_ptr<femm::CBlockLabel> > undolabellist;
+    // spatial hashes used for proximity and intersection tests while editing the geometry:
+    mutable femm::BoxHash nodeHash;
+    mutable femm::BoxHash lineHash;
+    mutable femm::BoxHash arcHash;
+    // number of nodes when the cell size of the hashes was chosen
+    mutable int geometryHashBase;
+    // set while enforcePSLG() re-adds the geometry; addSegment() and addArcSegment() don't clear the selection then
+    bool rebuildingGeometry;
+
+    /**
+     * @brief The UndoStore class holds the state of an entity list at the undo point.
+     * Only the entities that have been changed since the undo point are stored.
+     *
+     * Entities below savedFrom() still have the index they had at the undo point,
+     * all entities from savedFrom() on have been saved.
+     */
+    template <class T>
+    class UndoStore
+    {
+    public:
+        /// \brief Start a new undo point for a list with \p size entities.
+        void reset(std::size_t size);
+        /// \brief Save a copy of \p entity as entity \p i, unless entity \p i is saved already.
+        void save(int i, const T &entity);
+        /// \brief Save a copy of list[i], unless it is saved already.
+        void save(const std::vector<std::unique_ptr<T>> &list, int i);
+        /// \brief Save all entities from \p first on, before they are erased or renumbered.
+        void saveFrom(const std::vector<std::unique_ptr<T>> &list, int first);
+        /// \brief Take over the entities of \p oldlist that are not saved yet.
+        /// \p oldlist must be a list of the entities that has not been renumbered since the undo point.
+        void takeRemaining(std::vector<std::unique_ptr<T>> &oldlist);
+        /// \brief Swap the saved entities into \p list.
+        void restore(std::vector<std::unique_ptr<T>> &list);
+        /// \brief Get the saved entity \p i, or \c nullptr if the entity hasn't changed.
+        const T *saved(int i) const;
+        /// \brief Get the number of unsaved entities at the start of the list.
+        int savedFrom() const { return m_savedFrom; }
+    private:
+        std::map<int, std::unique_ptr<T>> m_saved;
+        int m_savedFrom = 0;
+    };
+
+    // nodes, segments, and block labels for undo purposes...
+    UndoStore<femm::CNode>       undonodelist;
+    UndoStore<femm::CSegment>    undolinelist;
+    UndoStore<femm::CArcSegment> undoarclist;
+    UndoStore<femm::CBlockLabel> undolabellist;
 };
 
 
@@ -84,14 +84,19 @@ template< class PointPropT
 ParserResult FemmReader<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT>
 ::parse(const std::string &file)
 {
-    std::ifstream input;
-
-    input.open(file.c_str(), std::ifstream::in);
-    if (!input.is_open())
+    std::ifstream inputFile;
+    // holds the problem description if the file only references it (see [ProblemFile])
+    std::filebuf problemFile;
+    // fingerprint of the referenced problem file at solution time (see [ProblemFileHash])
+    std::string problemFileHash;
+
+    inputFile.open(file.c_str(), std::ifstream::in);
+    if (!inputFile.is_open())
     {
         err << "Couldn't read from file " << file<< "\n";
         return F_FILE_NOT_OPENED;
     }
+    std::istream input(inputFile.rdbuf());
     problem->pathName = file;
 
     // parse the file
@@ -102,10 +107,18 @@ ParserResult FemmReader<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLa
 
     bool success = true;
     bool readSolutionData = false;
-    while (input.good() && success)
+    while (success)
     {
-        if (input.eof())
+        if (!input.good() || input.eof())
+        {
+            // continue with the solution file after the referenced problem file has been read
+            if (input.rdbuf() == &problemFile)
+            {
+                input.rdbuf(inputFile.rdbuf());
+                continue;
+            }
             break;
+        }
 
         std::string line;
         std::getline(input, line);
@@ -592,6 +605,45 @@ ParserResult FemmReader<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLa
             break;
         }
 
+        if (token == "[problemfilehash]")
+        {
+            success &= expectChar(lineStream, '=', err);
+            success &= parseString(lineStream, &problemFileHash, err);
+            continue;
+        }
+
+        // the problem description is stored in a separate file
+        if (token == "[problemfile]")
+        {
+            std::string problemFileName;
+            success &= expectChar(lineStream, '=', err);
+            success &= parseString(lineStream, &problemFileName, err);
+            if (!success)
+                break;
+            if (input.rdbuf() == &problemFile)
+            {
+                err << "Nested [ProblemFile] references are not supported\n";
+                success = false;
+                break;
+            }
+            problemFileName = resolveRelativePath(problemFileName, file);
+            if (!problemFileHash.empty() && fileFingerprint(problemFileName) != problemFileHash)
+            {
+                err << "Problem file " << problemFileName << " has been changed since the solution was computed.\n"
+                    << "Re-analyze the problem.\n";
+                success = false;
+                break;
+            }
+            if (!problemFile.open(problemFileName.c_str(), std::ios_base::in))
+            {
+                err << "Couldn't read from problem file " << problemFileName << "\n";
+                success = false;
+                break;
+            }
+            input.rdbuf(&problemFile);
+            continue;
+        }
+
         // fall-through; token was not used
         if (!handleToken(token, lineStream, err))
         {
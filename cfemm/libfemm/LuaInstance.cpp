@@ -114,6 +114,21 @@ CComplex femm::LuaInstance::getGlobal(const std::string &varName, bool *ok)
     return value;
 }
 
+std::string femm::LuaInstance::getGlobalString(const std::string &varName, bool *ok)
+{
+    lua_getglobal(lua, varName.c_str()); //+1
+
+    bool isString = lua_isstring(lua,-1);
+    std::string value;
+    if (isString)
+        value = lua_tostring(lua,-1);
+    if (ok!=nullptr)
+        *ok = isString;
+    lua_pop(lua, 1); //-1
+
+    return value;
+}
+
 void femm::LuaInstance::setGlobal(const std::string &varName, CComplex val)
 {
     lua_pushnumber(lua, val); //+1
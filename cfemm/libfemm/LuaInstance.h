@@ -108,6 +108,14 @@ public:
      */
     CComplex getGlobal( const std::string &varName, bool *ok=nullptr );
 
+    /**
+     * @brief Get a global lua string variable.
+     * @param varName the name of the global variable
+     * @param ok if not \c nullptr, this variable is set to \c true if \p varName could be retrieved, \c false otherwise.
+     * @return The variable value, or an empty string on error
+     */
+    std::string getGlobalString( const std::string &varName, bool *ok=nullptr );
+
     /**
      * @brief Set a global lua variable.
      * @param varName the name of the global variable
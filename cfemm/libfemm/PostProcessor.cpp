@@ -174,7 +174,7 @@ void PostProcessor::addContourPointFromNode(double mx, double my)
 {
     if (!problem->nodelist.empty())
     {
-        int n0=problem->closestNode(mx,my);
+        int n0=closestNode(mx,my);
 
         int lineno=-1;
         int arcno=-1;
@@ -191,7 +191,7 @@ void PostProcessor::addContourPointFromNode(double mx, double my)
         if (y==z)
             return;
 
-        int n1 = problem->closestNode(y.re,y.im);
+        int n1 = closestNode(y.re,y.im);
         CComplex x(problem->nodelist[n1]->x,problem->nodelist[n1]->y);
 
         //check to see if this point and the last point are ends of an
@@ -296,62 +296,58 @@ void PostProcessor::addContourPointFromNode(double mx, double my)
 }
 
 
-// identical in EPProc, FPProc and HPProc
-int femm::PostProcessor::InTriangle(double x, double y) const
+void femm::PostProcessor::buildElementGrid()
 {
-    static int k=0;
-    int j,hi,lo,sz;
-    double z;
-
-    sz = meshelems.size();
-
-    if ((k < 0) || (k >= sz)) k = 0;
-
-    // In most applications, the triangle we're looking
-    // for is nearby the last one we found.  Since the elements
-    // are ordered in a banded structure, we want to check the
-    // elements nearby the last one selected first.
-    if (InTriangleTest(x,y,k)) return k;
-
-    // wasn't in the last searched triangle, so look through all the
-    // elements
-    hi = k;
-    lo = k;
+    elementGrid.build((int)meshelems.size(), [this](int i, int j) {
+        const femmsolver::CMeshNode *node = meshnodes[meshelems[i]->p[j]].get();
+        return CComplex(node->x, node->y);
+    });
+}
 
-    for(j=0; j<sz; j+=2)
+void femm::PostProcessor::buildLabelElements()
+{
+    labelElements.assign(problem->labellist.size(), std::vector<int>());
+    for (int i=0; i<(int)meshelems.size(); i++)
     {
-        hi++;
-        if (hi >= sz) hi = 0;
-        lo--;
-        if (lo < 0)   lo = sz - 1;
-
-        CComplex hiCtr = meshelems[hi]->ctr;
-        z = (hiCtr.re - x) * (hiCtr.re - x) + (hiCtr.im - y) * (hiCtr.im - y);
-
-        if (z <= meshelems[hi]->rsqr)
-        {
-            if (InTriangleTest(x,y,hi))
-            {
-                k = hi;
-                return k;
-            }
-        }
+        int lbl = meshelems[i]->lbl;
+        if (lbl>=0 && lbl<(int)labelElements.size())
+            labelElements[lbl].push_back(i);
+    }
+}
 
-        CComplex loCtr = meshelems[lo]->ctr;
-        z = (loCtr.re-x)*(loCtr.re-x) + (loCtr.im-y)*(loCtr.im-y);
+void femm::PostProcessor::buildNodeTree()
+{
+    nodeTree.buildPoints((int)problem->nodelist.size(), [this](int i) {
+        return CComplex(problem->nodelist[i]->x, problem->nodelist[i]->y);
+    });
+}
 
-        if (z <= meshelems[lo]->rsqr)
-        {
-            if (InTriangleTest(x,y,lo))
-            {
-                k = lo;
-                return k;
-            }
-        }
+int femm::PostProcessor::closestNode(double x, double y) const
+{
+    if (nodeTree.empty())
+        return problem->closestNode(x,y);
+    return nodeTree.nearest(x, y, [this,x,y](int i) {
+        return problem->nodelist[i]->GetDistance(x,y);
+    });
+}
 
+std::vector<int> femm::PostProcessor::selectedElements() const
+{
+    std::vector<int> elements;
+    for (int lbl=0; lbl<(int)labelElements.size(); lbl++)
+    {
+        if (problem->labellist[lbl]->IsSelected)
+            elements.insert(elements.end(), labelElements[lbl].begin(), labelElements[lbl].end());
     }
+    return elements;
+}
 
-    return (-1);
+// identical in EPProc, FPProc and HPProc
+int femm::PostProcessor::InTriangle(double x, double y) const
+{
+    return elementGrid.find(x, y, [this,x,y](int i) {
+        return InTriangleTest(x,y,i);
+    });
 }
 
 // EPProc  and FPProc are identical
@@ -900,7 +896,7 @@ void PostProcessor::getNodalD(CComplex *d, int N) const
     int i,j,k,n,m,p,eos,nos,qn;
     int lf,rt;
     double xi,yi,ii,xx,xy,yy,iv,xv,yv,dx,dy,dv,Ex,Ey,det;
-    static int q[21];
+    int q[21];
     bool flag;
 
     const auto *elem = reinterpret_cast<const femmsolver::CHSElement*>(meshelems[N].get());
@@ -1106,6 +1102,7 @@ void femm::PostProcessor::FindBoundaryEdges()
         for(j = 0; j < 3; j ++)
             meshelems[i]->n[j] = 0;
     }
+    elementNeighbours.assign(3*meshelems.size(), -1);
 
     int orgi, desti;
     int ei, ni;
@@ -1140,6 +1137,8 @@ void femm::PostProcessor::FindBoundaryEdges()
                         break;
                     }
                 }
+                if (done)
+                    elementNeighbours[3*i+j] = ei;
                 if (!done) {
                     // This edge must be a Boundary Edge.
                     meshelems[i]->n[j] = 1;
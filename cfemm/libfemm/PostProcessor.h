@@ -30,7 +30,16 @@
 #include "femmcomplex.h"
 #include "fparse.h"
 #include "FemmProblem.h"
-
+#include "make_unique.h"
+#include "meshWalk.h"
+#include "parallelTools.h"
+#include "rasterTools.h"
+#include "spatialIndex.h"
+
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
 #include <vector>
 
 namespace femm {
@@ -237,6 +246,14 @@ protected:
     // mesh data
     std::vector< std::unique_ptr<femmsolver::CMeshNode>>   meshnodes;
     std::vector< std::unique_ptr<femmsolver::CElement>> meshelems;
+    // spatial index over meshelems, used by InTriangle()
+    TriangleGrid elementGrid;
+    // spatial index over problem->nodelist, used by closestNode()
+    BoxTree nodeTree;
+    // labelElements[lbl] lists the elements of block label lbl, in ascending order
+    std::vector< std::vector<int> > labelElements;
+    // elementNeighbours[3*i+j] is the element across the edge opposite corner j of element i, or -1 (set by FindBoundaryEdges())
+    std::vector<int> elementNeighbours;
 
     // List of elements connected to each node;
     int *NumList;
@@ -299,9 +316,103 @@ protected:
      */
     void getPointD(double x, double y, CComplex &D, const femmsolver::CElement &element) const;
 
+    /**
+     * @brief Build the spatial index used by InTriangle().
+     * Needs to be called after the mesh has been loaded.
+     */
+    void buildElementGrid();
+    /**
+     * @brief Build the element lists of the block labels used by selectedElements().
+     * Needs to be called after the mesh has been loaded.
+     */
+    void buildLabelElements();
+    /**
+     * @brief Build the spatial index over the input nodes used by closestNode().
+     * Needs to be called after the problem geometry has been loaded.
+     */
+    void buildNodeTree();
+    /**
+     * @brief Find the input node closest to a point.
+     * The result is the same as for FemmProblem::closestNode(), but uses the spatial index if it has been built.
+     * @param x
+     * @param y
+     * @return the node index, or -1 if there are no nodes.
+     */
+    int closestNode(double x, double y) const;
+    /**
+     * @brief Get the elements of all selected blocks.
+     * @return the element indices, grouped by block label
+     */
+    std::vector<int> selectedElements() const;
     int InTriangle(double x, double y) const;
+    /**
+     * @brief Locate several points in the mesh, and call \p evaluate(k,elm) for each point \c k inside the mesh.
+     * The points are processed in the order of the spatial index, using several threads.
+     * @param n the number of points
+     * @param x array of \p n x coordinates
+     * @param y array of \p n y coordinates
+     * @param inMesh array of \p n flags, set to \c true for points inside the mesh.
+     * @param evaluate a callable with the signature \c void(int k,int elm); must be safe to call concurrently.
+     * @return the number of points inside the mesh
+     */
+    template <class EvaluateFunc>
+    int evaluatePoints(int n, const double *x, const double *y, bool *inMesh, EvaluateFunc evaluate) const
+    {
+        std::vector<int> elm(n);
+        std::vector<int> found = elementGrid.findAll(n, x, y, [this,x,y](int k, int i) {
+            return InTriangleTest(x[k],y[k],i);
+        }, elm.data());
+        for (int k=0; k<n; k++)
+            inMesh[k] = (elm[k]>=0);
+        parallelFor(static_cast<int>(found.size()), [&](int begin, int end) {
+            for (int q=begin; q<end; q++)
+                evaluate(found[q], elm[found[q]]);
+        }, 256);
+        return static_cast<int>(found.size());
+    }
+    /**
+     * @brief Sample the solution on a regular grid (see femm::rasterizeTriangles() and femm::evaluateRaster()).
+     * @param grid the grid
+     * @param numPlanes the number of values per grid point
+     * @param evaluate a callable with the signature \c void(double x,double y,int elm,float *v); must be safe to call concurrently.
+     * @param values receives numPlanes*grid.size() values, plane by plane; NaN for points outside the mesh.
+     * @return the number of grid points inside the mesh
+     */
+    template <class EvaluateFunc>
+    int rasterize(const RasterGrid &grid, int numPlanes, EvaluateFunc evaluate, std::vector<float> &values) const
+    {
+        std::vector<int> owner(grid.size());
+        int count = rasterizeTriangles((int)meshelems.size(), grid,
+            [this](int elm, int j) {
+                const femmsolver::CMeshNode *node = meshnodes[meshelems[elm]->p[j]].get();
+                return CComplex(node->x, node->y);
+            },
+            [this](double x, double y, int elm) { return InTriangleTest(x,y,elm); },
+            owner.data());
+        evaluateRaster(grid, owner.data(), numPlanes, evaluate, values);
+        return count;
+    }
     // currently virtual until we merge hpproc version of it:
     virtual bool InTriangleTest(double x, double y, int i) const;
+    /**
+     * @brief Integrate along a straight contour segment, element by element (see femm::integrateLine()).
+     * Requires the element neighbours, i.e. FindBoundaryEdges() must have been called.
+     * @param p0 start of the segment
+     * @param p1 end of the segment
+     * @param integrand a callable with the signature \c void(int elm,CComplex p,double dz)
+     */
+    template <class IntegrandFunc>
+    void integrateContourSegment(CComplex p0, CComplex p1, IntegrandFunc integrand) const
+    {
+        integrateLine(p0, p1, d_LineIntegralPoints,
+            [this](int elm, int j) {
+                const femmsolver::CMeshNode *node = meshnodes[meshelems[elm]->p[j]].get();
+                return CComplex(node->x, node->y);
+            },
+            [this](int elm, int j) { return elementNeighbours[3*elm+j]; },
+            [this](CComplex p) { return InTriangle(p.re, p.im); },
+            integrand);
+    }
 
     /**
      * @brief isKosher
@@ -346,6 +457,43 @@ protected:
     CComplex HenrotteVector(int k) const;
     void FindBoundaryEdges();
 
+    /**
+     * @brief Read \p count records (mesh nodes or elements) from \p input.
+     * The lines are read sequentially, but parsed in parallel using \c RecordT::fromStream().
+     * @param input input stream
+     * @param count the number of records (one per line)
+     * @param records the records are stored here, in file order
+     * @param err output stream for error messages
+     * @param fixup called for each parsed record before it is stored
+     */
+    template <class RecordT, class BaseT, class FixupFunc>
+    void parseRecords(std::istream &input, int count, std::vector<std::unique_ptr<BaseT>> &records, std::ostream &err, FixupFunc fixup) const
+    {
+        std::vector<std::string> lines(count);
+        for(int i=0; i<count; i++)
+            std::getline(input, lines[i]);
+
+        size_t offset = records.size();
+        records.resize(offset+count);
+        // error messages of each chunk, keyed by the first line of the chunk
+        std::map<int,std::string> errors;
+        std::mutex errorMutex;
+        parallelFor(count, [&](int begin, int end) {
+            std::ostringstream chunkErr;
+            for(int i=begin; i<end; i++)
+            {
+                std::istringstream lineStream(lines[i]);
+                RecordT record = RecordT::fromStream(lineStream, chunkErr);
+                fixup(record);
+                records[offset+i] = MAKE_UNIQUE<RecordT>(record);
+            }
+            std::lock_guard<std::mutex> lock(errorMutex);
+            errors[begin] = chunkErr.str();
+        });
+        for (const auto &msg : errors)
+            err << msg.second;
+    }
+
     // pointer to function to call when issuing warning messages
     MessageCB WarnMessage;
     //	void MsgBox(const char* message);
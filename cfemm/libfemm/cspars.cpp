@@ -48,7 +48,7 @@ CBigComplexLinProb::~CBigComplexLinProb()
 {
     if (n==0) return;
 
-    int i;
+    SparseIndex i;
     CComplexEntry *uo,*ui;
 
     free(b);
@@ -116,9 +116,9 @@ CBigComplexLinProb::~CBigComplexLinProb()
     }
 }
 
-int CBigComplexLinProb::Create(int d, int bw, int nodes)
+int CBigComplexLinProb::Create(SparseIndex d, SparseIndex bw, SparseIndex nodes)
 {
-    int i;
+    SparseIndex i;
 
     bdw=bw;
     NumNodes=nodes;
@@ -144,10 +144,10 @@ int CBigComplexLinProb::Create(int d, int bw, int nodes)
     return 1;
 }
 
-void CBigComplexLinProb::Put(CComplex v, int p, int q, int k)
+void CBigComplexLinProb::Put(CComplex v, SparseIndex p, SparseIndex q, int k)
 {
     CComplexEntry *e,*l = NULL;
-    int i;
+    SparseIndex i;
 
     if(q<p)
     {
@@ -232,14 +232,14 @@ void CBigComplexLinProb::Put(CComplex v, int p, int q, int k)
     return;
 }
 
-CComplex CBigComplexLinProb::Get(int p, int q, int k)
+CComplex CBigComplexLinProb::Get(SparseIndex p, SparseIndex q, int k)
 {
     CComplexEntry *e;
     bool flip = false;
 
     if(q<p)
     {
-        int i;
+        SparseIndex i;
         i=p;
         p=q;
         q=i;
@@ -282,14 +282,14 @@ CComplex CBigComplexLinProb::Get(int p, int q, int k)
     return CComplex(0,0);
 }
 
-void CBigComplexLinProb::AddTo(CComplex v, int p, int q)
+void CBigComplexLinProb::AddTo(CComplex v, SparseIndex p, SparseIndex q)
 {
 	Put(Get(p,q)+v,p,q);
 }
 
 void CBigComplexLinProb::MultA(CComplex *X, CComplex *Y, int k)
 {
-    int i;
+    SparseIndex i;
     CComplexEntry *e;
 
     for(i=0; i<n; i++) Y[i]=0;
@@ -361,7 +361,7 @@ void CBigComplexLinProb::MultA(CComplex *X, CComplex *Y, int k)
 
 void CBigComplexLinProb::MultConjA(CComplex *X, CComplex *Y, int k)
 {
-    int i;
+    SparseIndex i;
     CComplexEntry *e;
 
     for(i=0; i<n; i++) Y[i]=0;
@@ -405,7 +405,7 @@ void CBigComplexLinProb::MultConjA(CComplex *X, CComplex *Y, int k)
 
 void CBigComplexLinProb::MultAPPA(CComplex *X, CComplex *Y)
 {
-    int i;
+    SparseIndex i;
     MultA(X,Z);
     MultPC(Z,Y);
     for(i=0; i<n; i++) Y[i].im=-Y[i].im;
@@ -416,7 +416,7 @@ void CBigComplexLinProb::MultAPPA(CComplex *X, CComplex *Y)
 
 CComplex CBigComplexLinProb::Dot(CComplex *x, CComplex *y)
 {
-    int i;
+    SparseIndex i;
     CComplex z;
 
     z=0;
@@ -427,7 +427,7 @@ CComplex CBigComplexLinProb::Dot(CComplex *x, CComplex *y)
 
 CComplex CBigComplexLinProb::ConjDot(CComplex *x, CComplex *y)
 {
-    int i;
+    SparseIndex i;
     CComplex z;
 
     z=0;
@@ -438,7 +438,7 @@ CComplex CBigComplexLinProb::ConjDot(CComplex *x, CComplex *y)
 
 void CBigComplexLinProb::MultPC(CComplex *X, CComplex *Y)
 {
-    int i;
+    SparseIndex i;
 
     // Jacobi preconditioner:
 //	for(i=0;i<n;i++) Y[i]=X[i]/M[i]->x; return;
@@ -479,9 +479,9 @@ void CBigComplexLinProb::MultPC(CComplex *X, CComplex *Y)
 
 }
 
-void CBigComplexLinProb::SetValue(int i, CComplex x)
+void CBigComplexLinProb::SetValue(SparseIndex i, CComplex x)
 {
-    int k,fst,lst;
+    SparseIndex k,fst,lst;
     CComplex z;
 
     if(bdw==0)
@@ -538,7 +538,7 @@ void CBigComplexLinProb::SetValue(int i, CComplex x)
 
 void CBigComplexLinProb::Wipe()
 {
-    int i;
+    SparseIndex i;
     CComplexEntry *e;
 
     for(i=0; i<n; i++)
@@ -589,13 +589,14 @@ void CBigComplexLinProb::Wipe()
     }
 }
 
-void CBigComplexLinProb::AntiPeriodicity(int i, int j)
+void CBigComplexLinProb::AntiPeriodicity(SparseIndex i, SparseIndex j)
 {
-    int k,fst,lst,h;
+    SparseIndex k,fst,lst;
+    int h;
     CComplex v1,v2,c;
 
 #ifdef KLUDGE
-    int tmpbdw=bdw;
+    SparseIndex tmpbdw=bdw;
     bdw=0;
 #endif
 
@@ -674,13 +675,14 @@ void CBigComplexLinProb::AntiPeriodicity(int i, int j)
 #endif
 }
 
-void CBigComplexLinProb::Periodicity(int i, int j)
+void CBigComplexLinProb::Periodicity(SparseIndex i, SparseIndex j)
 {
-    int k,fst,lst,h;
+    SparseIndex k,fst,lst;
+    int h;
     CComplex v1,v2,c;
 
 #ifdef KLUDGE
-    int tmpbdw=bdw;
+    SparseIndex tmpbdw=bdw;
     bdw=0;
 #endif
 
@@ -763,7 +765,7 @@ void CBigComplexLinProb::Periodicity(int i, int j)
 // with a pathological starting point.
 int CBigComplexLinProb::PCGSQStart()
 {
-    int i,k;
+    SparseIndex i,k;
     CComplex res,res_new,del,rho,pAp;
 
     // quick check for most obvious sign of singularity;
@@ -821,7 +823,7 @@ int CBigComplexLinProb::PCGSQStart()
 // Complex-Symmetric Preconditioned BiCG
 int CBigComplexLinProb::PBCGSolve(int flag)
 {
-    int i;
+    SparseIndex i;
     CComplex res,res_new,del,rho,pAp;
     double er,normb;
     int prg2,prg1=0;
@@ -899,7 +901,7 @@ int CBigComplexLinProb::BiCGSTAB(int flag)
     double er,normb;
     CComplex om,alf,rho1,rho2,bta;
     CComplex *P2,*R2,*Z2,*t;
-    int i,j,k;
+    SparseIndex i,j,k;
 //    CStdString out;
 
     P2=(CComplex *)calloc(n,sizeof(CComplex));
@@ -983,7 +985,7 @@ int CBigComplexLinProb::BiCGSTAB(int flag)
 int CBigComplexLinProb::KludgeSolve(int flag)
 {
 
-    int i,k;
+    SparseIndex i,k;
     double er,normb,c;
 //	CStdString out; // doesn't appear to be used
     CComplex *borig, *v, *r;
@@ -22,12 +22,14 @@
 #ifndef CSPARS_H
 #define CSPARS_H
 
+#include "spars.h"
+
 class CComplexEntry
 {
 public:
 
     CComplex x;				// value stored in the entry
-    int c;					// column that the entry lives in
+    SparseIndex c;			// column that the entry lives in
     CComplexEntry *next;	// pointer to next entry in the row;
     CComplexEntry();
 
@@ -53,10 +55,10 @@ public:
     CComplexEntry **Mh;			// Hermitian matrix arising from N-R algorithm;
     CComplexEntry **Ma;			// Antihermitian matrix arising from N-R algorithm;
     CComplexEntry **Ms;			// Additional complex-symmetric matrix arising from N-R algorithm;
-    int n;						// dimensions of the matrix;
-    int bdw;					// optional bandwidth parameter;
+    SparseIndex n;				// dimensions of the matrix;
+    SparseIndex bdw;			// optional bandwidth parameter;
     int bNewton;				// Flag which denotes whether or not there are entries in Mh or Ms;
-    int NumNodes;
+    SparseIndex NumNodes;
     double Precision;
     double Lambda;			// relaxation factor;
 
@@ -64,17 +66,17 @@ public:
 
     CBigComplexLinProb();				// constructor
     ~CBigComplexLinProb();				// destructor
-    int Create(int d, int bw, int nodes);	// initialize the problem
-    void Put(CComplex v, int p, int q, int k=0); // use to create/set entries in the matrix
-    CComplex Get(int p, int q, int k=0);
-    void AddTo(CComplex v, int p, int q);
+    int Create(SparseIndex d, SparseIndex bw, SparseIndex nodes);	// initialize the problem
+    void Put(CComplex v, SparseIndex p, SparseIndex q, int k=0); // use to create/set entries in the matrix
+    CComplex Get(SparseIndex p, SparseIndex q, int k=0);
+    void AddTo(CComplex v, SparseIndex p, SparseIndex q);
     void MultA(CComplex *X, CComplex *Y, int k=0);
     void MultConjA(CComplex *X, CComplex *Y, int k=0);
     CComplex Dot(CComplex *x, CComplex *y);
     CComplex ConjDot(CComplex *x, CComplex *y);
-    void SetValue(int i, CComplex x);
-    void Periodicity(int i, int j);
-    void AntiPeriodicity(int i, int j);
+    void SetValue(SparseIndex i, CComplex x);
+    void Periodicity(SparseIndex i, SparseIndex j);
+    void AntiPeriodicity(SparseIndex i, SparseIndex j);
     void Wipe();
     void MultPC(CComplex *X, CComplex *Y);
     void MultAPPA(CComplex *X, CComplex *Y);
@@ -22,6 +22,7 @@
 // does Cuthill-McKee algorithm as described in Hoole;
 
 #include<stdio.h>
+#include <algorithm>
 #include<math.h>
 #include "malloc.h"
 #include "femmcomplex.h"
@@ -29,6 +30,7 @@
 #include "femmenums.h"
 //#include "spars.h"
 #include "feasolver.h"
+#include "nodeOrdering.h"
 
 template< class PointPropT
           , class BoundaryPropT
@@ -40,47 +42,43 @@ template< class PointPropT
 int FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,MeshElementT>
 ::SortElements()
 {
-    // Comb Sort -- see http://en.wikipedia.org/wiki/Comb_sort
-    int *Score;
-    int i,j,k,gap;
-
-    Score=(int*)calloc(NumEls,sizeof(int));
-
-    for(k=0; k<NumEls; k++)
+    // Order the elements consistently with the node numbering, so that
+    // loops over meshele gather their node data from meshnode in (nearly)
+    // increasing address order: sort by smallest node number, and elements
+    // sharing the smallest node by largest node number.
+    // Both passes are stable counting sorts, i.e. linear in NumEls+NumNodes.
+    std::vector<int> count(NumNodes+1);
+    std::vector<int> order(NumEls);
+    std::vector<int> sorted(NumEls);
+    int k;
+
+    for(k=0; k<NumEls; k++) order[k]=k;
+
+    for(int pass=0; pass<2; pass++)
     {
-        Score[k]=meshele[k].p[0]+meshele[k].p[1]+meshele[k].p[2];
+        // first pass sorts by the secondary key (largest node),
+        // second pass by the primary key (smallest node)
+        auto key = [&](int el) {
+            const int *p = meshele[el].p;
+            return (pass==0) ? std::max(p[0],std::max(p[1],p[2]))
+                             : std::min(p[0],std::min(p[1],p[2]));
+        };
+
+        std::fill(count.begin(), count.end(), 0);
+        for(k=0; k<NumEls; k++) count[key(k)+1]++;
+        for(k=1; k<=NumNodes; k++) count[k]+=count[k-1];
+        for(k=0; k<NumEls; k++) sorted[count[key(order[k])]++]=order[k];
+        order.swap(sorted);
     }
 
-    gap = NumEls;
-
-    do
-    {
-        //update the gap value for a next comb
-        if (gap > 1)
-        {
-            gap=(gap*10)/13;
-            if ((gap==10) || (gap==9)) gap=11;
-
-        }
-
-        //a single "comb" over the input list
-        for(j=0,i=0; (j+gap)<NumEls; j++)
-        {
-            if (Score[j]>Score[j+gap])
-            {
-                k=j+gap;
-                i=Score[k];
-                Score[k]=Score[j];
-                Score[j]=i;
-                std::swap(meshele[k],meshele[j]);
-                i=1;
-            }
-        }
-    }
-    while((gap>1)&&(i>0));
-
+    std::vector<MeshElementT> sortedElements;
+    sortedElements.reserve(NumEls);
+    for(k=0; k<NumEls; k++)
+        sortedElements.push_back(std::move(meshele[order[k]]));
+    meshele.swap(sortedElements);
+    // element k was element order[k] in the .ele file
+    ElementFileNumber.swap(order);
 
-    free(Score);
     return true;
 }
 
@@ -91,23 +89,22 @@ template< class PointPropT
           , class BlockLabelT
           , class MeshElementT
           >
-int FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,MeshElementT>
-::Cuthill(bool deletefiles)
+bool FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,MeshElementT>
+::CuthillNumbering(bool deletefiles, std::vector<int> &newnum)
 {
 
     FILE *fp;
     int i, n0, n1, n, newwide;
     long int j, n_lines;
     std::vector<std::vector<int>> ocon;
-    std::vector<int> newnum, numcon, nxtnum;
-    char infile[256];
+    std::vector<int> numcon, nxtnum;
 
     // read in connectivity from nodefile
-    sprintf(infile,"%s.edge",PathName.c_str());
-    if((fp=fopen(infile,"rt"))==NULL)
+    std::string infile = PathName + ".edge";
+    if((fp=fopen(infile.c_str(),"rt"))==NULL)
     {
         //MsgBox("Couldn't open %s",infile);
-        printf("Couldn't open %s",infile);
+        printf("Couldn't open %s",infile.c_str());
         return false;
     }
     // read in number of lines
@@ -211,104 +208,169 @@ int FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,MeshE
     fclose(fp);
     if (deletefiles)
     {
-        remove(infile);
+        remove(infile.c_str());
     }
 
 
-    // sort connections in order of increasing connectivity;
-    // I'm lazy, so I'm doing a bubble sort;
-    for(n0=0; n0<NumNodes; n0++)
+    if (Ordering == femm::NodeOrdering::ReverseCuthillMcKee)
     {
-        for(i=1; i<numcon[n0]; i++)
-            for(j=1; j<numcon[n0]; j++)
-                if(numcon[ocon[n0][j]]<numcon[ocon[n0][j-1]])
-                {
-                    n1=ocon[n0][j];
-                    ocon[n0][j]=ocon[n0][j-1];
-                    ocon[n0][j-1]=n1;
-                }
+        newnum = femm::reverseCuthillMcKee(ocon);
     }
-
-
-    // search for a node to start with;
-    j = numcon[0];
-    n0 = 0;
-    for(i=1; i<NumNodes; i++)
+    else if (Ordering == femm::NodeOrdering::NestedDissection)
     {
-        if(numcon[i]<j)
+        newnum = femm::nestedDissection(ocon);
+    }
+    else
+    {
+        // sort connections in order of increasing connectivity;
+        // I'm lazy, so I'm doing a bubble sort;
+        for(n0=0; n0<NumNodes; n0++)
         {
-            j=numcon[i];
-            n0=i;
+            for(i=1; i<numcon[n0]; i++)
+                for(j=1; j<numcon[n0]; j++)
+                    if(numcon[ocon[n0][j]]<numcon[ocon[n0][j-1]])
+                    {
+                        n1=ocon[n0][j];
+                        ocon[n0][j]=ocon[n0][j-1];
+                        ocon[n0][j-1]=n1;
+                    }
         }
-        if(j==2) i=n_lines;	// break out if j==2,
-        // because this is the best we can do
-    }
 
-    // do renumbering algorithm;
-    for(i=0; i<NumNodes; i++) nxtnum[i]=-1;
-    newnum[n0]=0;
-    n=1;
-    nxtnum[0]=n0;
 
-    do
-    {
-        // renumber in order of increasing number of connections;
-
-        for(i=0; i<numcon[n0]; i++)
+        // search for a node to start with;
+        j = numcon[0];
+        n0 = 0;
+        for(i=1; i<NumNodes; i++)
         {
-            if (newnum[ocon[n0][i]]<0)
+            if(numcon[i]<j)
             {
-                newnum[ocon[n0][i]]=n;
-                nxtnum[n]=ocon[n0][i];
-                n++;
+                j=numcon[i];
+                n0=i;
             }
+            if(j==2) i=n_lines;	// break out if j==2,
+            // because this is the best we can do
         }
 
-        // need to catch case in which problem is multiply
-        // connected and still renumber right.
-        if(nxtnum[newnum[n0]+1]<0)
+        // do renumbering algorithm;
+        for(i=0; i<NumNodes; i++) nxtnum[i]=-1;
+        newnum[n0]=0;
+        n=1;
+        nxtnum[0]=n0;
+
+        do
         {
-            //	WarnMessage("Multiply Connected!");
-            //	exit(0);
+            // renumber in order of increasing number of connections;
 
-            // first, get a node that hasn't been visited yet;
-            for(i=0; i<NumNodes; i++)
-                if(newnum[i]<0)
+            for(i=0; i<numcon[n0]; i++)
+            {
+                if (newnum[ocon[n0][i]]<0)
                 {
-                    j=numcon[i];
-                    n0=i;
-                    break;
+                    newnum[ocon[n0][i]]=n;
+                    nxtnum[n]=ocon[n0][i];
+                    n++;
                 }
+            }
 
-
-            // now, get a new starting node;
-            for(i=0; i<NumNodes; i++)
+            // need to catch case in which problem is multiply
+            // connected and still renumber right.
+            if(nxtnum[newnum[n0]+1]<0)
             {
-                if((newnum[i]<0) && (numcon[i]<j))
+                //	WarnMessage("Multiply Connected!");
+                //	exit(0);
+
+                // first, get a node that hasn't been visited yet;
+                for(i=0; i<NumNodes; i++)
+                    if(newnum[i]<0)
+                    {
+                        j=numcon[i];
+                        n0=i;
+                        break;
+                    }
+
+
+                // now, get a new starting node;
+                for(i=0; i<NumNodes; i++)
                 {
-                    j=numcon[i];
-                    n0=i;
+                    if((newnum[i]<0) && (numcon[i]<j))
+                    {
+                        j=numcon[i];
+                        n0=i;
+                    }
+                    if(j==2) break;	// break out if j==2,
+                    // because this is the
+                    // best we can do
                 }
-                if(j==2) break;	// break out if j==2,
-                // because this is the
-                // best we can do
+
+                // now, set things to restart;
+                newnum[n0]=n;
+                nxtnum[n]=n0;
+                n++;
             }
+            else n0=nxtnum[newnum[n0]+1];
+
 
-            // now, set things to restart;
-            newnum[n0]=n;
-            nxtnum[n]=n0;
-            n++;
         }
-        else n0=nxtnum[newnum[n0]+1];
+        while(n<NumNodes);
+    }
 
+    // find new bandwidth and profile;
 
-    }
-    while(n<NumNodes);
+    // PBCs fuck up the banding, som could have to do
+    // something like:
+    // if(NumPBCs!=0) BandWidth=0;
+    // else{
+    // but if we apply the PCBs the last thing before the
+    // solver is called, we can take advantage of banding
+    // speed optimizations without messing things up.
+    femm::orderingStatistics(ocon, newnum, newwide, Profile);
 
-    // remap connectivities;
-    for(i=0; i<NumNodes; i++)
-        for(j=0; j<numcon[i]; j++)
-            ocon[i][j]=newnum[ocon[i][j]];
+    BandWidth=newwide+1;
+    // }
+
+    // free up the variables that we needed during the routine....
+    //free(numcon);
+    //free(nxtnum);
+    //free(ocon[0]);
+    //free(ocon);
+
+    return true;
+}
+
+template< class PointPropT
+          , class BoundaryPropT
+          , class BlockPropT
+          , class CircuitPropT
+          , class BlockLabelT
+          , class MeshElementT
+          >
+int FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,MeshElementT>
+::Cuthill(bool deletefiles)
+{
+    int i,j;
+    std::vector<int> newnum;
+
+    if (nodeNumbering && (int)nodeNumbering->newnum.size()==NumNodes
+            && nodeNumbering->Ordering==Ordering)
+    {
+        // the mesh has been renumbered before, reuse that numbering
+        newnum = nodeNumbering->newnum;
+        BandWidth = nodeNumbering->BandWidth;
+        Profile = nodeNumbering->Profile;
+        if (deletefiles)
+        {
+            remove((PathName + ".edge").c_str());
+        }
+    } else {
+        if (!CuthillNumbering(deletefiles, newnum))
+            return false;
+        if (nodeNumbering)
+        {
+            nodeNumbering->newnum = newnum;
+            nodeNumbering->Ordering = Ordering;
+            nodeNumbering->BandWidth = BandWidth;
+            nodeNumbering->Profile = Profile;
+        }
+    }
 
     // remap (anti)periodic boundary points
     for(i=0; i<NumPBCs; i++)
@@ -329,33 +391,6 @@ int FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,MeshE
 		}
 	}
 
-    // find new bandwidth;
-
-    // PBCs fuck up the banding, som could have to do
-    // something like:
-    // if(NumPBCs!=0) BandWidth=0;
-    // else{
-    // but if we apply the PCBs the last thing before the
-    // solver is called, we can take advantage of banding
-    // speed optimizations without messing things up.
-    for(n0=0,newwide=0; n0<NumNodes; n0++)
-    {
-        for(i=0; i<numcon[n0]; i++)
-            if(abs(newnum[n0]-ocon[n0][i])>newwide)
-            {
-                newwide=abs(newnum[n0]-ocon[n0][i]);
-            }
-    }
-
-    BandWidth=newwide+1;
-    // }
-
-    // free up the variables that we needed during the routine....
-    //free(numcon);
-    //free(nxtnum);
-    //free(ocon[0]);
-    //free(ocon);
-
     // new mapping remains in newnum;
     // apply this mapping to elements first.
     for(i=0; i<NumEls; i++)
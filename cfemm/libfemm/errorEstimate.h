@@ -0,0 +1,70 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#ifndef FEMM_ERRORESTIMATE_H
+#define FEMM_ERRORESTIMATE_H
+
+#include "femmcomplex.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * \file errorEstimate.h
+ * \brief Error indicators for solutions on triangle meshes, used for adaptive meshing and mesh size fields.
+ */
+
+namespace femm
+{
+
+inline double squaredMagnitude(double x)
+{
+    return x*x;
+}
+
+inline double squaredMagnitude(const CComplex &z)
+{
+    return z.re*z.re + z.im*z.im;
+}
+
+/**
+ * @brief Add the jumps of the tangential field intensity across the interior edges to an error indicator.
+ * For each edge between element \c i and its neighbour \c k, with edge vector \c t,
+ * 0.5*|(H_i-H_k).t|^2*min(mu_i,mu_k) is added to \c eta2[i], i.e. each element gets half of the edge.
+ * Summed over the mesh, this compares to the magnetic energy.
+ * @param numElements
+ * @param neighbour \c neighbour(i,j) returns the element across the edge opposite corner \c j of element \c i, or -1
+ * @param corner \c corner(i,j) returns the position of corner \c j of element \c i
+ * @param H1 x component of the field intensity in each element (\c double, or \c CComplex for time harmonic problems)
+ * @param H2 y component of the field intensity in each element
+ * @param mu permeability of each element
+ * @param scale factor for each contribution, e.g. for converting the edge lengths and permeabilities to SI units
+ * @param eta2 squared error indicator of each element
+ */
+template<class T, class Neighbour, class Corner>
+void addTangentialFieldJumps(int numElements, Neighbour neighbour, Corner corner,
+                             const std::vector<T> &H1, const std::vector<T> &H2, const std::vector<double> &mu,
+                             double scale, std::vector<double> &eta2)
+{
+    for (int i=0; i<numElements; i++)
+    {
+        for (int j=0; j<3; j++)
+        {
+            const int k = neighbour(i,j);
+            if (k<0)
+                continue;
+            const CComplex t = corner(i,(j+2)%3) - corner(i,(j+1)%3);
+            // jump times edge length:
+            const double jump2 = squaredMagnitude((H1[i]-H1[k])*t.re + (H2[i]-H2[k])*t.im);
+            eta2[i] += 0.5*scale*jump2*std::min(mu[i],mu[k]);
+        }
+    }
+}
+
+} // namespace femm
+
+#endif
@@ -81,7 +81,10 @@ FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,MeshEleme
     , DoForceMaxMeshArea(false)
     , DoSmartMesh(true)
     , bMultiplyDefinedLabels(false)
+    , ShareProblemFile(false)
+    , Ordering(femm::NodeOrdering::CuthillMcKee)
     , BandWidth(0)
+    , Profile(0)
     , meshele()
     , NumNodes(0)
     , NumEls(0)
@@ -102,6 +105,7 @@ FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,MeshEleme
     , labellist()
     , agelist()
     , nodes()
+    , nodeNumbering()
 {
 
     // initialise the warning message box function pointer to
@@ -149,7 +153,9 @@ void FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,Mesh
     DoSmartMesh = true;
     bMultiplyDefinedLabels = false;
     BandWidth = 0;
+    Profile = 0;
     meshele.clear();
+    ElementFileNumber.clear();
     NumNodes = 0;
     NumEls = 0;
     NumBlockProps = 0;
@@ -576,6 +582,43 @@ bool FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,Mesh
     return false;
 }
 
+template< class PointPropT
+          , class BoundaryPropT
+          , class BlockPropT
+          , class CircuitPropT
+          , class BlockLabelT
+          , class MeshElementT
+          >
+bool FEASolver<PointPropT,BoundaryPropT,BlockPropT,CircuitPropT,BlockLabelT,MeshElementT>
+::writeProblemDescription(FILE *fp, const std::string &problemFile) const
+{
+    FILE *fz = fopen(problemFile.c_str(),"rt");
+    if (fz==NULL)
+        return false;
+
+    if (ShareProblemFile)
+    {
+        fclose(fz);
+        // the reference is relative to the solution file, which is
+        // always written next to the problem file:
+        std::string::size_type pos = problemFile.find_last_of("/\\");
+        std::string baseName = (pos==std::string::npos) ? problemFile : problemFile.substr(pos+1);
+        // the fingerprint is written first, so that readers can verify the
+        // problem file before they switch to it:
+        fprintf(fp,"[ProblemFileHash] = \"%s\"\n",fileFingerprint(problemFile).c_str());
+        fprintf(fp,"[ProblemFile] = \"%s\"\n",baseName.c_str());
+        return true;
+    }
+
+    char c[1024];
+    while(fgets(c,1024,fz)!=NULL)
+    {
+        fputs(c,fp);
+    }
+    fclose(fz);
+    return true;
+}
+
 template< class PointPropT
           , class BoundaryPropT
           , class BlockPropT
@@ -40,6 +40,7 @@
 #include "CCommonPoint.h"
 #include "CNode.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -66,6 +67,19 @@ enum LoadMeshErr
     ELMLABELTOOBIG
 };
 
+/**
+ * @brief The NodeNumbering struct holds the result of the node renumbering of a mesh.
+ * It allows several solver runs on the same mesh to share the renumbering.
+ * \see FEASolver::nodeNumbering
+ */
+struct NodeNumbering
+{
+    std::vector<int> newnum; ///< \brief new number of each mesh node; empty, if not computed yet
+    femm::NodeOrdering Ordering = femm::NodeOrdering::CuthillMcKee; ///< \brief ordering used to compute newnum
+    int BandWidth = 0;       ///< \brief bandwidth of the renumbered mesh
+    int64_t Profile = 0;     ///< \brief profile of the renumbered mesh
+};
+
 template< class PointPropT
           , class BoundaryPropT
           , class BlockPropT
@@ -107,14 +121,27 @@ public:
     bool    DoForceMaxMeshArea;
     bool    DoSmartMesh;
     bool    bMultiplyDefinedLabels;
+    /**
+     * @brief If set, solution files only reference the problem file instead of containing a copy of it.
+     * This avoids duplicating the problem description when many solutions are written for the same problem.
+     * The problem file must then be kept alongside the solution file.
+     */
+    bool    ShareProblemFile;
 
 
+    /// \brief Ordering used by Cuthill() to renumber the mesh nodes
+    femm::NodeOrdering Ordering;
+
     // CArrays containing the mesh information
-    int	BandWidth;
+    SparseIndex BandWidth;
+    /// \brief Profile (envelope size) of the renumbered mesh, as computed by Cuthill()
+    int64_t Profile;
     std::vector<MeshElementT> meshele;
+    /// \brief Number of each element of meshele in the \c .ele file, as set by SortElements()
+    std::vector<int> ElementFileNumber;
 
-    int NumNodes;
-    int NumEls;
+    SparseIndex NumNodes;
+    SparseIndex NumEls;
 
     // lists of properties
     int NumBlockProps;
@@ -140,6 +167,13 @@ public:
     std::vector< BlockLabelT > labellist;
     std::vector< femmsolver::CAirGapElement > agelist;
     std::vector< femm::CNode > nodes;
+
+    /**
+     * @brief Node renumbering shared with other solver runs on the same mesh.
+     * If set and filled in, Cuthill() applies this renumbering instead of computing it from the \c .edge file.
+     * If set but empty, Cuthill() stores the renumbering it computed.
+     */
+    std::shared_ptr<NodeNumbering> nodeNumbering;
 // Operations
 public:
 
@@ -160,6 +194,13 @@ public:
     static std::string getErrorString(LoadMeshErr err);
 
     int Cuthill(bool deleteFiles=true);
+    /**
+     * @brief Order the mesh elements consistently with the node numbering.
+     * Elements are sorted by their smallest node number, then by their largest node number,
+     * in linear time.
+     * ElementFileNumber is set accordingly.
+     * Called by Cuthill() after renumbering the nodes.
+     */
     int SortElements();
 
     // pointer to function to call when issuing warning messages
@@ -172,6 +213,15 @@ protected:
 
     bool meshLoadedFromPrevSolution;
 
+    /**
+     * @brief Compute the node renumbering selected by Ordering from the connectivity in the \c .edge file.
+     * Also sets BandWidth and Profile.
+     * @param deleteFiles if \c true, the \c .edge file is removed after reading it
+     * @param newnum receives the new number of each mesh node
+     * @return \c true on success
+     */
+    bool CuthillNumbering(bool deleteFiles, std::vector<int> &newnum);
+
 protected:
     /**
      * @brief LoadProblemFile
@@ -202,6 +252,20 @@ protected:
      */
     virtual bool handleToken(const std::string &token, std::istream &input, std::ostream &err);
 
+    /**
+     * @brief Write the problem description part of a solution file.
+     * Normally, the problem file is copied verbatim to the solution file.
+     * If ShareProblemFile is set, a \verbatim[ProblemFile]\endverbatim reference
+     * (relative to the solution file) is written instead.
+     * It is preceded by a \verbatim[ProblemFileHash]\endverbatim entry holding
+     * the fileFingerprint() of the problem file, so that readers can detect
+     * a problem file that was changed after solving.
+     * @param fp the (open) solution file
+     * @param problemFile path to the problem file
+     * @return \c true on success, \c false if the problem file could not be read.
+     */
+    bool writeProblemDescription(FILE *fp, const std::string &problemFile) const;
+
 private:
 
     virtual void SortNodes (std::vector<int> newnum) = 0;
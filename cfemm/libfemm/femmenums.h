@@ -94,6 +94,37 @@ inline EditMode intToEditMode(int m)
     }
 }
 
+/**
+ * @brief The NodeOrdering determines how the solvers renumber the mesh nodes before assembling the system.
+ */
+enum class NodeOrdering {
+    /// \brief Cuthill-McKee ordering as done by FEMM
+    CuthillMcKee = 0,
+    /// \brief Reverse Cuthill-McKee ordering from a pseudo-peripheral node
+    ReverseCuthillMcKee = 1,
+    /// \brief Nested dissection ordering
+    NestedDissection = 2,
+    /// \brief An invalid value
+    Invalid
+};
+
+/**
+ * @brief Convert a short name ("cm", "rcm", "nd") into a NodeOrdering enum.
+ * An empty name selects the default ordering (NodeOrdering::CuthillMcKee).
+ * @param name
+ * @return a valid NodeOrdering for known names, NodeOrdering::Invalid otherwise.
+ */
+inline NodeOrdering nameToNodeOrdering(const std::string &name)
+{
+    if (name.empty() || name=="cm")
+        return NodeOrdering::CuthillMcKee;
+    if (name=="rcm")
+        return NodeOrdering::ReverseCuthillMcKee;
+    if (name=="nd")
+        return NodeOrdering::NestedDissection;
+    return NodeOrdering::Invalid;
+}
+
 /**
  * @brief The FileType enum determines how the problem description is written to disc.
  */
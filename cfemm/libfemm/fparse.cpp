@@ -1,5 +1,6 @@
 #include "fparse.h"
 
+#include "hashTools.h"
 #include "stringTools.h"
 
 #include <algorithm>
@@ -302,4 +303,50 @@ bool parseValue(istream &input, bool &val, ostream &err)
     return true;
 }
 
+bool readLine(FILE *fp, string &line)
+{
+    char buf[1024];
+    line.clear();
+    while (fgets(buf,sizeof(buf),fp)!=NULL)
+    {
+        line += buf;
+        if (line.back()=='\n')
+            break;
+    }
+    return !line.empty();
+}
+
+string resolveRelativePath(const string &path, const string &referenceFile)
+{
+    if (path.empty() || path[0]=='/' || path[0]=='\\'
+            || (path.size()>1 && path[1]==':'))
+        return path;
+
+    string::size_type pos = referenceFile.find_last_of("/\\");
+    if (pos==string::npos)
+        return path;
+    return referenceFile.substr(0,pos+1) + path;
+}
+
+string fileFingerprint(const string &path)
+{
+    ifstream file(path.c_str(), ios::in | ios::binary);
+    if (!file.is_open())
+        return string();
+
+    FNV1aHash hash;
+    unsigned long long size = 0;
+    char buf[4096];
+    while (file.read(buf, sizeof(buf)) || file.gcount() > 0)
+    {
+        hash.add(buf, static_cast<size_t>(file.gcount()));
+        size += static_cast<unsigned long long>(file.gcount());
+    }
+
+    char fingerprint[64];
+    snprintf(fingerprint, sizeof(fingerprint), "%llu:%016llx"
+             , size, static_cast<unsigned long long>(hash.value()));
+    return string(fingerprint);
+}
+
 }
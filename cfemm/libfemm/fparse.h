@@ -1,6 +1,7 @@
 #ifndef FEMM_FPARSE_H
 #define FEMM_FPARSE_H
 
+#include <cstdio>
 #include <string>
 #include <iostream>
 #include <algorithm>
@@ -76,6 +77,31 @@ bool parseValue(std::istream &input, int &val, std::ostream &err = std::cerr);
  * @return \c true, if the conversion worked, \c false otherwise
  */
 bool parseValue(std::istream &input, bool &val, std::ostream &err = std::cerr);
+/**
+ * @brief resolveRelativePath resolves a path relative to the directory of another file.
+ * Absolute paths are returned unchanged.
+ * @param path the (possibly relative) path
+ * @param referenceFile the file \p path is relative to
+ * @return the resolved path
+ */
+std::string resolveRelativePath(const std::string &path, const std::string &referenceFile);
+/**
+ * @brief fileFingerprint computes a fingerprint of the contents of a file.
+ * The fingerprint has the form "<size>:<hash>", where hash is the hexadecimal
+ * 64 bit FNV-1a hash of the file contents.
+ * @param path the file
+ * @return the fingerprint, or an empty string if the file could not be read.
+ */
+std::string fileFingerprint(const std::string &path);
+
+/**
+ * @brief readLine reads a line of arbitrary length from a file.
+ * Like fgets, the line terminator is kept.
+ * @param fp the input file
+ * @param line receives the line
+ * @return \c false, if no characters could be read
+ */
+bool readLine(FILE *fp, std::string &line);
 
 // declare a default warning message function
 int PrintWarningMsg(const char* message, ...);
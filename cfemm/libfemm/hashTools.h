@@ -0,0 +1,71 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#ifndef FEMM_HASHTOOLS_H
+#define FEMM_HASHTOOLS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * \file hashTools.h
+ * \brief Helpers for computing fingerprints of (mesh) data.
+ */
+
+namespace femm
+{
+
+/**
+ * @brief The FNV1aHash class computes a 64 bit FNV-1a hash over a sequence of values.
+ *
+ * Values are hashed by their binary representation, i.e. the same values in the
+ * same order give the same hash on the same platform.
+ * The hash is not suitable for cryptographic purposes.
+ */
+class FNV1aHash
+{
+public:
+    FNV1aHash() : hash(14695981039346656037ULL) {}
+
+    /**
+     * @brief Add raw bytes to the hash.
+     * @param data
+     * @param len number of bytes
+     */
+    void add(const void *data, std::size_t len)
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        for (std::size_t i=0; i<len; i++)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    /**
+     * @brief Add a value of arithmetic type to the hash.
+     * @param value
+     */
+    template <class T>
+    void add(T value)
+    {
+        static_assert(std::is_arithmetic<T>::value, "FNV1aHash::add(T) needs an arithmetic type");
+        add(&value, sizeof(T));
+    }
+
+    /**
+     * @return the hash of all values added so far
+     */
+    uint64_t value() const { return hash; }
+
+private:
+    uint64_t hash;
+};
+
+} //namespace
+#endif
@@ -0,0 +1,182 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#ifndef FEMM_MESHWALK_H
+#define FEMM_MESHWALK_H
+
+#include "femmcomplex.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * \file meshWalk.h
+ * \brief Walking along straight lines through a triangle mesh, used for line integrals.
+ */
+
+namespace femm
+{
+
+/**
+ * @brief Get the part of a straight line that lies inside a triangle.
+ * The line is given by p(u) = p0 + u*(p1-p0), and only the part with u0 <= u <= 1 is considered.
+ * @param c the triangle corners
+ * @param p0 start of the line
+ * @param p1 end of the line
+ * @param u0 start parameter
+ * @param ua receives the parameter where the line enters the triangle
+ * @param ub receives the parameter where the line leaves the triangle
+ * @return the index \c j of the edge opposite corner \c j through which the line leaves the triangle,
+ * -1 if the line ends inside the triangle, or -2 if the line does not pass through the triangle.
+ */
+inline int clipLineToTriangle(const CComplex (&c)[3], CComplex p0, CComplex p1, double u0, double &ua, double &ub)
+{
+    const CComplex d = p1-p0;
+    const double len = abs(d);
+    // +1 for counter clockwise corners, -1 for clockwise corners:
+    const double orient = ((c[1].re-c[0].re)*(c[2].im-c[0].im) - (c[1].im-c[0].im)*(c[2].re-c[0].re) < 0) ? -1. : 1.;
+
+    int exitEdge = -1;
+    ua = u0;
+    ub = 1;
+    for (int j=0; j<3; j++)
+    {
+        const CComplex a = c[(j+1)%3];
+        const CComplex e = c[(j+2)%3] - a;
+        // f(u) = f0 + u*df is |e| times the distance of p(u) from edge j, positive inside the triangle
+        const double f0 = orient*(e.re*(p0.im-a.im) - e.im*(p0.re-a.re));
+        const double df = orient*(e.re*d.im - e.im*d.re);
+        const double tol = 1.e-10*abs(e)*len;
+        if (df>0)
+        {
+            ua = std::max(ua, -(f0+tol)/df);
+        } else if (df<0) {
+            const double u = (f0+tol)/(-df);
+            if (u<ub)
+            {
+                ub = u;
+                exitEdge = j;
+            }
+        } else if (f0<-tol) {
+            return -2;
+        }
+    }
+    if (ub<=ua)
+        return -2;
+    return exitEdge;
+}
+
+/**
+ * @brief Walk along a straight line through a triangle mesh.
+ *
+ * Starting from the element that contains \p p0, the walk moves on to the element on the other side of
+ * the edge through which the line leaves the current element, so that only the elements crossed by
+ * the line are visited. Where that does not work (e.g. if the line passes exactly through a mesh node),
+ * the next element is searched using \p locate. Parts of the line outside the mesh are skipped;
+ * the point where the line enters the mesh again is searched for at \p numSteps equidistant points.
+ *
+ * @param p0 start of the line
+ * @param p1 end of the line
+ * @param numSteps number of search points used for parts of the line outside the mesh
+ * @param corner a callable with the signature \c CComplex(int elm,int j), returning corner \c j (0..2) of element \c elm.
+ * @param neighbour a callable with the signature \c int(int elm,int j), returning the element
+ * on the other side of the edge opposite corner \c j of element \c elm, or -1 for a boundary edge.
+ * @param locate a callable with the signature \c int(CComplex p), returning the element containing \c p, or -1.
+ * @param visit a callable with the signature \c void(int elm,double ua,double ub), called for each part
+ * p(ua)..p(ub) of the line inside element \c elm, in order of increasing \c ua.
+ */
+template <class CornerFunc, class NeighbourFunc, class LocateFunc, class VisitFunc>
+void walkLine(CComplex p0, CComplex p1, int numSteps,
+              CornerFunc corner, NeighbourFunc neighbour, LocateFunc locate, VisitFunc visit)
+{
+    if (p0==p1)
+        return;
+
+    const double step = 1./std::max(numSteps,1);
+    // parameter distance used to step over element borders and mesh nodes
+    const double eps = 1.e-9;
+
+    auto clip = [&](int elm, double u0, double &ua, double &ub) {
+        CComplex c[3] = { corner(elm,0), corner(elm,1), corner(elm,2) };
+        return clipLineToTriangle(c, p0, p1, u0, ua, ub);
+    };
+
+    double u = 0;
+    int elm = locate(p0);
+    while (u<1)
+    {
+        double ua = 0, ub = 0;
+        int exitEdge = -2;
+        if (elm>=0)
+        {
+            exitEdge = clip(elm, u, ua, ub);
+            // elm only touches the line at a node: search instead, so that the walk cannot get stuck
+            if (exitEdge>=0 && ub<u+eps)
+                exitEdge = -2;
+        }
+
+        double next = u;
+        if (exitEdge==-2)
+        {
+            // the line does not continue in elm: search the next element along the line
+            elm = -1;
+            for (double us=u+eps; us<1; us=std::max(us+eps, (std::floor(us/step)+1)*step))
+            {
+                int e = locate(p0 + us*(p1-p0));
+                if (e<0)
+                    continue;
+                exitEdge = clip(e, u, ua, ub);
+                if (exitEdge!=-2)
+                {
+                    elm = e;
+                    // always make progress, even if the search disagrees with clipLineToTriangle():
+                    next = us;
+                    break;
+                }
+            }
+            if (elm<0)
+                return;
+        }
+
+        visit(elm, ua, ub);
+        if (exitEdge<0)
+            return;
+        u = std::max(ub, next);
+        elm = neighbour(elm, exitEdge);
+    }
+}
+
+/**
+ * @brief Integrate along a straight line through a triangle mesh.
+ * The line is split at the element borders (see walkLine()), and each part is integrated by a
+ * 3 point Gauss-Legendre rule. This is exact for polynomials of up to 5th order,
+ * i.e. for the piecewise polynomial fields of first order elements, without resampling the line.
+ * @param p0 start of the line
+ * @param p1 end of the line
+ * @param numSteps number of search points used for parts of the line outside the mesh
+ * @param corner see walkLine()
+ * @param neighbour see walkLine()
+ * @param locate see walkLine()
+ * @param integrand a callable with the signature \c void(int elm,CComplex p,double w), called for each
+ * integration point \c p in element \c elm; \c w is the length of the line represented by the point.
+ */
+template <class CornerFunc, class NeighbourFunc, class LocateFunc, class IntegrandFunc>
+void integrateLine(CComplex p0, CComplex p1, int numSteps,
+                   CornerFunc corner, NeighbourFunc neighbour, LocateFunc locate, IntegrandFunc integrand)
+{
+    static const double gaussPoint[3] = { 0.11270166537925831, 0.5, 0.88729833462074169 };
+    static const double gaussWeight[3] = { 5./18., 8./18., 5./18. };
+
+    const double length = abs(p1-p0);
+    walkLine(p0, p1, numSteps, corner, neighbour, locate, [&](int elm, double ua, double ub) {
+        for (int g=0; g<3; g++)
+            integrand(elm, p0 + (ua+(ub-ua)*gaussPoint[g])*(p1-p0), gaussWeight[g]*(ub-ua)*length);
+    });
+}
+
+} //namespace
+#endif
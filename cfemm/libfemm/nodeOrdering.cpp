@@ -0,0 +1,279 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#include "nodeOrdering.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+/// subgraphs with at most this many nodes are not dissected any further
+constexpr std::size_t minDissectionSize = 64;
+
+/**
+ * @brief Breadth-first search on subgraphs of the mesh graph.
+ * A subgraph is given by the nodes whose set number equals the number of the subgraph.
+ */
+class GraphSearch
+{
+public:
+    explicit GraphSearch(const std::vector<std::vector<int>> &adjacency);
+
+    /// \brief Make the given nodes a new subgraph, and return its number.
+    int newSet(const std::vector<int> &nodes);
+    /**
+     * @brief Compute the level structure rooted at root, restricted to the subgraph.
+     * Neighbours are visited in order of increasing degree, i.e. the nodes are in Cuthill-McKee order.
+     * @param root
+     * @param set the subgraph
+     * @param nodes receives the reachable nodes, level by level
+     * @param levelStart receives the index of the first node of each level into nodes, plus the end index
+     */
+    void levels(int root, int set, std::vector<int> &nodes, std::vector<std::size_t> &levelStart);
+    /**
+     * @brief Find a pseudo-peripheral node (George and Liu) in the component of start.
+     * Also returns the level structure rooted at that node.
+     */
+    int pseudoPeripheralNode(int start, int set, std::vector<int> &nodes, std::vector<std::size_t> &levelStart);
+    /// \brief Append the reverse Cuthill-McKee order of the subgraph to order.
+    void appendRCM(const std::vector<int> &subgraph, std::vector<int> &order);
+    /// \brief Append the nested dissection order of the subgraph to order.
+    void appendDissection(const std::vector<int> &subgraph, std::vector<int> &order);
+
+private:
+    /// neighbours sorted by increasing degree
+    std::vector<std::vector<int>> sortedAdjacency;
+    std::vector<int> setOf;
+    std::vector<int> visited;
+    int numSets;
+    int numSearches;
+};
+
+GraphSearch::GraphSearch(const std::vector<std::vector<int>> &adjacency)
+    : sortedAdjacency(adjacency.size())
+    , setOf(adjacency.size(), 0)
+    , visited(adjacency.size(), 0)
+    , numSets(0)
+    , numSearches(0)
+{
+    // bucket the nodes by degree, and append each node to the lists of its neighbours
+    // in that order, so that all adjacency lists end up sorted by degree in linear time:
+    std::size_t maxDegree = 0;
+    for (const auto &neighbours : adjacency)
+        maxDegree = std::max(maxDegree, neighbours.size());
+    std::vector<std::size_t> bucketStart(maxDegree+2, 0);
+    for (const auto &neighbours : adjacency)
+        bucketStart[neighbours.size()+1]++;
+    for (std::size_t d=1; d<bucketStart.size(); d++)
+        bucketStart[d] += bucketStart[d-1];
+    std::vector<int> byDegree(adjacency.size());
+    for (std::size_t i=0; i<adjacency.size(); i++)
+        byDegree[bucketStart[adjacency[i].size()]++] = static_cast<int>(i);
+
+    for (std::size_t i=0; i<adjacency.size(); i++)
+        sortedAdjacency[i].reserve(adjacency[i].size());
+    for (int node : byDegree)
+    {
+        for (int neighbour : adjacency[node])
+            sortedAdjacency[neighbour].push_back(node);
+    }
+}
+
+int GraphSearch::newSet(const std::vector<int> &nodes)
+{
+    numSets++;
+    for (int node : nodes)
+        setOf[node] = numSets;
+    return numSets;
+}
+
+void GraphSearch::levels(int root, int set, std::vector<int> &nodes, std::vector<std::size_t> &levelStart)
+{
+    numSearches++;
+    nodes.clear();
+    levelStart.clear();
+
+    nodes.push_back(root);
+    visited[root] = numSearches;
+    std::size_t begin = 0;
+    while (begin < nodes.size())
+    {
+        levelStart.push_back(begin);
+        const std::size_t end = nodes.size();
+        for (std::size_t k=begin; k<end; k++)
+        {
+            for (int neighbour : sortedAdjacency[nodes[k]])
+            {
+                if (setOf[neighbour]==set && visited[neighbour]!=numSearches)
+                {
+                    visited[neighbour] = numSearches;
+                    nodes.push_back(neighbour);
+                }
+            }
+        }
+        begin = end;
+    }
+    levelStart.push_back(nodes.size());
+}
+
+int GraphSearch::pseudoPeripheralNode(int start, int set, std::vector<int> &nodes, std::vector<std::size_t> &levelStart)
+{
+    int root = start;
+    levels(root, set, nodes, levelStart);
+
+    std::vector<int> candidateNodes;
+    std::vector<std::size_t> candidateLevels;
+    for (;;)
+    {
+        // try the node of minimum degree in the last level:
+        int candidate = -1;
+        for (std::size_t k=levelStart[levelStart.size()-2]; k<nodes.size(); k++)
+        {
+            if (candidate<0 || sortedAdjacency[nodes[k]].size() < sortedAdjacency[candidate].size())
+                candidate = nodes[k];
+        }
+        levels(candidate, set, candidateNodes, candidateLevels);
+        if (candidateLevels.size() <= levelStart.size())
+            return root;
+        root = candidate;
+        nodes.swap(candidateNodes);
+        levelStart.swap(candidateLevels);
+    }
+}
+
+void GraphSearch::appendRCM(const std::vector<int> &subgraph, std::vector<int> &order)
+{
+    const int set = newSet(subgraph);
+    const std::size_t first = order.size();
+    std::vector<int> nodes;
+    std::vector<std::size_t> levelStart;
+    for (int node : subgraph)
+    {
+        // start a new component:
+        if (setOf[node] != set)
+            continue;
+        pseudoPeripheralNode(node, set, nodes, levelStart);
+        for (int n : nodes)
+        {
+            order.push_back(n);
+            setOf[n] = 0;
+        }
+    }
+    std::reverse(order.begin()+first, order.end());
+}
+
+void GraphSearch::appendDissection(const std::vector<int> &subgraph, std::vector<int> &order)
+{
+    if (subgraph.size() <= minDissectionSize)
+    {
+        appendRCM(subgraph, order);
+        return;
+    }
+
+    const int set = newSet(subgraph);
+    std::vector<int> nodes;
+    std::vector<std::size_t> levelStart;
+    pseudoPeripheralNode(subgraph[0], set, nodes, levelStart);
+
+    if (nodes.size() < subgraph.size())
+    {
+        // disconnected: handle the component of subgraph[0] and the rest separately
+        std::vector<int> rest;
+        rest.reserve(subgraph.size()-nodes.size());
+        for (int n : nodes)
+            setOf[n] = 0;
+        for (int n : subgraph)
+        {
+            if (setOf[n] == set)
+                rest.push_back(n);
+        }
+        appendDissection(nodes, order);
+        appendDissection(rest, order);
+        return;
+    }
+
+    const std::size_t numLevels = levelStart.size()-1;
+    if (numLevels < 3)
+    {
+        appendRCM(subgraph, order);
+        return;
+    }
+
+    // use the smallest level in the middle third as separator:
+    std::size_t separator = numLevels/2;
+    for (std::size_t l=numLevels/3; l<=(2*numLevels)/3; l++)
+    {
+        if (l>0 && l+1<numLevels
+                && levelStart[l+1]-levelStart[l] < levelStart[separator+1]-levelStart[separator])
+            separator = l;
+    }
+
+    std::vector<int> lower(nodes.begin(), nodes.begin()+levelStart[separator]);
+    std::vector<int> upper(nodes.begin()+levelStart[separator+1], nodes.end());
+    std::vector<int> separatorNodes(nodes.begin()+levelStart[separator], nodes.begin()+levelStart[separator+1]);
+    nodes.clear();
+    nodes.shrink_to_fit();
+
+    appendDissection(lower, order);
+    appendDissection(upper, order);
+    order.insert(order.end(), separatorNodes.begin(), separatorNodes.end());
+}
+
+std::vector<int> orderToNumbering(const std::vector<int> &order)
+{
+    std::vector<int> newnum(order.size());
+    for (std::size_t k=0; k<order.size(); k++)
+        newnum[order[k]] = static_cast<int>(k);
+    return newnum;
+}
+
+std::vector<int> allNodes(std::size_t numNodes)
+{
+    std::vector<int> nodes(numNodes);
+    for (std::size_t i=0; i<numNodes; i++)
+        nodes[i] = static_cast<int>(i);
+    return nodes;
+}
+
+} // namespace
+
+std::vector<int> femm::reverseCuthillMcKee(const std::vector<std::vector<int>> &adjacency)
+{
+    GraphSearch search(adjacency);
+    std::vector<int> order;
+    order.reserve(adjacency.size());
+    search.appendRCM(allNodes(adjacency.size()), order);
+    return orderToNumbering(order);
+}
+
+std::vector<int> femm::nestedDissection(const std::vector<std::vector<int>> &adjacency)
+{
+    GraphSearch search(adjacency);
+    std::vector<int> order;
+    order.reserve(adjacency.size());
+    search.appendDissection(allNodes(adjacency.size()), order);
+    return orderToNumbering(order);
+}
+
+void femm::orderingStatistics(const std::vector<std::vector<int>> &adjacency,
+                              const std::vector<int> &newnum,
+                              int &bandwidth, int64_t &profile)
+{
+    bandwidth = 0;
+    profile = 0;
+    for (std::size_t i=0; i<adjacency.size(); i++)
+    {
+        int first = newnum[i];
+        for (int neighbour : adjacency[i])
+        {
+            bandwidth = std::max(bandwidth, std::abs(newnum[i]-newnum[neighbour]));
+            first = std::min(first, newnum[neighbour]);
+        }
+        profile += newnum[i]-first;
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#ifndef FEMM_NODEORDERING_H
+#define FEMM_NODEORDERING_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * \file nodeOrdering.h
+ * \brief Fill-reducing and bandwidth-reducing orderings of the mesh nodes.
+ *
+ * All functions take the mesh connectivity as adjacency lists
+ * (one list of neighbouring nodes for each node, without the node itself),
+ * and return the new number of each node.
+ */
+
+namespace femm
+{
+
+/**
+ * @brief Compute a reverse Cuthill-McKee ordering.
+ * Each connected component is numbered breadth-first from a pseudo-peripheral node
+ * (found with the algorithm of George and Liu),
+ * visiting the neighbours of a node in order of increasing degree.
+ * The resulting order is reversed, which reduces the profile of the matrix.
+ * @param adjacency the neighbours of each node
+ * @return the new number of each node
+ */
+std::vector<int> reverseCuthillMcKee(const std::vector<std::vector<int>> &adjacency);
+
+/**
+ * @brief Compute a nested dissection ordering.
+ * The graph is split recursively by level set separators of a breadth-first search
+ * from a pseudo-peripheral node. The separator nodes are numbered after both halves,
+ * and small subgraphs are numbered by reverse Cuthill-McKee.
+ *
+ * This ordering has a large bandwidth, but produces much less fill-in than banded orderings
+ * when the matrix is factorised by a direct solver.
+ * @param adjacency the neighbours of each node
+ * @return the new number of each node
+ */
+std::vector<int> nestedDissection(const std::vector<std::vector<int>> &adjacency);
+
+/**
+ * @brief Compute the bandwidth and profile of the matrix of a renumbered mesh.
+ * @param adjacency the neighbours of each node
+ * @param newnum the new number of each node
+ * @param bandwidth receives the largest difference between the numbers of neighbouring nodes
+ * @param profile receives the envelope size, i.e. the sum over all rows of the distance
+ *        between the diagonal and the first nonzero entry of the row
+ */
+void orderingStatistics(const std::vector<std::vector<int>> &adjacency,
+                        const std::vector<int> &newnum,
+                        int &bandwidth, int64_t &profile);
+
+} //namespace
+#endif
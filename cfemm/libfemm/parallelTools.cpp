@@ -0,0 +1,38 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#include "parallelTools.h"
+
+#include <atomic>
+#include <cstdlib>
+
+namespace {
+// 0: use default
+std::atomic<unsigned int> configuredThreadCount(0);
+} // anonymous namespace
+
+unsigned int femm::threadCount()
+{
+    unsigned int n = configuredThreadCount;
+    if (n>0)
+        return n;
+
+    const char *env = std::getenv("XFEMM_NUM_THREADS");
+    if (env)
+    {
+        int envCount = std::atoi(env);
+        if (envCount>0)
+            return static_cast<unsigned int>(envCount);
+    }
+    n = std::thread::hardware_concurrency();
+    return (n>0) ? n : 1;
+}
+
+void femm::setThreadCount(unsigned int n)
+{
+    configuredThreadCount = n;
+}
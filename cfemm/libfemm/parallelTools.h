@@ -0,0 +1,157 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#ifndef FEMM_PARALLELTOOLS_H
+#define FEMM_PARALLELTOOLS_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+ * \file parallelTools.h
+ * \brief Helpers for running independent loop iterations on several threads.
+ */
+
+namespace femm
+{
+
+/**
+ * @brief Get the number of threads used by parallelFor().
+ * Unless set by setThreadCount(), this is the value of the environment variable
+ * \c XFEMM_NUM_THREADS, or the number of hardware threads if that is not set.
+ * @return the number of threads (at least 1)
+ */
+unsigned int threadCount();
+
+/**
+ * @brief Set the number of threads used by parallelFor().
+ * @param n the number of threads, or 0 to restore the default.
+ */
+void setThreadCount(unsigned int n);
+
+/**
+ * @brief parallelFor splits the range [0,n) into contiguous chunks and calls
+ * \p f(begin,end) for each chunk, using up to threadCount() threads.
+ *
+ * The chunks are processed concurrently, so \p f must not write to data shared between chunks.
+ * Ranges smaller than two chunks of \p minChunkSize are processed on the calling thread.
+ * The chunk boundaries only depend on \p n and threadCount().
+ *
+ * @param n the number of iterations
+ * @param f a callable with the signature \c void(int begin,int end)
+ * @param minChunkSize minimum number of iterations per chunk
+ */
+template <class Func>
+void parallelFor(int n, Func f, int minChunkSize=1024)
+{
+    int numChunks = std::min(static_cast<int>(threadCount()), n/std::max(minChunkSize,1));
+    if (numChunks<=1)
+    {
+        if (n>0)
+            f(0,n);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(numChunks-1);
+    for (int chunk=1; chunk<numChunks; chunk++)
+    {
+        int begin = static_cast<int>(static_cast<long long>(n)*chunk/numChunks);
+        int end = static_cast<int>(static_cast<long long>(n)*(chunk+1)/numChunks);
+        workers.emplace_back(f, begin, end);
+    }
+    f(0, static_cast<int>(static_cast<long long>(n)/numChunks));
+    for (auto &worker : workers)
+        worker.join();
+}
+
+/**
+ * @brief parallelSums computes \p m sums over i in [0,n) at once, using up to threadCount() threads.
+ *
+ * For each i, \p f(i,terms) stores the \p m terms of index i in \p terms[0..m-1];
+ * all of them need to be set. \p sum[j] is set to the sum of the j-th terms.
+ *
+ * The range is split into blocks of \p blockSize indices, which are summed using
+ * compensated (Kahan) summation. The block sums are then added pairwise.
+ * Neither the blocks nor the order of the additions depend on the number of threads,
+ * so the result is reproducible from run to run and for any thread count.
+ *
+ * \p f is called concurrently, so it must not write to data shared between calls.
+ *
+ * @param n the number of indices
+ * @param m the number of sums
+ * @param f a callable with the signature \c void(int i, T *terms)
+ * @param sum array of \p m sums
+ * @param blockSize number of indices per block
+ */
+template <class T, class Func>
+void parallelSums(int n, int m, Func f, T *sum, int blockSize=256)
+{
+    for (int j=0; j<m; j++)
+        sum[j] = T(0);
+    int numBlocks = (n>0) ? (n+blockSize-1)/blockSize : 0;
+    if (numBlocks==0 || m<=0)
+        return;
+
+    std::vector<T> partialSum(static_cast<size_t>(numBlocks)*m, T(0));
+    parallelFor(numBlocks, [&](int begin, int end) {
+        std::vector<T> term(m);
+        std::vector<T> compensation(m);
+        for (int block=begin; block<end; block++)
+        {
+            T *blockSum = &partialSum[static_cast<size_t>(block)*m];
+            std::fill(compensation.begin(), compensation.end(), T(0));
+            int last = std::min(n, (block+1)*blockSize);
+            for (int i=block*blockSize; i<last; i++)
+            {
+                f(i, term.data());
+                for (int j=0; j<m; j++)
+                {
+                    T y = term[j] - compensation[j];
+                    T t = blockSum[j] + y;
+                    compensation[j] = (t - blockSum[j]) - y;
+                    blockSum[j] = t;
+                }
+            }
+        }
+    }, 4);
+
+    for (int stride=1; stride<numBlocks; stride*=2)
+    {
+        for (int block=0; block+stride<numBlocks; block+=2*stride)
+        {
+            for (int j=0; j<m; j++)
+                partialSum[static_cast<size_t>(block)*m+j] += partialSum[static_cast<size_t>(block+stride)*m+j];
+        }
+    }
+    std::copy(partialSum.begin(), partialSum.begin()+m, sum);
+}
+
+/**
+ * @brief parallelSum computes the sum of \p f(i) for i in [0,n), using up to threadCount() threads.
+ *
+ * This is parallelSums() for a single sum, so the result is reproducible from run to run
+ * and for any thread count.
+ *
+ * @param n the number of terms
+ * @param f a callable with the signature \c T(int i); must be safe to call concurrently.
+ * @param blockSize number of terms per block
+ * @return the sum, or T(0) if \p n is 0
+ */
+template <class T, class Func>
+T parallelSum(int n, Func f, int blockSize=256)
+{
+    T sum;
+    parallelSums<T>(n, 1, [&f](int i, T *term) {
+        *term = f(i);
+    }, &sum, blockSize);
+    return sum;
+}
+
+} //namespace
+#endif
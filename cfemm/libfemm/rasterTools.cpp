@@ -0,0 +1,60 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#include "rasterTools.h"
+
+#include <cstdio>
+
+femm::RasterGrid femm::makeRasterGrid(double x0, double y0, double x1, double y1, int nx, int ny)
+{
+    RasterGrid grid;
+    grid.x0 = x0;
+    grid.y0 = y0;
+    grid.dx = (nx>1) ? (x1-x0)/(nx-1) : 0;
+    grid.dy = (ny>1) ? (y1-y0)/(ny-1) : 0;
+    grid.nx = nx;
+    grid.ny = ny;
+    return grid;
+}
+
+bool femm::rasterRange(double lo, double hi, double origin, double step, int n, int &first, int &last)
+{
+    if (n<=0 || lo>hi)
+        return false;
+    if (step==0)
+    {
+        // all points have the same coordinate
+        if (origin<lo || origin>hi)
+            return false;
+        first = 0;
+        last = n-1;
+        return true;
+    }
+    double a = (lo-origin)/step;
+    double b = (hi-origin)/step;
+    if (a>b)
+        std::swap(a,b);
+    // clamp before converting to int, to avoid overflows:
+    a = std::max(std::floor(a)-1, 0.);
+    b = std::min(std::ceil(b)+1, n-1.);
+    if (a>b)
+        return false;
+    first = static_cast<int>(a);
+    last = static_cast<int>(b);
+    return true;
+}
+
+bool femm::writeRaster(const std::string &filename, const std::vector<float> &values)
+{
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp)
+        return false;
+    bool ok = (fwrite(values.data(), sizeof(float), values.size(), fp) == values.size());
+    if (fclose(fp)!=0)
+        ok = false;
+    return ok;
+}
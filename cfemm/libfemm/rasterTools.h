@@ -0,0 +1,158 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#ifndef FEMM_RASTERTOOLS_H
+#define FEMM_RASTERTOOLS_H
+
+#include "femmcomplex.h"
+#include "parallelTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * \file rasterTools.h
+ * \brief Sampling of mesh solutions on regular grids, e.g. for field maps.
+ */
+
+namespace femm
+{
+
+/**
+ * @brief The RasterGrid struct describes a regular grid of sample points.
+ * Grid point (i,j) lies at (x0+i*dx, y0+j*dy), and its values are stored at index i+j*nx,
+ * i.e. row by row, starting with the row at y0.
+ */
+struct RasterGrid
+{
+    double x0, y0;
+    double dx, dy;
+    int nx, ny;
+
+    int size() const { return nx*ny; }
+    double x(int i) const { return x0+i*dx; }
+    double y(int j) const { return y0+j*dy; }
+};
+
+/**
+ * @brief Make a grid of \p nx times \p ny points, with corners (x0,y0) and (x1,y1).
+ * If \p nx (or \p ny) is 1, all points are at x0 (or y0).
+ */
+RasterGrid makeRasterGrid(double x0, double y0, double x1, double y1, int nx, int ny);
+
+/**
+ * @brief Get the grid indices k with origin+k*step between \p lo and \p hi.
+ * The range is widened by one index on both sides, so that rounding errors can not lose any points.
+ * @return \c false, if the range is empty
+ */
+bool rasterRange(double lo, double hi, double origin, double step, int n, int &first, int &last);
+
+/**
+ * @brief Find the mesh triangle containing each grid point, by scan converting the triangles onto the grid.
+ * Each triangle only tests the grid points next to the span it covers in each grid row,
+ * so that the total work is O(grid points + triangles) instead of one point location per grid point.
+ * Points on the border between triangles belong to the triangle with the lowest index.
+ * @param numTriangles the number of triangles
+ * @param grid the grid
+ * @param corner a callable with the signature \c CComplex(int i,int j),
+ * returning corner \c j (0..2) of triangle \c i.
+ * @param inTriangle a callable with the signature \c bool(double x,double y,int i),
+ * that tests whether the point lies in triangle \c i.
+ * @param owner output array of grid.size() triangle indices, -1 for points outside the mesh.
+ * @return the number of grid points inside the mesh
+ */
+template <class CornerFunc, class InTriangleFunc>
+int rasterizeTriangles(int numTriangles, const RasterGrid &grid, CornerFunc corner, InTriangleFunc inTriangle, int *owner)
+{
+    std::fill(owner, owner+grid.size(), -1);
+    int count = 0;
+    for (int elm=0; elm<numTriangles; elm++)
+    {
+        const CComplex c[3] = { corner(elm,0), corner(elm,1), corner(elm,2) };
+        const double ymin = std::min(c[0].im, std::min(c[1].im, c[2].im));
+        const double ymax = std::max(c[0].im, std::max(c[1].im, c[2].im));
+        int j0, j1;
+        if (!rasterRange(ymin, ymax, grid.y0, grid.dy, grid.ny, j0, j1))
+            continue;
+        for (int j=j0; j<=j1; j++)
+        {
+            // span of the triangle in this row; rows next to the triangle get the span at its top or bottom:
+            const double y = std::max(ymin, std::min(grid.y(j), ymax));
+            double xmin = std::numeric_limits<double>::max();
+            double xmax = -xmin;
+            for (int k=0; k<3; k++)
+            {
+                const CComplex &a = c[k];
+                const CComplex &b = c[(k+1)%3];
+                if (y<std::min(a.im,b.im) || y>std::max(a.im,b.im))
+                    continue;
+                double xa = a.re, xb = b.re;
+                if (a.im!=b.im)
+                    xa = xb = a.re + (y-a.im)*(b.re-a.re)/(b.im-a.im);
+                xmin = std::min(xmin, std::min(xa,xb));
+                xmax = std::max(xmax, std::max(xa,xb));
+            }
+            int i0, i1;
+            if (!rasterRange(xmin, xmax, grid.x0, grid.dx, grid.nx, i0, i1))
+                continue;
+            for (int i=i0; i<=i1; i++)
+            {
+                int &o = owner[i+j*grid.nx];
+                if (o<0 && inTriangle(grid.x(i), grid.y(j), elm))
+                {
+                    o = elm;
+                    count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Evaluate the solution at the grid points inside the mesh.
+ * The grid points are evaluated on several threads (see parallelFor()).
+ * @param grid the grid
+ * @param owner the triangle containing each grid point, see rasterizeTriangles()
+ * @param numPlanes the number of values per grid point
+ * @param evaluate a callable with the signature \c void(double x,double y,int elm,float *v),
+ * storing \p numPlanes values in \c v; must be safe to call concurrently.
+ * @param values receives numPlanes*grid.size() values, plane by plane; NaN for points outside the mesh.
+ */
+template <class EvaluateFunc>
+void evaluateRaster(const RasterGrid &grid, const int *owner, int numPlanes, EvaluateFunc evaluate, std::vector<float> &values)
+{
+    const size_t n = static_cast<size_t>(grid.size());
+    values.assign(numPlanes*n, std::numeric_limits<float>::quiet_NaN());
+    parallelFor(grid.size(), [&](int begin, int end) {
+        std::vector<float> v(numPlanes);
+        for (int p=begin; p<end; p++)
+        {
+            if (owner[p]<0)
+                continue;
+            evaluate(grid.x(p%grid.nx), grid.y(p/grid.nx), owner[p], v.data());
+            for (int q=0; q<numPlanes; q++)
+                values[q*n+p] = v[q];
+        }
+    }, 1024);
+}
+
+/**
+ * @brief Write raster values to a binary file.
+ * The file contains the values as 32 bit floats in native byte order, without any header,
+ * in the order used by evaluateRaster(), i.e. as an array [planes][ny][nx].
+ * @param filename
+ * @param values
+ * @return \c true on success
+ */
+bool writeRaster(const std::string &filename, const std::vector<float> &values);
+
+} //namespace
+#endif
@@ -50,7 +50,7 @@ CBigLinProb::~CBigLinProb()
 {
     if (n==0) return;
 
-    int i;
+    SparseIndex i;
     CEntry *uo,*ui;
 
     free(b);
@@ -77,9 +77,9 @@ CBigLinProb::~CBigLinProb()
     n = 0;
 }
 
-int CBigLinProb::Create(int d, int bw)
+int CBigLinProb::Create(SparseIndex d, SparseIndex bw)
 {
-    int i;
+    SparseIndex i;
 
     bdw=bw;
     b=(double *)calloc(d,sizeof(double));
@@ -102,7 +102,7 @@ int CBigLinProb::Create(int d, int bw)
     return 1;
 }
 
-void CBigLinProb::Put(double v, int p, int q)
+void CBigLinProb::Put(double v, SparseIndex p, SparseIndex q)
 {
     CEntry *e,*l = NULL;
 
@@ -141,7 +141,7 @@ void CBigLinProb::Put(double v, int p, int q)
     return;
 }
 
-double CBigLinProb::Get(int p, int q)
+double CBigLinProb::Get(SparseIndex p, SparseIndex q)
 {
     if (q < p)
     {
@@ -159,14 +159,14 @@ double CBigLinProb::Get(int p, int q)
     return 0;
 }
 
-void CBigLinProb::AddTo(double v, int p, int q)
+void CBigLinProb::AddTo(double v, SparseIndex p, SparseIndex q)
 {
 	Put(Get(p,q)+v,p,q);
 }
 
 void CBigLinProb::MultA(double *X, double *Y)
 {
-    int i;
+    SparseIndex i;
     CEntry *e;
 
     for(i=0; i<n; i++) Y[i]=0;
@@ -186,7 +186,7 @@ void CBigLinProb::MultA(double *X, double *Y)
 
 double CBigLinProb::Dot(double *X, double *Y)
 {
-    int i;
+    SparseIndex i;
     double z;
 
     for(i=0,z=0; i<n; i++) z+=X[i]*Y[i];
@@ -201,7 +201,7 @@ void CBigLinProb::MultPC(const double *X, double *Y)
     // for(i=0;i<n;i++) Y[i]=X[i]/M[i]->x;
 
     // SSOR preconditioner:
-    int i;
+    SparseIndex i;
     double c;
     CEntry *e;
 
@@ -237,14 +237,14 @@ void CBigLinProb::MultPC(const double *X, double *Y)
 
 bool CBigLinProb::PCGSolve(int flag)
 {
-    int i;
+    SparseIndex i;
     double res,res_o,res_new;
     double er,del,rho,pAp;
 
     // quick check for most obvious sign of singularity;
     for(i=0; i<n; i++) if(M[i]->x==0)
         {
-            fprintf(stderr,"singular flag tripped at %i of %i\n", i,n);
+            fprintf(stderr,"singular flag tripped at %lld of %lld\n", (long long)i, (long long)n);
             return 0;
         }
 
@@ -315,9 +315,9 @@ bool CBigLinProb::PCGSolve(int flag)
     return true;
 }
 
-void CBigLinProb::SetValue(int i, double x)
+void CBigLinProb::SetValue(SparseIndex i, double x)
 {
-    int k,fst,lst;
+    SparseIndex k,fst,lst;
     double z;
 
     if(bdw==0)
@@ -347,7 +347,7 @@ void CBigLinProb::SetValue(int i, double x)
 
 void CBigLinProb::Wipe()
 {
-    int i;
+    SparseIndex i;
     CEntry *e;
 
     for(i=0; i<n; i++)
@@ -363,13 +363,56 @@ void CBigLinProb::Wipe()
     }
 }
 
-void CBigLinProb::AntiPeriodicity(int i, int j)
+void CBigLinProb::SaveValues(CBigLinProbValues &values) const
 {
-    int k,fst,lst;
+    values.rowStart.assign(1,0);
+    values.col.clear();
+    values.x.clear();
+    values.b.assign(b,b+n);
+
+    for(SparseIndex i=0; i<n; i++)
+    {
+        for(CEntry *e=M[i]; e!=NULL; e=e->next)
+        {
+            values.col.push_back(e->c);
+            values.x.push_back(e->x);
+        }
+        values.rowStart.push_back(values.col.size());
+    }
+}
+
+void CBigLinProb::RestoreValues(const CBigLinProbValues &values)
+{
+    SparseIndex i,k;
+    CEntry *e;
+
+    for(i=0; i<n; i++)
+    {
+        b[i]=values.b[i];
+
+        // entries are never removed from a row, and both lists are sorted by column:
+        e=M[i];
+        for(k=values.rowStart[i]; k<values.rowStart[i+1]; k++)
+        {
+            while(e->c < values.col[k])
+            {
+                e->x=0;
+                e=e->next;
+            }
+            e->x=values.x[k];
+            e=e->next;
+        }
+        for(; e!=NULL; e=e->next) e->x=0;
+    }
+}
+
+void CBigLinProb::AntiPeriodicity(SparseIndex i, SparseIndex j)
+{
+    SparseIndex k,fst,lst;
     double v1,v2,c;
 
 #ifdef KLUDGE
-    int tmpbdw=bdw;
+    SparseIndex tmpbdw=bdw;
     bdw=0;
 #endif
 
@@ -418,13 +461,13 @@ void CBigLinProb::AntiPeriodicity(int i, int j)
 #endif
 }
 
-void CBigLinProb::Periodicity(int i, int j)
+void CBigLinProb::Periodicity(SparseIndex i, SparseIndex j)
 {
-    int k,fst,lst;
+    SparseIndex k,fst,lst;
     double v1,v2,c;
 
 #ifdef KLUDGE
-    int tmpbdw=bdw;
+    SparseIndex tmpbdw=bdw;
     bdw=0;
 #endif
 
@@ -479,7 +522,7 @@ void CBigLinProb::Periodicity(int i, int j)
 void CBigLinProb::ComputeBandwidth()
 {
     CEntry *e;
-    int k,bw,maxbw;
+    SparseIndex k,bw,maxbw;
 
     for(maxbw=0,k=0; k<n; k++)
     {
@@ -491,5 +534,5 @@ void CBigLinProb::ComputeBandwidth()
 
 //	MsgBox("Assumed Bandwidth = %i\nActual Bandwidth = %i",bdw,maxbw);
 
-    printf("Assumed Bandwidth = %i\nActual Bandwidth = %i", bdw, maxbw);
+    printf("Assumed Bandwidth = %lld\nActual Bandwidth = %lld", (long long)bdw, (long long)maxbw);
 }
@@ -22,18 +22,45 @@
 #ifndef SPARS_H
 #define SPARS_H
 
+#include <cstdint>
+#include <vector>
+
+/**
+ * Index type for the rows and columns of the sparse matrices,
+ * also used for the node and element counts of the solvers.
+ * Configure with XFEMM_LARGE_MODELS to use 64 bit indices for very large meshes.
+ */
+#ifdef XFEMM_LARGE_MODELS
+typedef int64_t SparseIndex;
+#else
+typedef int SparseIndex;
+#endif
+
 class CEntry
 {
 public:
 
     double x;				// value stored in the entry
-    int c;					// column that the entry lives in
+    SparseIndex c;			// column that the entry lives in
     CEntry *next;			// pointer to next entry in row;
     CEntry();
 
 private:
 };
 
+/**
+ * @brief Matrix entries and right hand side of a CBigLinProb,
+ * as saved by CBigLinProb::SaveValues().
+ */
+class CBigLinProbValues
+{
+public:
+    std::vector<SparseIndex> rowStart; ///< index of the first entry of each row in col and x
+    std::vector<SparseIndex> col;      ///< column of each entry
+    std::vector<double> x;             ///< value of each entry
+    std::vector<double> b;             ///< right hand side
+};
+
 
 class CBigLinProb
 {
@@ -48,8 +75,8 @@ public:
     double *Z;
     double *b;				// RHS of linear equation
     CEntry **M;				// pointer to list of matrix entries;
-    int n;					// dimensions of the matrix;
-    int bdw;				// Optional matrix bandwidth parameter;
+    SparseIndex n;			// dimensions of the matrix;
+    SparseIndex bdw;		// Optional matrix bandwidth parameter;
     double Precision;		// error tolerance for solution
     double Lambda;			// relaxation factor;
 
@@ -61,18 +88,29 @@ public:
     CBigLinProb();
     // destructor
     ~CBigLinProb();
-    virtual int Create(int d, int bw);	// initialize the problem
-    void Put(double v, int p, int q);
+    virtual int Create(SparseIndex d, SparseIndex bw);	// initialize the problem
+    void Put(double v, SparseIndex p, SparseIndex q);
     // use to create/set entries in the matrix
-    double Get(int p, int q);
+    double Get(SparseIndex p, SparseIndex q);
     bool PCGSolve(int flag);	// flag==true if guess for V present;
     void MultPC(const double *X, double *Y);
-    void AddTo(double v, int p, int q);
+    void AddTo(double v, SparseIndex p, SparseIndex q);
     void MultA(double *X, double *Y);
-    void SetValue(int i, double x);
-    void Periodicity(int i, int j);
-    void AntiPeriodicity(int i, int j);
+    void SetValue(SparseIndex i, double x);
+    void Periodicity(SparseIndex i, SparseIndex j);
+    void AntiPeriodicity(SparseIndex i, SparseIndex j);
     void Wipe();
+    /**
+     * @brief Save the current matrix entries and right hand side.
+     * @param values receives the values
+     */
+    void SaveValues(CBigLinProbValues &values) const;
+    /**
+     * @brief Replace the matrix entries and right hand side by values saved with SaveValues().
+     * Entries that have been added to the matrix after saving the values are set to zero.
+     * @param values the saved values
+     */
+    void RestoreValues(const CBigLinProbValues &values);
     double Dot(double *X, double *Y);
     void ComputeBandwidth();
 
@@ -0,0 +1,453 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#include "spatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+femm::TriangleGrid::TriangleGrid()
+    : boxes()
+    , cellStart()
+    , cellItems()
+    , extent{0,0,0,0}
+    , numColumns(0)
+    , numRows(0)
+    , columnScale(0)
+    , rowScale(0)
+{
+}
+
+void femm::TriangleGrid::clear()
+{
+    boxes.clear();
+    boxes.shrink_to_fit();
+    cellStart.clear();
+    cellStart.shrink_to_fit();
+    cellItems.clear();
+    cellItems.shrink_to_fit();
+    numColumns = 0;
+    numRows = 0;
+}
+
+void femm::TriangleGrid::setBoxes(std::vector<Box> &triangleBoxes)
+{
+    clear();
+    boxes.swap(triangleBoxes);
+    const int n = static_cast<int>(boxes.size());
+    if (n==0)
+        return;
+
+    extent = boxes[0];
+    for (const Box &b: boxes)
+    {
+        extent.xmin = std::min(extent.xmin, b.xmin);
+        extent.xmax = std::max(extent.xmax, b.xmax);
+        extent.ymin = std::min(extent.ymin, b.ymin);
+        extent.ymax = std::max(extent.ymax, b.ymax);
+    }
+
+    // choose about one cell per triangle, with (roughly) square cells:
+    double width = extent.xmax - extent.xmin;
+    double height = extent.ymax - extent.ymin;
+    if (width>0 && height>0)
+    {
+        numColumns = static_cast<int>(std::ceil(std::sqrt(n*width/height)));
+        numColumns = std::max(1, std::min(numColumns, n));
+        numRows = std::max(1, std::min(n/numColumns, n));
+    } else {
+        // degenerate mesh, use a single row or column
+        numColumns = (width>0) ? n : 1;
+        numRows = (height>0) ? n : 1;
+    }
+    columnScale = (width>0) ? numColumns/width : 0;
+    rowScale = (height>0) ? numRows/height : 0;
+
+    // count the cells covered by each triangle, then fill in the triangle indices:
+    cellStart.assign(static_cast<size_t>(numColumns)*numRows+1, 0);
+    for (const Box &b: boxes)
+    {
+        int c0=column(b.xmin), c1=column(b.xmax);
+        int r0=row(b.ymin), r1=row(b.ymax);
+        for (int r=r0; r<=r1; r++)
+            for (int c=c0; c<=c1; c++)
+                cellStart[r*numColumns+c+1]++;
+    }
+    for (size_t c=1; c<cellStart.size(); c++)
+        cellStart[c] += cellStart[c-1];
+
+    cellItems.resize(cellStart.back());
+    std::vector<int> fill(cellStart.begin(), cellStart.end()-1);
+    for (int i=0; i<n; i++)
+    {
+        const Box &b = boxes[i];
+        int c0=column(b.xmin), c1=column(b.xmax);
+        int r0=row(b.ymin), r1=row(b.ymax);
+        for (int r=r0; r<=r1; r++)
+            for (int c=c0; c<=c1; c++)
+                cellItems[fill[r*numColumns+c]++] = i;
+    }
+}
+
+int femm::TriangleGrid::cellAt(double x, double y) const
+{
+    if (boxes.empty()
+            || x<extent.xmin || x>extent.xmax
+            || y<extent.ymin || y>extent.ymax)
+        return -1;
+    return row(y)*numColumns + column(x);
+}
+
+int femm::TriangleGrid::column(double x) const
+{
+    int c = static_cast<int>((x-extent.xmin)*columnScale);
+    return std::max(0, std::min(c, numColumns-1));
+}
+
+int femm::TriangleGrid::row(double y) const
+{
+    int r = static_cast<int>((y-extent.ymin)*rowScale);
+    return std::max(0, std::min(r, numRows-1));
+}
+
+femm::BoxTree::BoxTree()
+    : boxes()
+    , items()
+    , nodes()
+{
+}
+
+void femm::BoxTree::clear()
+{
+    boxes.clear();
+    boxes.shrink_to_fit();
+    items.clear();
+    items.shrink_to_fit();
+    nodes.clear();
+    nodes.shrink_to_fit();
+}
+
+void femm::BoxTree::setBoxes(std::vector<Box> &itemBoxes)
+{
+    clear();
+    boxes.swap(itemBoxes);
+    const int n = static_cast<int>(boxes.size());
+    if (n==0)
+        return;
+
+    items.resize(n);
+    for (int i=0; i<n; i++)
+        items[i] = i;
+    nodes.reserve(2*(n/4)+1);
+    buildNode(0, n);
+}
+
+int femm::BoxTree::buildNode(int begin, int end)
+{
+    // maximum number of items in a leaf
+    const int leafSize = 8;
+
+    const int idx = static_cast<int>(nodes.size());
+    nodes.push_back(Node());
+    Box extent = boxes[items[begin]];
+    for (int n=begin+1; n<end; n++)
+    {
+        const Box &b = boxes[items[n]];
+        extent.xmin = std::min(extent.xmin, b.xmin);
+        extent.xmax = std::max(extent.xmax, b.xmax);
+        extent.ymin = std::min(extent.ymin, b.ymin);
+        extent.ymax = std::max(extent.ymax, b.ymax);
+    }
+    nodes[idx].extent = extent;
+    nodes[idx].left = -1;
+    nodes[idx].right = -1;
+    nodes[idx].begin = begin;
+    nodes[idx].end = end;
+    if (end-begin<=leafSize)
+        return idx;
+
+    // split at the median of the box centres along the longer side:
+    const bool splitX = (extent.xmax-extent.xmin) >= (extent.ymax-extent.ymin);
+    const int mid = begin + (end-begin)/2;
+    std::nth_element(items.begin()+begin, items.begin()+mid, items.begin()+end,
+                     [this,splitX](int a, int b) {
+        const Box &ba = boxes[a];
+        const Box &bb = boxes[b];
+        return splitX ? (ba.xmin+ba.xmax < bb.xmin+bb.xmax) : (ba.ymin+ba.ymax < bb.ymin+bb.ymax);
+    });
+    const int left = buildNode(begin, mid);
+    const int right = buildNode(mid, end);
+    nodes[idx].left = left;
+    nodes[idx].right = right;
+    return idx;
+}
+
+namespace {
+// maximum number of cells listing a single item
+const int64_t maxItemCells = 256;
+}
+
+femm::BoxHash::BoxHash()
+    : m_cellSize(0)
+    , numItems(0)
+    , cells()
+    , largeItems()
+    , occupied{0,0,-1,-1}
+    , extent{0,0,0,0}
+    , hasExtent(false)
+{
+}
+
+void femm::BoxHash::reset(double cellSize)
+{
+    clear();
+    m_cellSize = cellSize;
+}
+
+void femm::BoxHash::clear()
+{
+    numItems = 0;
+    cells.clear();
+    largeItems.clear();
+    occupied = {0,0,-1,-1};
+    hasExtent = false;
+}
+
+void femm::BoxHash::add(double xmin, double ymin, double xmax, double ymax)
+{
+    const int i = numItems++;
+    if (!std::isfinite(xmin) || !std::isfinite(ymin) || !std::isfinite(xmax) || !std::isfinite(ymax))
+    {
+        largeItems.push_back(i);
+        return;
+    }
+    extendExtent(xmin, ymin, xmax, ymax);
+    if (m_cellSize<=0)
+    {
+        largeItems.push_back(i);
+        return;
+    }
+
+    const int64_t c0 = cellCoord(xmin), c1 = cellCoord(xmax);
+    const int64_t r0 = cellCoord(ymin), r1 = cellCoord(ymax);
+    if ((c1-c0+1)*(r1-r0+1) > maxItemCells)
+    {
+        largeItems.push_back(i);
+        return;
+    }
+    extendOccupied(c0, r0, c1, r1);
+    for (int64_t r=r0; r<=r1; r++)
+        for (int64_t c=c0; c<=c1; c++)
+            cells[cellKey(c,r)].push_back(i);
+}
+
+void femm::BoxHash::addLine(double x0, double y0, double x1, double y1)
+{
+    const int i = numItems++;
+    if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+    {
+        largeItems.push_back(i);
+        return;
+    }
+    extendExtent(std::min(x0,x1), std::min(y0,y1), std::max(x0,x1), std::max(y0,y1));
+    if (m_cellSize<=0)
+    {
+        largeItems.push_back(i);
+        return;
+    }
+
+    std::vector<int64_t> ranges;
+    if (lineCells(x0, y0, x1, y1, 0, ranges) > maxItemCells)
+    {
+        largeItems.push_back(i);
+        return;
+    }
+    for (size_t k=0; k<ranges.size(); k+=3)
+    {
+        extendOccupied(ranges[k+1], ranges[k], ranges[k+2], ranges[k]);
+        for (int64_t c=ranges[k+1]; c<=ranges[k+2]; c++)
+            cells[cellKey(c,ranges[k])].push_back(i);
+    }
+}
+
+void femm::BoxHash::truncate(int n)
+{
+    if (n<numItems)
+        numItems = std::max(0,n);
+}
+
+bool femm::BoxHash::bounds(double &xmin, double &ymin, double &xmax, double &ymax) const
+{
+    if (!hasExtent)
+        return false;
+    xmin = extent[0]; ymin = extent[1];
+    xmax = extent[2]; ymax = extent[3];
+    return true;
+}
+
+void femm::BoxHash::query(double xmin, double ymin, double xmax, double ymax, std::vector<int> &found) const
+{
+    found.clear();
+    if (numItems==0 || xmin>xmax || ymin>ymax)
+        return;
+    if (!std::isfinite(xmin) || !std::isfinite(ymin) || !std::isfinite(xmax) || !std::isfinite(ymax))
+    {
+        addAll(found);
+        return;
+    }
+
+    if (!cells.empty())
+    {
+        // only look at the occupied part of the box
+        const int64_t c0 = std::max(cellCoord(xmin), occupied.c0);
+        const int64_t c1 = std::min(cellCoord(xmax), occupied.c1);
+        const int64_t r0 = std::max(cellCoord(ymin), occupied.r0);
+        const int64_t r1 = std::min(cellCoord(ymax), occupied.r1);
+        if (c0<=c1 && r0<=r1 && (c1-c0+1)*(r1-r0+1) > static_cast<int64_t>(cells.size()))
+        {
+            addAll(found);
+            return;
+        }
+        for (int64_t r=r0; r<=r1; r++)
+        {
+            for (int64_t c=c0; c<=c1; c++)
+            {
+                auto cell = cells.find(cellKey(c,r));
+                if (cell!=cells.end())
+                    found.insert(found.end(), cell->second.begin(), cell->second.end());
+            }
+        }
+    }
+    finishQuery(found);
+}
+
+void femm::BoxHash::queryLine(double x0, double y0, double x1, double y1, double d, std::vector<int> &found) const
+{
+    found.clear();
+    if (numItems==0)
+        return;
+    if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1) || !std::isfinite(d))
+    {
+        addAll(found);
+        return;
+    }
+
+    if (!cells.empty())
+    {
+        std::vector<int64_t> ranges;
+        if (lineCells(x0, y0, x1, y1, d, ranges) > static_cast<int64_t>(cells.size()))
+        {
+            addAll(found);
+            return;
+        }
+        for (size_t k=0; k<ranges.size(); k+=3)
+        {
+            for (int64_t c=ranges[k+1]; c<=ranges[k+2]; c++)
+            {
+                auto cell = cells.find(cellKey(c,ranges[k]));
+                if (cell!=cells.end())
+                    found.insert(found.end(), cell->second.begin(), cell->second.end());
+            }
+        }
+    }
+    finishQuery(found);
+}
+
+int64_t femm::BoxHash::lineCells(double x0, double y0, double x1, double y1, double d, std::vector<int64_t> &ranges) const
+{
+    // leave some room for rounding errors
+    const double pad = std::max(d,0.) + m_cellSize*1.e-6;
+    ranges.clear();
+
+    int64_t count = 0;
+    const int64_t r0 = cellCoord(std::min(y0,y1)-pad);
+    const int64_t r1 = cellCoord(std::max(y0,y1)+pad);
+    for (int64_t r=r0; r<=r1; r++)
+    {
+        // x range of the part of the line that lies within this row (widened by pad)
+        double xa = std::min(x0,x1);
+        double xb = std::max(x0,x1);
+        if (y1!=y0)
+        {
+            const double ta = (r*m_cellSize - pad - y0)/(y1-y0);
+            const double tb = ((r+1)*m_cellSize + pad - y0)/(y1-y0);
+            const double lo = std::max(0., std::min(ta,tb));
+            const double hi = std::min(1., std::max(ta,tb));
+            if (lo>hi)
+                continue;
+            xa = x0 + lo*(x1-x0);
+            xb = x0 + hi*(x1-x0);
+            if (xa>xb)
+                std::swap(xa,xb);
+        }
+        const int64_t c0 = cellCoord(xa-pad);
+        const int64_t c1 = cellCoord(xb+pad);
+        ranges.push_back(r);
+        ranges.push_back(c0);
+        ranges.push_back(c1);
+        count += c1-c0+1;
+    }
+    return count;
+}
+
+void femm::BoxHash::extendOccupied(int64_t c0, int64_t r0, int64_t c1, int64_t r1)
+{
+    if (occupied.c0>occupied.c1)
+    {
+        occupied = {c0,r0,c1,r1};
+    } else {
+        occupied.c0 = std::min(occupied.c0, c0);
+        occupied.r0 = std::min(occupied.r0, r0);
+        occupied.c1 = std::max(occupied.c1, c1);
+        occupied.r1 = std::max(occupied.r1, r1);
+    }
+}
+
+void femm::BoxHash::extendExtent(double xmin, double ymin, double xmax, double ymax)
+{
+    if (!hasExtent)
+    {
+        extent[0] = xmin; extent[1] = ymin;
+        extent[2] = xmax; extent[3] = ymax;
+        hasExtent = true;
+    } else {
+        extent[0] = std::min(extent[0], xmin);
+        extent[1] = std::min(extent[1], ymin);
+        extent[2] = std::max(extent[2], xmax);
+        extent[3] = std::max(extent[3], ymax);
+    }
+}
+
+void femm::BoxHash::addAll(std::vector<int> &found) const
+{
+    found.resize(numItems);
+    for (int i=0; i<numItems; i++)
+        found[i] = i;
+}
+
+void femm::BoxHash::finishQuery(std::vector<int> &found) const
+{
+    found.insert(found.end(), largeItems.begin(), largeItems.end());
+
+    // remove duplicates and truncated items:
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    found.erase(std::lower_bound(found.begin(), found.end(), numItems), found.end());
+}
+
+int64_t femm::BoxHash::cellCoord(double v) const
+{
+    // keep cell coordinates in a range that fits into the cell key
+    const double limit = 1.e9;
+    const double c = std::floor(v/m_cellSize);
+    return static_cast<int64_t>(std::max(-limit, std::min(c, limit)));
+}
+
+uint64_t femm::BoxHash::cellKey(int64_t c, int64_t r)
+{
+    return (static_cast<uint64_t>(c+(INT64_C(1)<<31)) << 32) | static_cast<uint64_t>(r+(INT64_C(1)<<31));
+}
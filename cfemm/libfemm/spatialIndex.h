@@ -0,0 +1,538 @@
+/*
+ * License:
+ * This software is subject to the Aladdin Free Public Licence
+ * version 8, November 18, 1999.
+ * The full license text is available in the file LICENSE.txt supplied
+ * along with the source code.
+ */
+#ifndef FEMM_SPATIALINDEX_H
+#define FEMM_SPATIALINDEX_H
+
+#include "femmcomplex.h"
+#include "parallelTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * \file spatialIndex.h
+ * \brief Spatial search structures for mesh queries.
+ */
+
+namespace femm
+{
+
+/**
+ * @brief The TriangleGrid class is a uniform bucket grid over the bounding boxes of mesh triangles.
+ *
+ * The grid has roughly one cell per triangle, and every triangle is listed in all cells
+ * that its bounding box overlaps. Point location then only has to test the few triangles
+ * listed in a single cell, instead of walking through the whole element list.
+ *
+ * A point on the border between several triangles is assigned to the triangle with the lowest index,
+ * so that the result only depends on the point.
+ *
+ * Lookups do not modify the grid, i.e. find() and findAll() may be called concurrently from several threads.
+ */
+class TriangleGrid
+{
+public:
+    TriangleGrid();
+
+    /**
+     * @brief Build the grid.
+     * @param numTriangles the number of triangles
+     * @param corner a callable with the signature \c CComplex(int i,int j),
+     * returning corner \c j (0..2) of triangle \c i.
+     */
+    template <class CornerFunc>
+    void build(int numTriangles, CornerFunc corner)
+    {
+        std::vector<Box> triangleBoxes(numTriangles);
+        for (int i=0; i<numTriangles; i++)
+        {
+            Box &b = triangleBoxes[i];
+            CComplex p = corner(i,0);
+            b.xmin = b.xmax = p.re;
+            b.ymin = b.ymax = p.im;
+            for (int j=1; j<3; j++)
+            {
+                p = corner(i,j);
+                if (p.re<b.xmin) b.xmin = p.re;
+                if (p.re>b.xmax) b.xmax = p.re;
+                if (p.im<b.ymin) b.ymin = p.im;
+                if (p.im>b.ymax) b.ymax = p.im;
+            }
+        }
+        setBoxes(triangleBoxes);
+    }
+
+    /**
+     * @brief Remove all triangles from the grid.
+     */
+    void clear();
+
+    /**
+     * @return \c true, if the grid contains no triangles.
+     */
+    bool empty() const { return boxes.empty(); }
+
+    /**
+     * @brief Find the triangle containing a point.
+     * If the point lies on the border between several triangles, the one with the lowest index is returned.
+     * @param x
+     * @param y
+     * @param inTriangle a callable with the signature \c bool(int i),
+     * that tests whether the point lies in triangle \c i.
+     * @return the triangle index, or -1 if the point is not inside any triangle.
+     */
+    template <class InTriangleFunc>
+    int find(double x, double y, InTriangleFunc inTriangle) const
+    {
+        return findInCell(cellAt(x,y), x, y, inTriangle);
+    }
+
+    /**
+     * @brief Find the triangles containing several points.
+     * Points outside the grid are rejected without testing any triangles.
+     * The remaining points are sorted by grid cell, and the search is distributed over several threads (see parallelFor()).
+     * For each point, the result is the same as for find().
+     * @param n the number of points
+     * @param x array of \p n x coordinates
+     * @param y array of \p n y coordinates
+     * @param inTriangle a callable with the signature \c bool(int point,int i),
+     * that tests whether point \c point lies in triangle \c i.
+     * @param triangle output array of size \p n, receives the triangle index for each point, or -1.
+     * @return the indices of all points inside a triangle, ordered by grid cell (i.e. neighbouring points are close to each other).
+     */
+    template <class InTriangleFunc>
+    std::vector<int> findAll(int n, const double *x, const double *y, InTriangleFunc inTriangle, int *triangle) const
+    {
+        // (cell,point) pairs
+        std::vector<std::pair<int,int>> queries;
+        queries.reserve(n);
+        for (int k=0; k<n; k++)
+        {
+            triangle[k] = -1;
+            int cell = cellAt(x[k],y[k]);
+            if (cell>=0)
+                queries.emplace_back(cell,k);
+        }
+        std::sort(queries.begin(), queries.end());
+
+        parallelFor(static_cast<int>(queries.size()), [&](int begin, int end) {
+            for (int q=begin; q<end; q++)
+            {
+                const int k = queries[q].second;
+                triangle[k] = findInCell(queries[q].first, x[k], y[k],
+                                         [&inTriangle,k](int i) { return inTriangle(k,i); });
+            }
+        }, 256);
+
+        std::vector<int> found;
+        found.reserve(queries.size());
+        for (const auto &query: queries)
+        {
+            if (triangle[query.second]>=0)
+                found.push_back(query.second);
+        }
+        return found;
+    }
+
+private:
+    struct Box
+    {
+        double xmin, ymin, xmax, ymax;
+    };
+
+    template <class InTriangleFunc>
+    int findInCell(int cell, double x, double y, InTriangleFunc inTriangle) const
+    {
+        if (cell<0)
+            return -1;
+        // the triangles of a cell are listed in ascending order, so the first match has the lowest index
+        for (int n=cellStart[cell]; n<cellStart[cell+1]; n++)
+        {
+            int i = cellItems[n];
+            const Box &b = boxes[i];
+            if (x<b.xmin || x>b.xmax || y<b.ymin || y>b.ymax)
+                continue;
+            if (inTriangle(i))
+                return i;
+        }
+        return -1;
+    }
+
+    void setBoxes(std::vector<Box> &triangleBoxes);
+    int cellAt(double x, double y) const;
+    int column(double x) const;
+    int row(double y) const;
+
+    std::vector<Box> boxes;
+    // cell c contains triangles cellItems[cellStart[c]] .. cellItems[cellStart[c+1]-1]
+    std::vector<int> cellStart;
+    std::vector<int> cellItems;
+    Box extent;
+    int numColumns;
+    int numRows;
+    double columnScale;
+    double rowScale;
+};
+
+/**
+ * @brief The BoxTree class is a k-d tree over the bounding boxes of geometry items, used for nearest item queries.
+ *
+ * Each tree node splits its items at the median of their box centres, along the longer side of the node's extent.
+ * nearest() descends into the closer subtree first, and skips all subtrees whose extent is farther away
+ * than the best item found so far. For input nodes, segments and arcs this typically takes O(log n) distance evaluations,
+ * instead of testing every item.
+ *
+ * Queries do not modify the tree, i.e. nearest() may be called concurrently from several threads.
+ */
+class BoxTree
+{
+public:
+    BoxTree();
+
+    /**
+     * @brief Build the tree.
+     * @param numItems the number of items
+     * @param bounds a callable with the signature \c void(int i,double &xmin,double &ymin,double &xmax,double &ymax),
+     * returning the bounding box of item \c i.
+     */
+    template <class BoundsFunc>
+    void build(int numItems, BoundsFunc bounds)
+    {
+        std::vector<Box> itemBoxes(numItems);
+        for (int i=0; i<numItems; i++)
+        {
+            Box &b = itemBoxes[i];
+            bounds(i, b.xmin, b.ymin, b.xmax, b.ymax);
+        }
+        setBoxes(itemBoxes);
+    }
+
+    /**
+     * @brief Build the tree for a set of points.
+     * @param numPoints the number of points
+     * @param point a callable with the signature \c CComplex(int i), returning point \c i.
+     */
+    template <class PointFunc>
+    void buildPoints(int numPoints, PointFunc point)
+    {
+        build(numPoints, [&point](int i, double &xmin, double &ymin, double &xmax, double &ymax) {
+            CComplex p = point(i);
+            xmin = xmax = p.re;
+            ymin = ymax = p.im;
+        });
+    }
+
+    /**
+     * @brief Remove all items from the tree.
+     */
+    void clear();
+
+    /**
+     * @return \c true, if the tree contains no items.
+     */
+    bool empty() const { return boxes.empty(); }
+
+    /**
+     * @brief Find the item closest to a point.
+     * If several items have the same distance, the one with the lowest index is returned,
+     * i.e. the result is the same as for a linear search that only accepts strictly smaller distances.
+     * @param x
+     * @param y
+     * @param distance a callable with the signature \c double(int i), returning the distance of item \c i from the point.
+     * The distance must not be smaller than the distance between the point and the bounding box of the item.
+     * @return the item index, or -1 if the tree is empty.
+     */
+    template <class DistanceFunc>
+    int nearest(double x, double y, DistanceFunc distance) const
+    {
+        if (nodes.empty())
+            return -1;
+
+        int best = -1;
+        double bestDistance = 0;
+        // (node, distance of the node extent) pairs that still need to be visited
+        std::vector<std::pair<int,double>> pending;
+        pending.reserve(64);
+        pending.emplace_back(0, boxDistance(nodes[0].extent, x, y));
+        while (!pending.empty())
+        {
+            const std::pair<int,double> top = pending.back();
+            pending.pop_back();
+            if (best>=0 && top.second>bestDistance)
+                continue;
+
+            const Node &node = nodes[top.first];
+            if (node.left<0)
+            {
+                for (int n=node.begin; n<node.end; n++)
+                {
+                    const int i = items[n];
+                    if (best>=0 && boxDistance(boxes[i], x, y)>bestDistance)
+                        continue;
+                    const double d = distance(i);
+                    if (best<0 || d<bestDistance || (d==bestDistance && i<best))
+                    {
+                        best = i;
+                        bestDistance = d;
+                    }
+                }
+                continue;
+            }
+
+            // push the farther child first, so that the closer one is visited next:
+            const double dLeft = boxDistance(nodes[node.left].extent, x, y);
+            const double dRight = boxDistance(nodes[node.right].extent, x, y);
+            if (dLeft<=dRight)
+            {
+                pending.emplace_back(node.right, dRight);
+                pending.emplace_back(node.left, dLeft);
+            } else {
+                pending.emplace_back(node.left, dLeft);
+                pending.emplace_back(node.right, dRight);
+            }
+        }
+        return best;
+    }
+
+private:
+    struct Box
+    {
+        double xmin, ymin, xmax, ymax;
+    };
+    struct Node
+    {
+        Box extent;
+        // child nodes, or -1 for a leaf
+        int left, right;
+        // a leaf contains items[begin] .. items[end-1]
+        int begin, end;
+    };
+
+    static double boxDistance(const Box &b, double x, double y)
+    {
+        const double dx = std::max(0., std::max(b.xmin-x, x-b.xmax));
+        const double dy = std::max(0., std::max(b.ymin-y, y-b.ymax));
+        return std::sqrt(dx*dx + dy*dy);
+    }
+
+    void setBoxes(std::vector<Box> &itemBoxes);
+    int buildNode(int begin, int end);
+
+    std::vector<Box> boxes;
+    std::vector<int> items;
+    std::vector<Node> nodes;
+};
+
+/**
+ * @brief The BoxHash class is a spatial hash over the bounding boxes of geometry items, which can grow one item at a time.
+ *
+ * The plane is divided into square cells of a fixed size, and every item is listed in all cells that its bounding box overlaps
+ * (or, for straight lines, in all cells that the line passes through).
+ * Only occupied cells are stored. Items that cover very many cells (or that have no finite bounding box)
+ * are kept in a separate list and are part of every query result.
+ *
+ * In contrast to TriangleGrid and BoxTree, items can be added after the hash has been set up,
+ * which makes it suitable for a geometry that is being edited.
+ * Items can only be removed from the end (see truncate()).
+ *
+ * Query results are conservative: they contain all items whose bounding box overlaps the query box,
+ * but may contain some others as well. Callers are expected to do the exact test on each candidate.
+ */
+class BoxHash
+{
+public:
+    BoxHash();
+
+    /**
+     * @brief Remove all items and set a new cell size.
+     * @param cellSize the edge length of a cell
+     */
+    void reset(double cellSize);
+
+    /**
+     * @brief Remove all items, but keep the cell size.
+     */
+    void clear();
+
+    /**
+     * @return the edge length of a cell, or 0 if the hash has not been set up yet.
+     */
+    double cellSize() const { return m_cellSize; }
+
+    /**
+     * @return the number of items
+     */
+    int size() const { return numItems; }
+
+    /**
+     * @brief Add an item. The item index is the previous size().
+     * @param xmin
+     * @param ymin
+     * @param xmax
+     * @param ymax
+     */
+    void add(double xmin, double ymin, double xmax, double ymax);
+
+    /**
+     * @brief Add a straight line item. The item index is the previous size().
+     * In contrast to add(), the item is only listed in the cells that the line passes through.
+     * @param x0
+     * @param y0
+     * @param x1
+     * @param y1
+     */
+    void addLine(double x0, double y0, double x1, double y1);
+
+    /**
+     * @brief Remove all items with index \p n or higher.
+     * Their cell entries are kept, but ignored in queries.
+     * Items that are added later with the same index are listed in addition to the old entries, i.e. queries stay conservative.
+     * @param n the new size
+     */
+    void truncate(int n);
+
+    /**
+     * @brief Get the common bounding box of all items that were added since the last reset() or clear().
+     * @param xmin
+     * @param ymin
+     * @param xmax
+     * @param ymax
+     * @return \c false, if no item with a finite bounding box was added.
+     */
+    bool bounds(double &xmin, double &ymin, double &xmax, double &ymax) const;
+
+    /**
+     * @brief Find all items that may overlap a box.
+     * If the box covers more cells than there are occupied cells, all items are returned.
+     * @param xmin
+     * @param ymin
+     * @param xmax
+     * @param ymax
+     * @param found receives the candidate item indices in ascending order
+     */
+    void query(double xmin, double ymin, double xmax, double ymax, std::vector<int> &found) const;
+
+    /**
+     * @brief Find all items that may come closer than \p d to a straight line.
+     * If the search covers more cells than there are occupied cells, all items are returned.
+     * @param x0
+     * @param y0
+     * @param x1
+     * @param y1
+     * @param d search distance
+     * @param found receives the candidate item indices in ascending order
+     */
+    void queryLine(double x0, double y0, double x1, double y1, double d, std::vector<int> &found) const;
+
+    /**
+     * @brief Find the item closest to a point.
+     * The cells are searched in square rings around the point until no unvisited cell can contain a closer item.
+     * If several items have the same distance, the one with the lowest index is returned,
+     * i.e. the result is the same as for a linear search that only accepts strictly smaller distances.
+     * @param x
+     * @param y
+     * @param distance a callable with the signature \c double(int i), returning the distance of item \c i from the point.
+     * The distance must not be smaller than the distance between the point and the bounding box of the item.
+     * @return the item index, or -1 if the hash is empty.
+     */
+    template <class DistanceFunc>
+    int nearest(double x, double y, DistanceFunc distance) const
+    {
+        int best = -1;
+        double bestDistance = 0;
+        auto consider = [&](int i) {
+            if (i>=numItems)
+                return;
+            const double d = distance(i);
+            if (best<0 || d<bestDistance || (d==bestDistance && i<best))
+            {
+                best = i;
+                bestDistance = d;
+            }
+        };
+
+        if (numItems==0)
+            return -1;
+        if (cells.empty() || !std::isfinite(x) || !std::isfinite(y))
+        {
+            for (int i=0; i<numItems; i++)
+                consider(i);
+            return best;
+        }
+
+        for (int i: largeItems)
+            consider(i);
+        const int64_t cx = cellCoord(x);
+        const int64_t cy = cellCoord(y);
+        // rings closer than r0 contain no occupied cells, rings beyond rmax neither
+        const int64_t r0 = std::max<int64_t>({0, occupied.c0-cx, cx-occupied.c1, occupied.r0-cy, cy-occupied.r1});
+        const int64_t rmax = std::max<int64_t>({cx-occupied.c0, occupied.c1-cx, cy-occupied.r0, occupied.r1-cy});
+        for (int64_t r=r0; r<=rmax; r++)
+        {
+            // items in ring r or beyond are at least (r-1) cells away
+            if (best>=0 && bestDistance < (r-1)*m_cellSize)
+                break;
+            if (8*r > static_cast<int64_t>(cells.size()))
+            {
+                // the rings are mostly empty by now, just test the remaining items
+                for (int i=0; i<numItems; i++)
+                    consider(i);
+                break;
+            }
+            for (int64_t c=cx-r; c<=cx+r; c++)
+            {
+                // top and bottom rows of the ring, and the left and right columns in between
+                const bool edgeColumn = (c==cx-r || c==cx+r);
+                for (int64_t row=cy-r; row<=cy+r; row += (edgeColumn || r==0) ? 1 : 2*r)
+                {
+                    auto cell = cells.find(cellKey(c,row));
+                    if (cell==cells.end())
+                        continue;
+                    for (int i: cell->second)
+                        consider(i);
+                }
+            }
+        }
+        return best;
+    }
+
+private:
+    int64_t cellCoord(double v) const;
+    static uint64_t cellKey(int64_t c, int64_t r);
+    /**
+     * @brief Compute the cells within distance \p d of a straight line.
+     * @param ranges receives (row, first column, last column) for each row
+     * @return the number of cells
+     */
+    int64_t lineCells(double x0, double y0, double x1, double y1, double d, std::vector<int64_t> &ranges) const;
+    void extendOccupied(int64_t c0, int64_t r0, int64_t c1, int64_t r1);
+    void extendExtent(double xmin, double ymin, double xmax, double ymax);
+    void addAll(std::vector<int> &found) const;
+    void finishQuery(std::vector<int> &found) const;
+
+    double m_cellSize;
+    int numItems;
+    // cell key -> indices of the items overlapping the cell
+    std::unordered_map<uint64_t, std::vector<int>> cells;
+    // items that are part of every query result
+    std::vector<int> largeItems;
+    // range of occupied cells
+    struct {
+        int64_t c0, r0, c1, r1;
+    } occupied;
+    // common bounding box of the items
+    double extent[4];
+    bool hasExtent;
+};
+
+} //namespace
+#endif
@@ -0,0 +1,349 @@
+// Regression tests for the geometry editing methods of FemmProblem.
+//
+// usage: femmproblem-test <test> <file.fem>
+//   closest ... compare closestNode(), closestSegment() and closestArcSegment()
+//               with a linear search after edits that invalidate the spatial hashes
+//   undo ...... compare undo() after updateUndoIncremental() with undo() after
+//               updateUndo(), which saves a copy of the whole geometry
+#include "FemmProblem.h"
+#include "FemmReader.h"
+#include "femmconstants.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace femm;
+
+namespace {
+
+std::shared_ptr<FemmProblem> loadProblem(const std::string &file)
+{
+    auto problem = std::make_shared<FemmProblem>(FileType::MagneticsFile);
+    MagneticsReader reader(problem, std::cerr);
+    if (reader.parse(file) != F_FILE_OK)
+    {
+        std::cerr << "Could not read " << file << "\n";
+        return nullptr;
+    }
+    return problem;
+}
+
+/**
+ * @brief Select nodes, and (arc) segments with both end points, within a circle.
+ */
+void selectCircle(FemmProblem &problem, double x, double y, double r)
+{
+    for (auto &node: problem.nodelist)
+        if (node->GetDistance(x,y) < r)
+            node->IsSelected = true;
+    for (auto &label: problem.labellist)
+        if (label->GetDistance(x,y) < r)
+            label->IsSelected = true;
+    for (auto &line: problem.linelist)
+        if (problem.nodelist[line->n0]->GetDistance(x,y) < r
+                && problem.nodelist[line->n1]->GetDistance(x,y) < r)
+            line->IsSelected = true;
+    for (auto &arc: problem.arclist)
+        if (problem.nodelist[arc->n0]->GetDistance(x,y) < r
+                && problem.nodelist[arc->n1]->GetDistance(x,y) < r)
+            arc->IsSelected = true;
+}
+
+void boundingBox(const FemmProblem &problem, double &x0, double &y0, double &x1, double &y1)
+{
+    x0 = x1 = problem.nodelist[0]->x;
+    y0 = y1 = problem.nodelist[0]->y;
+    for (const auto &node: problem.nodelist)
+    {
+        x0 = std::min(x0, node->x);
+        x1 = std::max(x1, node->x);
+        y0 = std::min(y0, node->y);
+        y1 = std::max(y1, node->y);
+    }
+}
+
+/**
+ * @brief Check the result of a closest* query against the minimum distance over all entities.
+ * Ties are resolved differently by the spatial hash, so only the distances are compared.
+ */
+template<class Distance>
+bool checkClosest(const char *what, int found, int count, double x, double y, Distance distance)
+{
+    if (count == 0)
+        return found == -1;
+    double best = distance(0);
+    for (int i=1; i<count; i++)
+        best = std::min(best, distance(i));
+    if (found < 0 || found >= count || distance(found) != best)
+    {
+        std::cerr << "closest " << what << " at (" << x << "," << y << "): got index " << found
+                  << " with distance " << (found >= 0 && found < count ? distance(found) : NAN)
+                  << ", expected distance " << best << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool checkQueries(const FemmProblem &problem, const std::string &step)
+{
+    double x0,y0,x1,y1;
+    boundingBox(problem, x0, y0, x1, y1);
+    const double padx = 0.1*(x1-x0);
+    const double pady = 0.1*(y1-y0);
+    x0 -= padx; x1 += padx;
+    y0 -= pady; y1 += pady;
+
+    bool ok = true;
+    auto check = [&](double x, double y) {
+        ok = checkClosest("node", problem.closestNode(x,y), (int)problem.nodelist.size(), x, y,
+                          [&](int i) { return problem.nodelist[i]->GetDistance(x,y); }) && ok;
+        ok = checkClosest("segment", problem.closestSegment(x,y), (int)problem.linelist.size(), x, y,
+                          [&](int i) { return problem.shortestDistanceFromSegment(x,y,i); }) && ok;
+        ok = checkClosest("arc segment", problem.closestArcSegment(x,y), (int)problem.arclist.size(), x, y,
+                          [&](int i) { return problem.shortestDistanceFromArc(CComplex(x,y),*problem.arclist[i]); }) && ok;
+    };
+    const int n = 60;
+    for (int i=0; i<=n; i++)
+        for (int j=0; j<=n; j++)
+            check(x0 + i*(x1-x0)/n, y0 + j*(y1-y0)/n);
+    // query close to the nodes, where the neighbouring entities are closest together
+    for (const auto &node: problem.nodelist)
+        check(node->x + 1e-3*padx, node->y - 1e-3*pady);
+
+    std::cout << step << ": " << problem.nodelist.size() << " nodes, "
+              << problem.linelist.size() << " segments, "
+              << problem.arclist.size() << " arc segments "
+              << (ok ? "OK" : "FAILED") << "\n";
+    return ok;
+}
+
+bool testClosest(const std::string &file)
+{
+    auto problem = loadProblem(file);
+    if (!problem || problem->nodelist.empty())
+        return false;
+
+    double x0,y0,x1,y1;
+    boundingBox(*problem, x0, y0, x1, y1);
+    const double cx = 0.5*(x0+x1);
+    const double cy = 0.5*(y0+y1);
+    const double size = std::max(x1-x0, y1-y0);
+
+    bool ok = checkQueries(*problem, "loaded");
+    problem->updateUndo();
+
+    selectCircle(*problem, x0+0.3*(x1-x0), y0+0.6*(y1-y0), 0.15*size);
+    problem->deleteSelectedNodes();
+    problem->unselectAll();
+    ok = checkQueries(*problem, "deleteSelectedNodes") && ok;
+
+    // remove (arc) segments from the middle of the lists, and from their end
+    for (int i=0; i<(int)problem->linelist.size(); i+=3)
+        problem->linelist[i]->IsSelected = true;
+    problem->deleteSelectedSegments();
+    for (int i=0; i<(int)problem->arclist.size(); i+=4)
+        problem->arclist[i]->IsSelected = true;
+    problem->deleteSelectedArcSegments();
+    ok = checkQueries(*problem, "deleteSelectedSegments/ArcSegments") && ok;
+    if (!problem->linelist.empty())
+        problem->linelist.back()->IsSelected = true;
+    problem->deleteSelectedSegments();
+    if (!problem->arclist.empty())
+        problem->arclist.back()->IsSelected = true;
+    problem->deleteSelectedArcSegments();
+    ok = checkQueries(*problem, "delete last (arc) segment") && ok;
+
+    // new nodes are appended to the hashes
+    const double tol = problem->defaultTolerance();
+    for (int i=0; i<20; i++)
+        problem->addNode(cx + 0.4*size*cos(0.3*i), cy + 0.4*size*sin(0.3*i), tol);
+    ok = checkQueries(*problem, "addNode") && ok;
+
+    problem->undo();
+    problem->unselectAll();
+    ok = checkQueries(*problem, "undo") && ok;
+
+    selectCircle(*problem, cx, cy, 0.25*size);
+    problem->translateMove(0.05*size, 0.02*size, EditMode::EditGroup);
+    problem->unselectAll();
+    ok = checkQueries(*problem, "translateMove") && ok;
+
+    problem->enforcePSLG();
+    ok = checkQueries(*problem, "enforcePSLG") && ok;
+
+    return ok;
+}
+
+/**
+ * @brief Write the problem description into a string, so that two states can be compared.
+ */
+std::string describe(const FemmProblem &problem)
+{
+    std::ostringstream out;
+    problem.writeProblemDescription(out);
+    return out.str();
+}
+
+/**
+ * @brief Get the node that is closest to node \p n, apart from \p n itself.
+ */
+int nearestOtherNode(const FemmProblem &problem, int n)
+{
+    int nearest = -1;
+    for (int i=0; i<(int)problem.nodelist.size(); i++)
+    {
+        if (i != n && (nearest < 0 || problem.nodelist[i]->GetDistance(problem.nodelist[n]->x, problem.nodelist[n]->y)
+                       < problem.nodelist[nearest]->GetDistance(problem.nodelist[n]->x, problem.nodelist[n]->y)))
+            nearest = i;
+    }
+    return nearest;
+}
+
+bool testUndo(const std::string &file)
+{
+    auto original = loadProblem(file);
+    if (!original || original->nodelist.size() < 2)
+        return false;
+    const std::string originalDescription = describe(*original);
+
+    double x0,y0,x1,y1;
+    boundingBox(*original, x0, y0, x1, y1);
+    const double cx = 0.5*(x0+x1);
+    const double cy = 0.5*(y0+y1);
+    const double size = std::max(x1-x0, y1-y0);
+
+    const std::vector<std::pair<std::string, std::function<void(FemmProblem&)>>> edits = {
+        { "translateMove nodes", [&](FemmProblem &problem) {
+              selectCircle(problem, cx, cy, 0.2*size);
+              problem.translateMove(0.01*size, 0.005*size, EditMode::EditNodes);
+          } },
+        { "translateMove group", [&](FemmProblem &problem) {
+              selectCircle(problem, x0+0.3*(x1-x0), y0+0.6*(y1-y0), 0.15*size);
+              problem.translateMove(0.05*size, 0.02*size, EditMode::EditGroup);
+          } },
+        { "rotateMove", [&](FemmProblem &problem) {
+              selectCircle(problem, cx, cy, 0.3*size);
+              problem.rotateMove(CComplex(cx,cy), 7, EditMode::EditGroup);
+          } },
+        { "scaleMove", [&](FemmProblem &problem) {
+              selectCircle(problem, cx, cy, 0.3*size);
+              problem.scaleMove(cx, cy, 1.1, EditMode::EditGroup);
+          } },
+        { "translateMove onto another node", [&](FemmProblem &problem) {
+              // the moved node is merged with its neighbour
+              const int n = problem.closestNode(cx, cy);
+              const int m = nearestOtherNode(problem, n);
+              problem.nodelist[n]->IsSelected = true;
+              problem.translateMove(problem.nodelist[m]->x - problem.nodelist[n]->x,
+                                    problem.nodelist[m]->y - problem.nodelist[n]->y, EditMode::EditNodes);
+          } },
+        { "addNode splitting (arc) segments", [&](FemmProblem &problem) {
+              const double tol = problem.defaultTolerance();
+              for (int i=0; i<(int)problem.linelist.size() && i<10; i+=3)
+              {
+                  const CComplex p = 0.5*(problem.nodelist[problem.linelist[i]->n0]->CC()
+                          + problem.nodelist[problem.linelist[i]->n1]->CC());
+                  problem.addNode(p.re, p.im, tol);
+              }
+              for (int i=0; i<(int)problem.arclist.size() && i<10; i+=3)
+              {
+                  CComplex c;
+                  double R;
+                  problem.getCircle(*problem.arclist[i], c, R);
+                  const CComplex p = c + (problem.nodelist[problem.arclist[i]->n0]->CC() - c)
+                          * exp(I*problem.arclist[i]->ArcLength*PI/360.);
+                  problem.addNode(p.re, p.im, tol);
+              }
+          } },
+        { "createRadius", [&](FemmProblem &problem) {
+              // createRadius() sets its own undo point
+              for (int n=0; n<(int)problem.nodelist.size(); n++)
+              {
+                  if (problem.canCreateRadius(n) && problem.createRadius(n, 0.005*size))
+                      break;
+              }
+          } },
+        { "deleteSelectedNodes", [&](FemmProblem &problem) {
+              selectCircle(problem, x0+0.3*(x1-x0), y0+0.6*(y1-y0), 0.15*size);
+              problem.deleteSelectedNodes();
+          } },
+        { "deleteSelectedSegments/ArcSegments/BlockLabels", [&](FemmProblem &problem) {
+              for (int i=0; i<(int)problem.linelist.size(); i+=3)
+                  problem.linelist[i]->IsSelected = true;
+              for (int i=0; i<(int)problem.arclist.size(); i+=4)
+                  problem.arclist[i]->IsSelected = true;
+              for (int i=0; i<(int)problem.labellist.size(); i+=2)
+                  problem.labellist[i]->IsSelected = true;
+              problem.deleteSelectedSegments();
+              problem.deleteSelectedArcSegments();
+              problem.deleteSelectedBlockLabels();
+          } },
+    };
+
+    bool ok = true;
+    for (const auto &edit: edits)
+    {
+        auto full = loadProblem(file);
+        auto incremental = loadProblem(file);
+        full->updateUndo();
+        incremental->updateUndoIncremental();
+
+        edit.second(*full);
+        edit.second(*incremental);
+        full->unselectAll();
+        incremental->unselectAll();
+        const std::string editedDescription = describe(*full);
+        bool editOk = (editedDescription != originalDescription)
+                && (describe(*incremental) == editedDescription);
+
+        full->undo();
+        incremental->undo();
+        const std::string undoneDescription = describe(*full);
+        editOk = (describe(*incremental) == undoneDescription) && editOk;
+
+        // undoing twice redoes the edit
+        full->undo();
+        incremental->undo();
+        editOk = (describe(*incremental) == describe(*full)) && editOk;
+
+        // undo() keeps the entities that were appended after the undo point,
+        // so some edits are "not restored" with either kind of undo point
+        std::cout << edit.first << ": "
+                  << (undoneDescription == originalDescription ? "restored" : "not restored") << " "
+                  << (editOk ? "OK" : "FAILED") << "\n";
+        ok = ok && editOk;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <test> <file.fem>\n";
+        return 2;
+    }
+    const std::string test = argv[1];
+    const std::string file = argv[2];
+
+    bool ok;
+    if (test == "closest")
+        ok = testClosest(file);
+    else if (test == "undo")
+        ok = testUndo(file);
+    else
+    {
+        std::cerr << "Unknown test: " << test << "\n";
+        return 2;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// Regression test for the copy constructor of CMMaterialProp:
+// all members must be copied, including the ones only used by the solver and post processor.
+//
+// usage: materialprop-test
+#include "CMaterialProp.h"
+
+#include <iostream>
+
+using namespace femm;
+
+namespace {
+
+int failed = 0;
+
+template<class T>
+void check(const char *name, const T &copied, const T &expected)
+{
+    if (!(copied == expected))
+    {
+        std::cerr << "member " << name << " was not copied\n";
+        failed++;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    CMMaterialProp prop;
+    prop.BlockName = "Iron";
+    prop.mu_x = 1200;
+    prop.mu_y = 800;
+    prop.BHpoints = 2;
+    prop.Bdata = {0, 1.5};
+    prop.Hdata = {0, CComplex(2000,-50)};
+    prop.slope = {CComplex(1,2), CComplex(3,4)};
+    prop.LamType = 1;
+    prop.LamFill = 0.95;
+    prop.H_c = 1.e6;
+    prop.Nrg = 12.5;
+    prop.J = CComplex(3,-1);
+    prop.Cduct = 5.8;
+    prop.Lam_d = 0.35;
+    prop.Theta_hn = 10;
+    prop.Theta_hx = 20;
+    prop.Theta_hy = 30;
+    prop.NStrands = 7;
+    prop.WireD = 0.2;
+    prop.mu_fdx = CComplex(900,-90);
+    prop.mu_fdy = CComplex(700,-70);
+    prop.MuMax = 4321.5;
+    prop.Frequency = 50;
+
+    const CMMaterialProp copy(prop);
+    check("BlockName", copy.BlockName, prop.BlockName);
+    check("mu_x", copy.mu_x, prop.mu_x);
+    check("mu_y", copy.mu_y, prop.mu_y);
+    check("BHpoints", copy.BHpoints, prop.BHpoints);
+    check("Bdata", copy.Bdata, prop.Bdata);
+    check("Hdata", copy.Hdata, prop.Hdata);
+    check("slope", copy.slope, prop.slope);
+    check("LamType", copy.LamType, prop.LamType);
+    check("LamFill", copy.LamFill, prop.LamFill);
+    check("H_c", copy.H_c, prop.H_c);
+    check("Nrg", copy.Nrg, prop.Nrg);
+    check("J", copy.J, prop.J);
+    check("Cduct", copy.Cduct, prop.Cduct);
+    check("Lam_d", copy.Lam_d, prop.Lam_d);
+    check("Theta_hn", copy.Theta_hn, prop.Theta_hn);
+    check("Theta_hx", copy.Theta_hx, prop.Theta_hx);
+    check("Theta_hy", copy.Theta_hy, prop.Theta_hy);
+    check("NStrands", copy.NStrands, prop.NStrands);
+    check("WireD", copy.WireD, prop.WireD);
+    check("mu_fdx", copy.mu_fdx, prop.mu_fdx);
+    check("mu_fdy", copy.mu_fdy, prop.mu_fdy);
+    check("MuMax", copy.MuMax, prop.MuMax);
+    check("Frequency", copy.Frequency, prop.Frequency);
+
+    if (failed == 0)
+        std::cout << "all members copied\n";
+    return (failed == 0) ? 0 : 1;
+}
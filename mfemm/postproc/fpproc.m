@@ -57,6 +57,7 @@ classdef fpproc < mfemmpproc
 %    getgapb - 
 %    getgapa - 
 %    getgapharmonics - 
+%    rasterize - samples the solution on a regular grid
 %
     
 % Copyright 2012-2014 Richard Crozier
@@ -485,6 +486,12 @@ classdef fpproc < mfemmpproc
             % fpproc.blockintegral(type) peforms the desired integral on
             % the currently selected blocks.
             %
+            % If type is a vector of integral types, all of the integrals
+            % are computed in a single pass over the mesh, and int is a
+            % row vector with one value per type. In this case, the 2D
+            % shape centroid (type 25) is returned as the complex number
+            % x + iy.
+            %
             % fpproc.blockintegral(type, x, y) clears any existing block
             % selection, selects the  the block closest to (x,y) and performs  
             % the integral on this block.
@@ -496,7 +503,8 @@ classdef fpproc < mfemmpproc
             % Input
             %
             %  type - an integer flag determining the integral type to e
-            %   perfomed. The following options are available:
+            %   perfomed, or a vector of such flags. The following options
+            %   are available:
             %
             %   0   A.J
             %   1   A
@@ -745,6 +753,37 @@ classdef fpproc < mfemmpproc
         end
         
         
+        function F = rasterize (this, x0, y0, x1, y1, nx, ny)
+            % samples the solution on a regular grid of points
+            %
+            % Syntax
+            %
+            % F = rasterize (x0, y0, x1, y1, nx, ny)
+            %
+            % Input
+            %
+            %   x0, y0, x1, y1 - coordinates of the opposite corners of the
+            %     grid
+            %
+            %   nx, ny - number of grid points in the x and y direction
+            %
+            % Output
+            %
+            %   F - (ny x nx x p) single precision array of solution values,
+            %     with F(j,i,:) at the point (x0 + (i-1)*(x1-x0)/(nx-1),
+            %     y0 + (j-1)*(y1-y0)/(ny-1)), and NaN at points outside the
+            %     mesh. The planes are:
+            %     F(:,:,1) - magnetic vector potential, A
+            %     F(:,:,2:3) - flux density, Bx and By
+            %     F(:,:,4) - magnitude of the flux density, |B|
+            %     For time harmonic problems, these are the real parts,
+            %     and F(:,:,5:7) are the imaginary parts of A, Bx and By.
+            %
+            
+            F = fpproc_interface_mex('rasterize', this.objectHandle, x0, y0, x1, y1, nx, ny);
+            
+        end
+        
         function hfig = plotBfield(this, x, y, w, h, varargin)
             % creates a plot of the flux density vector field
             %
@@ -1301,24 +1340,18 @@ classdef fpproc < mfemmpproc
             %
             %
             
-            B = nan * ones (numel(angles), 2);
+            [Br, Bt] = fpproc_interface_mex('getgapb', this.objectHandle, bound_name, double(angles(:)));
             
-            for ind = 1:numel(angles)
-            
-                [Br, Bt] = fpproc_interface_mex('getgapb', this.objectHandle, bound_name, angles(ind));
-                
-                B(ind,1:2) = [Br, Bt];
-            
-            end
+            B = [Br(:), Bt(:)];
             
         end
         
-        function B = getgapa(this, bound_name, angles)
+        function A = getgapa(this, bound_name, angles)
             % Get the vector potential values for air gap boundary at specified angles
             %
             % Syntax
             %
-            % B = fpproc.getgapa(X, Y)
+            % A = fpproc.getgapa(bound_name, angles)
             %
             % Input
             %
@@ -1332,21 +1365,14 @@ classdef fpproc < mfemmpproc
             %
             % Output
             %
-            %   B - (n x 2) matrix containing the radial and tangential 
-            %    flux density at the requested angles in the specified air
-            %    gap region
+            %   A - (n x 1) vector containing the vector potential at the
+            %    requested angles in the specified air gap region
             %
             %
             
-            B = nan * ones (numel(angles), 2);
-            
-            for ind = 1:numel(angles)
+            A = fpproc_interface_mex('getgapa', this.objectHandle, bound_name, double(angles(:)));
             
-                [Br, Bt] = fpproc_interface_mex('getgapa', this.objectHandle, bound_name, angles(ind));
-                
-                B(ind,1:2) = [Br, Bt];
-            
-            end
+            A = A(:);
             
         end
         
@@ -1373,19 +1399,22 @@ classdef fpproc < mfemmpproc
             
         end
         
-        function [acc, acs, brc, brs, btc, bts] = getgapharmonics (this, bound_name, n)
+        function [acc, acs, brc, brs, btc, bts, n] = getgapharmonics (this, bound_name, n)
             % get values of harmonics of air gap boundary
             %
             % Syntax
             %
             % [acc, acs, brc, brs, btc, bts] = fpproc.getgapharmonics (bound_name, n)
+            % [acc, acs, brc, brs, btc, bts, n] = fpproc.getgapharmonics (bound_name)
             %
             % Input
             %
             %   bound_name - name of the air gap boundary for which the
             %    flux density is to be evaluated
             %
-            %   n - harmonic number
+            %   n - (optional) vector of harmonic numbers. If omitted, all
+            %    available harmonics are returned. Harmonics which are not
+            %    available are returned as NaN.
             %
             % Output
             %
@@ -1401,8 +1430,16 @@ classdef fpproc < mfemmpproc
             %
             %   bts - 
             %
+            %   n - column vector of the harmonic numbers
             %
             
+            % all harmonics are fetched in one call
+            [allacc, allacs, allbrc, allbrs, allbtc, allbts, nh] = ...
+                fpproc_interface_mex('getgapharmonics', this.objectHandle, bound_name);
+            
+            if nargin < 3
+                n = double(nh(:));
+            end
             
             acc = nan * ones (numel(n), 1); 
             acs = acc;
@@ -1411,12 +1448,14 @@ classdef fpproc < mfemmpproc
             btc = acc;
             bts = acc;
             
-            for ind = 1:numel(n)
+            [found, ind] = ismember (n(:), double(nh(:)));
             
-                [acc(ind,1), acs(ind,1), brc(ind,1), brs(ind,1), btc(ind,1), bts(ind,1)] ...
-                    = fpproc_interface_mex('getgapharmonics', this.objectHandle, bound_name, n(ind));
-            
-            end
+            acc(found) = allacc(ind(found));
+            acs(found) = allacs(ind(found));
+            brc(found) = allbrc(ind(found));
+            brs(found) = allbrs(ind(found));
+            btc(found) = allbtc(ind(found));
+            bts(found) = allbts(ind(found));
             
         end
         
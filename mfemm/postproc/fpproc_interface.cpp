@@ -9,6 +9,9 @@
 #include <string>
 #include <cstring>
 #include <cmath>
+#include <memory>
+#include <vector>
+#include <limits>
 #include "mex.h"
 #include "fpproc.h"
 #include "fpproc_interface.h"
@@ -182,12 +185,17 @@ int FPProc_interface::getpointvals(int nlhs, mxArray *plhs[], int nrhs, const mx
                            "x and y must both be column vectors.");
     }
 
-    if(myrows != myrows)
+    if(mxrows != myrows)
     {
         mexErrMsgIdAndTxt( "MFEMM:fpproc:invalidSizeInputs",
                            "x and y must be column vectors of the same size.");
     }
 
+    // evaluate all points in one batch
+    std::vector<CMPointVals> pointVals(mxrows);
+    std::unique_ptr<bool[]> inMesh(new bool[mxrows]);
+    theFPProc.GetPointValues((int)mxrows, px, py, pointVals.data(), inMesh.get());
+
     if (theFPProc.Frequency!=0)
     {
 #ifdef _MEX_DEBUG
@@ -201,9 +209,9 @@ int FPProc_interface::getpointvals(int nlhs, mxArray *plhs[], int nrhs, const mx
 
         for(int i=0; i<(int)mxrows; i++)
         {
-            CMPointVals u;
+            CMPointVals &u = pointVals[i];
 
-            if(theFPProc.GetPointValues(px[i], py[i], u)==true)
+            if(inMesh[i])
             {
                 // copy the point values to the matlab array at the
                 // appropriate locations
@@ -308,9 +316,9 @@ int FPProc_interface::getpointvals(int nlhs, mxArray *plhs[], int nrhs, const mx
 
         for(int i=0; i<(int)mxrows; i++)
         {
-            CMPointVals u;
+            CMPointVals &u = pointVals[i];
 
-            if(theFPProc.GetPointValues(px[i], py[i], u)==true)
+            if(inMesh[i])
             {
                 // copy the point values to the matlab array at the
                 // appropriate locations
@@ -727,10 +735,8 @@ int FPProc_interface::clearblock()
 
 int FPProc_interface::blockintegral(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
-    int type;
-
     double *ptype, *outpointerRe, *outpointerIm;
-    size_t mrows, ncols;
+    size_t ntypes;
 
     /* check for proper number of arguments */
     if(nrhs!=3)
@@ -740,23 +746,24 @@ int FPProc_interface::blockintegral(int nlhs, mxArray *plhs[], int nrhs, const m
         mexErrMsgIdAndTxt( "MFEMM:fpproc:maxlhs",
                            "Too many of output arguments.");
 
-    /*  get the dimensions of the matrix input x */
-    mrows = mxGetM(prhs[2]);
-    ncols = mxGetN(prhs[2]);
+    /*  get the number of integral types */
+    ntypes = mxGetNumberOfElements(prhs[2]);
     // check dimensions are allowed
-    if((mrows!=1) | (ncols!=1))
+    if((ntypes<1) | (mxGetM(prhs[2])>1 && mxGetN(prhs[2])>1))
     {
         mexErrMsgIdAndTxt( "MFEMM:fpproc:invalidSizeInputs",
-                           "type must be a scalar.");
+                           "type must be a scalar or a vector.");
     }
 
     // get a pointer to the actual data
     ptype = mxGetPr(prhs[2]);
 
-    // cast the value in the matlab matrix to an integer
-    type = (int) ptype[0];
-
-    CComplex z;
+    // cast the values in the matlab matrix to integers
+    std::vector<int> types(ntypes);
+    for(size_t i=0; i<ntypes; i++)
+    {
+        types[i] = (int) ptype[i];
+    }
 
     bool flg = false;
     for(unsigned int i=0; i<theFPProc.blocklist.size(); i++)
@@ -773,39 +780,67 @@ int FPProc_interface::blockintegral(int nlhs, mxArray *plhs[], int nrhs, const m
                           "Block integral failed, no area has been selected");
     }
 
-    if((type<0) || (type>25))
+    bool needsMask = false;
+    for(size_t i=0; i<ntypes; i++)
     {
-        mexErrMsgIdAndTxt( "MFEMM:fpproc:invalidinttype",
-                           "Invalid block integral type selected %d",type);
-        return 0;
+        if((types[i]<0) || (types[i]>25))
+        {
+            mexErrMsgIdAndTxt( "MFEMM:fpproc:invalidinttype",
+                               "Invalid block integral type selected %d",types[i]);
+            return 0;
+        }
+        if((types[i]>=18) && (types[i]<=23))
+        {
+            needsMask = true;
+        }
     }
 
-    if((type>=18) && (type<=23))
+    if(needsMask)
     {
         theFPProc.MakeMask();
     }
 
-    z = theFPProc.BlockIntegral(type);
+    // all integrals are computed in a single pass over the mesh
+    std::vector<CComplex> z(ntypes);
+    theFPProc.BlockIntegral((int)ntypes, types.data(), z.data());
 
-    if (type == 25)
+    if (ntypes > 1)
+    {
+        // one (possibly complex) value per requested integral,
+        // the 2D block centroid is returned as x + iy
+        bool isreal = true;
+        for(size_t i=0; i<ntypes; i++)
+        {
+            if (z[i].Im() != 0.0) isreal = false;
+        }
+        plhs[0] = mxCreateDoubleMatrix( (mwSize)(1), (mwSize)ntypes, isreal ? mxREAL : mxCOMPLEX);
+        outpointerRe = mxGetPr(plhs[0]);
+        outpointerIm = isreal ? NULL : mxGetPi(plhs[0]);
+        for(size_t i=0; i<ntypes; i++)
+        {
+            outpointerRe[i] = z[i].Re();
+            if (!isreal) outpointerIm[i] = z[i].Im();
+        }
+    }
+    else if (types[0] == 25)
     {
         // 2D block centroid
         /*  set the output pointer to the output matrix */
         plhs[0] = mxCreateDoubleMatrix( (mwSize)(1), (mwSize)(2), mxREAL);
         // get a pointer to the start of the actual output data array
         outpointerRe = mxGetPr(plhs[0]);
-        outpointerRe[0] = z.Re();
-        outpointerRe[1] = z.Im();
+        outpointerRe[0] = z[0].Re();
+        outpointerRe[1] = z[0].Im();
     }
     else
     {
-        if (z.Im() == 0.0)
+        if (z[0].Im() == 0.0)
         {
             /*  set the output pointer to the output matrix */
             plhs[0] = mxCreateDoubleMatrix( (mwSize)(1), (mwSize)(1), mxREAL);
             // get a pointer to the start of the actual output data array
             outpointerRe = mxGetPr(plhs[0]);
-            outpointerRe[0] = z.Re();
+            outpointerRe[0] = z[0].Re();
         }
         else
         {
@@ -814,8 +849,8 @@ int FPProc_interface::blockintegral(int nlhs, mxArray *plhs[], int nrhs, const m
             // get a pointer to the start of the actual output data array
             outpointerRe = mxGetPr(plhs[0]);
             outpointerIm = mxGetPi(plhs[0]);
-            outpointerRe[0] = z.Re();
-            outpointerIm[0] = z.Im();
+            outpointerRe[0] = z[0].Re();
+            outpointerIm[0] = z[0].Im();
         }
     }
 
@@ -1046,7 +1081,7 @@ int FPProc_interface::getcircuitprops(int nlhs, mxArray *plhs[], int nrhs, const
 
     CComplex amps,volts,fluxlinkage;
 
-    amps = theFPProc.circproplist[k].Amps;
+    amps = theFPProc.GetCircuitCurrent(k);
     volts = theFPProc.GetVoltageDrop(k);
     fluxlinkage = theFPProc.GetFluxLinkage(k);
 
@@ -1839,22 +1874,20 @@ int FPProc_interface::getgapb (int nlhs, mxArray *plhs[], int nrhs, const mxArra
     // boundary name (first two are used for the class interface) */
     std::string myBdryName = mxnthargstring (nrhs, prhs, 1, 2);
 
-    /*  get the angle input */
-    double angle = mxnthargscalar (nrhs, prhs, 2, 2);
-
-//#ifdef _MEX_DEBUG
-    mexPrintf("getgapb, requested angle is %g\n", angle);
-//#endif
+    /*  get the angles input, all angles are evaluated in one call */
+    mxtestnumeric (prhs[3], 2);
+    int nangles = (int)mxGetNumberOfElements (prhs[3]);
+    const double *angles = mxGetPr (prhs[3]);
 
-    CComplex br = 0;
-    CComplex bt = 0;
+    std::vector<CComplex> br (nangles);
+    std::vector<CComplex> bt (nangles);
 
-    FPProcError result = theFPProc.getAGEflux(myBdryName, angle, br, bt);
+    FPProcError result = theFPProc.getAGEflux(myBdryName, nangles, angles, br.data (), bt.data ());
 
     checkAGEResult (result, myBdryName);
 
-    mxSetLHS (br, 1, nlhs, plhs);
-    mxSetLHS (bt, 2, nlhs, plhs);
+    mxSetLHS (br, 1, nangles, nlhs, plhs);
+    mxSetLHS (bt, 2, nangles, nlhs, plhs);
 
     return 0;
 
@@ -1880,16 +1913,18 @@ int FPProc_interface::getgapa (int nlhs, mxArray *plhs[], int nrhs, const mxArra
     // boundary name (first two are used for the class interface) */
     std::string myBdryName = mxnthargstring (nrhs, prhs, 1, 2);
 
-    /*  get the angle input */
-    double angle = mxnthargscalar (nrhs, prhs, 2, 2);
+    /*  get the angles input, all angles are evaluated in one call */
+    mxtestnumeric (prhs[3], 2);
+    int nangles = (int)mxGetNumberOfElements (prhs[3]);
+    const double *angles = mxGetPr (prhs[3]);
 
-    CComplex ac = 0;
+    std::vector<CComplex> ac (nangles);
 
-    FPProcError result = theFPProc.getGapA(myBdryName, angle, ac);
+    FPProcError result = theFPProc.getGapA(myBdryName, nangles, angles, ac.data ());
 
     checkAGEResult (result, myBdryName);
 
-    mxSetLHS (ac, 1, nlhs, plhs);
+    mxSetLHS (ac, 1, nangles, nlhs, plhs);
 
     return 0;
 
@@ -1897,6 +1932,37 @@ int FPProc_interface::getgapa (int nlhs, mxArray *plhs[], int nrhs, const mxArra
 
 int FPProc_interface::getgapharmonics (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
+    // with just the boundary name, all harmonics are returned in one call,
+    // followed by the harmonic numbers
+    if(nrhs==3)
+    {
+        if(nlhs != 7)
+        {
+            mexErrMsgIdAndTxt( "MFEMM:fpproc:maxlhs",
+                               "Wrong number of output arguments.");
+        }
+
+        std::string myBdryName = mxnthargstring (nrhs, prhs, 1, 2);
+
+        std::vector<int> nh;
+        std::vector<CComplex> acc, acs, brc, brs, btc, bts;
+
+        FPProcError result = theFPProc.getGapHarmonics(myBdryName, nh, acc, acs, brc, brs, btc, bts);
+
+        checkAGEResult (result, myBdryName);
+
+        int nn = (int)nh.size ();
+        mxSetLHS (acc, 1, nn, nlhs, plhs);
+        mxSetLHS (acs, 2, nn, nlhs, plhs);
+        mxSetLHS (brc, 3, nn, nlhs, plhs);
+        mxSetLHS (brs, 4, nn, nlhs, plhs);
+        mxSetLHS (btc, 5, nn, nlhs, plhs);
+        mxSetLHS (bts, 6, nn, nlhs, plhs);
+        mxSetLHS (nh, 7, nlhs, plhs);
+
+        return 0;
+    }
+
     // check for proper number of arguments (note first two used are for
     // class handle args, real args follow this)
     if(nrhs!=4)
@@ -1967,6 +2033,51 @@ int FPProc_interface::numgapharmonics (int nlhs, mxArray *plhs[], int nrhs, cons
 }
 
 
+int FPProc_interface::rasterize(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    /* check for proper number of arguments */
+    if(nrhs!=8)
+        mexErrMsgIdAndTxt( "MFEMM:fpproc:invalidNumInputs",
+                           "Six inputs required.");
+    else if(nlhs > 1)
+        mexErrMsgIdAndTxt( "MFEMM:fpproc:maxlhs",
+                           "Too many output arguments.");
+
+    double nx = std::floor(mxGetScalar(prhs[6]));
+    double ny = std::floor(mxGetScalar(prhs[7]));
+    if (nx < 1 || ny < 1 || nx*ny > std::numeric_limits<int>::max())
+    {
+        mexErrMsgIdAndTxt( "MFEMM:fpproc:invalidgridsize",
+                           "The number of grid points must be positive.");
+    }
+
+    femm::RasterGrid grid = femm::makeRasterGrid(mxGetScalar(prhs[2]), mxGetScalar(prhs[3]),
+                                                 mxGetScalar(prhs[4]), mxGetScalar(prhs[5]),
+                                                 (int)nx, (int)ny);
+    std::vector<float> values;
+    int numPlanes = theFPProc.RasterizeFields(grid, values);
+
+    // the raster is stored row by row; matlab wants one grid row per matrix row
+    mwSize dims[3] = { (mwSize)grid.ny, (mwSize)grid.nx, (mwSize)numPlanes };
+    plhs[0] = mxCreateNumericArray(3, dims, mxSINGLE_CLASS, mxREAL);
+    float *outpointer = (float*)mxGetData(plhs[0]);
+
+    size_t planeSize = (size_t)grid.size();
+    for (int p = 0; p < numPlanes; p++)
+    {
+        for (int j = 0; j < grid.ny; j++)
+        {
+            for (int i = 0; i < grid.nx; i++)
+            {
+                outpointer[p*planeSize + j + (size_t)i*grid.ny] = values[p*planeSize + i + (size_t)j*grid.nx];
+            }
+        }
+    }
+
+    return 0;
+}
+
+
 void FPProc_interface::checkAGEResult (FPProcError result, std::string boundname)
 {
     switch (result)
@@ -50,6 +50,7 @@ public:
     int getgapa (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
     int getgapharmonics (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
     int numgapharmonics (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+    int rasterize (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
 
 private:
 
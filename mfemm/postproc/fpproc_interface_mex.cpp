@@ -42,6 +42,7 @@ enum ClassMethods { evNotDefined,
                     getgapa,
                     getgapharmonics,
                     numgapharmonics,
+                    rasterize,
                   };
 
 // Map to associate the command strings with the class
@@ -82,6 +83,7 @@ void Initialize()
     s_mapClassMethodStrs["getgapa"]           = getgapa;
     s_mapClassMethodStrs["getgapharmonics"]   = getgapharmonics;
     s_mapClassMethodStrs["numgapharmonics"]   = numgapharmonics;
+    s_mapClassMethodStrs["rasterize"]         = rasterize;
 }
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
@@ -224,6 +226,9 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     case numgapharmonics:
         FPProc_interface_instance->numgapharmonics(nlhs, plhs, nrhs, prhs);
         return;
+    case rasterize:
+        FPProc_interface_instance->rasterize(nlhs, plhs, nrhs, prhs);
+        return;
     default:
         mexErrMsgTxt("Unrecognised class command string.");
         break;
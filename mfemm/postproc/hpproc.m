@@ -52,6 +52,7 @@ classdef hpproc < mfemmpproc
     %    getgroupelements - gets information about mesh elements in groups
     %    getgroupcentroids - gets the centroids of mesh elements in groups
     %    getgroupareas - gets the areas of mesh elements in groups
+    %    rasterize - samples the solution on a regular grid
     %
     
 % Copyright 2012-2014 Richard Crozier
@@ -988,6 +989,35 @@ classdef hpproc < mfemmpproc
         
         end
         
+        function F = rasterize (this, x0, y0, x1, y1, nx, ny)
+            % samples the solution on a regular grid of points
+            %
+            % Syntax
+            %
+            % F = rasterize (x0, y0, x1, y1, nx, ny)
+            %
+            % Input
+            %
+            %   x0, y0, x1, y1 - coordinates of the opposite corners of the
+            %     grid
+            %
+            %   nx, ny - number of grid points in the x and y direction
+            %
+            % Output
+            %
+            %   F - (ny x nx x p) single precision array of solution values,
+            %     with F(j,i,:) at the point (x0 + (i-1)*(x1-x0)/(nx-1),
+            %     y0 + (j-1)*(y1-y0)/(ny-1)), and NaN at points outside the
+            %     mesh. The planes are:
+            %     F(:,:,1) - temperature, T
+            %     F(:,:,2:3) - heat flux, Fx and Fy
+            %     F(:,:,4) - magnitude of the heat flux, |F|
+            %
+            
+            F = hpproc_interface_mex('rasterize', this.objectHandle, x0, y0, x1, y1, nx, ny);
+            
+        end
+        
         function hfig = plotFfield(this, x, y, w, h, varargin)
             % creates a plot of the heat flux vector field
             %
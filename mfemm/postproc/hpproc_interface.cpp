@@ -9,6 +9,9 @@
 #include <string>
 #include <cstring>
 #include <cmath>
+#include <memory>
+#include <vector>
+#include <limits>
 #include "mex.h"
 #include "hpproc.h"
 #include "hpproc_interface.h"
@@ -133,13 +136,17 @@ int HPProc_interface::getpointvals(int nlhs, mxArray *plhs[], int nrhs, const mx
                            "x and y must both be column vectors.");
     }
 
-    if(myrows != myrows)
+    if(mxrows != myrows)
     {
         mexErrMsgIdAndTxt( "MFEMM:hpproc:invalidSizeInputs",
                            "x and y must be column vectors of the same size.");
     }
 
-   
+    // evaluate all points in one batch
+    std::vector<CHPointVals> pointVals(mxrows);
+    std::unique_ptr<bool[]> inMesh(new bool[mxrows]);
+    theHPProc.getPointValues((int)mxrows, px, py, pointVals.data(), inMesh.get());
+
 #ifdef _MEX_DEBUG
         mexPrintf("Frequency was zero.\n");
 #endif
@@ -150,9 +157,9 @@ int HPProc_interface::getpointvals(int nlhs, mxArray *plhs[], int nrhs, const mx
 
     for(int i=0; i<(int)mxrows; i++)
     {
-		 CHPointVals u;
+        CHPointVals &u = pointVals[i];
 
-        if(theHPProc.getPointValues(px[i], py[i], u)==true)
+        if(inMesh[i])
         {
             // copy the point values to the matlab array at the
             // appropriate locations
@@ -1252,6 +1259,50 @@ int HPProc_interface::getgroupvertices(int nlhs, mxArray *plhs[], int nrhs, cons
     return 0;
 }
 
+int HPProc_interface::rasterize(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    /* check for proper number of arguments */
+    if(nrhs!=8)
+        mexErrMsgIdAndTxt( "MFEMM:hpproc:invalidNumInputs",
+                           "Six inputs required.");
+    else if(nlhs > 1)
+        mexErrMsgIdAndTxt( "MFEMM:hpproc:maxlhs",
+                           "Too many output arguments.");
+
+    double nx = std::floor(mxGetScalar(prhs[6]));
+    double ny = std::floor(mxGetScalar(prhs[7]));
+    if (nx < 1 || ny < 1 || nx*ny > std::numeric_limits<int>::max())
+    {
+        mexErrMsgIdAndTxt( "MFEMM:hpproc:invalidgridsize",
+                           "The number of grid points must be positive.");
+    }
+
+    femm::RasterGrid grid = femm::makeRasterGrid(mxGetScalar(prhs[2]), mxGetScalar(prhs[3]),
+                                                 mxGetScalar(prhs[4]), mxGetScalar(prhs[5]),
+                                                 (int)nx, (int)ny);
+    std::vector<float> values;
+    int numPlanes = theHPProc.rasterizeFields(grid, values);
+
+    // the raster is stored row by row; matlab wants one grid row per matrix row
+    mwSize dims[3] = { (mwSize)grid.ny, (mwSize)grid.nx, (mwSize)numPlanes };
+    plhs[0] = mxCreateNumericArray(3, dims, mxSINGLE_CLASS, mxREAL);
+    float *outpointer = (float*)mxGetData(plhs[0]);
+
+    size_t planeSize = (size_t)grid.size();
+    for (int p = 0; p < numPlanes; p++)
+    {
+        for (int j = 0; j < grid.ny; j++)
+        {
+            for (int i = 0; i < grid.nx; i++)
+            {
+                outpointer[p*planeSize + j + (size_t)i*grid.ny] = values[p*planeSize + i + (size_t)j*grid.nx];
+            }
+        }
+    }
+
+    return 0;
+}
+
 
 ///////////////////////////////////////////////////////////////
 /////////////      FUNCTIONS TO BE CONVERTED     //////////////
@@ -44,6 +44,7 @@ public:
     int getgroupvertices (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
     int getgroupcentroids (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
     int getgroupareas (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+    int rasterize (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
     
 // To be created
 //	int addcontour(lua_State * L);
@@ -34,7 +34,8 @@ enum ClassMethods { evNotDefined,
                     getgroupelements,
                     getgroupvertices,
                     getgroupcentroids,
-                    getgroupareas
+                    getgroupareas,
+                    rasterize
                   };
 
 // Map to associate the command strings with the class
@@ -68,6 +69,7 @@ void Initialize()
     s_mapClassMethodStrs["getgroupvertices"]  = getgroupvertices;
     s_mapClassMethodStrs["getgroupcentroids"] = getgroupcentroids;
     s_mapClassMethodStrs["getgroupareas"]     = getgroupareas;
+    s_mapClassMethodStrs["rasterize"]         = rasterize;
 }
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
@@ -189,6 +191,9 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     case getgroupareas:
         HPProc_interface_instance->getgroupareas(nlhs, plhs, nrhs, prhs);
         return;
+    case rasterize:
+        HPProc_interface_instance->rasterize(nlhs, plhs, nrhs, prhs);
+        return;
     default:
         mexErrMsgTxt("Unrecognised class command string.");
         break;
@@ -27,8 +27,12 @@ function libfemm_sources = getlibfemmsources ()
         'fullmatrix.cpp', ...
         'IntPoint.cpp', ...
         'LuaInstance.cpp', ...
+        'nodeOrdering.cpp', ...
+        'parallelTools.cpp', ...
         'PostProcessor.cpp', ...
+        'rasterTools.cpp', ...
         'spars.cpp', ...
+        'spatialIndex.cpp', ...
         'stringTools.cpp', ... 
         };
 